@@ -391,6 +391,53 @@ svn_cache__create_null(svn_cache__t **cache_p,
                        const char *id,
                        apr_pool_t *result_pool);
 
+/**
+ * Creates a new cache in @a *cache_p that keeps its entries in files
+ * below @a directory, such that they survive the current process.  The
+ * directory will be created if necessary and may be shared by multiple
+ * caches and processes.  @a prefix differentiates the entries of this
+ * cache from those of other caches in the same @a directory.  The
+ * elements in the cache will be indexed by keys of length @a klen, which
+ * may be APR_HASH_KEY_STRING if they are strings.  Values will be
+ * serialized using @a serialize_func and deserialized using
+ * @a deserialize_func.
+ *
+ * If @a deserialize_func is NULL, then the data is returned as an
+ * svn_stringbuf_t; if @a serialize_func is NULL, then the data is
+ * assumed to be an svn_stringbuf_t.
+ *
+ * Roughly @a size bytes of disk space will be used at most.  Newer
+ * entries will evict older ones and entries too large for the cache
+ * will be silently dropped.  The cache holds at most one entry per 256kB
+ * of @a size and no more than 4M entries in total.
+ *
+ * Where supported, entries get written to disk in the background.  They
+ * are not guaranteed to be visible to other cache instances until the
+ * pool of this cache got cleaned up.
+ *
+ * If @a memory_cache is not NULL, it will be used as the first level
+ * cache, i.e. all entries will be written to it as well and it will be
+ * consulted before reading from disk.  Entries found on disk only will
+ * be added to it.  Its key and value types must match the ones given
+ * here.
+ *
+ * @a *cache_p will be allocated in @a result_pool.  @a scratch_pool is
+ * used for temporary allocations.
+ *
+ * These caches do not support svn_cache__iter.
+ */
+svn_error_t *
+svn_cache__create_persistent(svn_cache__t **cache_p,
+                             svn_cache__t *memory_cache,
+                             const char *directory,
+                             apr_uint64_t size,
+                             svn_cache__serialize_func_t serialize_func,
+                             svn_cache__deserialize_func_t deserialize_func,
+                             apr_ssize_t klen,
+                             const char *prefix,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
 /**
  * Sets @a handler to be @a cache's error handling routine.  If any
  * error is returned from a call to svn_cache__get or svn_cache__set, @a
@@ -100,6 +100,27 @@ typedef struct svn_fs_fs__histogram_t
   svn_fs_fs__histogram_line_t lines[64];
 } svn_fs_fs__histogram_t;
 
+/* Storage and reconstruction cost of a group of representations.
+ */
+typedef struct svn_fs_fs__cost_info_t
+{
+  /* number of representations */
+  apr_uint64_t count;
+
+  /* total size after deltification (i.e. on disk size) */
+  apr_uint64_t packed_size;
+
+  /* total size after de-deltification (i.e. plain text size) */
+  apr_uint64_t expanded_size;
+
+  /* sum of all representation delta chain lengths, i.e. the number of
+   * deltas to combine when reading each of them once */
+  apr_uint64_t chain_len;
+
+  /* longest delta chain found in this group */
+  apr_uint64_t max_chain_len;
+} svn_fs_fs__cost_info_t;
+
 /* Information we collect per file ending.
  */
 typedef struct svn_fs_fs__extension_info_t
@@ -113,8 +134,24 @@ typedef struct svn_fs_fs__extension_info_t
 
   /* histogram of sizes of changed files */
   svn_fs_fs__histogram_t node_histogram;
+
+  /* cost of the file text representations */
+  svn_fs_fs__cost_info_t cost;
 } svn_fs_fs__extension_info_t;
 
+/* Information we collect per path prefix.
+ */
+typedef struct svn_fs_fs__path_info_t
+{
+  /* The directory the nodes are in, cut off after the configured number
+   * of path segments.  "/" for the root directory. */
+  const char *path;
+
+  /* cost of all representations (text and props of files and
+   * directories) first referenced by nodes below PATH */
+  svn_fs_fs__cost_info_t cost;
+} svn_fs_fs__path_info_t;
+
 /* Compression statistics we collect over a given set of representations.
  */
 typedef struct svn_fs_fs__rep_pack_stats_t
@@ -253,17 +290,36 @@ typedef struct svn_fs_fs__stats_t
 
   /* extension -> svn_fs_fs__extension_info_t* map */
   apr_hash_t *by_extension;
+
+  /* path prefix -> svn_fs_fs__path_info_t* map */
+  apr_hash_t *by_path;
+
+  /* number of revisions that have been taken from the stats cache
+   * instead of being read from the repository */
+  apr_uint64_t cached_revision_count;
 } svn_fs_fs__stats_t;
 
 
 /* Scan all contents of the repository FS and return statistics in *STATS,
  * allocated in RESULT_POOL.  Report progress through PROGRESS_FUNC with
  * PROGRESS_BATON, if PROGRESS_FUNC is not NULL.
+ *
+ * Representation costs will be attributed to the directories containing
+ * the respective nodes, cut off after PATH_DEPTH path segments.
+ *
+ * If CACHE_PATH is not NULL, it names a file that keeps the results for
+ * all packed shards between runs.  Results for shards found in that file
+ * will be used instead of reading the shards again.  The file will be
+ * updated to cover all packed shards when this function returns.  Stale
+ * or otherwise unsuitable caches will simply be ignored.
+ *
  * Use SCRATCH_POOL for temporary allocations.
  */
 svn_error_t *
 svn_fs_fs__get_stats(svn_fs_fs__stats_t **stats,
                      svn_fs_t *fs,
+                     int path_depth,
+                     const char *cache_path,
                      svn_fs_progress_notify_func_t progress_func,
                      void *progress_baton,
                      svn_cancel_func_t cancel_func,
@@ -353,6 +409,79 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                       apr_array_header_t *entries,
                       apr_pool_t *scratch_pool);
 
+/* Results of redeltifying a single pack file, as reported by
+ * svn_fs_fs__redeltify().
+ */
+typedef struct svn_fs_fs__redeltify_info_t
+{
+  /* First revision in the shard. */
+  svn_revnum_t shard_rev;
+
+  /* Number of file representations in the shard. */
+  apr_uint64_t rep_count;
+
+  /* Number of file representations that got re-encoded. */
+  apr_uint64_t redeltified_count;
+
+  /* Sum of the delta chain lengths of all file representations in the
+   * shard, i.e. the number of deltas to combine when reading each of
+   * them once, before and after the operation. */
+  apr_uint64_t chain_len_before;
+  apr_uint64_t chain_len_after;
+
+  /* Longest delta chain of any file representation in the shard before
+   * and after the operation. */
+  apr_uint64_t max_chain_len_before;
+  apr_uint64_t max_chain_len_after;
+
+  /* Size of the pack file contents, excluding the indexes, before and
+   * after the operation. */
+  apr_uint64_t size_before;
+  apr_uint64_t size_after;
+} svn_fs_fs__redeltify_info_t;
+
+/* Callback function type receiving the results INFO for a single shard,
+ * a user provided BATON and a SCRATCH_POOL for temporary allocations.
+ */
+typedef void
+(*svn_fs_fs__redeltify_notify_t)(const svn_fs_fs__redeltify_info_t *info,
+                                 void *baton,
+                                 apr_pool_t *scratch_pool);
+
+/* Rewrite all packed shards in FS that contain revisions between
+ * START_REV and END_REV, re-encoding file representations against the
+ * skip-delta base of their respective node.  Representations are only
+ * replaced if that shortens their delta chain or, for equal length,
+ * reduces their size.  The contents and checksums of all nodes remain
+ * unchanged.  The indexes of the new pack files get regenerated and the
+ * rep-cache will be updated.
+ *
+ * Representations referenced from revisions after END_REV's shard cannot
+ * be changed and will be kept as they are.  Once all shards have been
+ * processed, the old pack files get replaced and the FS instance ID
+ * changes, such that caches will not return stale data.  Processes that
+ * keep FS open, e.g. servers, must be restarted afterwards.
+ *
+ * Replacing the pack files and updating the rep-cache is journaled.  If
+ * the operation gets interrupted at that stage, the next svn_fs_open()
+ * of the repository will complete it.
+ *
+ * The operation requires logical addressing and fails if there are any
+ * outstanding transactions in FS.  Call NOTIFY_FUNC with NOTIFY_BATON,
+ * if not NULL, for every shard once its new pack file has been written.
+ * If not NULL, call CANCEL_FUNC with CANCEL_BATON from time to time.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__redeltify(svn_fs_t *fs,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_fs_fs__redeltify_notify_t notify_func,
+                     void *notify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
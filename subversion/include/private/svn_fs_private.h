@@ -211,6 +211,22 @@ svn_fs__get_deleted_node(svn_fs_root_t **node_root,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
+/** Like svn_fs_hotcopy3(), but copy from the already open filesystem
+ * @a src_fs.  Copying repeatedly from the same @a src_fs saves the cost
+ * of opening the source, i.e. of reading its format and configuration,
+ * each time.
+ */
+svn_error_t *
+svn_fs__hotcopy_from(svn_fs_t *src_fs,
+                     const char *dst_path,
+                     svn_boolean_t clean,
+                     svn_boolean_t incremental,
+                     svn_fs_hotcopy_notify_t notify_func,
+                     void *notify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
 
 /** @} */
 
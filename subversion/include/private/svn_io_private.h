@@ -85,6 +85,115 @@ svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
 
+/** Copy the contents of @a from_file to @a to_file.  @a from_file must
+ * be at its start and nothing may have been written to @a to_file, yet.
+ *
+ * Where supported, the operating system performs the copy without passing
+ * the data through user space and file systems that support reflinks will
+ * let both files share their data blocks.
+ *
+ * If @a cancel_func is not @c NULL, call it with @a cancel_baton at
+ * regular intervals during the copy.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_copy_contents(apr_file_t *from_file,
+                           apr_file_t *to_file,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool);
+
+/** Like svn_io_copy_file(), but if @a cancel_func is not @c NULL, call it
+ * with @a cancel_baton at regular intervals while copying the contents.
+ */
+svn_error_t *
+svn_io__copy_file(const char *src,
+                  const char *dst,
+                  svn_boolean_t copy_perms,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *pool);
+
+/** Tell the operating system that we are about to read @a length bytes
+ * starting at @a offset from @a file, so it can start fetching them from
+ * disk asynchronously.  This is a no-op where not supported.
+ *
+ * The OS may read all of the range right away, so callers should limit
+ * @a length to what they are actually going to read soon.
+ */
+void
+svn_io__file_prefetch(apr_file_t *file,
+                      apr_off_t offset,
+                      apr_off_t length);
+
+/** Tell the operating system that we will not read the @a length bytes
+ * starting at @a offset from @a file again soon, so it may drop them from
+ * its page cache.  A @a length of 0 means "up to the end of the file".
+ * This is a no-op where not supported.
+ */
+void
+svn_io__file_evict(apr_file_t *file,
+                   apr_off_t offset,
+                   apr_off_t length);
+
+/** Like svn_io__file_prefetch but for the @a length bytes of memory-mapped
+ * file contents starting at @a data.
+ */
+void
+svn_io__memory_prefetch(const void *data,
+                        apr_size_t length);
+
+/** Watches a set of files and folders for modifications.
+ * @see svn_io__file_watch_create()
+ */
+typedef struct svn_io__file_watch_t svn_io__file_watch_t;
+
+/** Start watching the files and folders given as <tt>const char *</tt>
+ * in @a paths for modifications and return the watch in @a *watch.
+ * Writing a file as well as replacing it, e.g. by renaming another file
+ * onto its path, counts as a modification.  For folders, adding, removing
+ * or renaming their entries counts as well.  Changes to other files in
+ * the same parent folders are ignored.
+ *
+ * Where the OS can notify us about changes, use that.  Otherwise, fall
+ * back to polling the modification time, size and inode number of all
+ * @a paths.  The @a paths do not need to exist.
+ *
+ * The watch lives in @a result_pool and releases all OS resources when
+ * that pool gets cleaned up.  Use @a scratch_pool for temporaries.
+ */
+svn_error_t *
+svn_io__file_watch_create(svn_io__file_watch_t **watch,
+                          const apr_array_header_t *paths,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/** Wait for at most @a timeout for any of the paths watched by @a watch
+ * to get modified.  Set @a *changed to TRUE if one has been modified since
+ * the watch was created or since the last call that set @a *changed to
+ * TRUE, respectively.  Return immediately in that case.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_watch_wait(svn_boolean_t *changed,
+                        svn_io__file_watch_t *watch,
+                        apr_interval_time_t timeout,
+                        apr_pool_t *scratch_pool);
+
+/** Write all modified data that the OS caches for the file system that
+ * contains @a path to disk.  Unlike calling fsync on individual files,
+ * this covers any number of files with a single request.
+ *
+ * Where flushing a single file system is not supported, flush all of
+ * them.  Return #SVN_ERR_UNSUPPORTED_FEATURE if neither is possible,
+ * e.g. on Windows.  Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__flush_file_system(const char *path,
+                          apr_pool_t *scratch_pool);
+
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
  */
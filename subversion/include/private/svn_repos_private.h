@@ -349,6 +349,21 @@ svn_repos__dump_node_record(svn_stream_t *dump_stream,
                             svn_boolean_t content_length_always,
                             apr_pool_t *scratch_pool);
 
+/** Like svn_repos_hotcopy3(), but copy from the already open repository
+ * @a src_repos.  Copying repeatedly from the same @a src_repos saves the
+ * cost of opening the source filesystem each time.
+ */
+svn_error_t *
+svn_repos__hotcopy_from(svn_repos_t *src_repos,
+                        const char *dst_path,
+                        svn_boolean_t clean_logs,
+                        svn_boolean_t incremental,
+                        svn_repos_notify_func_t notify_func,
+                        void *notify_baton,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton,
+                        apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -133,6 +133,17 @@ svn_sqlite__open(svn_sqlite__db_t **db, const char *path,
 svn_error_t *
 svn_sqlite__close(svn_sqlite__db_t *db);
 
+/* Let SQLite read the pages of the database in DB through a shared memory
+   mapping instead of copying them into a private page cache.
+
+   Only use this for databases on local storage that are not going to be
+   truncated by other processes, e.g. the repository's rep-cache.db.  If
+   the file gets truncated underneath a mapping, the process receives a
+   SIGBUS instead of an I/O error.  This rules out working copy databases,
+   which commonly live on network file systems. */
+svn_error_t *
+svn_sqlite__enable_mmap(svn_sqlite__db_t *db);
+
 /* Add a custom function to be used with this database connection.  The data
    in BATON should live at least as long as the connection in DB.
 
@@ -250,7 +250,14 @@ typedef enum svn_repos_notify_action_t
   svn_repos_notify_pack_noop,
 
   /** The revision properties got set. @since New in 1.10. */
-  svn_repos_notify_load_revprop_set
+  svn_repos_notify_load_revprop_set,
+
+  /** A revision has been read into the caches. @since New in 1.11. */
+  svn_repos_notify_warm_cache_rev_end,
+
+  /** The cache warm-up stopped because the budget has been used up.
+   * @since New in 1.11. */
+  svn_repos_notify_warm_cache_full
 } svn_repos_notify_action_t;
 
 /** The type of warning occurring.
@@ -3276,6 +3283,63 @@ svn_repos_verify_fs(svn_repos_t *repos,
                     void *cancel_baton,
                     apr_pool_t *pool);
 
+/**
+ * Read the nodes within the @a paths trees of @a repos, such that the
+ * repository caches will be populated with their directory listings,
+ * properties and file contents.  If @a contents_only is set, don't read
+ * any properties.  Use this to avoid slow responses after a server
+ * restart.  @a paths is an array of <tt>const char *</tt>
+ * repository paths.  If it is @c NULL or empty, cover the whole tree.
+ *
+ * Read the full trees in @a end_rev and for all revisions from
+ * @a start_rev up to, but not including, @a end_rev only the nodes that
+ * got changed in that revision.  Revisions are read in descending order.
+ * If @a end_rev is #SVN_INVALID_REVNUM, use the youngest revision.  If
+ * @a start_rev is #SVN_INVALID_REVNUM, only read @a end_rev.
+ *
+ * Stop once approximately @a budget bytes have been added to the
+ * in-memory cache.  If @a budget is 0, use the configured size of the
+ * in-memory cache as budget.  Without an in-memory cache, stop after
+ * reading @a budget bytes of data instead.
+ *
+ * If @a notify_func is not null, then call it with @a notify_baton and
+ * with a notification structure in which the fields are set as follows.
+ *
+ *   For each revision read:
+ *      @c action = svn_repos_notify_warm_cache_rev_end
+ *      @c revision = the revision
+ *
+ *   If the budget got used up:
+ *      @c action = svn_repos_notify_warm_cache_full
+ *      @c revision = the last revision read (partially)
+ *
+ * If @a cancel_func is not @c NULL, call it periodically with @a
+ * cancel_baton as argument to see if the caller wishes to cancel the
+ * operation.
+ *
+ * Use @a scratch_pool for temporary allocation.
+ *
+ * @note The caches are local to the current process.  Only file contents
+ * and delta windows may also be stored in memcached or the persistent
+ * cache, if the repository has been configured to use them.  Only those
+ * remain useful to other processes, so callers that don't warm the
+ * caches of the current process should set @a contents_only.
+ *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_repos_warm_cache(svn_repos_t *repos,
+                     const apr_array_header_t *paths,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     apr_uint64_t budget,
+                     svn_boolean_t contents_only,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool);
+
 /**
  * Dump the contents of the filesystem within already-open @a repos into
  * writable @a dumpstream.  If @a dumpstream is
@@ -644,31 +644,16 @@ svn_fs_delete_fs(const char *path, apr_pool_t *pool)
   return svn_error_trace(vtable->delete_fs(path, pool));
 }
 
-svn_error_t *
-svn_fs_hotcopy3(const char *src_path, const char *dst_path,
-                svn_boolean_t clean, svn_boolean_t incremental,
-                svn_fs_hotcopy_notify_t notify_func,
-                void *notify_baton,
-                svn_cancel_func_t cancel_func,
-                void *cancel_baton,
-                apr_pool_t *scratch_pool)
+/* Verify that DST_PATH may receive a hotcopy of a filesystem of type
+ * SRC_FS_TYPE.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+check_hotcopy_dst(const char *dst_path,
+                  const char *src_fs_type,
+                  apr_pool_t *scratch_pool)
 {
-  fs_library_vtable_t *vtable;
-  const char *src_fs_type;
-  svn_fs_t *src_fs;
-  svn_fs_t *dst_fs;
   const char *dst_fs_type;
   svn_node_kind_t dst_kind;
 
-  if (strcmp(src_path, dst_path) == 0)
-    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
-                             _("Hotcopy source and destination are equal"));
-
-  SVN_ERR(svn_fs_type(&src_fs_type, src_path, scratch_pool));
-  SVN_ERR(get_library_vtable(&vtable, src_fs_type, scratch_pool));
-  src_fs = fs_new(NULL, scratch_pool);
-  dst_fs = fs_new(NULL, scratch_pool);
-
   SVN_ERR(svn_io_check_path(dst_path, &dst_kind, scratch_pool));
   if (dst_kind == svn_node_file)
     return svn_error_createf(SVN_ERR_NODE_UNEXPECTED_KIND, NULL,
@@ -702,6 +687,34 @@ svn_fs_hotcopy3(const char *src_path, const char *dst_path,
         }
     }
 
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_hotcopy3(const char *src_path, const char *dst_path,
+                svn_boolean_t clean, svn_boolean_t incremental,
+                svn_fs_hotcopy_notify_t notify_func,
+                void *notify_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool)
+{
+  fs_library_vtable_t *vtable;
+  const char *src_fs_type;
+  svn_fs_t *src_fs;
+  svn_fs_t *dst_fs;
+
+  if (strcmp(src_path, dst_path) == 0)
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Hotcopy source and destination are equal"));
+
+  SVN_ERR(svn_fs_type(&src_fs_type, src_path, scratch_pool));
+  SVN_ERR(get_library_vtable(&vtable, src_fs_type, scratch_pool));
+  src_fs = fs_new(NULL, scratch_pool);
+  dst_fs = fs_new(NULL, scratch_pool);
+
+  SVN_ERR(check_hotcopy_dst(dst_path, src_fs_type, scratch_pool));
+
   SVN_ERR(vtable->hotcopy(src_fs, dst_fs, src_path, dst_path, clean,
                           incremental, notify_func, notify_baton,
                           cancel_func, cancel_baton, common_pool_lock,
@@ -709,6 +722,39 @@ svn_fs_hotcopy3(const char *src_path, const char *dst_path,
   return svn_error_trace(write_fs_type(dst_path, src_fs_type, scratch_pool));
 }
 
+svn_error_t *
+svn_fs__hotcopy_from(svn_fs_t *src_fs,
+                     const char *dst_path,
+                     svn_boolean_t clean,
+                     svn_boolean_t incremental,
+                     svn_fs_hotcopy_notify_t notify_func,
+                     void *notify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  fs_library_vtable_t *vtable;
+  const char *src_fs_type;
+  svn_fs_t *dst_fs;
+
+  if (strcmp(src_fs->path, dst_path) == 0)
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Hotcopy source and destination are equal"));
+
+  SVN_ERR(svn_fs_type(&src_fs_type, src_fs->path, scratch_pool));
+  SVN_ERR(get_library_vtable(&vtable, src_fs_type, scratch_pool));
+  dst_fs = fs_new(NULL, scratch_pool);
+
+  SVN_ERR(check_hotcopy_dst(dst_path, src_fs_type, scratch_pool));
+
+  /* The back-end will notice that SRC_FS is open already. */
+  SVN_ERR(vtable->hotcopy(src_fs, dst_fs, src_fs->path, dst_path, clean,
+                          incremental, notify_func, notify_baton,
+                          cancel_func, cancel_baton, common_pool_lock,
+                          scratch_pool, common_pool));
+  return svn_error_trace(write_fs_type(dst_path, src_fs_type, scratch_pool));
+}
+
 svn_error_t *
 svn_fs_pack(const char *path,
             svn_fs_pack_notify_t notify_func,
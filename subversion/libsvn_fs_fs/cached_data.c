@@ -484,9 +484,10 @@ get_node_revision_body(node_revision_t **noderev_p,
       else
         {
           /* physical addressing mode reading, parsing and caching */
-          SVN_ERR(svn_fs_fs__read_noderev(noderev_p,
-                                          revision_file->stream,
-                                          result_pool,
+          svn_stream_t *stream;
+          SVN_ERR(svn_fs_fs__rev_file_stream(&stream, revision_file,
+                                             scratch_pool));
+          SVN_ERR(svn_fs_fs__read_noderev(noderev_p, stream, result_pool,
                                           scratch_pool));
           SVN_ERR(fixup_node_revision(fs, *noderev_p, scratch_pool));
 
@@ -808,9 +809,8 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
   if (rs->ver == -1)
     {
       char buf[4];
-      SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, pool));
-      SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                     sizeof(buf), NULL, NULL, pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf, sizeof(buf),
+                                       NULL, rs->start, pool));
 
       /* ### Layering violation */
       if (! ((buf[0] == 'S') && (buf[1] == 'V') && (buf[2] == 'N')))
@@ -1422,6 +1422,198 @@ set_cached_combined_window(svn_stringbuf_t *window,
   return SVN_NO_ERROR;
 }
 
+/* A section of a rev / pack file that we are about to read. */
+typedef struct prefetch_range_t
+{
+  apr_file_t *file;
+  apr_off_t offset;
+  apr_off_t length;
+} prefetch_range_t;
+
+/* Reads within the same file that are no more than this many bytes apart
+   will be prefetched as a single range. */
+#define PREFETCH_MAX_GAP 0x10000
+
+/* Prefetch at most this many blocks from the start of each rep.  The
+   windows of all reps in a chain get combined in lock-step, so we need
+   the beginning of each rep first.  The OS' own read-ahead will take
+   care of the rest once we read sequentially. */
+#define PREFETCH_MAX_REP_BLOCKS 4
+
+/* Upper limit to the total number of bytes prefetched for a single delta
+   chain.  Long chains would otherwise flood the OS cache with data that
+   may get evicted again before we get to read it. */
+#define PREFETCH_MAX_TOTAL 0x400000
+
+/* A svn_sort__array compatible comparator function, sorting the
+ * prefetch_range_t elements by file and offset. */
+static int
+compare_prefetch_ranges(const void *lhs,
+                        const void *rhs)
+{
+  const prefetch_range_t *lhs_range = lhs;
+  const prefetch_range_t *rhs_range = rhs;
+
+  if (lhs_range->file != rhs_range->file)
+    return (apr_uintptr_t)lhs_range->file < (apr_uintptr_t)rhs_range->file
+         ? -1 : 1;
+
+  if (lhs_range->offset != rhs_range->offset)
+    return lhs_range->offset < rhs_range->offset ? -1 : 1;
+
+  return 0;
+}
+
+/* Set the START offsets of all COUNT rep_state_t in STATES that don't
+   have them, yet.  Reps that share the same rev / pack file get resolved
+   by a single index lookup.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+set_start_offsets(rep_state_t **states,
+                  int count,
+                  apr_pool_t *scratch_pool)
+{
+  rep_state_t **batch = apr_palloc(scratch_pool, count * sizeof(*batch));
+  svn_fs_fs__id_part_t *items = apr_palloc(scratch_pool,
+                                           count * sizeof(*items));
+  apr_off_t *offsets = apr_palloc(scratch_pool, count * sizeof(*offsets));
+  int i, k;
+
+  for (i = 0; i < count; ++i)
+    {
+      shared_file_t *sfile = states[i]->sfile;
+      int batch_size = 0;
+
+      if (states[i]->start != -1)
+        continue;
+
+      /* Collect all reps from the same file that still lack their offset.
+         Delta chains are short, so the quadratic runtime doesn't matter. */
+      for (k = i; k < count; ++k)
+        if (states[k]->sfile == sfile && states[k]->start == -1)
+          {
+            batch[batch_size] = states[k];
+            items[batch_size].revision = states[k]->revision;
+            items[batch_size].number = states[k]->item_index;
+            ++batch_size;
+          }
+
+      SVN_ERR(auto_open_shared_file(sfile));
+      SVN_ERR(svn_fs_fs__item_offsets(offsets, sfile->fs, sfile->rfile,
+                                      items, batch_size, scratch_pool));
+
+      for (k = 0; k < batch_size; ++k)
+        batch[k]->start = offsets[k] + batch[k]->header_size;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Tell the OS about all the data in LIST (an array of rep_state_t *)
+   and the optional SRC_STATE that we are going to read, so it can
+   fetch the start of the delta chain from disk in the background.  Reps
+   whose windows are already cached are skipped.  Close reads within the
+   same pack file are combined.  Hint at no more than
+   PREFETCH_MAX_REP_BLOCKS blocks per rep and PREFETCH_MAX_TOTAL bytes in
+   total.  Use SCRATCH_POOL for temporary allocations.
+
+   This resolves the file offsets for all reps, which we would otherwise
+   do one after another while combining the first window. */
+static svn_error_t *
+prefetch_rep_list(apr_array_header_t *list,
+                  rep_state_t *src_state,
+                  apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *ranges;
+  rep_state_t **states;
+  prefetch_range_t current;
+  fs_fs_data_t *ffd;
+  apr_off_t max_rep_length;
+  apr_off_t budget = PREFETCH_MAX_TOTAL;
+  int i;
+  int count = list->nelts + (src_state ? 1 : 0);
+
+  /* There is nothing to combine for chains of length 1. */
+  if (count < 2)
+    return SVN_NO_ERROR;
+
+  /* Reps that we need to read. */
+  states = apr_palloc(scratch_pool, count * sizeof(*states));
+  for (i = 0; i < count; ++i)
+    states[i] = i < list->nelts ? APR_ARRAY_IDX(list, i, rep_state_t *)
+                                : src_state;
+
+  ffd = states[0]->sfile->fs->fsap_data;
+  max_rep_length = (apr_off_t)ffd->block_size * PREFETCH_MAX_REP_BLOCKS;
+
+  ranges = apr_array_make(scratch_pool, count, sizeof(prefetch_range_t));
+  for (i = 0; i < count; ++i)
+    {
+      rep_state_t *rs = states[i];
+      prefetch_range_t *range;
+
+      if (rs->window_cache)
+        {
+          window_cache_key_t key = { 0 };
+          svn_boolean_t is_cached;
+
+          SVN_ERR(svn_cache__has_key(&is_cached, rs->window_cache,
+                                     get_window_key(&key, rs),
+                                     scratch_pool));
+          if (is_cached)
+            continue;
+        }
+
+      states[ranges->nelts] = rs;
+      range = apr_array_push(ranges);
+      range->length = MIN((apr_off_t)rs->size, max_rep_length);
+    }
+
+  if (ranges->nelts == 0)
+    return SVN_NO_ERROR;
+
+  /* Now that we know which reps to read, resolve their offsets in bulk
+     and fill in the ranges. */
+  SVN_ERR(set_start_offsets(states, ranges->nelts, scratch_pool));
+  for (i = 0; i < ranges->nelts; ++i)
+    {
+      prefetch_range_t *range = &APR_ARRAY_IDX(ranges, i, prefetch_range_t);
+      range->file = states[i]->sfile->rfile->file;
+      range->offset = states[i]->start;
+    }
+
+  svn_sort__array(ranges, compare_prefetch_ranges);
+
+  current = APR_ARRAY_IDX(ranges, 0, prefetch_range_t);
+  for (i = 1; i < ranges->nelts; ++i)
+    {
+      const prefetch_range_t *next = &APR_ARRAY_IDX(ranges, i,
+                                                    prefetch_range_t);
+      if (   next->file == current.file
+          && next->offset <= current.offset + current.length
+                             + PREFETCH_MAX_GAP)
+        {
+          current.length = MAX(current.length,
+                               next->offset + next->length - current.offset);
+        }
+      else
+        {
+          svn_io__file_prefetch(current.file, current.offset,
+                                MIN(current.length, budget));
+          budget -= current.length;
+          if (budget <= 0)
+            return SVN_NO_ERROR;
+
+          current = *next;
+        }
+    }
+
+  svn_io__file_prefetch(current.file, current.offset,
+                        MIN(current.length, budget));
+
+  return SVN_NO_ERROR;
+}
+
 /* Build an array of rep_state structures in *LIST giving the delta
    reps from first_rep to a plain-text or self-compressed rep.  Set
    *SRC_STATE to the plain-text rep we find at the end of the chain,
@@ -1499,6 +1691,11 @@ build_rep_list(apr_array_header_t **list,
 
       rs = NULL;
     }
+
+  /* Now that we know the whole chain, don't make the OS read it piecemeal.
+     A cached base window does not need to be read, of course. */
+  SVN_ERR(prefetch_rep_list(*list, is_cached ? NULL : *src_state,
+                            iterpool));
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
@@ -1647,12 +1844,11 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
   SVN_ERR(auto_set_start_offset(rs, scratch_pool));
 
   offset = rs->start + rs->current;
-  SVN_ERR(rs_aligned_seek(rs, NULL, offset, scratch_pool));
 
   /* Read the plain data. */
   *nwin = svn_stringbuf_create_ensure(size, result_pool);
-  SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, (*nwin)->data, size,
-                                 NULL, NULL, result_pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, (*nwin)->data, size,
+                                   NULL, offset, scratch_pool));
   (*nwin)->data[size] = 0;
 
   /* Update RS. */
@@ -1839,9 +2035,8 @@ get_contents_from_windows(struct rep_read_baton *rb,
           SVN_ERR(auto_set_start_offset(rs, rb->pool));
 
           offset = rs->start + rs->current;
-          SVN_ERR(rs_aligned_seek(rs, NULL, offset, rb->pool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, cur,
-                                         copy_len, NULL, NULL, rb->pool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, cur, copy_len,
+                                           NULL, offset, rb->pool));
         }
 
       rs->current += copy_len;
@@ -3337,9 +3532,8 @@ cache_windows(svn_fs_t *fs,
 
           /* Read the raw window. */
           buf = apr_palloc(iterpool, window_len + 1);
-          SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, iterpool));
-          SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, buf,
-                                         window_len, NULL, NULL, iterpool));
+          SVN_ERR(svn_fs_fs__rev_file_read(rs->sfile->rfile, buf, window_len,
+                                           NULL, start_offset, iterpool));
           buf[window_len] = 0;
 
           /* update relative offset in representation */
@@ -3415,12 +3609,10 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
       /* for larger reps, the header may have crossed a block boundary.
        * make sure we still read blocks properly aligned, i.e. don't use
        * plain seek here. */
-      SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
-
       plaintext = svn_stringbuf_create_ensure(rs.size, result_pool);
-      SVN_ERR(svn_io_file_read_full2(rev_file->file, plaintext->data,
-                                     rs.size, &plaintext->len, NULL,
-                                     result_pool));
+      SVN_ERR(svn_fs_fs__rev_file_read(rev_file, plaintext->data, rs.size,
+                                       &plaintext->len, offset,
+                                       scratch_pool));
       plaintext->data[plaintext->len] = 0;
       rs.current += rs.size;
 
@@ -3515,8 +3707,8 @@ read_item(svn_stream_t **stream,
   svn_stringbuf_t *text = svn_stringbuf_create_ensure(entry->size, pool);
   text->len = entry->size;
   text->data[text->len] = 0;
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, text->data, text->len,
-                                 NULL, NULL, pool));
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, text->data, text->len, NULL,
+                                   entry->offset, pool));
 
   /* Return (construct, calculate) stream and checksum. */
   *stream = svn_stream_from_stringbuf(text, pool);
@@ -3718,6 +3910,20 @@ block_read(void **result,
                                           ffd->block_size, scratch_pool,
                                           scratch_pool));
 
+      /* Mapped pages get faulted in one by one.  The index tells us which
+       * range we are about to read, so request all of it at once. */
+      if (revision_file->mapped_data && entries->nelts)
+        {
+          svn_fs_fs__p2l_entry_t *first
+            = &APR_ARRAY_IDX(entries, 0, svn_fs_fs__p2l_entry_t);
+          svn_fs_fs__p2l_entry_t *last
+            = &APR_ARRAY_IDX(entries, entries->nelts - 1,
+                             svn_fs_fs__p2l_entry_t);
+          svn_fs_fs__rev_file_prefetch(revision_file, first->offset,
+                                       last->offset + last->size
+                                         - first->offset);
+        }
+
       SVN_ERR(aligned_seek(fs, revision_file->file, &block_start, offset,
                            iterpool));
 
@@ -31,6 +31,7 @@
 
 #include "svn_config.h"
 #include "svn_cache_config.h"
+#include "svn_dirent_uri.h"
 
 #include "svn_private_config.h"
 #include "svn_hash.h"
@@ -346,16 +347,53 @@ create_cache(svn_cache__t **cache_p,
   return SVN_NO_ERROR;
 }
 
+/* If FS has been configured to use an on-disk cache, replace *CACHE_P
+ * with a cache that uses the original *CACHE_P as its first level and
+ * persists all entries to disk.  *CACHE_P may be NULL.  The cache values
+ * are svn_stringbuf_t and keys are of size KLEN.  Use PREFIX to identify
+ * the cache contents.
+ *
+ * Unless NO_HANDLER is true, register an error handler that reports errors
+ * as warnings to the FS warning callback.
+ *
+ * Cache is allocated in RESULT_POOL, temporaries in SCRATCH_POOL.
+ */
+static svn_error_t *
+make_persistent(svn_cache__t **cache_p,
+                apr_ssize_t klen,
+                const char *prefix,
+                svn_fs_t *fs,
+                svn_boolean_t no_handler,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->persistent_cache_path == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__create_persistent(cache_p, *cache_p,
+                                       ffd->persistent_cache_path,
+                                       ffd->persistent_cache_size,
+                                       NULL, NULL, klen, prefix,
+                                       result_pool, scratch_pool));
+
+  /* Failing to access the disk is not a reason to fail the request. */
+  SVN_ERR(init_callbacks(*cache_p, fs,
+                         no_handler ? NULL
+                                    : warn_and_continue_on_cache_errors,
+                         result_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__initialize_caches(svn_fs_t *fs,
                              apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
-  const char *prefix = apr_pstrcat(pool,
-                                   "fsfs:", fs->uuid,
-                                   "/", normalize_key_part(fs->path, pool),
-                                   ":",
-                                   SVN_VA_NULL);
+  const char *prefix;
+  const char *fs_abspath;
   svn_membuffer_t *membuffer;
   svn_boolean_t no_handler = ffd->fail_stop;
   svn_boolean_t cache_txdeltas;
@@ -372,7 +410,21 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                       fs,
                       pool));
 
-  prefix = apr_pstrcat(pool, "ns:", cache_namespace, ":", prefix, SVN_VA_NULL);
+  /* Caches may be shared between processes, e.g. when using memcached or
+     a persistent cache.  Those processes may refer to the repository by
+     different paths, so key it by its absolute path.
+
+     The same path may be reused for a different repository with the same
+     UUID, e.g. after a dump / load cycle, and redeltify or recover rewrite
+     existing revisions in place.  Both change the instance ID, so include
+     it as well.  Older formats use the UUID instead. */
+  SVN_ERR(svn_dirent_get_absolute(&fs_abspath, fs->path, pool));
+  prefix = apr_pstrcat(pool,
+                       "ns:", cache_namespace, ":",
+                       "fsfs:", fs->uuid, ":", ffd->instance_id,
+                       "/", normalize_key_part(fs_abspath, pool),
+                       ":",
+                       SVN_VA_NULL);
   has_namespace = strlen(cache_namespace) > 0;
 
   membuffer = svn_cache__get_global_membuffer_cache();
@@ -546,6 +598,10 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(make_persistent(&(ffd->fulltext_cache),
+                              sizeof(pair_cache_key_t),
+                              apr_pstrcat(pool, prefix, "TEXT", SVN_VA_NULL),
+                              fs, no_handler, fs->pool, pool));
 
       SVN_ERR(create_cache(&(ffd->mergeinfo_cache),
                            NULL,
@@ -654,6 +710,11 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+      SVN_ERR(make_persistent(&(ffd->combined_window_cache),
+                              sizeof(window_cache_key_t),
+                              apr_pstrcat(pool, prefix, "COMBINED_WINDOW",
+                                          SVN_VA_NULL),
+                              fs, no_handler, fs->pool, pool));
     }
   else
     {
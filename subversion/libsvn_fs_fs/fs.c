@@ -40,6 +40,7 @@
 #include "id.h"
 #include "pack.h"
 #include "recovery.h"
+#include "redeltify.h"
 #include "rep-cache.h"
 #include "revprops.h"
 #include "transaction.h"
@@ -54,6 +55,10 @@
    per-filesystem shared data.  See fs_serialized_init. */
 #define SVN_FSFS_SHARED_USERDATA_PREFIX "svn-fsfs-shared-"
 
+/* The pool userdata key for the process-wide open info pool.
+   See get_open_info_pool. */
+#define SVN_FSFS_OPEN_INFO_USERDATA_KEY "svn-fsfs-open-info-pool"
+
 
 
 /* Initialize the part of FS that requires global serialization across all
@@ -336,6 +341,38 @@ fs_create(svn_fs_t *fs,
 
 /* Gaining access to an existing filesystem.  */
 
+/* Set *OPEN_INFO_POOL to the process-wide object pool that shares the
+   repository meta data between all FSFS instances, creating it in
+   COMMON_POOL upon first use.  The caller is responsible for serializing
+   the access to COMMON_POOL. */
+static svn_error_t *
+get_open_info_pool(svn_object_pool__t **open_info_pool,
+                   apr_pool_t *common_pool)
+{
+  void *val;
+  apr_status_t status;
+
+  status = apr_pool_userdata_get(&val, SVN_FSFS_OPEN_INFO_USERDATA_KEY,
+                                 common_pool);
+  if (status)
+    return svn_error_create(status, NULL,
+                            _("Can't fetch FSFS open info pool"));
+
+  if (!val)
+    {
+      SVN_ERR(svn_object_pool__create((svn_object_pool__t **)&val, TRUE,
+                                      common_pool));
+      status = apr_pool_userdata_set(val, SVN_FSFS_OPEN_INFO_USERDATA_KEY,
+                                     NULL, common_pool);
+      if (status)
+        return svn_error_create(status, NULL,
+                                _("Can't store FSFS open info pool"));
+    }
+
+  *open_info_pool = val;
+  return SVN_NO_ERROR;
+}
+
 /* This implements the fs_library_vtable_t.open() API.  Open an FSFS
    Subversion filesystem located at PATH, set *FS to point to the
    correct vtable for the filesystem.  Use POOL for any temporary
@@ -349,17 +386,29 @@ fs_open(svn_fs_t *fs,
         apr_pool_t *common_pool)
 {
   apr_pool_t *subpool = svn_pool_create(scratch_pool);
+  fs_fs_data_t *ffd;
 
   SVN_ERR(svn_fs__check_fs(fs, FALSE));
 
   SVN_ERR(initialize_fs_struct(fs));
 
+  /* Repeated opens of the same repository don't need to re-read and
+     re-parse the various meta data files. */
+  ffd = fs->fsap_data;
+  SVN_MUTEX__WITH_LOCK(common_pool_lock,
+                       get_open_info_pool(&ffd->open_info_pool,
+                                          common_pool));
+
   SVN_ERR(svn_fs_fs__open(fs, path, subpool));
 
   SVN_ERR(svn_fs_fs__initialize_caches(fs, subpool));
   SVN_MUTEX__WITH_LOCK(common_pool_lock,
                        fs_serialized_init(fs, common_pool, subpool));
 
+  /* Don't write to a half-redeltified repository.  Read-only users must
+     not need any locks, so leave completing it to the first writer. */
+  SVN_ERR(svn_fs_fs__check_redeltify(fs, subpool));
+
   svn_pool_destroy(subpool);
 
   return SVN_NO_ERROR;
@@ -504,7 +553,9 @@ fs_hotcopy(svn_fs_t *src_fs,
            apr_pool_t *pool,
            apr_pool_t *common_pool)
 {
-  SVN_ERR(fs_open(src_fs, src_path, common_pool_lock, pool, common_pool));
+  /* SRC_FS is open already when hotcopying repeatedly from it. */
+  if (!src_fs->fsap_data)
+    SVN_ERR(fs_open(src_fs, src_path, common_pool_lock, pool, common_pool));
 
   SVN_ERR(svn_fs__check_fs(dst_fs, FALSE));
   SVN_ERR(initialize_fs_struct(dst_fs));
@@ -625,6 +676,8 @@ svn_fs_fs__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(fs_version(), checklist, svn_ver_equal));
 
+  SVN_ERR(svn_fs__batch_fsync_init(common_pool));
+
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
 }
@@ -36,6 +36,7 @@
 #include "private/svn_fs_private.h"
 #include "private/svn_sqlite.h"
 #include "private/svn_mutex.h"
+#include "private/svn_object_pool.h"
 
 #include "rev_file.h"
 
@@ -68,8 +69,12 @@ extern "C" {
                                                     has not been packed. */
 #define PATH_REVPROP_GENERATION "revprop-generation"
                                                  /* Current revprop generation*/
+#define PATH_REDELTIFY_JOURNAL "redeltify-journal"
+                                                 /* Pending pack file swaps */
 #define PATH_MANIFEST         "manifest"         /* Manifest file name */
 #define PATH_PACKED           "pack"             /* Packed revision data file */
+#define PATH_REDELTIFIED_PACK "pack.redeltified" /* Pack file replacing
+                                                    PATH_PACKED */
 #define PATH_EXT_PACKED_SHARD ".pack"            /* Extension for packed
                                                     shards */
 #define PATH_EXT_L2P_INDEX    ".l2p"             /* extension of the log-
@@ -92,6 +97,7 @@ extern "C" {
 #define PATH_TXN_ITEM_INDEX "itemidx"      /* File containing the current item
                                               index number */
 #define PATH_INDEX          "index"        /* name of index files w/o ext */
+#define PATH_TXN_NODES      "nodes"        /* Sharded node files */
 
 /* Names of files in legacy FS formats */
 #define PATH_REV           "rev"           /* Proto rev file */
@@ -100,6 +106,8 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_PERSISTENT_CACHE_PATH "persistent-cache-path"
+#define CONFIG_OPTION_PERSISTENT_CACHE_SIZE "persistent-cache-size"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
@@ -115,6 +123,7 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_MAX_MAPPED_PACK_FILES "max-mapped-pack-files"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
@@ -127,7 +136,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -200,6 +209,14 @@ extern "C" {
     database. */
 #define SVN_FS_FS__MIN_REP_CACHE_SCHEMA_V2_FORMAT 8
 
+/* The minimum format number that keeps the in-txn node files in
+   PATH_TXN_NODES shards instead of the transaction directory itself. */
+#define SVN_FS_FS__MIN_TXN_NODE_SHARDS_FORMAT 9
+
+/* Number of sub-folders of PATH_TXN_NODES that the in-txn node files get
+   distributed over.  Keeps the folders small even for huge commits. */
+#define SVN_FS_FS__TXN_NODE_SHARDS 1024
+
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
    locks, so we don't have to add our own mutex for just in-process
@@ -347,6 +364,15 @@ typedef struct fs_fs_data_t
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
 
+  /* Maximum number of pack files that we may keep mapped into memory at
+   * any given time.  0 disables memory-mapped pack file access. */
+  int max_mapped_pack_files;
+
+  /* Pack file mappings in LRU order, i.e. the most recently used one is
+   * last.  NULL until the first pack file has been mapped.  See rev_file.c
+   * for the element type. */
+  apr_array_header_t *pack_mappings;
+
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
@@ -360,6 +386,13 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Directory of the on-disk 2nd level cache for fulltexts and combined
+     windows.  NULL, if that cache has been disabled. */
+  const char *persistent_cache_path;
+
+  /* Maximum disk space (in bytes) used by the on-disk cache. */
+  apr_int64_t persistent_cache_size;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -514,6 +547,14 @@ typedef struct fs_fs_data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* TRUE if an interrupted svn_fs_fs__redeltify() left a journal that
+     the next write access has to complete.  Only checked when opening. */
+  svn_boolean_t redeltify_pending;
+
+  /* Process-wide pool of the repository meta data read by svn_fs_fs__open.
+     May be NULL, in which case that data will always be read from disk. */
+  svn_object_pool__t *open_info_pool;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
@@ -37,6 +37,7 @@
 #include "cached_data.h"
 #include "id.h"
 #include "index.h"
+#include "redeltify.h"
 #include "rep-cache.h"
 #include "revprops.h"
 #include "transaction.h"
@@ -362,6 +363,9 @@ svn_fs_fs__with_write_lock(svn_fs_t *fs,
                            void *baton,
                            apr_pool_t *pool)
 {
+  /* Writers must not see a half-redeltified repository. */
+  SVN_ERR(svn_fs_fs__complete_redeltify(fs, pool));
+
   return svn_error_trace(
            with_lock(create_lock_baton(fs, write_lock, body, baton, pool),
                      pool));
@@ -374,6 +378,8 @@ svn_fs_fs__with_pack_lock(svn_fs_t *fs,
                           void *baton,
                           apr_pool_t *pool)
 {
+  SVN_ERR(svn_fs_fs__complete_redeltify(fs, pool));
+
   return svn_error_trace(
            with_lock(create_lock_baton(fs, pack_lock, body, baton, pool),
                      pool));
@@ -399,12 +405,14 @@ svn_fs_fs__with_all_locks(svn_fs_t *fs,
                           apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+  with_lock_baton_t *lock_baton;
+
+  SVN_ERR(svn_fs_fs__complete_redeltify(fs, pool));
 
   /* Be sure to use the correct lock ordering as documented in
      fs_fs_shared_data_t.  The lock chain is being created in
      innermost (last to acquire) -> outermost (first to acquire) order. */
-  with_lock_baton_t *lock_baton
-    = create_lock_baton(fs, write_lock, body, baton, pool);
+  lock_baton = create_lock_baton(fs, write_lock, body, baton, pool);
 
   if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
     lock_baton = chain_lock_baton(pack_lock, lock_baton);
@@ -737,21 +745,16 @@ parse_compression_option(compression_type_t *compression_type_p,
   return SVN_NO_ERROR;
 }
 
-/* Read the configuration information of the file system at FS_PATH
- * and set the respective values in FFD.  Use pools as usual.
+/* Set the respective values in FFD from CONFIG, the configuration of
+ * the file system at FS_PATH.  Use pools as usual.
  */
 static svn_error_t *
-read_config(fs_fs_data_t *ffd,
-            const char *fs_path,
-            apr_pool_t *result_pool,
-            apr_pool_t *scratch_pool)
+apply_config(fs_fs_data_t *ffd,
+             const char *fs_path,
+             svn_config_t *config,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
 {
-  svn_config_t *config;
-
-  SVN_ERR(svn_config_read3(&config,
-                           svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
-                           FALSE, FALSE, FALSE, scratch_pool));
-
   /* Initialize ffd->rep_sharing_allowed. */
   if (ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT)
     SVN_ERR(svn_config_get_bool(config, &ffd->rep_sharing_allowed,
@@ -850,14 +853,34 @@ read_config(fs_fs_data_t *ffd,
 
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
+      apr_int64_t max_mapped_pack_files;
+
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
                                   CONFIG_SECTION_DEBUG,
                                   CONFIG_OPTION_PACK_AFTER_COMMIT,
                                   FALSE));
+      SVN_ERR(svn_config_get_int64(config, &max_mapped_pack_files,
+                                   CONFIG_SECTION_IO,
+                                   CONFIG_OPTION_MAX_MAPPED_PACK_FILES,
+                                   0));
+
+      /* Negative values make no sense and huge ones exhaust the
+       * address space long before reaching the limit. */
+      if (max_mapped_pack_files < 0 || max_mapped_pack_files > 0x10000)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("%s is out of range for fsfs.conf "
+                                   "setting '%s'."),
+                                 apr_psprintf(scratch_pool,
+                                              "%" APR_INT64_T_FMT,
+                                              max_mapped_pack_files),
+                                 CONFIG_OPTION_MAX_MAPPED_PACK_FILES);
+
+      ffd->max_mapped_pack_files = (int)max_mapped_pack_files;
     }
   else
     {
       ffd->pack_after_commit = FALSE;
+      ffd->max_mapped_pack_files = 0;
     }
 
   /* Initialize compression settings in ffd. */
@@ -945,9 +968,47 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  /* On-disk cache configuration.  Relative paths are relative to FS_PATH. */
+  svn_config_get(config, &ffd->persistent_cache_path, CONFIG_SECTION_CACHES,
+                 CONFIG_OPTION_PERSISTENT_CACHE_PATH, NULL);
+  if (ffd->persistent_cache_path && *ffd->persistent_cache_path)
+    ffd->persistent_cache_path = svn_dirent_join(fs_path,
+                                                 ffd->persistent_cache_path,
+                                                 result_pool);
+  else
+    ffd->persistent_cache_path = NULL;
+
+  SVN_ERR(svn_config_get_int64(config, &ffd->persistent_cache_size,
+                               CONFIG_SECTION_CACHES,
+                               CONFIG_OPTION_PERSISTENT_CACHE_SIZE,
+                               1024));
+  if (ffd->persistent_cache_size <= 0)
+    ffd->persistent_cache_path = NULL;
+  else
+    ffd->persistent_cache_size *= 0x100000;
+
   return SVN_NO_ERROR;
 }
 
+/* Read the configuration information of the file system at FS_PATH
+ * and set the respective values in FFD.  Use pools as usual.
+ */
+static svn_error_t *
+read_config(fs_fs_data_t *ffd,
+            const char *fs_path,
+            apr_pool_t *result_pool,
+            apr_pool_t *scratch_pool)
+{
+  svn_config_t *config;
+
+  SVN_ERR(svn_config_read3(&config,
+                           svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
+                           FALSE, FALSE, FALSE, scratch_pool));
+
+  return svn_error_trace(apply_config(ffd, fs_path, config, result_pool,
+                                      scratch_pool));
+}
+
 static svn_error_t *
 write_config(svn_fs_t *fs,
              apr_pool_t *pool)
@@ -977,6 +1038,15 @@ write_config(svn_fs_t *fs,
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"### Fulltexts and combined delta windows can also be kept in an on-disk"    NL
+"### cache that survives server restarts.  It is checked whenever the data"  NL
+"### is not found in the in-memory cache.  Relative paths are relative to"   NL
+"### the repository's db directory.  The directory may be shared between"    NL
+"### repositories.  The cache is disabled by default."                       NL
+"# " CONFIG_OPTION_PERSISTENT_CACHE_PATH " = cache"                          NL
+"### Maximum disk space used by that cache in MB.  Defaults to 1024."        NL
+"### The cache holds at most 4 entries per MB and 4M entries in total."      NL
+"# " CONFIG_OPTION_PERSISTENT_CACHE_SIZE " = 1024"                           NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -1147,6 +1217,16 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### Packed revision files may be mapped into memory instead of being read"  NL
+"### through buffered file access.  This saves system calls and data"        NL
+"### copies when the repository is mostly held in the OS file cache.  It"    NL
+"### requires enough virtual address space to map the pack files, i.e. a"    NL
+"### 64 bit system.  Pack files must not be modified while being mapped."    NL
+"### max-mapped-pack-files limits the number of pack files that each open"   NL
+"### repository instance keeps mapped.  0 disables memory mapping, which"    NL
+"### is the default."                                                        NL
+"# " CONFIG_OPTION_MAX_MAPPED_PACK_FILES " = 0"                              NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1183,36 +1263,41 @@ read_global_config(svn_fs_t *fs)
   return SVN_NO_ERROR;
 }
 
-/* Read FS's UUID file and store the data in the FS struct. */
+/* Read the UUID file at PATH of a repository with the given FORMAT and
+ * return its contents in *UUID and *INSTANCE_ID.  Allocate the results
+ * in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
 static svn_error_t *
-read_uuid(svn_fs_t *fs,
-          apr_pool_t *scratch_pool)
+read_uuid_file(const char **uuid,
+               const char **instance_id,
+               const char *path,
+               int format,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
 {
-  fs_fs_data_t *ffd = fs->fsap_data;
   apr_file_t *uuid_file;
   char buf[APR_UUID_FORMATTED_LENGTH + 2];
   apr_size_t limit;
 
   /* Read the repository uuid. */
-  SVN_ERR(svn_io_file_open(&uuid_file, path_uuid(fs, scratch_pool),
-                           APR_READ | APR_BUFFERED, APR_OS_DEFAULT,
-                           scratch_pool));
+  SVN_ERR(svn_io_file_open(&uuid_file, path, APR_READ | APR_BUFFERED,
+                           APR_OS_DEFAULT, scratch_pool));
 
   limit = sizeof(buf);
   SVN_ERR(svn_io_read_length_line(uuid_file, buf, &limit, scratch_pool));
-  fs->uuid = apr_pstrdup(fs->pool, buf);
+  *uuid = apr_pstrdup(result_pool, buf);
 
   /* Read the instance ID. */
-  if (ffd->format >= SVN_FS_FS__MIN_INSTANCE_ID_FORMAT)
+  if (format >= SVN_FS_FS__MIN_INSTANCE_ID_FORMAT)
     {
       limit = sizeof(buf);
       SVN_ERR(svn_io_read_length_line(uuid_file, buf, &limit,
                                       scratch_pool));
-      ffd->instance_id = apr_pstrdup(fs->pool, buf);
+      *instance_id = apr_pstrdup(result_pool, buf);
     }
   else
     {
-      ffd->instance_id = fs->uuid;
+      *instance_id = *uuid;
     }
 
   SVN_ERR(svn_io_file_close(uuid_file, scratch_pool));
@@ -1220,6 +1305,149 @@ read_uuid(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Read FS's UUID file and store the data in the FS struct. */
+static svn_error_t *
+read_uuid(svn_fs_t *fs,
+          apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  return svn_error_trace(read_uuid_file(&fs->uuid, &ffd->instance_id,
+                                        path_uuid(fs, scratch_pool),
+                                        ffd->format, fs->pool,
+                                        scratch_pool));
+}
+
+/* Repository meta data that svn_fs_fs__open reads from various files.
+ * Instances are immutable once created and may be shared between all
+ * svn_fs_t objects of the same repository. */
+typedef struct open_info_t
+{
+  /* Contents of the format file. */
+  int format;
+  int max_files_per_dir;
+  svn_boolean_t use_log_addressing;
+
+  /* Contents of the uuid file. */
+  const char *uuid;
+  const char *instance_id;
+
+  /* Parsed fsfs.conf.  Read-only if shared via the open info pool. */
+  svn_config_t *config;
+} open_info_t;
+
+/* Read the meta data of the repository at FS->PATH into a new *INFO.
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for
+ * temporaries.
+ */
+static svn_error_t *
+read_open_info(open_info_t **info,
+               svn_fs_t *fs,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  open_info_t *result = apr_pcalloc(result_pool, sizeof(*result));
+
+  SVN_ERR(read_format(&result->format, &result->max_files_per_dir,
+                      &result->use_log_addressing,
+                      path_format(fs, scratch_pool), scratch_pool));
+  SVN_ERR(read_uuid_file(&result->uuid, &result->instance_id,
+                         path_uuid(fs, scratch_pool), result->format,
+                         result_pool, scratch_pool));
+  SVN_ERR(svn_config_read3(&result->config,
+                           svn_dirent_join(fs->path, PATH_CONFIG,
+                                           scratch_pool),
+                           FALSE, FALSE, FALSE, result_pool));
+
+  *info = result;
+  return SVN_NO_ERROR;
+}
+
+/* Append the identity and modification state of the file at PATH to KEY.
+ * Files that don't exist get a simple placeholder.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+append_file_stamp(svn_stringbuf_t *key,
+                  const char *path,
+                  apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  svn_error_t *err = svn_io_stat(&finfo, path,
+                                 APR_FINFO_MTIME | APR_FINFO_SIZE
+                                 | APR_FINFO_INODE,
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      svn_stringbuf_appendcstr(key, "\n-");
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  svn_stringbuf_appendcstr(key,
+                           apr_psprintf(scratch_pool,
+                                        "\n%" APR_TIME_T_FMT
+                                        ":%" APR_OFF_T_FMT
+                                        ":%" APR_UINT64_T_FMT,
+                                        finfo.mtime, finfo.size,
+                                        (apr_uint64_t)finfo.inode));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *INFO to the meta data of the repository at FS->PATH.  Use the
+ * process-wide FS->FSAP_DATA->OPEN_INFO_POOL to share that data between
+ * all instances and only read it from disk if any of the underlying files
+ * changed.  Keep the reference to the shared *INFO alive until
+ * RESULT_POOL gets cleaned up.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+get_open_info(const open_info_t **info,
+              svn_fs_t *fs,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_stringbuf_t *key_str;
+  svn_membuf_t key;
+  open_info_t *result;
+  apr_pool_t *item_pool;
+
+  /* Stat'ing is much cheaper than opening, reading and parsing the files.
+   * Atomically replaced files also get a new inode number. */
+  key_str = svn_stringbuf_create(fs->path, scratch_pool);
+  SVN_ERR(append_file_stamp(key_str, path_format(fs, scratch_pool),
+                            scratch_pool));
+  SVN_ERR(append_file_stamp(key_str, path_uuid(fs, scratch_pool),
+                            scratch_pool));
+  SVN_ERR(append_file_stamp(key_str,
+                            svn_dirent_join(fs->path, PATH_CONFIG,
+                                            scratch_pool),
+                            scratch_pool));
+
+  svn_membuf__create(&key, key_str->len, scratch_pool);
+  key.size = key_str->len; /* exact length is required! */
+  memcpy(key.data, key_str->data, key_str->len);
+
+  SVN_ERR(svn_object_pool__lookup((void **)info, ffd->open_info_pool, &key,
+                                  result_pool));
+  if (*info)
+    return SVN_NO_ERROR;
+
+  /* Not found or outdated => read and share the data. */
+  item_pool = svn_object_pool__new_item_pool(ffd->open_info_pool);
+  SVN_ERR(read_open_info(&result, fs, item_pool, scratch_pool));
+
+  /* Guarantee thread-safe access to the shared config object. */
+  svn_config__set_read_only(result->config, scratch_pool);
+
+  SVN_ERR(svn_object_pool__insert((void **)info, ffd->open_info_pool, &key,
+                                  result, item_pool, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__read_format_file(svn_fs_t *fs, apr_pool_t *scratch_pool)
 {
@@ -1243,20 +1471,40 @@ svn_error_t *
 svn_fs_fs__open(svn_fs_t *fs, const char *path, apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
+  const open_info_t *info;
+  svn_config_t *config;
   fs->path = apr_pstrdup(fs->pool, path);
 
-  /* Read the FS format file. */
-  SVN_ERR(svn_fs_fs__read_format_file(fs, pool));
+  /* Read format, uuid and configuration files or get them from the
+   * process-wide open info pool. */
+  if (ffd->open_info_pool)
+    {
+      SVN_ERR(get_open_info(&info, fs, pool, pool));
 
-  /* Read in and cache the repository uuid. */
-  SVN_ERR(read_uuid(fs, pool));
+      /* Shared configs are read-only and contain temp. buffers. */
+      config = svn_config__shallow_copy(info->config, pool);
+    }
+  else
+    {
+      open_info_t *new_info;
+      SVN_ERR(read_open_info(&new_info, fs, pool, pool));
+
+      info = new_info;
+      config = new_info->config;
+    }
+
+  ffd->format = info->format;
+  ffd->max_files_per_dir = info->max_files_per_dir;
+  ffd->use_log_addressing = info->use_log_addressing;
+  fs->uuid = apr_pstrdup(fs->pool, info->uuid);
+  ffd->instance_id = apr_pstrdup(fs->pool, info->instance_id);
 
   /* Read the min unpacked revision. */
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, pool));
 
-  /* Read the configuration file. */
-  SVN_ERR(read_config(ffd, fs->path, fs->pool, pool));
+  /* Apply the configuration. */
+  SVN_ERR(apply_config(ffd, fs->path, config, fs->pool, pool));
 
   /* Global configuration options. */
   SVN_ERR(read_global_config(fs));
@@ -1383,6 +1631,13 @@ upgrade_body(void *baton, apr_pool_t *pool)
   ffd->max_files_per_dir = max_files_per_dir;
   ffd->use_log_addressing = use_log_addressing;
 
+  /* Existing transactions still keep their node files in the flat layout.
+     Move them to where the new format expects them.  We hold the
+     txn-current lock, so no new transactions get created meanwhile. */
+  if (format < SVN_FS_FS__MIN_TXN_NODE_SHARDS_FORMAT)
+    SVN_ERR(svn_fs_fs__upgrade_txn_nodes(fs, upgrade_baton->cancel_func,
+                                         upgrade_baton->cancel_baton, pool));
+
   /* Always add / bump the instance ID such that no form of caching
      accidentally uses outdated information.  Keep the UUID. */
   SVN_ERR(svn_fs_fs__set_uuid(fs, fs->uuid, NULL, pool));
@@ -1950,6 +2205,8 @@ svn_fs_fs__create(svn_fs_t *fs,
                   break;
           case 9: format = 7;
                   break;
+          case 10: format = 8;
+                  break;
 
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
@@ -2322,8 +2579,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 11;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
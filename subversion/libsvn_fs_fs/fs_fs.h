@@ -185,7 +185,11 @@ svn_fs_fs__write_format(svn_fs_t *fs,
 
 /* Obtain a write lock on the filesystem FS in a subpool of POOL, call
    BODY with BATON and that subpool, destroy the subpool (releasing the write
-   lock) and return what BODY returned. */
+   lock) and return what BODY returned.
+
+   Before that, complete any redeltify operation that has been interrupted.
+   The same applies to svn_fs_fs__with_pack_lock and
+   svn_fs_fs__with_all_locks. */
 svn_error_t *
 svn_fs_fs__with_write_lock(svn_fs_t *fs,
                            svn_error_t *(*body)(void *baton,
@@ -19,9 +19,15 @@
  *    under the License.
  * ====================================================================
  */
+#include <apr_thread_proc.h>
+
 #include "svn_pools.h"
 #include "svn_path.h"
 #include "svn_dirent_uri.h"
+#include "svn_sorts.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_io_private.h"
 
 #include "fs_fs.h"
 #include "hotcopy.h"
@@ -38,12 +44,15 @@
  * the destination and do not differ in terms of kind, size, and mtime.
  * Set *SKIPPED_P to FALSE only if the file was copied, do not change
  * the value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not
- * required. */
+ * required.  Call the optional CANCEL_FUNC with CANCEL_BATON while
+ * copying large files. */
 static svn_error_t *
 hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
                          const char *src_path,
                          const char *dst_path,
                          const char *file,
+                         svn_cancel_func_t cancel_func,
+                         void *cancel_baton,
                          apr_pool_t *scratch_pool)
 {
   const svn_io_dirent2_t *src_dirent;
@@ -72,8 +81,10 @@ hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
   if (skipped_p)
     *skipped_p = FALSE;
 
-  return svn_error_trace(svn_io_dir_file_copy(src_path, dst_path, file,
-                                              scratch_pool));
+  src_target = svn_dirent_join(src_path, file, scratch_pool);
+  return svn_error_trace(svn_io__copy_file(src_target, dst_target, TRUE,
+                                           cancel_func, cancel_baton,
+                                           scratch_pool));
 }
 
 /* Set *NAME_P to the UTF-8 representation of directory entry NAME.
@@ -185,7 +196,9 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
           if (this_entry.filetype == APR_REG) /* regular file */
             {
               SVN_ERR(hotcopy_io_dir_file_copy(skipped_p, src, dst_path,
-                                               entryname_utf8, subpool));
+                                               entryname_utf8,
+                                               cancel_func, cancel_baton,
+                                               subpool));
             }
           else if (this_entry.filetype == APR_LNK) /* symlink */
             {
@@ -241,6 +254,7 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
  * to DST_SUBDIR. Assume a sharding layout based on MAX_FILES_PER_DIR.
  * Set *SKIPPED_P to FALSE only if the file was copied, do not change the
  * value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not required.
+ * Call the optional CANCEL_FUNC with CANCEL_BATON while copying.
  * Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
 hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
@@ -248,6 +262,8 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
                         const char *dst_subdir,
                         svn_revnum_t rev,
                         int max_files_per_dir,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton,
                         apr_pool_t *scratch_pool)
 {
   const char *src_subdir_shard = src_subdir,
@@ -271,27 +287,32 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
   SVN_ERR(hotcopy_io_dir_file_copy(skipped_p,
                                    src_subdir_shard, dst_subdir_shard,
                                    apr_psprintf(scratch_pool, "%ld", rev),
+                                   cancel_func, cancel_baton,
                                    scratch_pool));
 
   return SVN_NO_ERROR;
 }
 
 
-/* Copy a packed shard containing revision REV, and which contains
- * MAX_FILES_PER_DIR revisions, from SRC_FS to DST_FS.
- * Update *DST_MIN_UNPACKED_REV in case the shard is new in DST_FS.
+/* Copy the files of a packed shard containing revision REV, and which
+ * contains MAX_FILES_PER_DIR revisions, from SRC_FS to DST_FS.
  * Do not re-copy data which already exists in DST_FS.
  * Set *SKIPPED_P to FALSE only if at least one part of the shard
  * was copied, do not change the value in *SKIPPED_P otherwise.
  * SKIPPED_P may be NULL if not required.
+ *
+ * This does not modify any of the meta data in DST_FS, so it may be called
+ * for multiple shards concurrently.  Call the optional CANCEL_FUNC with
+ * CANCEL_BATON between files and while copying them.
  * Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
 hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
-                          svn_revnum_t *dst_min_unpacked_rev,
                           svn_fs_t *src_fs,
                           svn_fs_t *dst_fs,
                           svn_revnum_t rev,
                           int max_files_per_dir,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
                           apr_pool_t *scratch_pool)
 {
   const char *src_subdir;
@@ -312,7 +333,7 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
   SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p, src_subdir_packed_shard,
                                           dst_subdir, packed_shard,
                                           TRUE /* copy_perms */,
-                                          NULL /* cancel_func */, NULL,
+                                          cancel_func, cancel_baton,
                                           scratch_pool));
 
   /* Copy revprops belonging to revisions in this pack. */
@@ -330,8 +351,12 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
         {
           svn_pool_clear(iterpool);
 
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
           SVN_ERR(hotcopy_copy_shard_file(skipped_p, src_subdir, dst_subdir,
                                           revprop_rev, max_files_per_dir,
+                                          cancel_func, cancel_baton,
                                           iterpool));
         }
       svn_pool_destroy(iterpool);
@@ -342,6 +367,7 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
       if (rev == 0)
         SVN_ERR(hotcopy_copy_shard_file(skipped_p, src_subdir, dst_subdir,
                                         0, max_files_per_dir,
+                                        cancel_func, cancel_baton,
                                         scratch_pool));
 
       /* packed revprops folder */
@@ -353,17 +379,205 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
                                               src_subdir_packed_shard,
                                               dst_subdir, packed_shard,
                                               TRUE /* copy_perms */,
-                                              NULL /* cancel_func */, NULL,
+                                              cancel_func, cancel_baton,
                                               scratch_pool));
     }
 
-  /* If necessary, update the min-unpacked rev file in the hotcopy. */
-  if (*dst_min_unpacked_rev < rev + max_files_per_dir)
+  return SVN_NO_ERROR;
+}
+
+/* Maximum number of packed shards that hotcopy_copy_packed_shards() will
+ * copy in one go. */
+#define SHARD_COPY_BATCH_SIZE 8
+
+#if APR_HAS_THREADS
+
+/* Number of threads that copy packed shards concurrently.  Even if the
+ * kernel can't share the data blocks between source and destination,
+ * this lets the latencies of the underlying storage overlap. */
+#define SHARD_COPY_THREADS 4
+
+/* Work shared by all threads of hotcopy_copy_packed_shards(). */
+typedef struct shard_batch_t
+{
+  /* Source and destination repositories. */
+  svn_fs_t *src_fs;
+  svn_fs_t *dst_fs;
+
+  /* Shard size. */
+  int max_files_per_dir;
+
+  /* First revision of the first shard and the number of shards to copy. */
+  svn_revnum_t start_rev;
+  int count;
+
+  /* The SKIPPED_P flags as returned by hotcopy_copy_packed_shard(),
+   * COUNT of them. */
+  svn_boolean_t *skipped;
+
+  /* Index of the next shard to process. */
+  volatile svn_atomic_t next;
+
+  /* Optional cancellation callback.  It gets called from all threads,
+   * so it must be thread-safe. */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} shard_batch_t;
+
+/* Per-thread data of hotcopy_copy_packed_shards(). */
+typedef struct shard_thread_baton_t
+{
+  /* The work to share with the other threads. */
+  shard_batch_t *batch;
+
+  /* Pool private to this thread. */
+  apr_pool_t *pool;
+
+  /* First error encountered by this thread. */
+  svn_error_t *err;
+} shard_thread_baton_t;
+
+/* Thread function copying shards from the shard_batch_t in the
+ * shard_thread_baton_t given by DATA until none are left. */
+static void * APR_THREAD_FUNC
+shard_copy_thread(apr_thread_t *tid,
+                  void *data)
+{
+  shard_thread_baton_t *baton = data;
+  shard_batch_t *batch = baton->batch;
+
+  while (baton->err == SVN_NO_ERROR)
+    {
+      int i = (int)svn_atomic_inc(&batch->next);
+      if (i >= batch->count)
+        break;
+
+      svn_pool_clear(baton->pool);
+      baton->err = hotcopy_copy_packed_shard(&batch->skipped[i],
+                                             batch->src_fs, batch->dst_fs,
+                                             batch->start_rev
+                                               + i * batch->max_files_per_dir,
+                                             batch->max_files_per_dir,
+                                             batch->cancel_func,
+                                             batch->cancel_baton,
+                                             baton->pool);
+    }
+
+  apr_thread_exit(tid, APR_SUCCESS);
+  return NULL;
+}
+
+#endif
+
+/* Copy the files of the COUNT consecutive packed shards, the first one of
+ * which starts at revision START_REV, from SRC_FS to DST_FS.  All shards
+ * contain MAX_FILES_PER_DIR revisions.  For each shard, set SKIPPED[i]
+ * as hotcopy_copy_packed_shard() would for SKIPPED_P.  COUNT must not
+ * exceed SHARD_COPY_BATCH_SIZE.
+ *
+ * If threads are available, copy multiple shards concurrently.  Call the
+ * optional CANCEL_FUNC with CANCEL_BATON from all of them.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+hotcopy_copy_packed_shards(svn_boolean_t *skipped,
+                           svn_fs_t *src_fs,
+                           svn_fs_t *dst_fs,
+                           svn_revnum_t start_rev,
+                           int count,
+                           int max_files_per_dir,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
+{
+  int i;
+
+  SVN_ERR_ASSERT(count <= SHARD_COPY_BATCH_SIZE);
+  for (i = 0; i < count; ++i)
+    skipped[i] = TRUE;
+
+#if APR_HAS_THREADS
+  if (count > 1)
     {
-      *dst_min_unpacked_rev = rev + max_files_per_dir;
-      SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
-                                                *dst_min_unpacked_rev,
-                                                scratch_pool));
+      shard_batch_t batch;
+      shard_thread_baton_t batons[SHARD_COPY_THREADS];
+      apr_thread_t *threads[SHARD_COPY_THREADS];
+      int thread_count = 0;
+      svn_error_t *err = SVN_NO_ERROR;
+
+      /* Threads get created and released in parallel, so their parent
+         pool must be thread-safe. */
+      apr_pool_t *threads_pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+
+      batch.src_fs = src_fs;
+      batch.dst_fs = dst_fs;
+      batch.max_files_per_dir = max_files_per_dir;
+      batch.start_rev = start_rev;
+      batch.count = count;
+      batch.skipped = skipped;
+      batch.cancel_func = cancel_func;
+      batch.cancel_baton = cancel_baton;
+      svn_atomic_set(&batch.next, 0);
+
+      for (i = 0; i < SHARD_COPY_THREADS && i < count; ++i)
+        {
+          apr_status_t status;
+
+          /* Each thread needs its own pool hierarchy to be thread-safe. */
+          batons[i].batch = &batch;
+          batons[i].pool = svn_pool_create(NULL);
+          batons[i].err = SVN_NO_ERROR;
+
+          status = apr_thread_create(&threads[i], NULL, shard_copy_thread,
+                                     &batons[i], threads_pool);
+          if (status)
+            {
+              svn_pool_destroy(batons[i].pool);
+              err = svn_error_wrap_apr(status, _("Can't create thread"));
+              break;
+            }
+
+          ++thread_count;
+        }
+
+      /* Wait for all threads, even if we could not start all of them.
+         The ones that did start will pick up the remaining shards. */
+      for (i = 0; i < thread_count; ++i)
+        {
+          apr_status_t retval;
+          apr_status_t status = apr_thread_join(&retval, threads[i]);
+          if (status)
+            err = svn_error_compose_create(
+                    err, svn_error_wrap_apr(status,
+                                            _("Can't join thread")));
+
+          err = svn_error_compose_create(err, batons[i].err);
+          svn_pool_destroy(batons[i].pool);
+        }
+
+      svn_pool_destroy(threads_pool);
+
+      /* No threads at all means no progress. */
+      if (thread_count == 0 || err)
+        return svn_error_trace(err);
+    }
+  else
+#endif
+    {
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+      for (i = 0; i < count; ++i)
+        {
+          svn_pool_clear(iterpool);
+          SVN_ERR(hotcopy_copy_packed_shard(&skipped[i], src_fs, dst_fs,
+                                            start_rev
+                                              + i * max_files_per_dir,
+                                            max_files_per_dir,
+                                            cancel_func, cancel_baton,
+                                            iterpool));
+        }
+
+      svn_pool_destroy(iterpool);
     }
 
   return SVN_NO_ERROR;
@@ -601,63 +815,83 @@ hotcopy_revisions(svn_fs_t *src_fs,
    */
 
   iterpool = svn_pool_create(pool);
-  /* First, copy packed shards. */
-  for (rev = 0; rev < src_min_unpacked_rev; rev += max_files_per_dir)
+  /* First, copy packed shards.  Copy the files of several shards at once
+   * but update the meta data of the destination strictly in revision
+   * order, such that it is consistent whenever we get interrupted. */
+  rev = 0;
+  while (rev < src_min_unpacked_rev)
     {
-      svn_boolean_t skipped = TRUE;
-      svn_revnum_t pack_end_rev;
+      svn_boolean_t skipped[SHARD_COPY_BATCH_SIZE];
+      int count = (int)MIN(SHARD_COPY_BATCH_SIZE,
+                           (src_min_unpacked_rev - rev) / max_files_per_dir);
+      int i;
 
       svn_pool_clear(iterpool);
 
       if (cancel_func)
         SVN_ERR(cancel_func(cancel_baton));
 
-      /* Copy the packed shard. */
-      SVN_ERR(hotcopy_copy_packed_shard(&skipped, &dst_min_unpacked_rev,
-                                        src_fs, dst_fs,
-                                        rev, max_files_per_dir,
-                                        iterpool));
-
-      pack_end_rev = rev + max_files_per_dir - 1;
+      /* Copy the packed shards. */
+      SVN_ERR(hotcopy_copy_packed_shards(skipped, src_fs, dst_fs,
+                                         rev, count, max_files_per_dir,
+                                         cancel_func, cancel_baton,
+                                         iterpool));
 
-      /* Whenever this pack did not previously exist in the destination,
-       * update 'current' to the most recent packed rev (so readers can see
-       * new revisions which arrived in this pack). */
-      if (pack_end_rev > dst_youngest)
+      for (i = 0; i < count; ++i, rev += max_files_per_dir)
         {
-          SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
-                                           iterpool));
-        }
+          svn_revnum_t pack_end_rev = rev + max_files_per_dir - 1;
 
-      /* When notifying about packed shards, make things simpler by either
-       * reporting a full revision range, i.e [pack start, pack end] or
-       * reporting nothing. There is one case when this approach might not
-       * be exact (incremental hotcopy with a pack replacing last unpacked
-       * revisions), but generally this is good enough. */
-      if (notify_func && !skipped)
-        notify_func(notify_baton, rev, pack_end_rev, iterpool);
+          /* If necessary, update the min-unpacked rev file in the
+           * hotcopy. */
+          if (dst_min_unpacked_rev < rev + max_files_per_dir)
+            {
+              dst_min_unpacked_rev = rev + max_files_per_dir;
+              SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
+                                                        dst_min_unpacked_rev,
+                                                        iterpool));
+            }
 
-      /* Remove revision files which are now packed. */
-      if (incremental)
-        {
-          SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
-                                           rev + max_files_per_dir,
-                                           max_files_per_dir, iterpool));
-          if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-            SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
-                                                 rev + max_files_per_dir,
-                                                 max_files_per_dir,
-                                                 iterpool));
-        }
+          /* Whenever this pack did not previously exist in the destination,
+           * update 'current' to the most recent packed rev (so readers can
+           * see new revisions which arrived in this pack). */
+          if (pack_end_rev > dst_youngest)
+            {
+              SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
+                                               iterpool));
+            }
+
+          /* When notifying about packed shards, make things simpler by
+           * either reporting a full revision range, i.e [pack start, pack
+           * end] or reporting nothing. There is one case when this approach
+           * might not be exact (incremental hotcopy with a pack replacing
+           * last unpacked revisions), but generally this is good enough. */
+          if (notify_func && !skipped[i])
+            notify_func(notify_baton, rev, pack_end_rev, iterpool);
+
+          /* Remove revision files which are now packed. */
+          if (incremental)
+            {
+              SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
+                                               rev + max_files_per_dir,
+                                               max_files_per_dir, iterpool));
+              if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+                SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
+                                                     rev + max_files_per_dir,
+                                                     max_files_per_dir,
+                                                     iterpool));
+            }
 
-      /* Now that all revisions have moved into the pack, the original
-       * rev dir can be removed. */
-      SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev, iterpool),
-                            cancel_func, cancel_baton, iterpool));
-      if (rev > 0 && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-        SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
-                                                             iterpool),
-                              cancel_func, cancel_baton, iterpool));
+          /* Now that all revisions have moved into the pack, the original
+           * rev dir can be removed. */
+          SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev,
+                                                          iterpool),
+                                cancel_func, cancel_baton, iterpool));
+          if (rev > 0
+              && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+            SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
+                                                                 iterpool),
+                                  cancel_func, cancel_baton, iterpool));
+        }
     }
 
   if (cancel_func)
@@ -694,11 +928,13 @@ hotcopy_revisions(svn_fs_t *src_fs,
       SVN_ERR(hotcopy_copy_shard_file(&skipped,
                                       src_revs_dir, dst_revs_dir, rev,
                                       max_files_per_dir,
+                                      cancel_func, cancel_baton,
                                       iterpool));
       /* Copy the revprop file. */
       SVN_ERR(hotcopy_copy_shard_file(&skipped,
                                       src_revprops_dir, dst_revprops_dir,
                                       rev, max_files_per_dir,
+                                      cancel_func, cancel_baton,
                                       iterpool));
 
       /* Whenever this revision did not previously exist in the destination,
@@ -761,10 +997,12 @@ hotcopy_revisions_old(svn_fs_t *src_fs,
 
       SVN_ERR(hotcopy_io_dir_file_copy(&skipped, src_revs_dir, dst_revs_dir,
                                        apr_psprintf(iterpool, "%ld", rev),
+                                       cancel_func, cancel_baton,
                                        iterpool));
       SVN_ERR(hotcopy_io_dir_file_copy(&skipped, src_revprops_dir,
                                        dst_revprops_dir,
                                        apr_psprintf(iterpool, "%ld", rev),
+                                       cancel_func, cancel_baton,
                                        iterpool));
 
       if (notify_func && !skipped)
@@ -1016,11 +1254,15 @@ svn_fs_fs__hotcopy(svn_fs_t *src_fs,
                    apr_pool_t *common_pool)
 {
   struct hotcopy_body_baton hbb;
+  fs_fs_data_t *src_ffd = src_fs->fsap_data;
 
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
-  SVN_ERR(svn_fs_fs__open(src_fs, src_path, pool));
+  /* SRC_FS has been opened by our caller, possibly some time ago.
+   * Pick up any packs that happened since. */
+  if (src_ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
+    SVN_ERR(svn_fs_fs__update_min_unpacked_rev(src_fs, pool));
 
   if (incremental)
     {
@@ -1051,10 +1293,8 @@ svn_fs_fs__hotcopy(svn_fs_t *src_fs,
   else
     {
       /* Start out with an empty destination using the same configuration
-       * as the source. */
-      fs_fs_data_t *src_ffd = src_fs->fsap_data;
-
-      /* Create the DST_FS repository with the same layout as SRC_FS. */
+       * as the source.  Create the DST_FS repository with the same layout
+       * as SRC_FS. */
       SVN_ERR(svn_fs_fs__create_file_tree(dst_fs, dst_path, src_ffd->format,
                                           src_ffd->max_files_per_dir,
                                           src_ffd->use_log_addressing,
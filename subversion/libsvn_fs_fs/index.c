@@ -186,6 +186,10 @@ struct svn_fs_fs__packed_number_stream_t
   /* underlying data file containing the packed values */
   apr_file_t *file;
 
+  /* If not NULL, the contents of FILE mapped into memory.  We will then
+   * read the data from here instead of from FILE. */
+  const unsigned char *mapped_data;
+
   /* Offset within FILE at which the stream data starts
    * (i.e. which offset will reported as offset 0 by packed_stream_offset). */
   apr_off_t stream_start;
@@ -256,37 +260,48 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
   value_position_pair_t *target;
   apr_off_t block_start = 0;
   apr_off_t block_left = 0;
-  apr_status_t err;
+  apr_status_t err = APR_SUCCESS;
 
   /* all buffered data will have been read starting here */
   stream->start_offset = stream->next_offset;
 
-  /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH blocks,
-   * i.e. the last number has been incomplete (and not buffered in stream)
-   * and need to be re-read.  Therefore, always correct the file pointer.
-   */
-  SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
-                                   &block_start, stream->next_offset,
-                                   stream->pool));
+  /* Mapped data is simply there.  No need for any I/O. */
+  if (stream->mapped_data)
+    {
+      bytes_read = (apr_size_t)MIN(sizeof(buffer),
+                                   stream->stream_end - stream->next_offset);
+      memcpy(buffer, stream->mapped_data + stream->next_offset, bytes_read);
+    }
+  else
+    {
+      /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH
+       * blocks, i.e. the last number has been incomplete (and not buffered
+       * in stream) and need to be re-read.  Therefore, always correct the
+       * file pointer.
+       */
+      SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
+                                       &block_start, stream->next_offset,
+                                       stream->pool));
 
-  /* prefetch at least one number but, if feasible, don't cross block
-   * boundaries.  This shall prevent jumping back and forth between two
-   * blocks because the extra data was not actually request _now_.
-   */
-  bytes_read = sizeof(buffer);
-  block_left = stream->block_size - (stream->next_offset - block_start);
-  if (block_left >= 10 && block_left < bytes_read)
-    bytes_read = (apr_size_t)block_left;
-
-  /* Don't read beyond the end of the file section that belongs to this
-   * index / stream. */
-  bytes_read = (apr_size_t)MIN(bytes_read,
-                               stream->stream_end - stream->next_offset);
-
-  err = apr_file_read(stream->file, buffer, &bytes_read);
-  if (err && !APR_STATUS_IS_EOF(err))
-    return stream_error_create(stream, err,
-      _("Can't read index file '%s' at offset 0x%s"));
+      /* prefetch at least one number but, if feasible, don't cross block
+       * boundaries.  This shall prevent jumping back and forth between two
+       * blocks because the extra data was not actually request _now_.
+       */
+      bytes_read = sizeof(buffer);
+      block_left = stream->block_size - (stream->next_offset - block_start);
+      if (block_left >= 10 && block_left < bytes_read)
+        bytes_read = (apr_size_t)block_left;
+
+      /* Don't read beyond the end of the file section that belongs to this
+       * index / stream. */
+      bytes_read = (apr_size_t)MIN(bytes_read,
+                                   stream->stream_end - stream->next_offset);
+
+      err = apr_file_read(stream->file, buffer, &bytes_read);
+      if (err && !APR_STATUS_IS_EOF(err))
+        return stream_error_create(stream, err,
+          _("Can't read index file '%s' at offset 0x%s"));
+    }
 
   /* if the last number is incomplete, trim it from the buffer */
   while (bytes_read > 0 && buffer[bytes_read-1] >= 0x80)
@@ -344,13 +359,13 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 }
 
 /* Create and open a packed number stream reading from offsets START to
- * END in FILE and return it in *STREAM.  Access the file in chunks of
+ * END in REV_FILE and return it in *STREAM.  Access the file in chunks of
  * BLOCK_SIZE bytes.  Expect the stream to be prefixed by STREAM_PREFIX.
  * Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL for temporaries.
  */
 static svn_error_t *
 packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
-                   apr_file_t *file,
+                   svn_fs_fs__revision_file_t *rev_file,
                    apr_off_t start,
                    apr_off_t end,
                    const char *stream_prefix,
@@ -367,10 +382,8 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
   SVN_ERR_ASSERT(len < sizeof(buffer));
 
   /* Read the header prefix and compare it with the expected prefix */
-  SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
+  SVN_ERR(svn_fs_fs__rev_file_read(rev_file, buffer, len, NULL, start,
                                    scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
-                                 scratch_pool));
 
   if (strncmp(buffer, stream_prefix, len))
     return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
@@ -382,7 +395,8 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
   result = apr_palloc(result_pool, sizeof(*result));
 
   result->pool = result_pool;
-  result->file = file;
+  result->file = rev_file->file;
+  result->mapped_data = (const unsigned char *)rev_file->mapped_data;
   result->stream_start = start + len;
   result->stream_end = end;
 
@@ -946,7 +960,7 @@ auto_open_l2p_index(svn_fs_fs__revision_file_t *rev_file,
 
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->l2p_stream,
-                                 rev_file->file,
+                                 rev_file,
                                  rev_file->l2p_offset,
                                  rev_file->p2l_offset,
                                  L2P_STREAM_PREFIX,
@@ -1816,6 +1830,99 @@ svn_fs_fs__item_offset(apr_off_t *absolute_position,
   return svn_error_trace(err);
 }
 
+svn_error_t *
+svn_fs_fs__item_offsets(apr_off_t *offsets,
+                        svn_fs_t *fs,
+                        svn_fs_fs__revision_file_t *rev_file,
+                        const svn_fs_fs__id_part_t *items,
+                        int count,
+                        apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  l2p_header_t *header;
+  l2p_page_t *page = NULL;
+  svn_fs_fs__page_cache_key_t key = { 0 };
+  apr_pool_t *iterpool;
+  int i;
+
+  if (count == 0)
+    return SVN_NO_ERROR;
+
+  /* Without l2p index, there is nothing to share between the lookups. */
+  if (!svn_fs_fs__use_log_addressing(fs))
+    {
+      iterpool = svn_pool_create(scratch_pool);
+      for (i = 0; i < count; ++i)
+        {
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_fs_fs__item_offset(&offsets[i], fs, rev_file,
+                                         items[i].revision, NULL,
+                                         items[i].number, iterpool));
+        }
+
+      svn_pool_destroy(iterpool);
+      return SVN_NO_ERROR;
+    }
+
+  /* All items are in the same rev / pack file and share the same index
+   * header. */
+  SVN_ERR(get_l2p_header(&header, rev_file, fs, items[0].revision,
+                         scratch_pool, scratch_pool));
+  key.is_packed = rev_file->is_packed;
+
+  /* PAGE lives in ITERPOOL, which we clear only when moving to another
+   * page. */
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < count; ++i)
+    {
+      l2p_page_info_baton_t info_baton;
+      l2p_entry_baton_t page_baton;
+
+      /* Locate the item within the index. */
+      info_baton.revision = items[i].revision;
+      info_baton.item_index = items[i].number;
+      SVN_ERR(l2p_page_info_copy(&info_baton, header, header->page_table,
+                                 header->page_table_index, scratch_pool));
+
+      /* Fetch the page, unless it is the one used for the previous item. */
+      assert(items[i].revision <= APR_UINT32_MAX);
+      if (   page == NULL
+          || key.revision != (apr_uint32_t)items[i].revision
+          || key.page != info_baton.page_no)
+        {
+          svn_boolean_t is_cached;
+
+          svn_pool_clear(iterpool);
+          key.revision = (apr_uint32_t)items[i].revision;
+          key.page = info_baton.page_no;
+
+          SVN_ERR(svn_cache__get((void **)&page, &is_cached,
+                                 ffd->l2p_page_cache, &key, iterpool));
+          if (!is_cached)
+            {
+              SVN_ERR(get_l2p_page(&page, rev_file, fs,
+                                   info_baton.first_revision,
+                                   &info_baton.entry, iterpool));
+              SVN_ERR(svn_cache__set(ffd->l2p_page_cache, &key, page,
+                                     iterpool));
+            }
+        }
+
+      /* Extract the offset. */
+      page_baton.revision = items[i].revision;
+      page_baton.item_index = items[i].number;
+      page_baton.page_offset = info_baton.page_offset;
+      SVN_ERR(l2p_page_get_entry(&page_baton, page, page->offsets,
+                                 scratch_pool));
+
+      offsets[i] = page_baton.offset;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /*
  * phys-to-log index
  */
@@ -2138,7 +2245,7 @@ auto_open_p2l_index(svn_fs_fs__revision_file_t *rev_file,
 
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->p2l_stream,
-                                 rev_file->file,
+                                 rev_file,
                                  rev_file->p2l_offset,
                                  rev_file->footer_offset,
                                  P2L_STREAM_PREFIX,
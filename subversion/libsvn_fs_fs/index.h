@@ -200,6 +200,25 @@ svn_fs_fs__item_offset(apr_off_t *absolute_position,
                        apr_uint64_t item_index,
                        apr_pool_t *scratch_pool);
 
+/* Vectored version of svn_fs_fs__item_offset for committed revisions:
+ * For each of the COUNT (revision, item index) pairs in ITEMS, write the
+ * position in the respective rev or pack file to the corresponding
+ * element of OFFSETS.  All ITEMS must be stored in REV_FILE.
+ *
+ * Items are being resolved in one pass with the index header being read
+ * only once and every index page being fetched once for each run of
+ * ITEMS that it covers.  Thus, ITEMS should be sorted by revision and
+ * item index.  Any order gives the correct results, though.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__item_offsets(apr_off_t *offsets,
+                        svn_fs_t *fs,
+                        svn_fs_fs__revision_file_t *rev_file,
+                        const svn_fs_fs__id_part_t *items,
+                        int count,
+                        apr_pool_t *scratch_pool);
+
 /* Use the log-to-phys indexes in FS to determine the maximum item indexes
  * assigned to revision START_REV to START_REV + COUNT - 1.  That is a
  * close upper limit to the actual number of items in the respective revs.
@@ -31,6 +31,7 @@
 #include "private/svn_string_private.h"
 #include "private/svn_io_private.h"
 
+#include "private/svn_fs_util.h"
 #include "fs_fs.h"
 #include "pack.h"
 #include "util.h"
@@ -234,8 +235,8 @@ typedef struct pack_context_t
    * the next range of revisions is being processed */
   apr_pool_t *info_pool;
 
-  /* ensure that all filesystem changes are written to disk. */
-  svn_boolean_t flush_to_disk;
+  /* schedule all files to be flushed to disk here. */
+  svn_fs__batch_fsync_t *batch;
 } pack_context_t;
 
 /* Create and initialize a new pack context for packing shard SHARD_REV in
@@ -243,7 +244,7 @@ typedef struct pack_context_t
  * and return the structure in *CONTEXT.
  *
  * Limit the number of items being copied per iteration to MAX_ITEMS.
- * Set FLUSH_TO_DISK, CANCEL_FUNC and CANCEL_BATON as well.
+ * Set BATCH, CANCEL_FUNC and CANCEL_BATON as well.
  */
 static svn_error_t *
 initialize_pack_context(pack_context_t *context,
@@ -252,7 +253,7 @@ initialize_pack_context(pack_context_t *context,
                         const char *shard_dir,
                         svn_revnum_t shard_rev,
                         int max_items,
-                        svn_boolean_t flush_to_disk,
+                        svn_fs__batch_fsync_t *batch,
                         svn_cancel_func_t cancel_func,
                         void *cancel_baton,
                         apr_pool_t *pool)
@@ -281,16 +282,16 @@ initialize_pack_context(pack_context_t *context,
   context->info_pool = svn_pool_create(pool);
   context->paths = svn_prefix_tree__create(context->info_pool);
 
-  context->flush_to_disk = flush_to_disk;
+  context->batch = batch;
 
   /* Create the new directory and pack file. */
   context->shard_dir = shard_dir;
   context->pack_file_dir = pack_file_dir;
   context->pack_file_path
     = svn_dirent_join(pack_file_dir, PATH_PACKED, pool);
-  SVN_ERR(svn_io_file_open(&context->pack_file, context->pack_file_path,
-                           APR_WRITE | APR_BUFFERED | APR_BINARY | APR_EXCL
-                             | APR_CREATE, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_fs__batch_fsync_create_file(&context->pack_file, batch,
+                                          context->pack_file_path, TRUE,
+                                          pool));
 
   /* Proto index files */
   SVN_ERR(svn_fs_fs__l2p_proto_index_open(
@@ -382,7 +383,8 @@ reset_pack_context(pack_context_t *context,
 }
 
 /* Call this after the last revision range.  It will finalize all index files
- * for CONTEXT and close any open files.  Use POOL for temporary allocations.
+ * for CONTEXT and close any open files - except for the pack file itself,
+ * which is owned by CONTEXT->BATCH.  Use POOL for temporary allocations.
  */
 static svn_error_t *
 close_pack_context(pack_context_t *context,
@@ -412,10 +414,7 @@ close_pack_context(pack_context_t *context,
   SVN_ERR(svn_io_remove_file2(proto_l2p_index_path, FALSE, pool));
   SVN_ERR(svn_io_remove_file2(proto_p2l_index_path, FALSE, pool));
 
-  /* Ensure that packed file is written to disk.*/
-  if (context->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(context->pack_file, pool));
-  SVN_ERR(svn_io_file_close(context->pack_file, pool));
+  /* The pack file itself will be flushed and closed by CONTEXT->BATCH. */
 
   return SVN_NO_ERROR;
 }
@@ -1538,9 +1537,9 @@ append_revision(pack_context_t *context,
  *
  * Pack the revision shard starting at SHARD_REV in filesystem FS from
  * SHARD_DIR into the PACK_FILE_DIR, using POOL for allocations.  Limit
- * the extra memory consumption to MAX_MEM bytes.  If FLUSH_TO_DISK is
- * non-zero, do not return until the data has actually been written on
- * the disk.  CANCEL_FUNC and CANCEL_BATON are what you think they are.
+ * the extra memory consumption to MAX_MEM bytes.  Schedule the pack file
+ * for fsync in BATCH.  CANCEL_FUNC and CANCEL_BATON are what you think
+ * they are.
  */
 static svn_error_t *
 pack_log_addressed(svn_fs_t *fs,
@@ -1548,7 +1547,7 @@ pack_log_addressed(svn_fs_t *fs,
                    const char *shard_dir,
                    svn_revnum_t shard_rev,
                    apr_size_t max_mem,
-                   svn_boolean_t flush_to_disk,
+                   svn_fs__batch_fsync_t *batch,
                    svn_cancel_func_t cancel_func,
                    void *cancel_baton,
                    apr_pool_t *pool)
@@ -1581,7 +1580,7 @@ pack_log_addressed(svn_fs_t *fs,
 
   /* set up a pack context */
   SVN_ERR(initialize_pack_context(&context, fs, pack_file_dir, shard_dir,
-                                  shard_rev, max_items, flush_to_disk,
+                                  shard_rev, max_items, batch,
                                   cancel_func, cancel_baton, pool));
 
   /* phase 1: determine the size of the revisions to pack */
@@ -1706,16 +1705,15 @@ svn_fs_fs__get_packed_offset(apr_off_t *rev_offset,
  *
  * Pack the revision shard starting at SHARD_REV containing exactly
  * MAX_FILES_PER_DIR revisions from SHARD_PATH into the PACK_FILE_DIR,
- * using POOL for allocations.  If FLUSH_TO_DISK is non-zero, do not
- * return until the data has actually been written on the disk.
- * CANCEL_FUNC and CANCEL_BATON are what you think they are.
+ * using POOL for allocations.  Schedule the pack and manifest files for
+ * fsync in BATCH.  CANCEL_FUNC and CANCEL_BATON are what you think they are.
  */
 static svn_error_t *
 pack_phys_addressed(const char *pack_file_dir,
                     const char *shard_path,
                     svn_revnum_t start_rev,
                     int max_files_per_dir,
-                    svn_boolean_t flush_to_disk,
+                    svn_fs__batch_fsync_t *batch,
                     svn_cancel_func_t cancel_func,
                     void *cancel_baton,
                     apr_pool_t *pool)
@@ -1731,17 +1729,14 @@ pack_phys_addressed(const char *pack_file_dir,
   pack_file_path = svn_dirent_join(pack_file_dir, PATH_PACKED, pool);
   manifest_file_path = svn_dirent_join(pack_file_dir, PATH_MANIFEST, pool);
 
-  /* Create the new directory and pack file.
-   * Use unbuffered apr_file_t since we're going to write using 16kb
-   * chunks. */
-  SVN_ERR(svn_io_file_open(&pack_file, pack_file_path,
-                           APR_WRITE | APR_CREATE | APR_EXCL,
-                           APR_OS_DEFAULT, pool));
+  /* Create the new pack file.  BATCH owns the handle.  We copy the rev
+   * files in large chunks, so APR buffering would only add another copy. */
+  SVN_ERR(svn_fs__batch_fsync_create_file(&pack_file, batch,
+                                          pack_file_path, FALSE, pool));
 
   /* Create the manifest file. */
-  SVN_ERR(svn_io_file_open(&manifest_file, manifest_file_path,
-                           APR_WRITE | APR_BUFFERED | APR_CREATE | APR_EXCL,
-                           APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_fs__batch_fsync_create_file(&manifest_file, batch,
+                                          manifest_file_path, TRUE, pool));
   manifest_stream = svn_stream_from_aprfile2(manifest_file, TRUE, pool);
 
   end_rev = start_rev + max_files_per_dir - 1;
@@ -1779,22 +1774,13 @@ pack_phys_addressed(const char *pack_file_dir,
                                cancel_func, cancel_baton, iterpool));
     }
 
-  /* Close stream over APR file. */
+  /* Close stream over APR file.  Flushing the manifest and pack file to
+   * disk is left to BATCH. */
   SVN_ERR(svn_stream_close(manifest_stream));
 
-  /* Ensure that pack file is written to disk. */
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(manifest_file, pool));
-  SVN_ERR(svn_io_file_close(manifest_file, pool));
-
   /* disallow write access to the manifest file */
   SVN_ERR(svn_io_set_file_read_only(manifest_file_path, FALSE, iterpool));
 
-  /* Ensure that pack file is written to disk. */
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(pack_file, pool));
-  SVN_ERR(svn_io_file_close(pack_file, pool));
-
   svn_pool_destroy(iterpool);
 
   return SVN_NO_ERROR;
@@ -1803,9 +1789,10 @@ pack_phys_addressed(const char *pack_file_dir,
 /* In filesystem FS, pack the revision SHARD containing exactly
  * MAX_FILES_PER_DIR revisions from SHARD_PATH into the PACK_FILE_DIR,
  * using POOL for allocations.  Try to limit the amount of temporary
- * memory needed to MAX_MEM bytes.  If FLUSH_TO_DISK is non-zero, do
- * not return until the data has actually been written on the disk.
- * CANCEL_FUNC and CANCEL_BATON are what you think they are.
+ * memory needed to MAX_MEM bytes.  All new files and directories get
+ * scheduled for fsync in BATCH, i.e. the data will not be durable before
+ * the caller runs it.  CANCEL_FUNC and CANCEL_BATON are what you think
+ * they are.
  *
  * If for some reason we detect a partial packing already performed, we
  * remove the pack file and start again.
@@ -1819,7 +1806,7 @@ pack_rev_shard(svn_fs_t *fs,
                apr_int64_t shard,
                int max_files_per_dir,
                apr_size_t max_mem,
-               svn_boolean_t flush_to_disk,
+               svn_fs__batch_fsync_t *batch,
                svn_cancel_func_t cancel_func,
                void *cancel_baton,
                apr_pool_t *pool)
@@ -1836,15 +1823,16 @@ pack_rev_shard(svn_fs_t *fs,
 
   /* Create the new directory and pack file. */
   SVN_ERR(svn_io_dir_make(pack_file_dir, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, pack_file_dir, pool));
 
   /* Index information files */
   if (svn_fs_fs__use_log_addressing(fs))
     SVN_ERR(pack_log_addressed(fs, pack_file_dir, shard_path,
-                               shard_rev, max_mem, flush_to_disk,
+                               shard_rev, max_mem, batch,
                                cancel_func, cancel_baton, pool));
   else
     SVN_ERR(pack_phys_addressed(pack_file_dir, shard_path, shard_rev,
-                                max_files_per_dir, flush_to_disk,
+                                max_files_per_dir, batch,
                                 cancel_func, cancel_baton, pool));
 
   SVN_ERR(svn_io_copy_perms(shard_path, pack_file_dir, pool));
@@ -1870,6 +1858,7 @@ struct pack_baton
   const char *revs_dir;
   const char *revsprops_dir;
   apr_int64_t shard;
+  svn_fs__batch_fsync_t *batch;
 
   /* Additional entries valid when entering synced_pack_shard(). */
   const char *rev_shard_path;
@@ -1912,10 +1901,13 @@ synced_pack_shard(void *baton,
                                              ffd->compress_packed_revprops
                                                ? SVN__COMPRESSION_ZLIB_DEFAULT
                                                : SVN__COMPRESSION_NONE,
-                                             ffd->flush_to_disk,
+                                             pb->batch,
                                              pb->cancel_func,
                                              pb->cancel_baton,
                                              pool));
+
+      /* Flush all revprop pack files concurrently. */
+      SVN_ERR(svn_fs__batch_fsync_run(pb->batch, pool));
     }
 
   /* Update the min-unpacked-rev file to reflect our newly packed shard. */
@@ -1986,11 +1978,15 @@ pack_shard(struct pack_baton *baton,
                                                        baton->shard),
                                           pool);
 
-  /* pack the revision content */
+  /* pack the revision content and make it durable before switching over.
+     Do the latter outside the write lock as it may take some time. */
+  SVN_ERR(svn_fs__batch_fsync_create(&baton->batch, ffd->flush_to_disk,
+                                     pool));
   SVN_ERR(pack_rev_shard(baton->fs, rev_pack_file_dir, baton->rev_shard_path,
                          baton->shard, ffd->max_files_per_dir,
-                         baton->max_mem, ffd->flush_to_disk,
+                         baton->max_mem, baton->batch,
                          baton->cancel_func, baton->cancel_baton, pool));
+  SVN_ERR(svn_fs__batch_fsync_run(baton->batch, pool));
 
   /* For newer repo formats, we only acquired the pack lock so far.
      Before modifying the repo state by switching over to the packed
@@ -32,6 +32,7 @@
 #include "revprops.h"
 #include "util.h"
 #include "cached_data.h"
+#include "redeltify.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
@@ -358,6 +359,9 @@ recover_body(void *baton, apr_pool_t *pool)
      Bump the instance ID. */
   SVN_ERR(svn_fs_fs__set_uuid(fs, fs->uuid, NULL, pool));
 
+  /* Finish any interrupted redeltify run.  We hold all locks already. */
+  SVN_ERR(svn_fs_fs__complete_redeltify_locked(fs, pool));
+
   /* We need to know the largest revision in the filesystem. */
   SVN_ERR(recover_get_largest_revision(fs, &max_rev, pool));
 
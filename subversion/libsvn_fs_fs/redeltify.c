@@ -0,0 +1,1454 @@
+/* redeltify.c --- re-encode file representations in packed shards
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_checksum.h"
+#include "svn_delta.h"
+#include "svn_dirent_uri.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_fs_fs_private.h"
+#include "private/svn_sorts_private.h"
+
+#include "cached_data.h"
+#include "fs_fs.h"
+#include "id.h"
+#include "index.h"
+#include "low_level.h"
+#include "redeltify.h"
+#include "rep-cache.h"
+#include "rev_file.h"
+#include "scan.h"
+#include "transaction.h"
+#include "util.h"
+
+#include "svn_private_config.h"
+
+/* Each representation item in a rev / pack file ends with this trailer. */
+#define REP_TRAILER "ENDREP\n"
+#define REP_TRAILER_LEN (sizeof(REP_TRAILER) - 1)
+
+/* Node revision lines referencing representations start with these. */
+#define TEXT_PREFIX "text: "
+#define PROPS_PREFIX "props: "
+
+/* Everything we know about a representation stored in one of the shards
+ * being processed.
+ */
+typedef struct rep_info_t
+{
+  /* Location of the representation.  This is also the hash key. */
+  svn_fs_fs__id_part_t key;
+
+  /* Item type as given by the p2l index.  0 if not found, yet. */
+  apr_uint32_t type;
+
+  /* Size of the item in the original pack file. */
+  apr_off_t item_size;
+
+  /* The representation header as found in the original pack file. */
+  svn_fs_fs__rep_header_t *header;
+
+  /* The representation as referenced by the file node revision that
+   * created it, together with that node's predecessor info.  REP is NULL
+   * if no such node revision has been found. */
+  representation_t *rep;
+  const svn_fs_id_t *predecessor_id;
+  int predecessor_count;
+
+  /* Set if revisions outside the shards being processed reference this
+   * representation, either directly or as a delta base.  We must not
+   * change its size then. */
+  svn_boolean_t pinned;
+
+  /* Set once the representation has been re-encoded.  The NEW_ITEM_SIZE
+   * bytes of the new item, including header and trailer, are stored at
+   * NEW_OFFSET in the temporary rep file.  NEW_SIZE is the length of the
+   * new delta data. */
+  svn_boolean_t rewritten;
+  apr_off_t new_offset;
+  apr_off_t new_item_size;
+  svn_filesize_t new_size;
+
+  /* Delta chain lengths before and after the operation.  0 if unknown. */
+  int chain_len_before;
+  int chain_len_after;
+} rep_info_t;
+
+/* Data shared by all stages of a redeltify run.
+ */
+typedef struct redeltify_context_t
+{
+  /* The repository to process. */
+  svn_fs_t *fs;
+
+  /* The range of revisions to rewrite.  START_REV is the first revision
+   * of the first shard and END_REV is the first revision following the
+   * last shard. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+
+  /* rep_info_t * for all representations within the range, keyed by
+   * their svn_fs_fs__id_part_t location. */
+  apr_hash_t *reps;
+
+  /* Temporary file receiving the re-encoded representations. */
+  apr_file_t *rep_file;
+
+  /* Cancellation support. */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* Pool for all data that lives as long as the context. */
+  apr_pool_t *pool;
+} redeltify_context_t;
+
+/* Return TRUE, if REVISION is within the range processed by CONTEXT. */
+static svn_boolean_t
+in_range(redeltify_context_t *context,
+         svn_revnum_t revision)
+{
+  return revision >= context->start_rev && revision < context->end_rev;
+}
+
+/* Return the info on the representation at ITEM_INDEX in REVISION from
+ * CONTEXT.  If there is none, return NULL or, if CREATE is set, add and
+ * return a new, empty info struct.
+ */
+static rep_info_t *
+get_rep_info(redeltify_context_t *context,
+             svn_revnum_t revision,
+             apr_uint64_t item_index,
+             svn_boolean_t create)
+{
+  svn_fs_fs__id_part_t key;
+  rep_info_t *info;
+
+  /* The struct is used as a hash key.  Make sure any padding is zero. */
+  memset(&key, 0, sizeof(key));
+  key.revision = revision;
+  key.number = item_index;
+
+  info = apr_hash_get(context->reps, &key, sizeof(key));
+  if (info == NULL && create)
+    {
+      info = apr_pcalloc(context->pool, sizeof(*info));
+      info->key = key;
+      apr_hash_set(context->reps, &info->key, sizeof(info->key), info);
+    }
+
+  return info;
+}
+
+/* Implements svn_fs_fs__scan_visitor_t.  Record the representation
+ * header for ENTRY in the redeltify_context_t BATON.
+ */
+static svn_error_t *
+scan_rep(const svn_fs_fs__p2l_entry_t *entry,
+         svn_stream_t *contents,
+         void *baton,
+         apr_pool_t *scratch_pool)
+{
+  redeltify_context_t *context = baton;
+  rep_info_t *info = get_rep_info(context, entry->item.revision,
+                                  entry->item.number, TRUE);
+
+  info->type = entry->type;
+  info->item_size = entry->size;
+  SVN_ERR(svn_fs_fs__read_rep_header(&info->header, contents,
+                                     context->pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__scan_visitor_t.  If the node revision in ENTRY
+ * created a new file representation, remember it as the owner of that
+ * representation in the redeltify_context_t BATON.
+ */
+static svn_error_t *
+scan_noderev(const svn_fs_fs__p2l_entry_t *entry,
+             svn_stream_t *contents,
+             void *baton,
+             apr_pool_t *scratch_pool)
+{
+  redeltify_context_t *context = baton;
+  node_revision_t *noderev;
+  representation_t *rep;
+
+  SVN_ERR(svn_fs_fs__read_noderev(&noderev, contents, scratch_pool,
+                                  scratch_pool));
+
+  rep = noderev->data_rep;
+  if (   noderev->kind == svn_node_file
+      && rep
+      && rep->revision == svn_fs_fs__id_rev(noderev->id))
+    {
+      rep_info_t *info = get_rep_info(context, rep->revision,
+                                      rep->item_index, TRUE);
+
+      /* With rep-sharing, multiple nodes in the same revision may refer
+       * to the same new representation.  Any of them will do. */
+      if (info->rep == NULL)
+        {
+          info->rep = svn_fs_fs__rep_copy(rep, context->pool);
+          info->predecessor_count = noderev->predecessor_count;
+          info->predecessor_id
+            = noderev->predecessor_id
+            ? svn_fs_fs__id_copy(noderev->predecessor_id, context->pool)
+            : NULL;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Pin the representation at ITEM_INDEX in REVISION in CONTEXT, if it is
+ * within the processed range. */
+static void
+pin_rep(redeltify_context_t *context,
+        svn_revnum_t revision,
+        apr_uint64_t item_index)
+{
+  if (in_range(context, revision))
+    {
+      rep_info_t *info = get_rep_info(context, revision, item_index, FALSE);
+      if (info)
+        info->pinned = TRUE;
+    }
+}
+
+/* Implements svn_fs_fs__scan_visitor_t for revisions following the
+ * processed range.  Pin all representations referenced by the node
+ * revision in ENTRY.  BATON is the redeltify_context_t.
+ */
+static svn_error_t *
+pin_noderev_reps(const svn_fs_fs__p2l_entry_t *entry,
+                 svn_stream_t *contents,
+                 void *baton,
+                 apr_pool_t *scratch_pool)
+{
+  redeltify_context_t *context = baton;
+  node_revision_t *noderev;
+
+  SVN_ERR(svn_fs_fs__read_noderev(&noderev, contents, scratch_pool,
+                                  scratch_pool));
+
+  if (noderev->data_rep)
+    pin_rep(context, noderev->data_rep->revision,
+            noderev->data_rep->item_index);
+  if (noderev->prop_rep)
+    pin_rep(context, noderev->prop_rep->revision,
+            noderev->prop_rep->item_index);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__scan_visitor_t for revisions following the
+ * processed range.  Pin the delta base of the representation in ENTRY.
+ * BATON is the redeltify_context_t.
+ */
+static svn_error_t *
+pin_delta_base(const svn_fs_fs__p2l_entry_t *entry,
+               svn_stream_t *contents,
+               void *baton,
+               apr_pool_t *scratch_pool)
+{
+  redeltify_context_t *context = baton;
+  svn_fs_fs__rep_header_t *header;
+
+  SVN_ERR(svn_fs_fs__read_rep_header(&header, contents, scratch_pool,
+                                     scratch_pool));
+  if (header->type == svn_fs_fs__rep_delta)
+    pin_rep(context, header->base_revision, header->base_item_index);
+
+  return SVN_NO_ERROR;
+}
+
+/* Scan the rev / pack file containing REVISION in CONTEXT using VISITORS.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+scan_file(redeltify_context_t *context,
+          svn_revnum_t revision,
+          const svn_fs_fs__scan_visitors_t *visitors,
+          apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__revision_file_t *rev_file;
+
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, context->fs, revision,
+                                           scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__scan_items(context->fs, rev_file, visitors, context,
+                                context->cancel_func, context->cancel_baton,
+                                scratch_pool));
+
+  return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+}
+
+/* Collect the representations in CONTEXT's range and pin all that get
+ * referenced from later revisions.  YOUNGEST is the youngest revision in
+ * the repository.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+collect_reps(redeltify_context_t *context,
+             svn_revnum_t youngest,
+             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = context->fs->fsap_data;
+  svn_fs_fs__scan_visitors_t visitors = { { 0 } };
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t revision;
+
+  /* All representations and their owners within the range. */
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_FILE_REP] = scan_rep;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_DIR_REP] = scan_rep;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_FILE_PROPS] = scan_rep;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_DIR_PROPS] = scan_rep;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_NODEREV] = scan_noderev;
+
+  for (revision = context->start_rev;
+       revision < context->end_rev;
+       revision += ffd->max_files_per_dir)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(scan_file(context, revision, &visitors, iterpool));
+    }
+
+  /* References can only point backwards in history.  So, only later
+   * revisions may keep us from changing a representation. */
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_FILE_REP] = pin_delta_base;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_DIR_REP] = pin_delta_base;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_FILE_PROPS] = pin_delta_base;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_DIR_PROPS] = pin_delta_base;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_NODEREV] = pin_noderev_reps;
+
+  while (revision <= youngest)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(scan_file(context, revision, &visitors, iterpool));
+
+      revision = svn_fs_fs__is_packed_rev(context->fs, revision)
+               ? revision + ffd->max_files_per_dir
+               : revision + 1;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *CHAIN_LEN to the length of the delta chain starting at the
+ * representation at ITEM_INDEX in REVISION as it will be after all
+ * representations processed so far by CONTEXT will have been replaced.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+get_chain_len_after(int *chain_len,
+                    redeltify_context_t *context,
+                    svn_revnum_t revision,
+                    apr_uint64_t item_index,
+                    apr_pool_t *scratch_pool)
+{
+  representation_t rep = { 0 };
+  int shard_count;
+  rep_info_t *info = get_rep_info(context, revision, item_index, FALSE);
+
+  if (info && info->chain_len_after)
+    {
+      *chain_len = info->chain_len_after;
+      return SVN_NO_ERROR;
+    }
+
+  /* This one and its bases remain as they are. */
+  rep.revision = revision;
+  rep.item_index = item_index;
+  svn_fs_fs__id_txn_reset(&rep.txn_id);
+
+  return svn_error_trace(svn_fs_fs__rep_chain_length(chain_len,
+                                                     &shard_count, &rep,
+                                                     context->fs,
+                                                     scratch_pool));
+}
+
+/* Set *BASE_REP to the pure skip-delta base for the representation in
+ * INFO and *BASE_CHAIN_LEN to the length of the delta chain starting at
+ * that base.  Set *BASE_REP to NULL, if we should not deltify against any
+ * other representation.  This is the same as choose_delta_base() in
+ * transaction.c minus the linear deltification for young nodes.  Allocate
+ * the result in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+choose_delta_base(representation_t **base_rep,
+                  int *base_chain_len,
+                  redeltify_context_t *context,
+                  rep_info_t *info,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = context->fs->fsap_data;
+  node_revision_t *base = NULL;
+  const svn_fs_id_t *id = info->predecessor_id;
+  apr_pool_t *iterpool;
+  representation_t *rep;
+  int count;
+  int walk;
+
+  *base_rep = NULL;
+  *base_chain_len = 0;
+  if (info->predecessor_count == 0 || id == NULL)
+    return SVN_NO_ERROR;
+
+  /* Flip the rightmost '1' bit of the predecessor count to determine
+     which file rev (counting from 0) we want to use.  Very long walks
+     are too expensive and simply start a new delta chain. */
+  count = info->predecessor_count & (info->predecessor_count - 1);
+  walk = info->predecessor_count - count;
+  if (walk > (int)ffd->max_deltification_walk)
+    return SVN_NO_ERROR;
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (; walk > 0; --walk)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__get_node_revision(&base, context->fs, id,
+                                           result_pool, iterpool));
+      id = base->predecessor_id;
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Very short rep bases are simply not worth it. */
+  rep = base->data_rep;
+  if (rep == NULL || rep->expanded_size < 64)
+    return SVN_NO_ERROR;
+
+  /* Shared reps may form a non-skipping delta chain in extreme cases. */
+  SVN_ERR(get_chain_len_after(base_chain_len, context, rep->revision,
+                              rep->item_index, scratch_pool));
+  if (*base_chain_len >= 2 * (int)ffd->max_linear_deltification + 2)
+    return SVN_NO_ERROR;
+
+  *base_rep = rep;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *HANDLER and *HANDLER_BATON to a window handler writing svndiff data
+ * to OUTPUT for FS.  Like txdelta_to_svndiff() in transaction.c, use the
+ * repository's configured compression type.  We have plenty of time for
+ * an offline operation, though, so use the best zlib compression.
+ * Allocate the handler in POOL.
+ */
+static void
+txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
+                   void **handler_baton,
+                   svn_stream_t *output,
+                   svn_fs_t *fs,
+                   apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->delta_compression_type == compression_type_lz4)
+    svn_txdelta_to_svndiff3(handler, handler_baton, output, 2,
+                            ffd->delta_compression_level, pool);
+  else if (ffd->delta_compression_type == compression_type_zlib)
+    svn_txdelta_to_svndiff3(handler, handler_baton, output, 1,
+                            SVN_DELTA_COMPRESSION_LEVEL_MAX, pool);
+  else
+    svn_txdelta_to_svndiff3(handler, handler_baton, output, 0,
+                            SVN_DELTA_COMPRESSION_LEVEL_NONE, pool);
+}
+
+/* Set INFO->CHAIN_LEN_AFTER for a representation that we keep as is.
+ * CONTEXT is the redeltify context.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+keep_rep(redeltify_context_t *context,
+         rep_info_t *info,
+         apr_pool_t *scratch_pool)
+{
+  if (info->header->type == svn_fs_fs__rep_delta)
+    {
+      int base_chain_len;
+      SVN_ERR(get_chain_len_after(&base_chain_len, context,
+                                  info->header->base_revision,
+                                  info->header->base_item_index,
+                                  scratch_pool));
+      info->chain_len_after = base_chain_len + 1;
+    }
+  else
+    {
+      info->chain_len_after = 1;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Re-encode the representation in INFO against its skip-delta base and
+ * append it to CONTEXT's temporary rep file.  Only keep the new encoding
+ * if it shortens the delta chain or, at equal length, saves space.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+redeltify_rep(redeltify_context_t *context,
+              rep_info_t *info,
+              apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = context->fs;
+  representation_t *base_rep;
+  svn_fs_fs__rep_header_t header = { 0 };
+  svn_stream_t *source;
+  svn_stream_t *target;
+  svn_stream_t *output;
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_checksum_t *md5;
+  svn_checksum_t expected;
+  apr_off_t start;
+  apr_off_t delta_start;
+  apr_off_t delta_end;
+  svn_filesize_t old_size;
+  int chain_len;
+
+  SVN_ERR(choose_delta_base(&base_rep, &chain_len, context, info,
+                            scratch_pool, scratch_pool));
+  ++chain_len;
+
+  /* Never make the reconstruction more expensive. */
+  if (chain_len > info->chain_len_before)
+    return svn_error_trace(keep_rep(context, info, scratch_pool));
+
+  if (base_rep)
+    {
+      rep_info_t *base_info = get_rep_info(context, base_rep->revision,
+                                           base_rep->item_index, FALSE);
+
+      header.type = svn_fs_fs__rep_delta;
+      header.base_revision = base_rep->revision;
+      header.base_item_index = base_rep->item_index;
+      header.base_length = base_info && base_info->rewritten
+                         ? base_info->new_size
+                         : base_rep->size;
+
+      /* All representations still get read from the original files. */
+      SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, FALSE,
+                                      scratch_pool));
+    }
+  else
+    {
+      header.type = svn_fs_fs__rep_self_delta;
+      source = svn_stream_empty(scratch_pool);
+    }
+
+  SVN_ERR(svn_fs_fs__get_contents(&target, fs, info->rep, FALSE,
+                                  scratch_pool));
+  target = svn_stream_checksummed2(target, &md5, NULL, svn_checksum_md5,
+                                   TRUE, scratch_pool);
+
+  /* Write the new representation. */
+  SVN_ERR(svn_io_file_get_offset(&start, context->rep_file, scratch_pool));
+  output = svn_stream_from_aprfile2(context->rep_file, TRUE, scratch_pool);
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, output, scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&delta_start, context->rep_file,
+                                 scratch_pool));
+
+  svn_txdelta2(&delta_stream, source, target, FALSE, scratch_pool);
+  txdelta_to_svndiff(&handler, &handler_baton, output, fs, scratch_pool);
+  SVN_ERR(svn_txdelta_send_txstream(delta_stream, handler, handler_baton,
+                                    scratch_pool));
+
+  SVN_ERR(svn_io_file_get_offset(&delta_end, context->rep_file,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_write_full(context->rep_file, REP_TRAILER,
+                                 REP_TRAILER_LEN, NULL, scratch_pool));
+
+  /* The contents must not change. */
+  SVN_ERR(svn_stream_close(target));
+  expected.kind = svn_checksum_md5;
+  expected.digest = info->rep->md5_digest;
+  if (!svn_checksum_match(&expected, md5))
+    return svn_error_trace(svn_checksum_mismatch_err(&expected, md5,
+                 scratch_pool,
+                 _("Checksum mismatch while redeltifying representation"
+                   " r%ld/%s"),
+                 info->key.revision,
+                 apr_psprintf(scratch_pool, "%" APR_UINT64_T_FMT,
+                              info->key.number)));
+
+  /* Keep it? */
+  old_size = info->item_size - info->header->header_size - REP_TRAILER_LEN;
+  if (chain_len == info->chain_len_before
+      && delta_end - delta_start >= old_size)
+    {
+      SVN_ERR(svn_io_file_seek(context->rep_file, APR_SET, &start,
+                               scratch_pool));
+      return svn_error_trace(keep_rep(context, info, scratch_pool));
+    }
+
+  info->rewritten = TRUE;
+  info->new_offset = start;
+  info->new_item_size = delta_end - start + REP_TRAILER_LEN;
+  info->new_size = delta_end - delta_start;
+  info->chain_len_after = chain_len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Comparator for svn_sort__array, ordering rep_info_t * by location. */
+static int
+compare_rep_info(const void *lhs,
+                 const void *rhs)
+{
+  const rep_info_t *lhs_info = *(const rep_info_t *const *)lhs;
+  const rep_info_t *rhs_info = *(const rep_info_t *const *)rhs;
+
+  if (lhs_info->key.revision != rhs_info->key.revision)
+    return lhs_info->key.revision < rhs_info->key.revision ? -1 : 1;
+  if (lhs_info->key.number != rhs_info->key.number)
+    return lhs_info->key.number < rhs_info->key.number ? -1 : 1;
+
+  return 0;
+}
+
+/* Return all file representations in CONTEXT as an array of rep_info_t *
+ * sorted by location.  Allocate the result in RESULT_POOL.
+ */
+static apr_array_header_t *
+get_file_reps(redeltify_context_t *context,
+              apr_pool_t *result_pool)
+{
+  apr_array_header_t *result
+    = apr_array_make(result_pool, apr_hash_count(context->reps),
+                     sizeof(rep_info_t *));
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(result_pool, context->reps);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      rep_info_t *info = apr_hash_this_val(hi);
+      if (info->type == SVN_FS_FS__ITEM_TYPE_FILE_REP)
+        APR_ARRAY_PUSH(result, rep_info_t *) = info;
+    }
+
+  svn_sort__array(result, compare_rep_info);
+
+  return result;
+}
+
+/* Re-encode all eligible file representations in REPS, an array of
+ * rep_info_t * sorted by location, and determine the new delta chain
+ * lengths.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * Because delta bases are always older than the representations using
+ * them, the new sizes and chain lengths of all bases will be known when
+ * we need them.
+ */
+static svn_error_t *
+redeltify_reps(redeltify_context_t *context,
+               apr_array_header_t *reps,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < reps->nelts; ++i)
+    {
+      rep_info_t *info = APR_ARRAY_IDX(reps, i, rep_info_t *);
+      representation_t rep = { 0 };
+      int shard_count;
+
+      svn_pool_clear(iterpool);
+      if (context->cancel_func)
+        SVN_ERR(context->cancel_func(context->cancel_baton));
+
+      rep.revision = info->key.revision;
+      rep.item_index = info->key.number;
+      svn_fs_fs__id_txn_reset(&rep.txn_id);
+      SVN_ERR(svn_fs_fs__rep_chain_length(&info->chain_len_before,
+                                          &shard_count, &rep, context->fs,
+                                          iterpool));
+
+      /* Only DELTA reps that nobody outside the range depends upon and
+       * whose node we know can be changed. */
+      if (   info->rep
+          && !info->pinned
+          && info->header->type != svn_fs_fs__rep_plain)
+        SVN_ERR(redeltify_rep(context, info, iterpool));
+      else
+        SVN_ERR(keep_rep(context, info, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton used while writing a new pack file.
+ */
+typedef struct write_baton_t
+{
+  /* The redeltify context. */
+  redeltify_context_t *context;
+
+  /* The new pack file and the number of bytes written to it so far. */
+  apr_file_t *file;
+  apr_off_t offset;
+
+  /* svn_fs_fs__p2l_entry_t * for all items written so far. */
+  apr_array_header_t *entries;
+
+  /* Pool for the ENTRIES. */
+  apr_pool_t *pool;
+} write_baton_t;
+
+/* Add a p2l entry describing the SIZE bytes just written for the item in
+ * ENTRY to BATON.
+ */
+static void
+add_entry(write_baton_t *baton,
+          const svn_fs_fs__p2l_entry_t *entry,
+          apr_off_t size)
+{
+  svn_fs_fs__p2l_entry_t *new_entry
+    = apr_pmemdup(baton->pool, entry, sizeof(*entry));
+
+  new_entry->offset = baton->offset;
+  new_entry->size = size;
+  new_entry->fnv1_checksum = 0;
+  APR_ARRAY_PUSH(baton->entries, svn_fs_fs__p2l_entry_t *) = new_entry;
+
+  baton->offset += size;
+}
+
+/* Copy the contents of STREAM to the new pack file in BATON.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+copy_stream(write_baton_t *baton,
+            svn_stream_t *stream,
+            apr_pool_t *scratch_pool)
+{
+  redeltify_context_t *context = baton->context;
+
+  return svn_error_trace(svn_stream_copy3(stream,
+                            svn_stream_from_aprfile2(baton->file, TRUE,
+                                                     scratch_pool),
+                            context->cancel_func, context->cancel_baton,
+                            scratch_pool));
+}
+
+/* Implements svn_fs_fs__scan_visitor_t.  Copy the item in ENTRY
+ * unchanged to the new pack file in the write_baton_t BATON.
+ */
+static svn_error_t *
+write_item(const svn_fs_fs__p2l_entry_t *entry,
+           svn_stream_t *contents,
+           void *baton,
+           apr_pool_t *scratch_pool)
+{
+  SVN_ERR(copy_stream(baton, contents, scratch_pool));
+  add_entry(baton, entry, entry->size);
+
+  return SVN_NO_ERROR;
+}
+
+/* Copy the re-encoded representation in INFO from the temporary rep file
+ * to the new pack file in BATON.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+copy_new_rep(write_baton_t *baton,
+             rep_info_t *info,
+             apr_pool_t *scratch_pool)
+{
+  apr_file_t *rep_file = baton->context->rep_file;
+  apr_off_t offset = info->new_offset;
+  apr_off_t remaining = info->new_item_size;
+  char *buffer = apr_palloc(scratch_pool, SVN__STREAM_CHUNK_SIZE);
+
+  SVN_ERR(svn_io_file_seek(rep_file, APR_SET, &offset, scratch_pool));
+  while (remaining > 0)
+    {
+      apr_size_t to_copy = (apr_size_t)MIN(SVN__STREAM_CHUNK_SIZE,
+                                           remaining);
+
+      SVN_ERR(svn_io_file_read_full2(rep_file, buffer, to_copy, NULL, NULL,
+                                     scratch_pool));
+      SVN_ERR(svn_io_file_write_full(baton->file, buffer, to_copy, NULL,
+                                     scratch_pool));
+      remaining -= to_copy;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__scan_visitor_t.  Write the representation in
+ * ENTRY to the new pack file in the write_baton_t BATON.  That is either
+ * the re-encoded one or the original one with its delta base size
+ * updated as necessary.
+ */
+static svn_error_t *
+write_rep(const svn_fs_fs__p2l_entry_t *entry,
+          svn_stream_t *contents,
+          void *baton,
+          apr_pool_t *scratch_pool)
+{
+  write_baton_t *b = baton;
+  redeltify_context_t *context = b->context;
+  rep_info_t *info = get_rep_info(context, entry->item.revision,
+                                  entry->item.number, FALSE);
+  rep_info_t *base_info = NULL;
+
+  if (info && info->rewritten)
+    {
+      SVN_ERR(copy_new_rep(b, info, scratch_pool));
+      add_entry(b, entry, info->new_item_size);
+
+      return SVN_NO_ERROR;
+    }
+
+  if (info && info->header->type == svn_fs_fs__rep_delta)
+    base_info = get_rep_info(context, info->header->base_revision,
+                             info->header->base_item_index, FALSE);
+
+  if (base_info && base_info->rewritten)
+    {
+      svn_fs_fs__rep_header_t header = *info->header;
+      svn_stringbuf_t *buffer = svn_stringbuf_create_empty(scratch_pool);
+
+      header.base_length = base_info->new_size;
+      SVN_ERR(svn_fs_fs__write_rep_header(&header,
+                                          svn_stream_from_stringbuf(buffer,
+                                                              scratch_pool),
+                                          scratch_pool));
+      SVN_ERR(svn_io_file_write_full(b->file, buffer->data, buffer->len,
+                                     NULL, scratch_pool));
+
+      SVN_ERR(svn_stream_skip(contents, info->header->header_size));
+      SVN_ERR(copy_stream(b, contents, scratch_pool));
+      add_entry(b, entry,
+                buffer->len + entry->size - info->header->header_size);
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(write_item(entry, contents, baton, scratch_pool));
+}
+
+/* If the node revision header LINE of LEN bytes, starting with a PREFIX,
+ * references a re-encoded representation in CONTEXT, set *PATCHED to the
+ * same line with the new representation size.  Otherwise, set *PATCHED
+ * to NULL.  Allocate the result in RESULT_POOL.
+ */
+static svn_error_t *
+patch_rep_line(const char **patched,
+               redeltify_context_t *context,
+               const char *line,
+               apr_size_t len,
+               const char *prefix,
+               apr_pool_t *result_pool)
+{
+  apr_size_t prefix_len = strlen(prefix);
+  apr_array_header_t *tokens;
+  svn_revnum_t revision;
+  apr_uint64_t item_index;
+  rep_info_t *info;
+
+  *patched = NULL;
+  if (len <= prefix_len || strncmp(line, prefix, prefix_len))
+    return SVN_NO_ERROR;
+
+  /* Tokens are: revision, item index, size, expanded size, ... */
+  tokens = svn_cstring_split(apr_pstrmemdup(result_pool, line + prefix_len,
+                                            len - prefix_len - 1),
+                             " ", FALSE, result_pool);
+  if (tokens->nelts < 4)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_revnum_parse(&revision, APR_ARRAY_IDX(tokens, 0, const char *),
+                           NULL));
+  SVN_ERR(svn_cstring_atoui64(&item_index,
+                              APR_ARRAY_IDX(tokens, 1, const char *)));
+
+  info = get_rep_info(context, revision, item_index, FALSE);
+  if (info && info->rewritten)
+    {
+      APR_ARRAY_IDX(tokens, 2, const char *)
+        = apr_psprintf(result_pool, "%" SVN_FILESIZE_T_FMT, info->new_size);
+      *patched = apr_pstrcat(result_pool, prefix,
+                             svn_cstring_join2(tokens, " ", FALSE,
+                                               result_pool),
+                             "\n", SVN_VA_NULL);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__scan_visitor_t.  Write the node revision in ENTRY
+ * to the new pack file in the write_baton_t BATON, updating the sizes of
+ * all re-encoded representations that it references.  Everything else
+ * remains byte-identical.
+ */
+static svn_error_t *
+write_noderev(const svn_fs_fs__p2l_entry_t *entry,
+              svn_stream_t *contents,
+              void *baton,
+              apr_pool_t *scratch_pool)
+{
+  write_baton_t *b = baton;
+  svn_stringbuf_t *text;
+  svn_stringbuf_t *result;
+  const char *line;
+  const char *end;
+
+  SVN_ERR(svn_stringbuf_from_stream(&text, contents,
+                                    (apr_size_t)entry->size, scratch_pool));
+  result = svn_stringbuf_create_ensure(text->len + 16, scratch_pool);
+
+  for (line = text->data, end = text->data + text->len; line < end; )
+    {
+      const char *eol = memchr(line, '\n', end - line);
+      apr_size_t len = eol ? (apr_size_t)(eol - line + 1)
+                           : (apr_size_t)(end - line);
+      const char *patched = NULL;
+
+      if (eol)
+        {
+          SVN_ERR(patch_rep_line(&patched, b->context, line, len,
+                                 TEXT_PREFIX, scratch_pool));
+          if (!patched)
+            SVN_ERR(patch_rep_line(&patched, b->context, line, len,
+                                   PROPS_PREFIX, scratch_pool));
+        }
+
+      if (patched)
+        svn_stringbuf_appendcstr(result, patched);
+      else
+        svn_stringbuf_appendbytes(result, line, len);
+
+      line += len;
+    }
+
+  SVN_ERR(svn_io_file_write_full(b->file, result->data, result->len, NULL,
+                                 scratch_pool));
+  add_entry(b, entry, result->len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the new pack file for the shard starting at SHARD_REV in CONTEXT
+ * to PATH_REDELTIFIED_PACK next to the original one, replacing any left
+ * over from a failed run.  Return the size of the original and the new
+ * pack file contents, excluding indexes, in *SIZE_BEFORE and *SIZE_AFTER,
+ * respectively.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_pack(apr_uint64_t *size_before,
+           apr_uint64_t *size_after,
+           redeltify_context_t *context,
+           svn_revnum_t shard_rev,
+           apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = context->fs;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__scan_visitors_t visitors = { { 0 } };
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__revision_file_t *new_file;
+  write_baton_t baton = { 0 };
+  const char *l2p_proto_index;
+  const char *p2l_proto_index;
+  apr_off_t max_offset;
+
+  SVN_ERR(svn_io_file_open(&baton.file,
+                           svn_fs_fs__path_rev_packed(fs, shard_rev,
+                                                      PATH_REDELTIFIED_PACK,
+                                                      scratch_pool),
+                           APR_READ | APR_WRITE | APR_CREATE
+                           | APR_TRUNCATE | APR_BUFFERED,
+                           APR_OS_DEFAULT, scratch_pool));
+  baton.context = context;
+  baton.entries = apr_array_make(scratch_pool, 1024,
+                                 sizeof(svn_fs_fs__p2l_entry_t *));
+  baton.pool = scratch_pool;
+
+  /* Copy all items in their original order.  Since the item sizes change,
+   * any block alignment is lost anyway.  So, drop the padding. */
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_FILE_REP] = write_rep;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_DIR_REP] = write_rep;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_FILE_PROPS] = write_rep;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_DIR_PROPS] = write_rep;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_NODEREV] = write_noderev;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_CHANGES] = write_item;
+
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, shard_rev,
+                                           scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__p2l_get_max_offset(&max_offset, fs, rev_file,
+                                        shard_rev, scratch_pool));
+  SVN_ERR(svn_fs_fs__scan_items(fs, rev_file, &visitors, &baton,
+                                context->cancel_func, context->cancel_baton,
+                                scratch_pool));
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Create the new indexes.  The p2l checksums get calculated from the
+   * new file contents. */
+  SVN_ERR(svn_fs_fs__wrap_temp_rev_file(&new_file, fs, baton.file,
+                                        shard_rev, scratch_pool));
+  SVN_ERR(svn_fs_fs__p2l_index_from_p2l_entries(&p2l_proto_index, fs,
+                                                new_file, baton.entries,
+                                                scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__l2p_index_from_p2l_entries(&l2p_proto_index, fs,
+                                                baton.entries,
+                                                scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__add_index_data(fs, baton.file, l2p_proto_index,
+                                    p2l_proto_index, shard_rev,
+                                    scratch_pool));
+
+  if (ffd->flush_to_disk)
+    SVN_ERR(svn_io_file_flush_to_disk(baton.file, scratch_pool));
+  SVN_ERR(svn_io_file_close(baton.file, scratch_pool));
+
+  *size_before = (apr_uint64_t)max_offset;
+  *size_after = (apr_uint64_t)baton.offset;
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the results for all representations in REPS, an array of
+ * rep_info_t * sorted by location, that belong to revisions before
+ * END_REV to INFO.  Start at index *NEXT and update it to point to the
+ * first element not processed.
+ */
+static void
+add_shard_info(svn_fs_fs__redeltify_info_t *info,
+               apr_array_header_t *reps,
+               int *next,
+               svn_revnum_t end_rev)
+{
+  for (; *next < reps->nelts; ++*next)
+    {
+      const rep_info_t *rep = APR_ARRAY_IDX(reps, *next, const rep_info_t *);
+      if (rep->key.revision >= end_rev)
+        break;
+
+      ++info->rep_count;
+      if (rep->rewritten)
+        ++info->redeltified_count;
+
+      info->chain_len_before += rep->chain_len_before;
+      info->chain_len_after += rep->chain_len_after;
+      info->max_chain_len_before = MAX(info->max_chain_len_before,
+                                       (apr_uint64_t)rep->chain_len_before);
+      info->max_chain_len_after = MAX(info->max_chain_len_after,
+                                      (apr_uint64_t)rep->chain_len_after);
+    }
+}
+
+/* Return the path of the journal that lists all pending changes of an
+ * interrupted redeltify run in FS.  Allocate the result in RESULT_POOL.
+ */
+static const char *
+path_journal(svn_fs_t *fs,
+             apr_pool_t *result_pool)
+{
+  return svn_dirent_join(fs->path, PATH_REDELTIFY_JOURNAL, result_pool);
+}
+
+/* Journal line prefixes.  Each "pack SHARD_REV" line names a shard whose
+ * PATH_REDELTIFIED_PACK replaces its pack file.  Each "rep REVISION ITEM
+ * SIZE" line gives the new on-disk size of a representation. */
+#define JOURNAL_PACK "pack"
+#define JOURNAL_REP "rep"
+
+/* Record all changes that CONTEXT still has to make to its repository in
+ * the journal: the new pack files for all shards and the new sizes of all
+ * re-encoded representations in REPS, an array of rep_info_t *.  Once the
+ * journal exists, svn_fs_fs__complete_redeltify() will roll the operation
+ * forward.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_journal(redeltify_context_t *context,
+              apr_array_header_t *reps,
+              apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = context->fs;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_stringbuf_t *journal = svn_stringbuf_create_empty(scratch_pool);
+  svn_revnum_t shard_rev;
+  int i;
+
+  for (shard_rev = context->start_rev;
+       shard_rev < context->end_rev;
+       shard_rev += ffd->max_files_per_dir)
+    svn_stringbuf_appendcstr(journal,
+                             apr_psprintf(scratch_pool,
+                                          JOURNAL_PACK " %ld\n", shard_rev));
+
+  for (i = 0; i < reps->nelts; ++i)
+    {
+      const rep_info_t *info = APR_ARRAY_IDX(reps, i, const rep_info_t *);
+      if (info->rewritten)
+        svn_stringbuf_appendcstr(journal,
+                                 apr_psprintf(scratch_pool,
+                                              JOURNAL_REP " %ld %"
+                                              APR_UINT64_T_FMT " %"
+                                              SVN_FILESIZE_T_FMT "\n",
+                                              info->key.revision,
+                                              info->key.number,
+                                              info->new_size));
+    }
+
+  /* The new pack files must be complete before we refer to them. */
+  return svn_error_trace(svn_io_write_atomic2(path_journal(fs, scratch_pool),
+                                              journal->data, journal->len,
+                                              NULL, ffd->flush_to_disk,
+                                              scratch_pool));
+}
+
+/* Set the on-disk sizes of the representation_t * in REPS in the
+ * rep-cache of FS.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+update_rep_cache(svn_fs_t *fs,
+                 apr_array_header_t *reps,
+                 apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_boolean_t exists;
+
+  if (reps->nelts == 0 || ffd->format < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__exists_rep_cache(&exists, fs, scratch_pool));
+  if (!exists)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_fs_fs__update_rep_sizes(fs, reps,
+                                                     scratch_pool));
+}
+
+/* Implements the svn_fs_fs__with_all_locks() callback.  Complete the
+ * redeltify run recorded in the journal of the svn_fs_t given as BATON,
+ * if there is one:  Move all new pack files into place, update the
+ * rep-cache, bump the instance ID and finally remove the journal.
+ * Every step may be repeated, so this works on interrupted runs as well
+ * as on interrupted completions.
+ */
+static svn_error_t *
+complete_journal(void *baton,
+                 apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = baton;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *journal_path = path_journal(fs, scratch_pool);
+  svn_stringbuf_t *journal;
+  apr_array_header_t *lines;
+  apr_array_header_t *reps;
+  apr_pool_t *iterpool;
+  svn_error_t *err;
+  int i;
+
+  err = svn_stringbuf_from_file2(&journal, journal_path, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  lines = svn_cstring_split(journal->data, "\n", TRUE, scratch_pool);
+  reps = apr_array_make(scratch_pool, lines->nelts,
+                        sizeof(representation_t *));
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < lines->nelts; ++i)
+    {
+      apr_array_header_t *tokens;
+      const char *type;
+      apr_int64_t values[3];
+      int k;
+
+      svn_pool_clear(iterpool);
+      tokens = svn_cstring_split(APR_ARRAY_IDX(lines, i, const char *),
+                                 " ", TRUE, iterpool);
+      type = tokens->nelts ? APR_ARRAY_IDX(tokens, 0, const char *) : "";
+      if (   !(strcmp(type, JOURNAL_PACK) == 0 && tokens->nelts == 2)
+          && !(strcmp(type, JOURNAL_REP) == 0 && tokens->nelts == 4))
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Malformed redeltify journal '%s'"),
+                                 svn_dirent_local_style(journal_path,
+                                                        iterpool));
+
+      for (k = 1; k < tokens->nelts; ++k)
+        SVN_ERR(svn_cstring_atoi64(&values[k - 1],
+                                   APR_ARRAY_IDX(tokens, k, const char *)));
+
+      if (tokens->nelts == 2)
+        {
+          svn_revnum_t shard_rev = (svn_revnum_t)values[0];
+          const char *new_path
+            = svn_fs_fs__path_rev_packed(fs, shard_rev,
+                                         PATH_REDELTIFIED_PACK, iterpool);
+          const char *pack_path
+            = svn_fs_fs__path_rev_packed(fs, shard_rev, PATH_PACKED,
+                                         iterpool);
+          svn_node_kind_t kind;
+
+          /* A missing new pack file has already been moved into place. */
+          SVN_ERR(svn_io_check_path(new_path, &kind, iterpool));
+          if (kind == svn_node_file)
+            SVN_ERR(svn_fs_fs__move_into_place(new_path, pack_path,
+                                               pack_path,
+                                               ffd->flush_to_disk,
+                                               iterpool));
+        }
+      else
+        {
+          representation_t *rep = apr_pcalloc(scratch_pool, sizeof(*rep));
+          rep->revision = (svn_revnum_t)values[0];
+          rep->item_index = (apr_uint64_t)values[1];
+          rep->size = (svn_filesize_t)values[2];
+          APR_ARRAY_PUSH(reps, representation_t *) = rep;
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Setting the same sizes again is harmless. */
+  SVN_ERR(update_rep_cache(fs, reps, scratch_pool));
+
+  /* Cached data on the old pack files must not be used anymore.  A new
+   * instance ID makes all cache keys for this repository change. */
+  SVN_ERR(svn_fs_fs__set_uuid(fs, fs->uuid, NULL, scratch_pool));
+
+  return svn_error_trace(svn_io_remove_file2(journal_path, FALSE,
+                                             scratch_pool));
+}
+
+/* Remove the PATH_REDELTIFIED_PACK files written by CONTEXT for the shards
+ * before END_REV.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+remove_new_packs(redeltify_context_t *context,
+                 svn_revnum_t end_rev,
+                 apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = context->fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t shard_rev;
+
+  for (shard_rev = context->start_rev;
+       shard_rev < end_rev;
+       shard_rev += ffd->max_files_per_dir)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_remove_file2(
+                  svn_fs_fs__path_rev_packed(context->fs, shard_rev,
+                                             PATH_REDELTIFIED_PACK,
+                                             iterpool),
+                  TRUE, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for redeltify_body(), containing the arguments passed to
+ * svn_fs_fs__redeltify(). */
+typedef struct redeltify_baton_t
+{
+  svn_fs_t *fs;
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_fs_fs__redeltify_notify_t notify_func;
+  void *notify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} redeltify_baton_t;
+
+/* Implements the svn_fs_fs__with_all_locks() callback for
+ * svn_fs_fs__redeltify().  BATON is a redeltify_baton_t.
+ */
+static svn_error_t *
+redeltify_body(void *baton,
+               apr_pool_t *scratch_pool)
+{
+  redeltify_baton_t *b = baton;
+  svn_fs_t *fs = b->fs;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  redeltify_context_t context = { 0 };
+  apr_array_header_t *txns;
+  apr_array_header_t *reps;
+  apr_pool_t *iterpool;
+  svn_revnum_t shard_rev;
+  svn_revnum_t end_rev = MIN(b->end_rev, ffd->min_unpacked_rev - 1);
+  int next = 0;
+
+  /* Never start over a journal that has not been completed, yet. */
+  SVN_ERR(complete_journal(fs, scratch_pool));
+
+  /* Transactions may refer to any representation.  We can't update them. */
+  SVN_ERR(svn_fs_fs__list_transactions(&txns, fs, scratch_pool));
+  if (txns->nelts)
+    return svn_error_createf(SVN_ERR_FS_TRANSACTION_NOT_DEAD, NULL,
+                             _("Cannot redeltify while there are %d"
+                               " outstanding transactions"),
+                             txns->nelts);
+
+  /* Only packed shards will be processed. */
+  if (b->start_rev > end_rev)
+    return SVN_NO_ERROR;
+
+  context.fs = fs;
+  context.start_rev = svn_fs_fs__packed_base_rev(fs, b->start_rev);
+  context.end_rev = svn_fs_fs__packed_base_rev(fs, end_rev)
+                  + ffd->max_files_per_dir;
+  context.reps = apr_hash_make(scratch_pool);
+  context.cancel_func = b->cancel_func;
+  context.cancel_baton = b->cancel_baton;
+  context.pool = scratch_pool;
+  SVN_ERR(svn_io_open_unique_file3(&context.rep_file, NULL, fs->path,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   scratch_pool, scratch_pool));
+
+  /* Re-encode the representations.  Until all new pack files have been
+   * written, all data gets read from the original files. */
+  SVN_ERR(collect_reps(&context, ffd->youngest_rev_cache, scratch_pool));
+  reps = get_file_reps(&context, scratch_pool);
+  SVN_ERR(redeltify_reps(&context, reps, scratch_pool));
+
+  /* Write the new pack files next to the old ones.  Should that fail,
+   * the repository remains unchanged. */
+  iterpool = svn_pool_create(scratch_pool);
+  for (shard_rev = context.start_rev;
+       shard_rev < context.end_rev;
+       shard_rev += ffd->max_files_per_dir)
+    {
+      svn_fs_fs__redeltify_info_t info = { 0 };
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      info.shard_rev = shard_rev;
+      err = write_pack(&info.size_before, &info.size_after, &context,
+                       shard_rev, iterpool);
+      if (err)
+        return svn_error_compose_create(err,
+                                        remove_new_packs(&context,
+                                                         shard_rev + 1,
+                                                         iterpool));
+
+      add_shard_info(&info, reps, &next,
+                     shard_rev + ffd->max_files_per_dir);
+
+      if (b->notify_func)
+        b->notify_func(&info, b->notify_baton, iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Replacing the pack files one by one leaves the repository in an
+   * inconsistent state until the rep-cache has been updated as well.
+   * Journal all the remaining steps first.  Should we get interrupted,
+   * the next svn_fs_open() will complete them. */
+  SVN_ERR(write_journal(&context, reps, scratch_pool));
+
+  return svn_error_trace(complete_journal(fs, scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__check_redeltify(svn_fs_t *fs,
+                           apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_node_kind_t kind;
+
+  ffd->redeltify_pending = FALSE;
+  if (! svn_fs_fs__use_log_addressing(fs))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_io_check_path(path_journal(fs, scratch_pool), &kind,
+                            scratch_pool));
+  ffd->redeltify_pending = (kind != svn_node_none);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__complete_redeltify(svn_fs_t *fs,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
+
+  if (! ffd->redeltify_pending)
+    return SVN_NO_ERROR;
+
+  /* Taking all locks calls us again; don't recurse. */
+  ffd->redeltify_pending = FALSE;
+  err = svn_fs_fs__with_all_locks(fs, complete_journal, fs, scratch_pool);
+  if (err)
+    {
+      ffd->redeltify_pending = TRUE;
+      return svn_error_trace(err);
+    }
+
+  /* Our caches still use the old instance ID.  Switch to new ones. */
+  return svn_error_trace(svn_fs_fs__initialize_caches(fs, scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__complete_redeltify_locked(svn_fs_t *fs,
+                                     apr_pool_t *scratch_pool)
+{
+  if (! svn_fs_fs__use_log_addressing(fs))
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(complete_journal(fs, scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__redeltify(svn_fs_t *fs,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     svn_fs_fs__redeltify_notify_t notify_func,
+                     void *notify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  redeltify_baton_t baton;
+
+  /* We need the p2l index to find all items. */
+  if (! svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_FS_UNSUPPORTED_FORMAT, NULL, NULL);
+
+  baton.fs = fs;
+  baton.start_rev = start_rev;
+  baton.end_rev = end_rev;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+
+  return svn_error_trace(svn_fs_fs__with_all_locks(fs, redeltify_body,
+                                                   &baton, scratch_pool));
+}
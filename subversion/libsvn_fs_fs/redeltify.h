@@ -0,0 +1,57 @@
+/* redeltify.h : internal interface to the FSFS redeltify functionality
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS__REDELTIFY_H
+#define SVN_LIBSVN_FS__REDELTIFY_H
+
+#include "fs.h"
+
+/* Set the REDELTIFY_PENDING flag of FS if svn_fs_fs__redeltify() got
+   interrupted while replacing its pack files.  This does not take any
+   locks, so it works for read-only users as well.
+
+   Must be called whenever FS gets opened.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__check_redeltify(svn_fs_t *fs,
+                           apr_pool_t *scratch_pool);
+
+/* If the REDELTIFY_PENDING flag of FS is set, complete the interrupted
+   redeltify operation, i.e. move the remaining new pack files into place
+   and update the rep-cache.  This takes all FS locks but only if there
+   is anything to do.  The caller must not hold any FS lock.
+
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__complete_redeltify(svn_fs_t *fs,
+                              apr_pool_t *scratch_pool);
+
+/* Like svn_fs_fs__complete_redeltify() but for callers that already hold
+   all FS locks, e.g. recovery.  Check the disk for a journal, independent
+   of the REDELTIFY_PENDING flag.
+
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__complete_redeltify_locked(svn_fs_t *fs,
+                                     apr_pool_t *scratch_pool);
+
+#endif
@@ -75,6 +75,11 @@ WHERE revision >= ?1 AND revision <= ?2
 SELECT MAX(revision)
 FROM rep_cache
 
+-- STMT_UPDATE_REP_SIZE
+/* Works for both V1 and V2 schemas. */
+UPDATE rep_cache SET size = ?3
+WHERE revision = ?1 AND offset = ?2
+
 -- STMT_DEL_REPS_YOUNGER_THAN_REV
 /* Works for both V1 and V2 schemas. */
 DELETE FROM rep_cache
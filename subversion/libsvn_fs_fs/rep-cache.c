@@ -97,6 +97,10 @@ open_rep_cache(void *baton,
                            0, NULL, 0,
                            fs->pool, pool));
 
+  /* The rep-cache lives next to the repository on the server side and
+     only grows.  Share its pages across processes. */
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__enable_mmap(sdb), sdb);
+
   SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, sdb, pool),
                         sdb);
   /* If we have an uninitialized database, go ahead and create the schema. */
@@ -378,6 +382,50 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
 }
 
 
+/* Body of svn_fs_fs__update_rep_sizes(), to be run within an SQLite
+   transaction.  Same arguments as that function. */
+static svn_error_t *
+update_rep_sizes(svn_fs_t *fs,
+                 const apr_array_header_t *reps,
+                 apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_sqlite__stmt_t *stmt;
+  int i;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                    STMT_UPDATE_REP_SIZE));
+  for (i = 0; i < reps->nelts; ++i)
+    {
+      const representation_t *rep
+        = APR_ARRAY_IDX(reps, i, const representation_t *);
+
+      SVN_ERR(svn_sqlite__bindf(stmt, "rii", rep->revision,
+                                (apr_int64_t) rep->item_index,
+                                (apr_int64_t) rep->size));
+      SVN_ERR(svn_sqlite__update(NULL, stmt));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__update_rep_sizes(svn_fs_t *fs,
+                            const apr_array_header_t *reps,
+                            apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT);
+  if (! ffd->rep_cache_db)
+    SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+
+  SVN_SQLITE__WITH_TXN(update_rep_sizes(fs, reps, pool),
+                       ffd->rep_cache_db);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__del_rep_reference(svn_fs_t *fs,
                              svn_revnum_t youngest,
@@ -90,6 +90,15 @@ svn_fs_fs__del_rep_reference(svn_fs_t *fs,
                              svn_revnum_t youngest,
                              apr_pool_t *pool);
 
+/* For all representation_t * in REPS, set the on-disk size of the reps
+   in FS's cache that are stored at the same location to the respective
+   REP->SIZE.  All updates happen in a single SQLite transaction.
+   Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__update_rep_sizes(svn_fs_t *fs,
+                            const apr_array_header_t *reps,
+                            apr_pool_t *pool);
+
 /* Start a transaction to take an SQLite reserved lock that prevents
    other writes, call BODY, end the transaction, and return what BODY returned.
  */
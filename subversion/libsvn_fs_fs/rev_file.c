@@ -20,6 +20,11 @@
  * ====================================================================
  */
 
+#include <apr_mmap.h>
+
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
 #include "rev_file.h"
 #include "fs_fs.h"
 #include "index.h"
@@ -54,9 +59,231 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
   file->p2l_offset = -1;
   file->p2l_checksum = NULL;
   file->footer_offset = -1;
+  file->mapped_data = NULL;
+  file->mapped_size = 0;
+  file->mapping = NULL;
   file->pool = pool;
 }
 
+#if APR_HAS_MMAP
+
+/* A read-only memory mapping of a whole pack file.  Mappings are being
+ * shared by all svn_fs_fs__revision_file_t instances of the same svn_fs_t
+ * and get recycled in LRU order. */
+typedef struct pack_mapping_t
+{
+  /* First revision in the mapped pack file. */
+  svn_revnum_t start_revision;
+
+  /* The mapping itself and its size, i.e. the size of the pack file. */
+  apr_mmap_t *mmap;
+  apr_off_t size;
+
+  /* Number of revision files currently referencing this mapping.
+   * Only unreferenced mappings may be dropped. */
+  int ref_count;
+
+  /* Pool containing this object and the mapping. */
+  apr_pool_t *pool;
+} pack_mapping_t;
+
+/* A reference from a revision file to a pack_mapping_t.  It gets
+ * allocated in the pool of the revision FILE and lives until either that
+ * pool or the pool of the MAPPING gets cleaned up, whichever comes first.
+ */
+typedef struct mapping_ref_t
+{
+  /* The referencing revision file. */
+  svn_fs_fs__revision_file_t *file;
+
+  /* The mapping being referenced. */
+  pack_mapping_t *mapping;
+} mapping_ref_t;
+
+static apr_status_t detach_mapping(void *baton);
+
+/* APR pool cleanup callback for the revision file pool, releasing the
+ * mapping_ref_t given as BATON. */
+static apr_status_t
+release_mapping(void *baton)
+{
+  mapping_ref_t *ref = baton;
+  --ref->mapping->ref_count;
+
+  /* The mapping survives us, so it must not call back into our pool. */
+  apr_pool_cleanup_kill(ref->mapping->pool, ref, detach_mapping);
+
+  return APR_SUCCESS;
+}
+
+/* APR pool cleanup callback for the mapping pool, invalidating the
+ * mapping_ref_t given as BATON.  This happens only if the svn_fs_t gets
+ * closed before all revision files have been released. */
+static apr_status_t
+detach_mapping(void *baton)
+{
+  mapping_ref_t *ref = baton;
+
+  ref->file->mapping = NULL;
+  ref->file->mapped_data = NULL;
+  ref->file->mapped_size = 0;
+
+  /* The mapping is gone, so there is nothing left to release. */
+  apr_pool_cleanup_kill(ref->file->pool, ref, release_mapping);
+
+  return APR_SUCCESS;
+}
+
+/* Return the pack file mapping for START_REVISION in FFD or NULL if that
+ * pack file has not been mapped.  Mark the result as most recently used.
+ */
+static pack_mapping_t *
+find_mapping(fs_fs_data_t *ffd,
+             svn_revnum_t start_revision)
+{
+  pack_mapping_t **mappings = (pack_mapping_t **)ffd->pack_mappings->elts;
+  int count = ffd->pack_mappings->nelts;
+  int i;
+
+  for (i = count - 1; i >= 0; --i)
+    if (mappings[i]->start_revision == start_revision)
+      {
+        pack_mapping_t *mapping = mappings[i];
+        memmove(&mappings[i], &mappings[i + 1],
+                (count - i - 1) * sizeof(*mappings));
+        mappings[count - 1] = mapping;
+
+        return mapping;
+      }
+
+  return NULL;
+}
+
+/* Drop the least recently used mapping in FFD that is not referenced by
+ * any revision file.  Return FALSE if all mappings are in use.
+ */
+static svn_boolean_t
+drop_unused_mapping(fs_fs_data_t *ffd)
+{
+  pack_mapping_t **mappings = (pack_mapping_t **)ffd->pack_mappings->elts;
+  int count = ffd->pack_mappings->nelts;
+  int i;
+
+  for (i = 0; i < count; ++i)
+    if (mappings[i]->ref_count == 0)
+      {
+        svn_pool_destroy(mappings[i]->pool);
+        memmove(&mappings[i], &mappings[i + 1],
+                (count - i - 1) * sizeof(*mappings));
+        --ffd->pack_mappings->nelts;
+
+        return TRUE;
+      }
+
+  return FALSE;
+}
+
+/* Map the pack FILE in FS into memory, add the mapping to FS' list of
+ * mappings and return it in *MAPPING.  Set *MAPPING to NULL if the file
+ * cannot be mapped.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+create_mapping(pack_mapping_t **mapping,
+               svn_fs_t *fs,
+               svn_fs_fs__revision_file_t *file,
+               apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  pack_mapping_t *result;
+  apr_pool_t *pool;
+  apr_mmap_t *mmap;
+  apr_off_t size;
+
+  *mapping = NULL;
+
+  SVN_ERR(svn_io_file_size_get(&size, file->file, scratch_pool));
+  if (size == 0 || (apr_uint64_t)size > APR_SIZE_MAX)
+    return SVN_NO_ERROR;
+
+  /* Mapping may fail, e.g. due to insufficient address space.  That's o.k.
+   * as we can always fall back to normal file access. */
+  pool = svn_pool_create(fs->pool);
+  if (apr_mmap_create(&mmap, file->file, 0, (apr_size_t)size,
+                      APR_MMAP_READ, pool))
+    {
+      svn_pool_destroy(pool);
+      return SVN_NO_ERROR;
+    }
+
+  result = apr_pcalloc(pool, sizeof(*result));
+  result->start_revision = file->start_revision;
+  result->mmap = mmap;
+  result->size = size;
+  result->ref_count = 0;
+  result->pool = pool;
+
+  APR_ARRAY_PUSH(ffd->pack_mappings, pack_mapping_t *) = result;
+  *mapping = result;
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* APR_HAS_MMAP */
+
+/* If FS has been configured to do so, make the contents of the pack FILE
+ * available as a memory mapping.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+auto_map_pack_file(svn_fs_fs__revision_file_t *file,
+                   svn_fs_t *fs,
+                   apr_pool_t *scratch_pool)
+{
+#if APR_HAS_MMAP
+  fs_fs_data_t *ffd = fs->fsap_data;
+  pack_mapping_t *mapping;
+  mapping_ref_t *ref;
+
+  if (!file->is_packed || ffd->max_mapped_pack_files == 0)
+    return SVN_NO_ERROR;
+
+  if (ffd->pack_mappings == NULL)
+    ffd->pack_mappings = apr_array_make(fs->pool, ffd->max_mapped_pack_files,
+                                        sizeof(pack_mapping_t *));
+
+  mapping = find_mapping(ffd, file->start_revision);
+  if (mapping == NULL)
+    {
+      /* Stay within our limits.  If all mappings are being used, simply
+       * access this file the traditional way. */
+      if (   ffd->pack_mappings->nelts >= ffd->max_mapped_pack_files
+          && !drop_unused_mapping(ffd))
+        return SVN_NO_ERROR;
+
+      SVN_ERR(create_mapping(&mapping, fs, file, scratch_pool));
+      if (mapping == NULL)
+        return SVN_NO_ERROR;
+    }
+
+  /* Keep the mapping alive as long as FILE might use it.  Since FILE's
+   * pool may or may not outlive FS, track that reference in both pools. */
+  ref = apr_palloc(file->pool, sizeof(*ref));
+  ref->file = file;
+  ref->mapping = mapping;
+
+  ++mapping->ref_count;
+  apr_pool_cleanup_register(file->pool, ref, release_mapping,
+                            apr_pool_cleanup_null);
+  apr_pool_cleanup_register(mapping->pool, ref, detach_mapping,
+                            apr_pool_cleanup_null);
+
+  file->mapping = ref;
+  file->mapped_data = mapping->mmap->mm;
+  file->mapped_size = mapping->size;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton type for set_read_only() */
 typedef struct set_read_only_baton_t
 {
@@ -160,6 +387,10 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
+          /* Never map files that we may modify. */
+          if (!writable)
+            SVN_ERR(auto_map_pack_file(file, fs, scratch_pool));
+
           return SVN_NO_ERROR;
         }
 
@@ -237,22 +468,23 @@ svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
       svn_stringbuf_t *footer;
 
       /* Determine file size. */
-      SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize, file->pool));
+      if (file->mapped_data)
+        filesize = file->mapped_size;
+      else
+        SVN_ERR(svn_io_file_seek(file->file, APR_END, &filesize,
+                                 file->pool));
 
       /* Read last byte (containing the length of the footer). */
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
+      SVN_ERR(svn_fs_fs__rev_file_read(file, &footer_length,
+                                       sizeof(footer_length), NULL,
                                        filesize - 1, file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, &footer_length,
-                                     sizeof(footer_length), NULL, NULL,
-                                     file->pool));
 
       /* Read footer. */
       footer = svn_stringbuf_create_ensure(footer_length, file->pool);
-      SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
+      SVN_ERR(svn_fs_fs__rev_file_read(file, footer->data, footer_length,
+                                       &footer->len,
                                        filesize - 1 - footer_length,
                                        file->pool));
-      SVN_ERR(svn_io_file_read_full2(file->file, footer->data, footer_length,
-                                     &footer->len, NULL, file->pool));
       footer->data[footer->len] = '\0';
 
       /* Extract index locations. */
@@ -274,6 +506,7 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   apr_file_t *apr_file;
   SVN_ERR(svn_io_file_open(&apr_file,
                            svn_fs_fs__path_txn_proto_rev(fs, txn_id,
@@ -286,10 +519,99 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
   (*file)->is_packed = FALSE;
   (*file)->start_revision = SVN_INVALID_REVNUM;
   (*file)->stream = svn_stream_from_aprfile2(apr_file, TRUE, result_pool);
+  (*file)->block_size = ffd->block_size;
+  (*file)->pool = result_pool;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__wrap_temp_rev_file(svn_fs_fs__revision_file_t **file,
+                              svn_fs_t *fs,
+                              apr_file_t *temp_file,
+                              svn_revnum_t start_revision,
+                              apr_pool_t *result_pool)
+{
+  *file = apr_palloc(result_pool, sizeof(**file));
+  init_revision_file(*file, fs, start_revision, result_pool);
+  (*file)->file = temp_file;
+  (*file)->stream = svn_stream_from_aprfile2(temp_file, TRUE, result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buffer,
+                         apr_size_t len,
+                         apr_size_t *bytes_read,
+                         apr_off_t offset,
+                         apr_pool_t *scratch_pool)
+{
+  if (file->mapped_data)
+    {
+      apr_size_t available = 0;
+      if (offset >= 0 && offset < file->mapped_size)
+        available = (apr_size_t)MIN(len, file->mapped_size - offset);
+
+      if (available < len && bytes_read == NULL)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Can't read %" APR_SIZE_T_FMT " bytes at "
+                                   "offset %" APR_OFF_T_FMT " from the pack "
+                                   "file of revision %ld"),
+                                 len, offset, file->start_revision);
+
+      memcpy(buffer, file->mapped_data + offset, available);
+      if (bytes_read)
+        *bytes_read = available;
+
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_io_file_aligned_seek(file->file, file->block_size, NULL,
+                                   offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(file->file, buffer, len, bytes_read, NULL,
+                                 scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rev_file_stream(svn_stream_t **stream,
+                           svn_fs_fs__revision_file_t *file,
+                           apr_pool_t *result_pool)
+{
+  if (file->mapped_data)
+    {
+      apr_off_t offset;
+      svn_string_t *data = apr_palloc(result_pool, sizeof(*data));
+
+      SVN_ERR(svn_io_file_get_offset(&offset, file->file, result_pool));
+      offset = MIN(offset, file->mapped_size);
+
+      /* Don't copy the data.  The mapping outlives the stream. */
+      data->data = file->mapped_data + offset;
+      data->len = (apr_size_t)(file->mapped_size - offset);
+      *stream = svn_stream_from_string(data, result_pool);
+    }
+  else
+    {
+      *stream = file->stream;
+    }
 
   return SVN_NO_ERROR;
 }
 
+void
+svn_fs_fs__rev_file_prefetch(svn_fs_fs__revision_file_t *file,
+                             apr_off_t offset,
+                             apr_off_t len)
+{
+  if (file->mapped_data && offset >= 0 && offset < file->mapped_size)
+    svn_io__memory_prefetch(file->mapped_data + offset,
+                            (apr_size_t)MIN(len, file->mapped_size - offset));
+}
+
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
@@ -298,10 +620,18 @@ svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
   if (file->file)
     SVN_ERR(svn_io_file_close(file->file, file->pool));
 
+#if APR_HAS_MMAP
+  if (file->mapping)
+    apr_pool_cleanup_run(file->pool, file->mapping, release_mapping);
+#endif
+
   file->file = NULL;
   file->stream = NULL;
   file->l2p_stream = NULL;
   file->p2l_stream = NULL;
+  file->mapped_data = NULL;
+  file->mapped_size = 0;
+  file->mapping = NULL;
 
   return SVN_NO_ERROR;
 }
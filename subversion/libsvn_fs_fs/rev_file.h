@@ -90,6 +90,15 @@ typedef struct svn_fs_fs__revision_file_t
    * been called, yet. */
   apr_off_t footer_offset;
 
+  /* If not NULL, the whole pack FILE mapped into memory (read-only).
+   * MAPPED_SIZE is the size of that mapping, i.e. of the pack file. */
+  const char *mapped_data;
+  apr_off_t mapped_size;
+
+  /* Our reference to the shared mapping object providing MAPPED_DATA.
+   * NULL if not mapped.  Private to rev_file.c. */
+  void *mapping;
+
   /* pool containing this object */
   apr_pool_t *pool;
 } svn_fs_fs__revision_file_t;
@@ -137,6 +146,52 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool);
 
+/* Wrap the TEMP_FILE, used in the context of FS, into a revision file
+ * struct, allocated in RESULT_POOL, and return it in *FILE.  The file
+ * shall contain the revision(s) starting at START_REVISION.
+ */
+svn_error_t *
+svn_fs_fs__wrap_temp_rev_file(svn_fs_fs__revision_file_t **file,
+                              svn_fs_t *fs,
+                              apr_file_t *temp_file,
+                              svn_revnum_t start_revision,
+                              apr_pool_t *result_pool);
+
+/* Read LEN bytes starting at OFFSET from FILE into BUFFER.  If BYTES_READ
+ * is not NULL, reading less data is not an error and *BYTES_READ will be
+ * set to the number of bytes actually read.
+ *
+ * Read from the memory-mapped contents of FILE if available and from
+ * FILE->FILE using aligned seeks otherwise.  The position of the FILE->FILE
+ * pointer is undefined afterwards.  Use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_read(svn_fs_fs__revision_file_t *file,
+                         void *buffer,
+                         apr_size_t len,
+                         apr_size_t *bytes_read,
+                         apr_off_t offset,
+                         apr_pool_t *scratch_pool);
+
+/* Return a stream in *STREAM that reads FILE from the current position of
+ * FILE->FILE.  If FILE is memory-mapped, the stream reads directly from
+ * the mapping without moving the FILE->FILE pointer and must not be used
+ * after FILE got closed.  Otherwise, this will simply be FILE->STREAM.
+ * Allocate the stream in RESULT_POOL.
+ */
+svn_error_t *
+svn_fs_fs__rev_file_stream(svn_stream_t **stream,
+                           svn_fs_fs__revision_file_t *file,
+                           apr_pool_t *result_pool);
+
+/* If FILE is memory-mapped, tell the OS that we will soon access the LEN
+ * bytes starting at OFFSET.  No-op otherwise.
+ */
+void
+svn_fs_fs__rev_file_prefetch(svn_fs_fs__revision_file_t *file,
+                             apr_off_t offset,
+                             apr_off_t len);
+
 /* Close all files and streams in FILE.
  */
 svn_error_t *
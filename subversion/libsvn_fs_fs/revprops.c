@@ -53,6 +53,7 @@ svn_fs_fs__upgrade_pack_revprops(svn_fs_t *fs,
   apr_int64_t first_unpacked_shard
     =  ffd->min_unpacked_rev / ffd->max_files_per_dir;
 
+  svn_fs__batch_fsync_t *batch;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   const char *revsprops_dir = svn_dirent_join(fs->path, PATH_REVPROPS_DIR,
                                               scratch_pool);
@@ -60,6 +61,9 @@ svn_fs_fs__upgrade_pack_revprops(svn_fs_t *fs,
                            ? SVN_DELTA_COMPRESSION_LEVEL_DEFAULT
                            : SVN_DELTA_COMPRESSION_LEVEL_NONE;
 
+  SVN_ERR(svn_fs__batch_fsync_create(&batch, ffd->flush_to_disk,
+                                     scratch_pool));
+
   /* first, pack all revprops shards to match the packed revision shards */
   for (shard = 0; shard < first_unpacked_shard; ++shard)
     {
@@ -78,10 +82,11 @@ svn_fs_fs__upgrade_pack_revprops(svn_fs_t *fs,
                                              revprops_shard_path,
                                              shard, ffd->max_files_per_dir,
                                              (int)(0.9 * ffd->revprop_pack_size),
-                                             compression_level,
-                                             ffd->flush_to_disk,
+                                             compression_level, batch,
                                              cancel_func, cancel_baton,
                                              iterpool));
+      SVN_ERR(svn_fs__batch_fsync_run(batch, iterpool));
+
       if (notify_func)
         SVN_ERR(notify_func(notify_baton, shard,
                             svn_fs_upgrade_pack_revprops, iterpool));
@@ -761,6 +766,25 @@ svn_fs_fs__get_revision_proplist(apr_hash_t **proplist_p,
   return SVN_NO_ERROR;
 }
 
+/* Create a new, uniquely named file in DIRECTORY, return its path in
+ * *PATH and an open handle to it in *FILE.  The handle is owned by BATCH,
+ * i.e. running BATCH will flush the file to disk and close it.
+ * Use POOL for allocations.
+ */
+static svn_error_t *
+open_unique_batched_file(apr_file_t **file,
+                         const char **path,
+                         const char *directory,
+                         svn_fs__batch_fsync_t *batch,
+                         apr_pool_t *pool)
+{
+  SVN_ERR(svn_io_open_unique_file3(NULL, path, directory,
+                                   svn_io_file_del_none, pool, pool));
+  SVN_ERR(svn_fs__batch_fsync_open_file(file, batch, *path, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Serialize the revision property list PROPLIST of revision REV in
  * filesystem FS to a non-packed file.  Return the name of that temporary
  * file in *TMP_PATH and the file path that it must be moved to in
@@ -774,27 +798,22 @@ write_non_packed_revprop(const char **final_path,
                          svn_fs_t *fs,
                          svn_revnum_t rev,
                          apr_hash_t *proplist,
+                         svn_fs__batch_fsync_t *batch,
                          apr_pool_t *pool)
 {
-  fs_fs_data_t *ffd = fs->fsap_data;
   apr_file_t *file;
   svn_stream_t *stream;
   *final_path = svn_fs_fs__path_revprops(fs, rev, pool);
 
   /* ### do we have a directory sitting around already? we really shouldn't
      ### have to get the dirname here. */
-  SVN_ERR(svn_io_open_unique_file3(&file, tmp_path,
+  SVN_ERR(open_unique_batched_file(&file, tmp_path,
                                    svn_dirent_dirname(*final_path, pool),
-                                   svn_io_file_del_none, pool, pool));
+                                   batch, pool));
   stream = svn_stream_from_aprfile2(file, TRUE, pool);
   SVN_ERR(svn_hash_write2(proplist, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
 
-  /* Flush temporary file to disk and close it. */
-  if (ffd->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(file, pool));
-  SVN_ERR(svn_io_file_close(file, pool));
-
   return SVN_NO_ERROR;
 }
 
@@ -881,6 +900,8 @@ serialize_revprops_header(svn_stream_t *stream,
 
 /* Writes the a pack file to FILE.  It copies the serialized data
  * from REVPROPS for the indexes [START,END) except for index CHANGED_INDEX.
+ * FILE is expected to be owned by a batch fsync object that will flush
+ * and close it later.
  *
  * The data for the latter is taken from NEW_SERIALIZED.  Note, that
  * CHANGED_INDEX may be outside the [START,END) range, i.e. no new data is
@@ -943,12 +964,9 @@ repack_revprops(svn_fs_t *fs,
                                ? SVN_DELTA_COMPRESSION_LEVEL_DEFAULT
                                : SVN_DELTA_COMPRESSION_LEVEL_NONE));
 
-  /* finally, write the content to the target file, flush and close it */
+  /* finally, write the content to the target file */
   SVN_ERR(svn_io_file_write_full(file, compressed->data, compressed->len,
                                  NULL, pool));
-  if (ffd->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(file, pool));
-  SVN_ERR(svn_io_file_close(file, pool));
 
   return SVN_NO_ERROR;
 }
@@ -957,7 +975,7 @@ repack_revprops(svn_fs_t *fs,
  *     [REVPROPS->START_REVISION + START, REVPROPS->START_REVISION + END - 1]
  * of REVPROPS->MANIFEST.  Add the name of old file to FILES_TO_DELETE,
  * auto-create that array if necessary.  Return an open file *FILE that is
- * allocated in POOL.
+ * owned by BATCH.  Use POOL for allocations.
  */
 static svn_error_t *
 repack_file_open(apr_file_t **file,
@@ -966,6 +984,7 @@ repack_file_open(apr_file_t **file,
                  int start,
                  int end,
                  apr_array_header_t **files_to_delete,
+                 svn_fs__batch_fsync_t *batch,
                  apr_pool_t *pool)
 {
   apr_int64_t tag;
@@ -1004,10 +1023,11 @@ repack_file_open(apr_file_t **file,
       = new_filename;
 
   /* open the file */
-  SVN_ERR(svn_io_file_open(file, svn_dirent_join(revprops->folder,
-                                                 new_filename,
-                                                 pool),
-                           APR_WRITE | APR_CREATE, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_fs__batch_fsync_open_file(file, batch,
+                                        svn_dirent_join(revprops->folder,
+                                                        new_filename,
+                                                        pool),
+                                        pool));
 
   return SVN_NO_ERROR;
 }
@@ -1016,7 +1036,7 @@ repack_file_open(apr_file_t **file,
  * PROPLIST.  Return a new file in *TMP_PATH that the caller shall move
  * to *FINAL_PATH to make the change visible.  Files to be deleted will
  * be listed in *FILES_TO_DELETE which may remain unchanged / unallocated.
- * Use POOL for allocations.
+ * All new files are scheduled for fsync in BATCH.  Use POOL for allocations.
  */
 static svn_error_t *
 write_packed_revprop(const char **final_path,
@@ -1025,6 +1045,7 @@ write_packed_revprop(const char **final_path,
                      svn_fs_t *fs,
                      svn_revnum_t rev,
                      apr_hash_t *proplist,
+                     svn_fs__batch_fsync_t *batch,
                      apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
@@ -1061,8 +1082,8 @@ write_packed_revprop(const char **final_path,
 
       *final_path = svn_dirent_join(revprops->folder, revprops->filename,
                                     pool);
-      SVN_ERR(svn_io_open_unique_file3(&file, tmp_path, revprops->folder,
-                                       svn_io_file_del_none, pool, pool));
+      SVN_ERR(open_unique_batched_file(&file, tmp_path, revprops->folder,
+                                       batch, pool));
       SVN_ERR(repack_revprops(fs, revprops, 0, revprops->sizes->nelts,
                               changed_index, serialized, new_total_size,
                               file, pool));
@@ -1112,7 +1133,8 @@ write_packed_revprop(const char **final_path,
       if (left_count)
         {
           SVN_ERR(repack_file_open(&file, fs, revprops, 0,
-                                   left_count, files_to_delete, pool));
+                                   left_count, files_to_delete, batch,
+                                   pool));
           SVN_ERR(repack_revprops(fs, revprops, 0, left_count,
                                   changed_index, serialized, new_total_size,
                                   file, pool));
@@ -1122,7 +1144,7 @@ write_packed_revprop(const char **final_path,
         {
           SVN_ERR(repack_file_open(&file, fs, revprops, changed_index,
                                    changed_index + 1, files_to_delete,
-                                   pool));
+                                   batch, pool));
           SVN_ERR(repack_revprops(fs, revprops, changed_index,
                                   changed_index + 1,
                                   changed_index, serialized, new_total_size,
@@ -1134,7 +1156,7 @@ write_packed_revprop(const char **final_path,
           SVN_ERR(repack_file_open(&file, fs, revprops,
                                    revprops->sizes->nelts - right_count,
                                    revprops->sizes->nelts,
-                                   files_to_delete, pool));
+                                   files_to_delete, batch, pool));
           SVN_ERR(repack_revprops(fs, revprops,
                                   revprops->sizes->nelts - right_count,
                                   revprops->sizes->nelts, changed_index,
@@ -1144,8 +1166,8 @@ write_packed_revprop(const char **final_path,
 
       /* write the new manifest */
       *final_path = svn_dirent_join(revprops->folder, PATH_MANIFEST, pool);
-      SVN_ERR(svn_io_open_unique_file3(&file, tmp_path, revprops->folder,
-                                       svn_io_file_del_none, pool, pool));
+      SVN_ERR(open_unique_batched_file(&file, tmp_path, revprops->folder,
+                                       batch, pool));
       stream = svn_stream_from_aprfile2(file, TRUE, pool);
       for (i = 0; i < revprops->manifest->nelts; ++i)
         {
@@ -1154,9 +1176,6 @@ write_packed_revprop(const char **final_path,
           SVN_ERR(svn_stream_printf(stream, pool, "%s\n", filename));
         }
       SVN_ERR(svn_stream_close(stream));
-      if (ffd->flush_to_disk)
-        SVN_ERR(svn_io_file_flush_to_disk(file, pool));
-      SVN_ERR(svn_io_file_close(file, pool));
     }
 
   return SVN_NO_ERROR;
@@ -1175,8 +1194,11 @@ svn_fs_fs__set_revision_proplist(svn_fs_t *fs,
   const char *tmp_path;
   const char *perms_reference;
   apr_array_header_t *files_to_delete = NULL;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs__batch_fsync_t *batch;
 
   SVN_ERR(svn_fs_fs__ensure_revision_exists(rev, fs, pool));
+  SVN_ERR(svn_fs__batch_fsync_create(&batch, ffd->flush_to_disk, pool));
 
   /* this info will not change while we hold the global FS write lock */
   is_packed = svn_fs_fs__is_packed_revprop(fs, rev);
@@ -1184,10 +1206,14 @@ svn_fs_fs__set_revision_proplist(svn_fs_t *fs,
   /* Serialize the new revprop data */
   if (is_packed)
     SVN_ERR(write_packed_revprop(&final_path, &tmp_path, &files_to_delete,
-                                 fs, rev, proplist, pool));
+                                 fs, rev, proplist, batch, pool));
   else
     SVN_ERR(write_non_packed_revprop(&final_path, &tmp_path,
-                                     fs, rev, proplist, pool));
+                                     fs, rev, proplist, batch, pool));
+
+  /* All new files must be on disk before we make them visible by moving
+   * the manifest / revprop file into place. */
+  SVN_ERR(svn_fs__batch_fsync_run(batch, pool));
 
   /* Previous cache contents is invalid now. */
   svn_fs_fs__reset_revprop_cache(fs);
@@ -1290,7 +1316,7 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
                          apr_array_header_t *sizes,
                          apr_size_t total_size,
                          int compression_level,
-                         svn_boolean_t flush_to_disk,
+                         svn_fs__batch_fsync_t *batch,
                          svn_cancel_func_t cancel_func,
                          void *cancel_baton,
                          apr_pool_t *scratch_pool)
@@ -1312,11 +1338,11 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
                                     sizes->nelts, iterpool));
 
   /* Some useful paths. */
-  SVN_ERR(svn_io_file_open(&pack_file, svn_dirent_join(pack_file_dir,
-                                                       pack_filename,
-                                                       scratch_pool),
-                           APR_WRITE | APR_CREATE, APR_OS_DEFAULT,
-                           scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_create_file(&pack_file, batch,
+                                          svn_dirent_join(pack_file_dir,
+                                                          pack_filename,
+                                                          scratch_pool),
+                                          FALSE, scratch_pool));
 
   /* Iterate over the revisions in this shard, squashing them together. */
   for (rev = start_rev; rev <= end_rev; rev++)
@@ -1348,12 +1374,9 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
   SVN_ERR(svn__compress_zlib(uncompressed->data, uncompressed->len,
                              compressed, compression_level));
 
-  /* write the pack file content to disk */
+  /* write the pack file content to disk.  BATCH will flush & close it. */
   SVN_ERR(svn_io_file_write_full(pack_file, compressed->data, compressed->len,
                                  NULL, scratch_pool));
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(pack_file, scratch_pool));
-  SVN_ERR(svn_io_file_close(pack_file, scratch_pool));
 
   svn_pool_destroy(iterpool);
 
@@ -1367,7 +1390,7 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
                                int max_files_per_dir,
                                apr_int64_t max_pack_size,
                                int compression_level,
-                               svn_boolean_t flush_to_disk,
+                               svn_fs__batch_fsync_t *batch,
                                svn_cancel_func_t cancel_func,
                                void *cancel_baton,
                                apr_pool_t *scratch_pool)
@@ -1394,10 +1417,12 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
 
   /* Create the new directory and manifest file stream. */
   SVN_ERR(svn_io_dir_make(pack_file_dir, APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, pack_file_dir,
+                                       scratch_pool));
 
-  SVN_ERR(svn_io_file_open(&manifest_file, manifest_file_path,
-                           APR_WRITE | APR_BUFFERED | APR_CREATE | APR_EXCL,
-                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_create_file(&manifest_file, batch,
+                                          manifest_file_path, TRUE,
+                                          scratch_pool));
   manifest_stream = svn_stream_from_aprfile2(manifest_file, TRUE,
                                              scratch_pool);
 
@@ -1439,7 +1464,7 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
           SVN_ERR(svn_fs_fs__copy_revprops(pack_file_dir, pack_filename,
                                            shard_path, start_rev, rev-1,
                                            sizes, total_size,
-                                           compression_level, flush_to_disk,
+                                           compression_level, batch,
                                            cancel_func, cancel_baton,
                                            iterpool));
 
@@ -1467,14 +1492,12 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
     SVN_ERR(svn_fs_fs__copy_revprops(pack_file_dir, pack_filename,
                                      shard_path, start_rev, rev-1,
                                      sizes, (apr_size_t)total_size,
-                                     compression_level, flush_to_disk,
+                                     compression_level, batch,
                                      cancel_func, cancel_baton, iterpool));
 
-  /* flush the manifest file to disk and update permissions */
+  /* finalize the manifest file and update permissions.  The actual fsync
+   * of all files is left to BATCH. */
   SVN_ERR(svn_stream_close(manifest_stream));
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(manifest_file, iterpool));
-  SVN_ERR(svn_io_file_close(manifest_file, iterpool));
   SVN_ERR(svn_io_copy_perms(shard_path, pack_file_dir, iterpool));
 
   svn_pool_destroy(iterpool);
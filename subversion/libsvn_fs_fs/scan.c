@@ -0,0 +1,247 @@
+/* scan.c --- sequential scans over rev / pack file contents
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_io_private.h"
+
+#include "scan.h"
+
+#include "svn_private_config.h"
+
+/* We read the rev / pack file in chunks of this size.  While we process
+ * one chunk, the OS may already fetch the next one. */
+#define SCAN_BUFFER_SIZE 0x100000
+
+/* Sequential reader over the rev / pack file.  It provides the contents
+ * of the current item.
+ */
+typedef struct scan_reader_t
+{
+  /* The file to read from. */
+  svn_fs_fs__revision_file_t *rev_file;
+
+  /* SCAN_BUFFER_SIZE bytes of buffer memory of which BUFFER_LEN bytes,
+   * starting at file offset BUFFER_START, contain valid data. */
+  char *buffer;
+  apr_off_t buffer_start;
+  apr_size_t buffer_len;
+
+  /* End of the file section covered by the p2l index. */
+  apr_off_t file_end;
+
+  /* Current read position and end of the current item. */
+  apr_off_t pos;
+  apr_off_t item_end;
+
+  /* Pool to use for temporary allocations during reads. */
+  apr_pool_t *pool;
+} scan_reader_t;
+
+/* Tell the OS that READER will soon need the LEN bytes following OFFSET.
+ */
+static void
+prefetch(scan_reader_t *reader,
+         apr_off_t offset,
+         apr_off_t len)
+{
+  if (reader->rev_file->mapped_data)
+    svn_fs_fs__rev_file_prefetch(reader->rev_file, offset, len);
+  else
+    svn_io__file_prefetch(reader->rev_file->file, offset, len);
+}
+
+/* Fill the buffer in READER with the data starting at READER->POS. */
+static svn_error_t *
+fill_buffer(scan_reader_t *reader)
+{
+  apr_off_t next;
+  apr_size_t to_read
+    = (apr_size_t)MIN(SCAN_BUFFER_SIZE, reader->file_end - reader->pos);
+
+  /* Items never extend beyond the section covered by the p2l index. */
+  SVN_ERR_ASSERT(to_read > 0);
+
+  SVN_ERR(svn_fs_fs__rev_file_read(reader->rev_file, reader->buffer,
+                                   to_read, NULL, reader->pos,
+                                   reader->pool));
+  reader->buffer_start = reader->pos;
+  reader->buffer_len = to_read;
+
+  /* Let the OS fetch the next chunk while we process this one. */
+  next = reader->pos + to_read;
+  if (next < reader->file_end)
+    prefetch(reader, next, MIN(SCAN_BUFFER_SIZE, reader->file_end - next));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_read_fn_t for the item contents stream.  BATON is the
+ * scan_reader_t and reading stops at the end of the current item.
+ */
+static svn_error_t *
+read_item_contents(void *baton,
+                   char *buffer,
+                   apr_size_t *len)
+{
+  scan_reader_t *reader = baton;
+  apr_size_t to_read = (apr_size_t)MIN(*len,
+                                       reader->item_end - reader->pos);
+  apr_size_t total = 0;
+
+  while (total < to_read)
+    {
+      apr_size_t offset;
+      apr_size_t chunk;
+
+      if (   reader->pos < reader->buffer_start
+          || reader->pos >= reader->buffer_start + reader->buffer_len)
+        SVN_ERR(fill_buffer(reader));
+
+      offset = (apr_size_t)(reader->pos - reader->buffer_start);
+      chunk = MIN(to_read - total, reader->buffer_len - offset);
+      memcpy(buffer + total, reader->buffer + offset, chunk);
+
+      total += chunk;
+      reader->pos += chunk;
+    }
+
+  *len = total;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__scan_items(svn_fs_t *fs,
+                      svn_fs_fs__revision_file_t *rev_file,
+                      const svn_fs_fs__scan_visitors_t *visitors,
+                      void *baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_revnum_t start = rev_file->start_revision;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *item_pool = svn_pool_create(scratch_pool);
+  scan_reader_t reader = { 0 };
+  apr_off_t offset;
+
+  reader.rev_file = rev_file;
+  reader.buffer = apr_palloc(scratch_pool, SCAN_BUFFER_SIZE);
+  reader.pool = item_pool;
+  SVN_ERR(svn_fs_fs__p2l_get_max_offset(&reader.file_end, fs, rev_file,
+                                        start, scratch_pool));
+
+  /* Get the OS started on the first chunk. */
+  prefetch(&reader, 0, MIN(SCAN_BUFFER_SIZE, reader.file_end));
+
+  for (offset = 0; offset < reader.file_end; )
+    {
+      apr_array_header_t *entries;
+      int i;
+
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      /* get all entries for the current block */
+      SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, fs, rev_file, start,
+                                          offset, ffd->p2l_page_size,
+                                          iterpool, iterpool));
+      if (entries->nelts == 0)
+        return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION,
+                                 NULL,
+                                 _("p2l does not cover offset %s"
+                                   " for revision %ld"),
+                                  apr_off_t_toa(scratch_pool, offset),
+                                  start);
+
+      /* process all entries (and later continue with the next block) */
+      for (i = 0; i < entries->nelts && offset < reader.file_end; ++i)
+        {
+          svn_fs_fs__scan_visitor_t visitor;
+          const svn_fs_fs__p2l_entry_t *entry
+            = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
+
+          /* skip bits we previously processed */
+          if (i == 0 && entry->offset < offset)
+            continue;
+
+          /* skip zero-sized entries */
+          if (entry->size == 0)
+            continue;
+
+          /* p2l index must cover all rev / pack file offsets exactly once */
+          if (entry->offset != offset)
+            return svn_error_createf(SVN_ERR_FS_INDEX_INCONSISTENT,
+                                     NULL,
+                                     _("p2l index entry for revision r%ld"
+                                       " is non-contiguous between offsets "
+                                       " %s and %s"),
+                                     start,
+                                     apr_off_t_toa(scratch_pool, offset),
+                                     apr_off_t_toa(scratch_pool,
+                                                   entry->offset));
+
+          /* Entry types must be within the valid range. */
+          if (entry->type >= SVN_FS_FS__ITEM_TYPE_ANY_REP)
+            return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION,
+                                     NULL,
+                                     _("p2l index entry for revision r%ld"
+                                       " at offset %s contains invalid item"
+                                       " type %d"),
+                                     start,
+                                     apr_off_t_toa(scratch_pool, offset),
+                                     entry->type);
+
+          visitor = visitors->visitors[entry->type];
+          if (visitor)
+            {
+              svn_stream_t *contents;
+
+              svn_pool_clear(item_pool);
+              reader.pos = entry->offset;
+              reader.item_end = MIN(entry->offset + entry->size,
+                                    reader.file_end);
+
+              contents = svn_stream_create(&reader, item_pool);
+              svn_stream_set_read2(contents, read_item_contents,
+                                   read_item_contents);
+
+              SVN_ERR(visitor(entry, contents, baton, item_pool));
+            }
+
+          /* advance offset */
+          offset += entry->size;
+        }
+    }
+
+  svn_pool_destroy(item_pool);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
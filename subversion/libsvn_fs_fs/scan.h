@@ -0,0 +1,83 @@
+/* scan.h : sequential scans over rev / pack file contents
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS__SCAN_H
+#define SVN_LIBSVN_FS__SCAN_H
+
+#include "fs.h"
+#include "index.h"
+#include "rev_file.h"
+
+/* Whole-file scans in physical order.
+ *
+ * Operations that process all items in a rev / pack file, such as verify
+ * and stats, would otherwise follow the logical structure of the data and
+ * seek back and forth within the file.  Instead, walk the p2l index and
+ * read the file strictly front to back using large sequential reads.
+ * For every item, a visitor registered for the item type gets called.
+ *
+ * This requires logical addressing.
+ */
+
+/* Callback type invoked by svn_fs_fs__scan_items() for the item described
+ * by ENTRY.  CONTENTS is a stream returning the ENTRY->SIZE bytes of the
+ * item as stored in the rev / pack file.  The visitor may read as much of
+ * it as it wants to; the scan will skip whatever remains.  The stream
+ * becomes invalid when the visitor returns.  BATON is the baton passed to
+ * svn_fs_fs__scan_items().  Use SCRATCH_POOL for temporary allocations.
+ */
+typedef svn_error_t *
+(*svn_fs_fs__scan_visitor_t)(const svn_fs_fs__p2l_entry_t *entry,
+                             svn_stream_t *contents,
+                             void *baton,
+                             apr_pool_t *scratch_pool);
+
+/* Item type specific visitors.  Items for which the respective element
+ * is NULL are being skipped without reading their contents.
+ */
+typedef struct svn_fs_fs__scan_visitors_t
+{
+  /* Indexed by item type, i.e. SVN_FS_FS__ITEM_TYPE_UNUSED up to and
+   * including SVN_FS_FS__ITEM_TYPE_CHANGES. */
+  svn_fs_fs__scan_visitor_t visitors[SVN_FS_FS__ITEM_TYPE_ANY_REP];
+} svn_fs_fs__scan_visitors_t;
+
+/* Walk all items in REV_FILE of FS in the order given by the p2l index,
+ * i.e. in the order they are stored in the file, and call the respective
+ * visitor from VISITORS with BATON for every non-empty item.  REV_FILE
+ * must be a committed rev or pack file.
+ *
+ * Return SVN_ERR_FS_INDEX_INCONSISTENT if the p2l index does not cover
+ * the file exactly once and SVN_ERR_FS_INDEX_CORRUPTION for items of an
+ * unknown type.  The optional CANCEL_FUNC will periodically be called
+ * with CANCEL_BATON.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__scan_items(svn_fs_t *fs,
+                      svn_fs_fs__revision_file_t *rev_file,
+                      const svn_fs_fs__scan_visitors_t *visitors,
+                      void *baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *scratch_pool);
+
+#endif
@@ -26,6 +26,8 @@
 #include "svn_sorts.h"
 
 #include "private/svn_cache.h"
+#include "private/svn_fspath.h"
+#include "private/svn_packed_data.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_fs_fs_private.h"
@@ -37,6 +39,7 @@
 #include "fs_fs.h"
 #include "cached_data.h"
 #include "low_level.h"
+#include "scan.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
@@ -96,6 +99,11 @@ typedef struct rep_stats_t
   /* length of the delta chain, including this representation,
    * saturated to 255 - if need be */
   apr_byte_t chain_length;
+
+  /* Cost groups this representation gets attributed to.  Set by the
+   * first node referencing it.  NULL, if not applicable. */
+  svn_fs_fs__path_info_t *path_info;
+  svn_fs_fs__extension_info_t *extension_info;
 } rep_stats_t;
 
 /* Represents a link in the rep delta chain.  REVISION + ITEM_INDEX points
@@ -192,6 +200,12 @@ typedef struct query_t
   /* collected statistics */
   svn_fs_fs__stats_t *stats;
 
+  /* Number of leading path segments to use for path prefixes. */
+  int path_depth;
+
+  /* Path of the stats cache file.  NULL if not caching results. */
+  const char *cache_path;
+
   /* Progress notification callback to call after each shard.  May be NULL. */
   svn_fs_progress_notify_func_t progress_func;
 
@@ -255,6 +269,94 @@ add_to_histogram(svn_fs_fs__histogram_t *histogram,
   histogram->lines[(apr_size_t)shift].sum += size;
 }
 
+/* Return the extension of the file at PATH, including the leading ".".
+ * Return "(none)" if the file name has no extension.
+ */
+static const char *
+get_extension(const char *path)
+{
+  const char * file_name = strrchr(path, '/');
+  const char * extension = file_name ? strrchr(file_name, '.') : NULL;
+
+  if (extension == NULL || extension == file_name + 1)
+    extension = "(none)";
+
+  return extension;
+}
+
+/* Return the info for EXTENSION in STATS.  Auto-create it if necessary.
+ */
+static svn_fs_fs__extension_info_t *
+get_extension_info(svn_fs_fs__stats_t *stats,
+                   const char *extension)
+{
+  svn_fs_fs__extension_info_t *info;
+
+  /* get / auto-insert entry for this extension */
+  info = apr_hash_get(stats->by_extension, extension, APR_HASH_KEY_STRING);
+  if (info == NULL)
+    {
+      apr_pool_t *pool = apr_hash_pool_get(stats->by_extension);
+      info = apr_pcalloc(pool, sizeof(*info));
+      info->extension = apr_pstrdup(pool, extension);
+
+      apr_hash_set(stats->by_extension, info->extension,
+                   APR_HASH_KEY_STRING, info);
+    }
+
+  return info;
+}
+
+/* Return the path prefix that nodes of KIND at PATH get attributed to when
+ * only the first DEPTH path segments are considered.  Allocate the result
+ * in RESULT_POOL.
+ */
+static const char *
+get_path_prefix(const char *path,
+                svn_node_kind_t kind,
+                int depth,
+                apr_pool_t *result_pool)
+{
+  const char *end;
+  int i;
+
+  /* Files get attributed to their parent directory. */
+  if (kind != svn_node_dir)
+    path = svn_fspath__dirname(path, result_pool);
+
+  /* Cut off after DEPTH segments. */
+  if (depth <= 0)
+    return "/";
+
+  end = path;
+  for (i = 0; i < depth && end; ++i)
+    end = strchr(end + 1, '/');
+
+  return end ? apr_pstrmemdup(result_pool, path, end - path) : path;
+}
+
+/* Return the info for the path PREFIX in STATS.  Auto-create it if
+ * necessary.
+ */
+static svn_fs_fs__path_info_t *
+get_path_info(svn_fs_fs__stats_t *stats,
+              const char *prefix)
+{
+  svn_fs_fs__path_info_t *info;
+
+  info = apr_hash_get(stats->by_path, prefix, APR_HASH_KEY_STRING);
+  if (info == NULL)
+    {
+      apr_pool_t *pool = apr_hash_pool_get(stats->by_path);
+      info = apr_pcalloc(pool, sizeof(*info));
+      info->path = apr_pstrdup(pool, prefix);
+
+      apr_hash_set(stats->by_path, info->path, APR_HASH_KEY_STRING, info);
+    }
+
+  return info;
+}
+
 /* Update data aggregators in STATS with this representation of type KIND,
  * on-disk REP_SIZE and expanded node size EXPANDED_SIZE for PATH in REVSION.
  * PLAIN_ADDED indicates whether the node has a deltification predecessor.
@@ -329,25 +431,8 @@ add_change(svn_fs_fs__stats_t *stats,
   /* by extension */
   if (kind == file_rep)
     {
-      /* determine extension */
-      svn_fs_fs__extension_info_t *info;
-      const char * file_name = strrchr(path, '/');
-      const char * extension = file_name ? strrchr(file_name, '.') : NULL;
-
-      if (extension == NULL || extension == file_name + 1)
-        extension = "(none)";
-
-      /* get / auto-insert entry for this extension */
-      info = apr_hash_get(stats->by_extension, extension, APR_HASH_KEY_STRING);
-      if (info == NULL)
-        {
-          apr_pool_t *pool = apr_hash_pool_get(stats->by_extension);
-          info = apr_pcalloc(pool, sizeof(*info));
-          info->extension = apr_pstrdup(pool, extension);
-
-          apr_hash_set(stats->by_extension, info->extension,
-                       APR_HASH_KEY_STRING, info);
-        }
+      svn_fs_fs__extension_info_t *info
+        = get_extension_info(stats, get_extension(path));
 
       /* update per-extension histogram */
       add_to_histogram(&info->node_histogram, expanded_size);
@@ -654,6 +739,28 @@ read_noderev(query_t *query,
                props->revision, noderev->created_path, props->kind,
                !noderev->predecessor_id);
 
+  /* the first node referencing a rep determines whom it gets billed to */
+  if (   (text && text->ref_count == 1)
+      || (props && props->ref_count == 1))
+    {
+      svn_fs_fs__path_info_t *path_info
+        = get_path_info(query->stats,
+                        get_path_prefix(noderev->created_path, noderev->kind,
+                                        query->path_depth, scratch_pool));
+
+      if (text && text->ref_count == 1)
+        {
+          text->path_info = path_info;
+          if (text->kind == file_rep)
+            text->extension_info
+              = get_extension_info(query->stats,
+                                   get_extension(noderev->created_path));
+        }
+
+      if (props && props->ref_count == 1)
+        props->path_info = path_info;
+    }
+
   /* if this is a directory and has not been processed, yet, read and
    * process it recursively */
   if (   noderev->kind == svn_node_dir && text && text->ref_count == 1
@@ -898,28 +1005,23 @@ get_log_change_count(const char *changes,
   return lines / 2;
 }
 
-/* Read the item described by ENTRY from the REV_FILE and return the
- * respective byte sequence in *CONTENTS, allocated in RESULT_POOL.
- * Use SCRATCH_POOL for temporary allocations
+/* Read the item described by ENTRY from the CONTENTS stream and return
+ * the respective byte sequence in *ITEM, allocated in RESULT_POOL.
  */
 static svn_error_t *
-read_item(svn_stringbuf_t **contents,
-          svn_fs_fs__revision_file_t *rev_file,
-          svn_fs_fs__p2l_entry_t *entry,
-          apr_pool_t *result_pool,
-          apr_pool_t *scratch_pool)
+read_item(svn_stringbuf_t **item,
+          svn_stream_t *contents,
+          const svn_fs_fs__p2l_entry_t *entry,
+          apr_pool_t *result_pool)
 {
-  svn_stringbuf_t *item = svn_stringbuf_create_ensure(entry->size,
-                                                      result_pool);
-  item->len = entry->size;
-  item->data[item->len] = 0;
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(entry->size,
+                                                        result_pool);
+  result->len = entry->size;
 
-  SVN_ERR(svn_io_file_aligned_seek(rev_file->file, rev_file->block_size,
-                                   NULL, entry->offset, scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(rev_file->file, item->data, item->len,
-                                 NULL, NULL, scratch_pool));
+  SVN_ERR(svn_stream_read_full(contents, result->data, &result->len));
+  result->data[result->len] = 0;
 
-  *contents = item;
+  *item = result;
 
   return SVN_NO_ERROR;
 }
@@ -988,6 +1090,106 @@ resolve_representation_refs(query_t *query,
   return SVN_NO_ERROR;
 }
 
+/* Baton type used by the item visitors in read_log_rev_or_packfile.
+ */
+typedef struct scan_baton_t
+{
+  /* The query we are gathering data for. */
+  query_t *query;
+
+  /* Delta chain links found so far.  Array of rep_ref_t *. */
+  apr_array_header_t *rep_refs;
+
+  /* Pools for persistent data and for REP_REFS, respectively. */
+  apr_pool_t *result_pool;
+  apr_pool_t *scratch_pool;
+} scan_baton_t;
+
+/* Return the revision info for the revision containing ENTRY as found in
+ * the scan_baton_t BATON.
+ */
+static revision_info_t *
+get_entry_revision_info(scan_baton_t *baton,
+                        const svn_fs_fs__p2l_entry_t *entry)
+{
+  return APR_ARRAY_IDX(baton->query->revisions, entry->item.revision,
+                       revision_info_t*);
+}
+
+/* Implements svn_fs_fs__scan_visitor_t for noderev items.  BATON is a
+ * scan_baton_t.
+ */
+static svn_error_t *
+scan_noderev(const svn_fs_fs__p2l_entry_t *entry,
+             svn_stream_t *contents,
+             void *baton,
+             apr_pool_t *scratch_pool)
+{
+  scan_baton_t *b = baton;
+  svn_stringbuf_t *item;
+
+  SVN_ERR(read_item(&item, contents, entry, scratch_pool));
+  SVN_ERR(read_noderev(b->query, item, get_entry_revision_info(b, entry),
+                       b->result_pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__scan_visitor_t for changed paths lists.  BATON
+ * is a scan_baton_t.
+ */
+static svn_error_t *
+scan_changes(const svn_fs_fs__p2l_entry_t *entry,
+             svn_stream_t *contents,
+             void *baton,
+             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *item;
+  revision_info_t *info = get_entry_revision_info(baton, entry);
+
+  SVN_ERR(read_item(&item, contents, entry, scratch_pool));
+  info->change_count = get_log_change_count(item->data + 0, item->len);
+  info->changes_len += entry->size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__scan_visitor_t for all types of representations.
+ * Collects the delta chain link in BATON, which is a scan_baton_t.
+ */
+static svn_error_t *
+scan_representation(const svn_fs_fs__p2l_entry_t *entry,
+                    svn_stream_t *contents,
+                    void *baton,
+                    apr_pool_t *scratch_pool)
+{
+  scan_baton_t *b = baton;
+  svn_fs_fs__rep_header_t *header;
+  rep_ref_t *ref = apr_pcalloc(b->scratch_pool, sizeof(*ref));
+
+  SVN_ERR(svn_fs_fs__read_rep_header(&header, contents,
+                                     scratch_pool, scratch_pool));
+
+  ref->header_size = header->header_size;
+  ref->revision = entry->item.revision;
+  ref->item_index = entry->item.number;
+
+  if (header->type == svn_fs_fs__rep_delta)
+    {
+      ref->base_item_index = header->base_item_index;
+      ref->base_revision = header->base_revision;
+    }
+  else
+    {
+      ref->base_item_index = SVN_FS_FS__ITEM_INDEX_UNUSED;
+      ref->base_revision = SVN_INVALID_REVNUM;
+    }
+
+  APR_ARRAY_PUSH(b->rep_refs, rep_ref_t *) = ref;
+
+  return SVN_NO_ERROR;
+}
+
 /* Process the logically addressed revision contents of revisions BASE to
  * BASE + COUNT - 1 in QUERY.
  *
@@ -1001,18 +1203,20 @@ read_log_rev_or_packfile(query_t *query,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool)
 {
-  fs_fs_data_t *ffd = query->fs->fsap_data;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   apr_off_t max_offset;
-  apr_off_t offset = 0;
   int i;
   svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__scan_visitors_t visitors = { { NULL } };
+  scan_baton_t baton;
 
   /* We collect the delta chain links as we scan the file.  Afterwards,
    * we determine the lengths of those delta chains and throw this
    * temporary container away. */
-  apr_array_header_t *rep_refs = apr_array_make(scratch_pool, 64,
-                                                sizeof(rep_ref_t *));
+  baton.query = query;
+  baton.rep_refs = apr_array_make(scratch_pool, 64, sizeof(rep_ref_t *));
+  baton.result_pool = result_pool;
+  baton.scratch_pool = scratch_pool;
 
   /* we will process every revision in the rev / pack file */
   for (i = 0; i < count; ++i)
@@ -1036,97 +1240,21 @@ read_log_rev_or_packfile(query_t *query,
      still be correct */
   APR_ARRAY_IDX(query->revisions, base, revision_info_t*)->end = max_offset;
 
-  /* for all offsets in the file, get the P2L index entries and process
-     the interesting items (change lists, noderevs) */
-  for (offset = 0; offset < max_offset; )
-    {
-      apr_array_header_t *entries;
-
-      svn_pool_clear(iterpool);
-
-      /* cancellation support */
-      if (query->cancel_func)
-        SVN_ERR(query->cancel_func(query->cancel_baton));
-
-      /* get all entries for the current block */
-      SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, query->fs, rev_file, base,
-                                          offset, ffd->p2l_page_size,
-                                          iterpool, iterpool));
-
-      /* process all entries (and later continue with the next block) */
-      for (i = 0; i < entries->nelts; ++i)
-        {
-          svn_stringbuf_t *item;
-          revision_info_t *info;
-          svn_fs_fs__p2l_entry_t *entry
-            = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
-
-          /* skip bits we previously processed */
-          if (i == 0 && entry->offset < offset)
-            continue;
-
-          /* skip zero-sized entries */
-          if (entry->size == 0)
-            continue;
-
-          /* read and process interesting items */
-          info = APR_ARRAY_IDX(query->revisions, entry->item.revision,
-                               revision_info_t*);
-
-          if (entry->type == SVN_FS_FS__ITEM_TYPE_NODEREV)
-            {
-              SVN_ERR(read_item(&item, rev_file, entry, iterpool, iterpool));
-              SVN_ERR(read_noderev(query, item, info, result_pool, iterpool));
-            }
-          else if (entry->type == SVN_FS_FS__ITEM_TYPE_CHANGES)
-            {
-              SVN_ERR(read_item(&item, rev_file, entry, iterpool, iterpool));
-              info->change_count
-                = get_log_change_count(item->data + 0, item->len);
-              info->changes_len += entry->size;
-            }
-          else if (   (entry->type == SVN_FS_FS__ITEM_TYPE_FILE_REP)
-                   || (entry->type == SVN_FS_FS__ITEM_TYPE_DIR_REP)
-                   || (entry->type == SVN_FS_FS__ITEM_TYPE_FILE_PROPS)
-                   || (entry->type == SVN_FS_FS__ITEM_TYPE_DIR_PROPS))
-            {
-              /* Collect the delta chain link. */
-              svn_fs_fs__rep_header_t *header;
-              rep_ref_t *ref = apr_pcalloc(scratch_pool, sizeof(*ref));
-
-              SVN_ERR(svn_io_file_aligned_seek(rev_file->file,
-                                               rev_file->block_size,
-                                               NULL, entry->offset,
-                                               iterpool));
-              SVN_ERR(svn_fs_fs__read_rep_header(&header,
-                                                 rev_file->stream,
-                                                 iterpool, iterpool));
-
-              ref->header_size = header->header_size;
-              ref->revision = entry->item.revision;
-              ref->item_index = entry->item.number;
-
-              if (header->type == svn_fs_fs__rep_delta)
-                {
-                  ref->base_item_index = header->base_item_index;
-                  ref->base_revision = header->base_revision;
-                }
-              else
-                {
-                  ref->base_item_index = SVN_FS_FS__ITEM_INDEX_UNUSED;
-                  ref->base_revision = SVN_INVALID_REVNUM;
-                }
-
-              APR_ARRAY_PUSH(rep_refs, rep_ref_t *) = ref;
-            }
+  /* read the file front to back and process the interesting items
+     (change lists, noderevs, representation headers) */
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_NODEREV] = scan_noderev;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_CHANGES] = scan_changes;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_FILE_REP] = scan_representation;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_DIR_REP] = scan_representation;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_FILE_PROPS] = scan_representation;
+  visitors.visitors[SVN_FS_FS__ITEM_TYPE_DIR_PROPS] = scan_representation;
 
-          /* advance offset */
-          offset += entry->size;
-        }
-    }
+  SVN_ERR(svn_fs_fs__scan_items(query->fs, rev_file, &visitors, &baton,
+                                query->cancel_func, query->cancel_baton,
+                                iterpool));
 
   /* Resolve the delta chain links. */
-  SVN_ERR(resolve_representation_refs(query, rep_refs));
+  SVN_ERR(resolve_representation_refs(query, baton.rep_refs));
 
   /* clean up and close file handles */
   svn_pool_destroy(iterpool);
@@ -1183,7 +1311,492 @@ read_log_revision_file(query_t *query,
   return SVN_NO_ERROR;
 }
 
+/* Version number of the stats cache file format. */
+#define STATS_CACHE_FORMAT 1
+
+/* Number of histograms in svn_fs_fs__stats_t filled by add_change. */
+#define CHANGE_HISTOGRAM_COUNT 13
+
+/* Return the histograms in STATS that get filled by add_change in
+ * HISTOGRAMS.
+ */
+static void
+get_change_histograms(svn_fs_fs__histogram_t *histograms[],
+                      svn_fs_fs__stats_t *stats)
+{
+  int i = 0;
+
+  histograms[i++] = &stats->rep_size_histogram;
+  histograms[i++] = &stats->node_size_histogram;
+  histograms[i++] = &stats->added_rep_size_histogram;
+  histograms[i++] = &stats->added_node_size_histogram;
+  histograms[i++] = &stats->unused_rep_histogram;
+  histograms[i++] = &stats->file_histogram;
+  histograms[i++] = &stats->file_rep_histogram;
+  histograms[i++] = &stats->file_prop_histogram;
+  histograms[i++] = &stats->file_prop_rep_histogram;
+  histograms[i++] = &stats->dir_histogram;
+  histograms[i++] = &stats->dir_rep_histogram;
+  histograms[i++] = &stats->dir_prop_histogram;
+  histograms[i++] = &stats->dir_prop_rep_histogram;
+
+  SVN_ERR_ASSERT_NO_RETURN(i == CHANGE_HISTOGRAM_COUNT);
+}
+
+/* Append HISTOGRAM to STREAM.
+ */
+static void
+write_histogram(svn_packed__int_stream_t *stream,
+                const svn_fs_fs__histogram_t *histogram)
+{
+  int i;
+
+  svn_packed__add_uint(stream, histogram->total.count);
+  svn_packed__add_uint(stream, histogram->total.sum);
+  for (i = 0; i < 64; ++i)
+    {
+      svn_packed__add_uint(stream, histogram->lines[i].count);
+      svn_packed__add_uint(stream, histogram->lines[i].sum);
+    }
+}
+
+/* Read the next histogram from STREAM into HISTOGRAM.
+ */
+static void
+read_histogram(svn_fs_fs__histogram_t *histogram,
+               svn_packed__int_stream_t *stream)
+{
+  int i;
+
+  histogram->total.count = svn_packed__get_uint(stream);
+  histogram->total.sum = svn_packed__get_uint(stream);
+  for (i = 0; i < 64; ++i)
+    {
+      histogram->lines[i].count = svn_packed__get_uint(stream);
+      histogram->lines[i].sum = svn_packed__get_uint(stream);
+    }
+}
+
+/* Set *SIZE to the size of the pack file containing REVISION in QUERY.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+get_pack_size(svn_filesize_t *size,
+              query_t *query,
+              svn_revnum_t revision,
+              apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  const char *path = svn_fs_fs__path_rev_absolute(query->fs, revision,
+                                                  scratch_pool);
+
+  SVN_ERR(svn_io_stat(&finfo, path, APR_FINFO_SIZE, scratch_pool));
+  *size = finfo.size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write all keys of HASH to STRINGS_STREAM and return a map from these
+ * keys to their 1-based position (int *) in that sequence.  Allocate the
+ * result in RESULT_POOL.
+ */
+static apr_hash_t *
+write_names(svn_packed__byte_stream_t *strings_stream,
+            apr_hash_t *hash,
+            apr_pool_t *result_pool)
+{
+  apr_hash_t *result = apr_hash_make(result_pool);
+  apr_hash_index_t *hi;
+  int count = 0;
+
+  for (hi = apr_hash_first(result_pool, hash); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      int *idx = apr_palloc(result_pool, sizeof(*idx));
+
+      *idx = ++count;
+      svn_packed__add_bytes(strings_stream, name, strlen(name));
+      apr_hash_set(result, name, APR_HASH_KEY_STRING, idx);
+    }
+
+  return result;
+}
+
+/* Return the 1-based position of NAME in MAP or 0 if NAME is NULL.
+ */
+static int
+get_name_index(apr_hash_t *map,
+               const char *name)
+{
+  return name ? *(int *)apr_hash_get(map, name, APR_HASH_KEY_STRING) : 0;
+}
+
+/* Write the results collected in QUERY for the first REVISION_COUNT
+ * revisions to the stats cache file.  This must be called before any
+ * later revision has been processed.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+write_stats_cache(query_t *query,
+                  svn_revnum_t revision_count,
+                  apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__stats_t *stats = query->stats;
+  svn_fs_fs__histogram_t *histograms[CHANGE_HISTOGRAM_COUNT];
+  svn_stringbuf_t *content = svn_stringbuf_create_empty(scratch_pool);
+  apr_hash_t *extension_map;
+  apr_hash_t *path_map;
+  apr_hash_index_t *hi;
+  svn_revnum_t revision;
+  apr_size_t i;
+  int k;
+
+  svn_packed__data_root_t *root = svn_packed__data_create_root(scratch_pool);
+  svn_packed__int_stream_t *header_stream
+    = svn_packed__create_int_stream(root, FALSE, FALSE);
+  svn_packed__int_stream_t *histogram_stream
+    = svn_packed__create_int_stream(root, FALSE, FALSE);
+  svn_packed__int_stream_t *changes_stream
+    = svn_packed__create_int_stream(root, FALSE, FALSE);
+  svn_packed__int_stream_t *revisions_stream
+    = svn_packed__create_int_stream(root, FALSE, FALSE);
+  svn_packed__int_stream_t *reps_stream
+    = svn_packed__create_int_stream(root, FALSE, FALSE);
+  svn_packed__byte_stream_t *strings_stream
+    = svn_packed__create_bytes_stream(root);
+
+  /* one sub-stream per struct member */
+  svn_packed__create_int_substream(changes_stream, FALSE, FALSE);
+  svn_packed__create_int_substream(changes_stream, TRUE, TRUE);
+
+  for (k = 0; k < 9; ++k)
+    svn_packed__create_int_substream(revisions_stream, k < 2, FALSE);
+
+  svn_packed__create_int_substream(reps_stream, TRUE, FALSE);
+  for (k = 1; k < 9; ++k)
+    svn_packed__create_int_substream(reps_stream, FALSE, FALSE);
+
+  /* Header, also used to detect stale caches. */
+  svn_packed__add_uint(header_stream, STATS_CACHE_FORMAT);
+  svn_packed__add_uint(header_stream, query->shard_size);
+  svn_packed__add_uint(header_stream,
+                       svn_fs_fs__use_log_addressing(query->fs));
+  svn_packed__add_uint(header_stream, query->path_depth);
+  svn_packed__add_uint(header_stream, revision_count);
+  svn_packed__add_uint(header_stream, apr_hash_count(stats->by_extension));
+  svn_packed__add_uint(header_stream, apr_hash_count(stats->by_path));
+
+  for (revision = 0; revision < revision_count;
+       revision += query->shard_size)
+    {
+      svn_filesize_t size;
+      SVN_ERR(get_pack_size(&size, query, revision, scratch_pool));
+      svn_packed__add_uint(header_stream, size);
+    }
+
+  svn_packed__add_bytes(strings_stream, query->fs->uuid,
+                        strlen(query->fs->uuid));
+
+  /* Cost group names. */
+  extension_map = write_names(strings_stream, stats->by_extension,
+                              scratch_pool);
+  path_map = write_names(strings_stream, stats->by_path, scratch_pool);
+
+  /* Aggregates filled by add_change. */
+  get_change_histograms(histograms, stats);
+  for (k = 0; k < CHANGE_HISTOGRAM_COUNT; ++k)
+    write_histogram(histogram_stream, histograms[k]);
+
+  for (hi = apr_hash_first(scratch_pool, stats->by_extension);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      svn_fs_fs__extension_info_t *info = apr_hash_this_val(hi);
+      write_histogram(histogram_stream, &info->rep_histogram);
+      write_histogram(histogram_stream, &info->node_histogram);
+    }
+
+  for (i = 0; i < stats->largest_changes->count; ++i)
+    {
+      svn_fs_fs__large_change_info_t *info
+        = stats->largest_changes->changes[i];
+
+      svn_packed__add_uint(changes_stream, info->size);
+      svn_packed__add_int(changes_stream, info->revision);
+      svn_packed__add_bytes(strings_stream, info->path->data,
+                            info->path->len);
+    }
+
+  /* Per-revision and per-representation data. */
+  for (revision = 0; revision < revision_count; ++revision)
+    {
+      revision_info_t *info = APR_ARRAY_IDX(query->revisions, revision,
+                                            revision_info_t *);
+
+      svn_packed__add_uint(revisions_stream, info->offset);
+      svn_packed__add_uint(revisions_stream, info->end);
+      svn_packed__add_uint(revisions_stream, info->changes_len);
+      svn_packed__add_uint(revisions_stream, info->change_count);
+      svn_packed__add_uint(revisions_stream, info->dir_noderev_count);
+      svn_packed__add_uint(revisions_stream, info->file_noderev_count);
+      svn_packed__add_uint(revisions_stream, info->dir_noderev_size);
+      svn_packed__add_uint(revisions_stream, info->file_noderev_size);
+      svn_packed__add_uint(revisions_stream, info->representations->nelts);
+
+      for (k = 0; k < info->representations->nelts; ++k)
+        {
+          rep_stats_t *rep = APR_ARRAY_IDX(info->representations, k,
+                                           rep_stats_t *);
+
+          svn_packed__add_uint(reps_stream, rep->item_index);
+          svn_packed__add_uint(reps_stream, rep->size);
+          svn_packed__add_uint(reps_stream, rep->expanded_size);
+          svn_packed__add_uint(reps_stream, rep->ref_count);
+          svn_packed__add_uint(reps_stream, rep->header_size);
+          svn_packed__add_uint(reps_stream, rep->kind);
+          svn_packed__add_uint(reps_stream, rep->chain_length);
+          svn_packed__add_uint(reps_stream,
+                get_name_index(path_map,
+                               rep->path_info ? rep->path_info->path
+                                              : NULL));
+          svn_packed__add_uint(reps_stream,
+                get_name_index(extension_map,
+                               rep->extension_info
+                                 ? rep->extension_info->extension
+                                 : NULL));
+        }
+    }
+
+  SVN_ERR(svn_packed__data_write(svn_stream_from_stringbuf(content,
+                                                           scratch_pool),
+                                 root, scratch_pool));
+  SVN_ERR(svn_io_write_atomic2(query->cache_path, content->data,
+                               content->len, NULL, FALSE, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the contents of the stats cache file and, if it matches the
+ * repository in QUERY, add the results stored in it to QUERY.  Set
+ * *REVISION_COUNT to the number of revisions covered, i.e. 0 if the cache
+ * could not be used.  Use RESULT_POOL for persistent allocations and
+ * SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+read_stats_cache(svn_revnum_t *revision_count,
+                 query_t *query,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__stats_t *stats = query->stats;
+  svn_fs_fs__histogram_t *histograms[CHANGE_HISTOGRAM_COUNT];
+  svn_stringbuf_t *content;
+  svn_packed__data_root_t *root;
+  svn_packed__int_stream_t *header_stream;
+  svn_packed__int_stream_t *histogram_stream;
+  svn_packed__int_stream_t *changes_stream;
+  svn_packed__int_stream_t *revisions_stream;
+  svn_packed__int_stream_t *reps_stream;
+  svn_packed__byte_stream_t *strings_stream;
+  svn_fs_fs__extension_info_t **extensions;
+  svn_fs_fs__path_info_t **paths;
+  apr_array_header_t *revisions;
+  int *rep_counts;
+  apr_uint64_t extension_count, path_count, rep_count = 0;
+  svn_revnum_t count, revision;
+  const char *uuid;
+  apr_size_t len, i;
+  svn_error_t *err;
+  int k;
+
+  *revision_count = 0;
+
+  /* No cache, yet? */
+  err = svn_stringbuf_from_file2(&content, query->cache_path, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* Unparsable caches will simply be replaced. */
+  err = svn_packed__data_read(&root,
+                              svn_stream_from_stringbuf(content,
+                                                        scratch_pool),
+                              scratch_pool, scratch_pool);
+  if (err && err->apr_err == SVN_ERR_CORRUPT_PACKED_DATA)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  header_stream = svn_packed__first_int_stream(root);
+  histogram_stream = header_stream
+                   ? svn_packed__next_int_stream(header_stream) : NULL;
+  changes_stream = histogram_stream
+                 ? svn_packed__next_int_stream(histogram_stream) : NULL;
+  revisions_stream = changes_stream
+                   ? svn_packed__next_int_stream(changes_stream) : NULL;
+  reps_stream = revisions_stream
+              ? svn_packed__next_int_stream(revisions_stream) : NULL;
+  strings_stream = svn_packed__first_byte_stream(root);
+  if (!reps_stream || !strings_stream)
+    return SVN_NO_ERROR;
+
+  /* Does the cache match the repository? */
+  if (   svn_packed__get_uint(header_stream) != STATS_CACHE_FORMAT
+      || svn_packed__get_uint(header_stream)
+           != (apr_uint64_t)query->shard_size
+      || svn_packed__get_uint(header_stream)
+           != (apr_uint64_t)svn_fs_fs__use_log_addressing(query->fs)
+      || svn_packed__get_uint(header_stream)
+           != (apr_uint64_t)query->path_depth)
+    return SVN_NO_ERROR;
+
+  count = (svn_revnum_t)svn_packed__get_uint(header_stream);
+  extension_count = svn_packed__get_uint(header_stream);
+  path_count = svn_packed__get_uint(header_stream);
+  if (   query->shard_size == 0
+      || count > query->min_unpacked_rev
+      || count % query->shard_size)
+    return SVN_NO_ERROR;
+
+  uuid = svn_packed__get_bytes(strings_stream, &len);
+  if (len != strlen(query->fs->uuid) || memcmp(uuid, query->fs->uuid, len))
+    return SVN_NO_ERROR;
+
+  /* Have any of the pack files been replaced since? */
+  for (revision = 0; revision < count; revision += query->shard_size)
+    {
+      svn_filesize_t size;
+      SVN_ERR(get_pack_size(&size, query, revision, scratch_pool));
+      if (svn_packed__get_uint(header_stream) != (apr_uint64_t)size)
+        return SVN_NO_ERROR;
+    }
+
+  /* Read the revision data and check that it is complete. */
+  if (   svn_packed__int_count(svn_packed__first_int_substream(
+                                 revisions_stream)) != (apr_size_t)count
+      || svn_packed__byte_block_count(strings_stream)
+           != extension_count + path_count
+              + stats->largest_changes->count)
+    return SVN_NO_ERROR;
+
+  revisions = apr_array_make(scratch_pool, (int)count,
+                             sizeof(revision_info_t *));
+  rep_counts = apr_palloc(scratch_pool, count * sizeof(*rep_counts));
+  for (revision = 0; revision < count; ++revision)
+    {
+      revision_info_t *info = apr_pcalloc(result_pool, sizeof(*info));
+      info->revision = revision;
+      info->offset = (apr_off_t)svn_packed__get_uint(revisions_stream);
+      info->end = (apr_off_t)svn_packed__get_uint(revisions_stream);
+      info->changes_len = svn_packed__get_uint(revisions_stream);
+      info->change_count = svn_packed__get_uint(revisions_stream);
+      info->dir_noderev_count = svn_packed__get_uint(revisions_stream);
+      info->file_noderev_count = svn_packed__get_uint(revisions_stream);
+      info->dir_noderev_size = svn_packed__get_uint(revisions_stream);
+      info->file_noderev_size = svn_packed__get_uint(revisions_stream);
+      rep_counts[revision] = (int)svn_packed__get_uint(revisions_stream);
+      info->representations = apr_array_make(result_pool,
+                                             rep_counts[revision],
+                                             sizeof(rep_stats_t *));
+
+      rep_count += rep_counts[revision];
+      APR_ARRAY_PUSH(revisions, revision_info_t *) = info;
+    }
+
+  if (svn_packed__int_count(svn_packed__first_int_substream(reps_stream))
+      != rep_count)
+    return SVN_NO_ERROR;
+
+  /* The cache is usable.  Restore the cost groups. */
+  extensions = apr_pcalloc(scratch_pool,
+                           (extension_count + 1) * sizeof(*extensions));
+  for (i = 1; i <= extension_count; ++i)
+    {
+      const char *name = svn_packed__get_bytes(strings_stream, &len);
+      extensions[i]
+        = get_extension_info(stats, apr_pstrmemdup(scratch_pool, name, len));
+    }
+
+  paths = apr_pcalloc(scratch_pool, (path_count + 1) * sizeof(*paths));
+  for (i = 1; i <= path_count; ++i)
+    {
+      const char *name = svn_packed__get_bytes(strings_stream, &len);
+      paths[i] = get_path_info(stats, apr_pstrmemdup(scratch_pool, name, len));
+    }
+
+  /* Restore the aggregates filled by add_change. */
+  get_change_histograms(histograms, stats);
+  for (k = 0; k < CHANGE_HISTOGRAM_COUNT; ++k)
+    read_histogram(histograms[k], histogram_stream);
+
+  for (i = 1; i <= extension_count; ++i)
+    {
+      read_histogram(&extensions[i]->rep_histogram, histogram_stream);
+      read_histogram(&extensions[i]->node_histogram, histogram_stream);
+    }
+
+  for (i = 0; i < stats->largest_changes->count; ++i)
+    {
+      svn_fs_fs__large_change_info_t *info
+        = stats->largest_changes->changes[i];
+      const char *path = svn_packed__get_bytes(strings_stream, &len);
+
+      info->size = svn_packed__get_uint(changes_stream);
+      info->revision = (svn_revnum_t)svn_packed__get_int(changes_stream);
+      svn_stringbuf_setempty(info->path);
+      svn_stringbuf_appendbytes(info->path, path, len);
+    }
+
+  stats->largest_changes->min_size
+    = stats->largest_changes->changes[stats->largest_changes->count - 1]
+        ->size;
+
+  /* Restore the per-revision and per-representation data. */
+  for (revision = 0; revision < count; ++revision)
+    {
+      revision_info_t *info = APR_ARRAY_IDX(revisions, revision,
+                                            revision_info_t *);
+
+      for (k = 0; k < rep_counts[revision]; ++k)
+        {
+          rep_stats_t *rep = apr_pcalloc(result_pool, sizeof(*rep));
+          apr_size_t path_idx, extension_idx;
+
+          rep->revision = revision;
+          rep->item_index = svn_packed__get_uint(reps_stream);
+          rep->size = svn_packed__get_uint(reps_stream);
+          rep->expanded_size = svn_packed__get_uint(reps_stream);
+          rep->ref_count = (apr_uint32_t)svn_packed__get_uint(reps_stream);
+          rep->header_size = (apr_uint16_t)svn_packed__get_uint(reps_stream);
+          rep->kind = (char)svn_packed__get_uint(reps_stream);
+          rep->chain_length = (apr_byte_t)svn_packed__get_uint(reps_stream);
+
+          path_idx = (apr_size_t)svn_packed__get_uint(reps_stream);
+          extension_idx = (apr_size_t)svn_packed__get_uint(reps_stream);
+          rep->path_info = path_idx <= path_count ? paths[path_idx] : NULL;
+          rep->extension_info = extension_idx <= extension_count
+                              ? extensions[extension_idx]
+                              : NULL;
+
+          APR_ARRAY_PUSH(info->representations, rep_stats_t *) = rep;
+        }
+
+      APR_ARRAY_PUSH(query->revisions, revision_info_t *) = info;
+    }
+
+  *revision_count = count;
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the repository and collect the stats info in QUERY.
+ * Take the results for packed shards from the stats cache, if possible,
+ * and update the cache afterwards.
  *
  * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
  * temporaries.
@@ -1194,10 +1807,17 @@ read_revisions(query_t *query,
                apr_pool_t *scratch_pool)
 {
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  svn_revnum_t revision;
+  svn_revnum_t revision = 0;
+  svn_revnum_t cached = 0;
+
+  /* fetch what we already know about the packed revs */
+  if (query->cache_path)
+    SVN_ERR(read_stats_cache(&cached, query, result_pool, iterpool));
 
-  /* read all packed revs */
-  for ( revision = 0
+  query->stats->cached_revision_count = cached;
+
+  /* read all remaining packed revs */
+  for ( revision = cached
       ; revision < query->min_unpacked_rev
       ; revision += query->shard_size)
     {
@@ -1209,6 +1829,13 @@ read_revisions(query_t *query,
         SVN_ERR(read_phys_pack_file(query, revision, result_pool, iterpool));
     }
 
+  /* Update the cache while it only contains packed revs. */
+  if (query->cache_path && revision > cached)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(write_stats_cache(query, revision, iterpool));
+    }
+
   /* read non-packed revs */
   for ( ; revision <= query->head; ++revision)
     {
@@ -1257,6 +1884,19 @@ add_rep_stats(svn_fs_fs__representation_stats_t *stats,
   stats->chain_len += rep->chain_length;
 }
 
+/* Accumulate the cost of REP in COST.
+ */
+static void
+add_cost(svn_fs_fs__cost_info_t *cost,
+         rep_stats_t *rep)
+{
+  cost->count++;
+  cost->packed_size += rep->size;
+  cost->expanded_size += rep->expanded_size;
+  cost->chain_len += rep->chain_length;
+  cost->max_chain_len = MAX(cost->max_chain_len, rep->chain_length);
+}
+
 /* Aggregate the info the in revision_info_t * array REVISIONS into the
  * respectve fields of STATS.
  */
@@ -1313,6 +1953,12 @@ aggregate_stats(const apr_array_header_t *revisions,
             }
 
           add_rep_stats(&stats->total_rep_stats, rep);
+
+          /* attribute the costs */
+          if (rep->path_info)
+            add_cost(&rep->path_info->cost, rep);
+          if (rep->extension_info)
+            add_cost(&rep->extension_info->cost, rep);
         }
     }
 }
@@ -1326,19 +1972,22 @@ create_stats(apr_pool_t *result_pool)
 
   initialize_largest_changes(stats, 64, result_pool);
   stats->by_extension = apr_hash_make(result_pool);
+  stats->by_path = apr_hash_make(result_pool);
 
   return stats;
 }
 
 /* Create a *QUERY, allocated in RESULT_POOL, reading filesystem FS and
- * collecting results in STATS.  Store the optional PROCESS_FUNC and
- * PROGRESS_BATON as well as CANCEL_FUNC and CANCEL_BATON in *QUERY, too.
- * Use SCRATCH_POOL for temporary allocations.
+ * collecting results in STATS.  Store PATH_DEPTH, the optional CACHE_PATH
+ * and PROCESS_FUNC and PROGRESS_BATON as well as CANCEL_FUNC and
+ * CANCEL_BATON in *QUERY, too.  Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 create_query(query_t **query,
              svn_fs_t *fs,
              svn_fs_fs__stats_t *stats,
+             int path_depth,
+             const char *cache_path,
              svn_fs_progress_notify_func_t progress_func,
              void *progress_baton,
              svn_cancel_func_t cancel_func,
@@ -1368,6 +2017,8 @@ create_query(query_t **query,
   /* Store other parameters */
   (*query)->fs = fs;
   (*query)->stats = stats;
+  (*query)->path_depth = path_depth;
+  (*query)->cache_path = cache_path;
   (*query)->progress_func = progress_func;
   (*query)->progress_baton = progress_baton;
   (*query)->cancel_func = cancel_func;
@@ -1379,6 +2030,8 @@ create_query(query_t **query,
 svn_error_t *
 svn_fs_fs__get_stats(svn_fs_fs__stats_t **stats,
                      svn_fs_t *fs,
+                     int path_depth,
+                     const char *cache_path,
                      svn_fs_progress_notify_func_t progress_func,
                      void *progress_baton,
                      svn_cancel_func_t cancel_func,
@@ -1389,7 +2042,8 @@ svn_fs_fs__get_stats(svn_fs_fs__stats_t **stats,
   query_t *query;
 
   *stats = create_stats(result_pool);
-  SVN_ERR(create_query(&query, fs, *stats, progress_func, progress_baton,
+  SVN_ERR(create_query(&query, fs, *stats, path_depth, cache_path,
+                       progress_func, progress_baton,
                        cancel_func, cancel_baton, scratch_pool,
                        scratch_pool));
   SVN_ERR(read_revisions(query, scratch_pool, scratch_pool));
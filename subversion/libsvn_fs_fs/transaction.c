@@ -507,6 +507,8 @@ svn_fs_fs__put_node_revision(svn_fs_t *fs,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   apr_file_t *noderev_file;
+  const char *noderev_path;
+  svn_error_t *err;
 
   noderev->is_fresh_txn_root = fresh_txn_root;
 
@@ -515,10 +517,28 @@ svn_fs_fs__put_node_revision(svn_fs_t *fs,
                              _("Attempted to write to non-transaction '%s'"),
                              svn_fs_fs__id_unparse(id, pool)->data);
 
-  SVN_ERR(svn_io_file_open(&noderev_file,
-                           svn_fs_fs__path_txn_node_rev(fs, id, pool),
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, pool));
+  noderev_path = svn_fs_fs__path_txn_node_rev(fs, id, pool);
+
+  /* The first file written for any node is its noderev.  So, this is the
+     only place where we may need to create the shard folder. */
+  err = svn_io_file_open(&noderev_file, noderev_path,
+                         APR_WRITE | APR_CREATE | APR_TRUNCATE
+                         | APR_BUFFERED, APR_OS_DEFAULT, pool);
+  if (   err && APR_STATUS_IS_ENOENT(err->apr_err)
+      && ffd->format >= SVN_FS_FS__MIN_TXN_NODE_SHARDS_FORMAT)
+    {
+      svn_error_clear(err);
+      err = svn_io_dir_make(svn_dirent_dirname(noderev_path, pool),
+                            APR_OS_DEFAULT, pool);
+      if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+        return svn_error_trace(err);
+      svn_error_clear(err);
+
+      err = svn_io_file_open(&noderev_file, noderev_path,
+                             APR_WRITE | APR_CREATE | APR_TRUNCATE
+                             | APR_BUFFERED, APR_OS_DEFAULT, pool);
+    }
+  SVN_ERR(err);
 
   SVN_ERR(svn_fs_fs__write_noderev(svn_stream_from_aprfile2(noderev_file, TRUE,
                                                             pool),
@@ -1049,6 +1069,7 @@ create_txn_dir(const char **id_p,
                svn_revnum_t rev,
                apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct get_and_increment_txn_key_baton cb;
   const char *txn_dir;
 
@@ -1067,8 +1088,16 @@ create_txn_dir(const char **id_p,
 
   *id_p = svn_fs_fs__id_txn_unparse(txn_id, pool);
   txn_dir = svn_fs_fs__path_txn_dir(fs, txn_id, pool);
+  SVN_ERR(svn_io_dir_make(txn_dir, APR_OS_DEFAULT, pool));
+
+  /* Large commits may touch hundreds of thousands of nodes.  Distribute
+     their files over a number of shards instead of piling them up in
+     TXN_DIR.  The shards themselves get created on demand. */
+  if (ffd->format >= SVN_FS_FS__MIN_TXN_NODE_SHARDS_FORMAT)
+    SVN_ERR(svn_io_dir_make(svn_fs_fs__path_txn_nodes(fs, txn_id, pool),
+                            APR_OS_DEFAULT, pool));
 
-  return svn_io_dir_make(txn_dir, APR_OS_DEFAULT, pool);
+  return SVN_NO_ERROR;
 }
 
 /* Create a unique directory for a transaction in FS based on revision
@@ -3593,13 +3622,14 @@ verify_locks(svn_fs_t *fs,
 }
 
 /* Writes final revision properties to file PATH applying permissions
-   from file PERMS_REFERENCE. This involves setting svn:date and
-   removing any temporary properties associated with the commit flags. */
+   from file PERMS_REFERENCE and schedule the necessary fsync calls in
+   BATCH. This involves setting svn:date and removing any temporary
+   properties associated with the commit flags. */
 static svn_error_t *
 write_final_revprop(const char *path,
                     const char *perms_reference,
                     svn_fs_txn_t *txn,
-                    svn_boolean_t flush_to_disk,
+                    svn_fs__batch_fsync_t *batch,
                     apr_pool_t *pool)
 {
   apr_hash_t *txnprops;
@@ -3607,6 +3637,7 @@ write_final_revprop(const char *path,
   svn_string_t *client_date;
   apr_file_t *revprop_file;
   svn_stream_t *stream;
+  apr_off_t offset;
 
   SVN_ERR(svn_fs_fs__txn_proplist(&txnprops, txn, pool));
 
@@ -3629,19 +3660,19 @@ write_final_revprop(const char *path,
       svn_hash_sets(txnprops, SVN_PROP_REVISION_DATE, &date);
     }
 
-  /* Create new revprops file. Tell OS to truncate existing file,
-     since  file may already exists from failed transaction. */
-  SVN_ERR(svn_io_file_open(&revprop_file, path,
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, pool));
+  /* Create new revprops file.  BATCH owns the file handle and will
+     fsync and close it later. */
+  SVN_ERR(svn_fs__batch_fsync_open_file(&revprop_file, batch, path,
+                                        pool));
 
   stream = svn_stream_from_aprfile2(revprop_file, TRUE, pool);
   SVN_ERR(svn_hash_write2(txnprops, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
 
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(revprop_file, pool));
-  SVN_ERR(svn_io_file_close(revprop_file, pool));
+  /* The file may already exist from a failed transaction.  Cut off any
+     left-over data. */
+  SVN_ERR(svn_io_file_get_offset(&offset, revprop_file, pool));
+  SVN_ERR(svn_io_file_trunc(revprop_file, offset, pool));
 
   SVN_ERR(svn_io_copy_perms(perms_reference, path, pool));
 
@@ -3753,6 +3784,7 @@ commit_body(void *baton, apr_pool_t *pool)
   apr_off_t initial_offset, changed_path_offset;
   const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
   apr_hash_t *changed_paths;
+  svn_fs__batch_fsync_t *batch;
   apr_array_header_t *directory_ids = apr_array_make(pool, 4,
                                                      sizeof(pair_cache_key_t));
 
@@ -3799,6 +3831,11 @@ commit_body(void *baton, apr_pool_t *pool)
   /* We are going to be one better than this puny old revision. */
   new_rev = old_rev + 1;
 
+  /* Collect all files and directories that we are about to create, so we
+     can fsync them concurrently just before making the revision visible
+     instead of paying for each fsync one after another. */
+  SVN_ERR(svn_fs__batch_fsync_create(&batch, ffd->flush_to_disk, pool));
+
   /* Get a write handle on the proto revision file. */
   SVN_ERR(get_writable_proto_rev(&proto_file, &proto_file_lockcookie,
                                  cb->fs, txn_id, pool));
@@ -3837,8 +3874,6 @@ commit_body(void *baton, apr_pool_t *pool)
                                      NULL, pool));
     }
 
-  if (ffd->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(proto_file, pool));
   SVN_ERR(svn_io_file_close(proto_file, pool));
 
   /* We don't unlock the prototype revision file immediately to avoid a
@@ -3863,6 +3898,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_dir, pool));
         }
 
       /* Create the revprops shard. */
@@ -3879,6 +3915,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVPROPS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_dir, pool));
         }
     }
 
@@ -3890,9 +3927,9 @@ commit_body(void *baton, apr_pool_t *pool)
   old_rev_filename = svn_fs_fs__path_rev_absolute(cb->fs, old_rev, pool);
   rev_filename = svn_fs_fs__path_rev(cb->fs, new_rev, pool);
   proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
-  SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename,
-                                     old_rev_filename, ffd->flush_to_disk,
-                                     pool));
+  SVN_ERR(svn_fs_fs__move_into_place_batched(proto_filename, rev_filename,
+                                             old_rev_filename, batch,
+                                             pool));
 
   /* Now that we've moved the prototype revision file out of the way,
      we can unlock it (since further attempts to write to the file
@@ -3904,7 +3941,7 @@ commit_body(void *baton, apr_pool_t *pool)
   SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
   revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
   SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
-                              cb->txn, ffd->flush_to_disk, pool));
+                              cb->txn, batch, pool));
 
   /* Run paranoia checks. */
   if (ffd->verify_before_commit)
@@ -3912,6 +3949,9 @@ commit_body(void *baton, apr_pool_t *pool)
       SVN_ERR(verify_before_commit(cb->fs, new_rev, pool));
     }
 
+  /* Commit all changes to disk before the new revision becomes visible. */
+  SVN_ERR(svn_fs__batch_fsync_run(batch, pool));
+
   /* Update the 'current' file. */
   SVN_ERR(write_final_current(cb->fs, txn_id, new_rev, start_node_id,
                               start_copy_id, pool));
@@ -4061,6 +4101,97 @@ svn_fs_fs__list_transactions(apr_array_header_t **names_p,
   return SVN_NO_ERROR;
 }
 
+/* Move the node files of the flat-layout transaction TXN_NAME in FS
+   into their PATH_TXN_NODES shards.  FS must already use a format of at
+   least SVN_FS_FS__MIN_TXN_NODE_SHARDS_FORMAT.  Files that have already
+   been moved are left alone, so this may be re-run after an interruption.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+shard_txn_nodes(svn_fs_t *fs,
+                const char *txn_name,
+                apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__id_part_t txn_id;
+  const char *txn_dir;
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_size_t prefix_len = strlen(PATH_PREFIX_NODE);
+
+  SVN_ERR(svn_fs_fs__id_txn_parse(&txn_id, txn_name));
+  txn_dir = svn_fs_fs__path_txn_dir(fs, &txn_id, scratch_pool);
+
+  SVN_ERR(svn_io_make_dir_recursively(svn_fs_fs__path_txn_nodes(fs, &txn_id,
+                                                                scratch_pool),
+                                      scratch_pool));
+  SVN_ERR(svn_io_get_dirents3(&dirents, txn_dir, TRUE, scratch_pool,
+                              scratch_pool));
+
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      const svn_fs_id_t *id;
+      char *id_str, *dot;
+      const char *shard_dir;
+
+      if (dirent->kind != svn_node_file
+          || strncmp(name, PATH_PREFIX_NODE, prefix_len) != 0)
+        continue;
+
+      svn_pool_clear(iterpool);
+
+      /* The file name is PATH_PREFIX_NODE, the node and copy ID parts of
+         the noderev ID and an optional extension.  Reconstruct the full
+         ID to find the shard. */
+      id_str = apr_pstrdup(iterpool, name + prefix_len);
+      dot = strchr(id_str, '.');
+      if (dot)
+        dot = strchr(dot + 1, '.');
+      if (dot)
+        *dot = '\0';
+      id_str = apr_pstrcat(iterpool, id_str, ".t", txn_name, SVN_VA_NULL);
+      SVN_ERR(svn_fs_fs__id_parse(&id, id_str, iterpool));
+
+      shard_dir = svn_fs_fs__path_txn_node_shard(fs, id, iterpool);
+      SVN_ERR(svn_io_make_dir_recursively(shard_dir, iterpool));
+      SVN_ERR(svn_io_file_rename2(svn_dirent_join(txn_dir, name, iterpool),
+                                  svn_dirent_join(shard_dir, name, iterpool),
+                                  FALSE, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__upgrade_txn_nodes(svn_fs_t *fs,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *txns;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  SVN_ERR(svn_fs_fs__list_transactions(&txns, fs, scratch_pool));
+  for (i = 0; i < txns->nelts; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(shard_txn_nodes(fs, APR_ARRAY_IDX(txns, i, const char *),
+                              iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__open_txn(svn_fs_txn_t **txn_p,
                     svn_fs_t *fs,
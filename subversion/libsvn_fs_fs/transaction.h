@@ -227,6 +227,18 @@ svn_fs_fs__list_transactions(apr_array_header_t **names_p,
                              svn_fs_t *fs,
                              apr_pool_t *pool);
 
+/* Move the node files of all existing transactions in FS from the
+   transaction directories into their PATH_TXN_NODES shards.  This is part
+   of upgrading FS to SVN_FS_FS__MIN_TXN_NODE_SHARDS_FORMAT and requires
+   FS->FSAP_DATA to already use that format.  The caller must hold the
+   txn-current lock.  CANCEL_FUNC and CANCEL_BATON are what you think they
+   are.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__upgrade_txn_nodes(svn_fs_t *fs,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *scratch_pool);
+
 /* Open the transaction named NAME in filesystem FS.  Set *TXN_P to
  * the transaction. If there is no such transaction, return
 ` * SVN_ERR_FS_NO_SUCH_TRANSACTION.  Allocate the new transaction in
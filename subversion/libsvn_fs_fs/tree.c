@@ -2262,6 +2262,7 @@ svn_fs_fs__commit_txn(const char **conflict_p,
   while (1729)
     {
       svn_revnum_t youngish_rev;
+      svn_revnum_t youngest_rev;
       svn_fs_root_t *youngish_root;
       dag_node_t *youngish_root_node;
 
@@ -2297,16 +2298,22 @@ svn_fs_fs__commit_txn(const char **conflict_p,
         }
       txn->base_rev = youngish_rev;
 
+      /* If someone else committed while we were merging, the commit
+         would only queue up for the write lock to then fail as out of
+         date.  Merge the new changes right away instead; that merge
+         only covers the revisions added since YOUNGISH_REV. */
+      SVN_ERR(svn_fs_fs__youngest_rev(&youngest_rev, fs, iterpool));
+      if (youngest_rev != youngish_rev)
+        continue;
+
       /* Try to commit. */
       err = svn_fs_fs__commit(new_rev, fs, txn, iterpool);
       if (err && (err->apr_err == SVN_ERR_FS_TXN_OUT_OF_DATE))
         {
           /* Did someone else finish committing a new revision while we
-             were in mid-merge or mid-commit?  If so, we'll need to
-             loop again to merge the new changes in, then try to
-             commit again.  Or if that's not what happened, then just
-             return the error. */
-          svn_revnum_t youngest_rev;
+             were in mid-commit?  If so, we'll need to loop again to
+             merge the new changes in, then try to commit again.  Or if
+             that's not what happened, then just return the error. */
           SVN_ERR(svn_fs_fs__youngest_rev(&youngest_rev, fs, iterpool));
           if (youngest_rev == youngish_rev)
             goto cleanup;
@@ -27,6 +27,7 @@
 #include "private/svn_string_private.h"
 
 #include "fs_fs.h"
+#include "id.h"
 #include "pack.h"
 #include "util.h"
 
@@ -317,6 +318,33 @@ svn_fs_fs__path_txn_proto_rev_lock(svn_fs_t *fs,
                            PATH_REV_LOCK, pool);
 }
 
+const char *
+svn_fs_fs__path_txn_nodes(svn_fs_t *fs,
+                          const svn_fs_fs__id_part_t *txn_id,
+                          apr_pool_t *pool)
+{
+  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, txn_id, pool),
+                         PATH_TXN_NODES, pool);
+}
+
+const char *
+svn_fs_fs__path_txn_node_shard(svn_fs_t *fs,
+                               const svn_fs_id_t *id,
+                               apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__id_txn_id(id);
+
+  if (ffd->format < SVN_FS_FS__MIN_TXN_NODE_SHARDS_FORMAT)
+    return svn_fs_fs__path_txn_dir(fs, txn_id, pool);
+
+  return svn_dirent_join(svn_fs_fs__path_txn_nodes(fs, txn_id, pool),
+                         apr_psprintf(pool, "%d",
+                              (int)(svn_fs_fs__id_node_id(id)->number
+                                    % SVN_FS_FS__TXN_NODE_SHARDS)),
+                         pool);
+}
+
 const char *
 svn_fs_fs__path_txn_node_rev(svn_fs_t *fs,
                              const svn_fs_id_t *id,
@@ -325,8 +353,7 @@ svn_fs_fs__path_txn_node_rev(svn_fs_t *fs,
   char *filename = (char *)svn_fs_fs__id_unparse(id, pool)->data;
   *strrchr(filename, '.') = '\0';
 
-  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, svn_fs_fs__id_txn_id(id),
-                                                 pool),
+  return svn_dirent_join(svn_fs_fs__path_txn_node_shard(fs, id, pool),
                          apr_psprintf(pool, PATH_PREFIX_NODE "%s",
                                       filename),
                          pool);
@@ -673,6 +700,41 @@ svn_fs_fs__move_into_place(const char *old_filename,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__move_into_place_batched(const char *old_filename,
+                                   const char *new_filename,
+                                   const char *perms_reference,
+                                   svn_fs__batch_fsync_t *batch,
+                                   apr_pool_t *pool)
+{
+  svn_error_t *err;
+  apr_file_t *file;
+
+  /* Move the file into place. */
+  err = svn_io_file_rename2(old_filename, new_filename, FALSE, pool);
+  if (err && APR_STATUS_IS_EXDEV(err->apr_err))
+    {
+      /* Can't rename across devices; fall back to copying. */
+      svn_error_clear(err);
+      SVN_ERR(svn_io_copy_file(old_filename, new_filename, FALSE, pool));
+    }
+  else if (err)
+    return svn_error_trace(err);
+
+  /* Schedule the new directory entry as well as the file contents for
+     fsync.  BATCH needs write access to the file on some platforms, so
+     get the handle before copying the permissions, which will usually
+     make the file read-only.  BATCH owns the handle and closes it. */
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, new_filename, pool));
+  SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, new_filename,
+                                        pool));
+
+  /* Copying permissions is a no-op on WIN32. */
+  SVN_ERR(svn_io_copy_perms(perms_reference, new_filename, pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_boolean_t
 svn_fs_fs__use_log_addressing(svn_fs_t *fs)
 {
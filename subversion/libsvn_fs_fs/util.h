@@ -25,6 +25,7 @@
 
 #include "svn_fs.h"
 #include "id.h"
+#include "private/svn_fs_util.h"
 
 /* Functions for dealing with recoverable errors on mutable files
  *
@@ -227,6 +228,27 @@ svn_fs_fs__path_txn_proto_rev_lock(svn_fs_t *fs,
                                    const svn_fs_fs__id_part_t *txn_id,
                                    apr_pool_t *pool);
 
+/* Return the path of the folder containing the node file shards of the
+ * transaction identified by TXN_ID in FS.  Only used by formats
+ * SVN_FS_FS__MIN_TXN_NODE_SHARDS_FORMAT and newer.  The result will be
+ * allocated in POOL.
+ */
+const char *
+svn_fs_fs__path_txn_nodes(svn_fs_t *fs,
+                          const svn_fs_fs__id_part_t *txn_id,
+                          apr_pool_t *pool);
+
+/* Return the path of the folder that contains the in-transaction files
+ * for the node revision identified by ID in FS.  That is either a shard
+ * folder below svn_fs_fs__path_txn_nodes() or, for formats older than
+ * SVN_FS_FS__MIN_TXN_NODE_SHARDS_FORMAT, the transaction folder itself.
+ * The result will be allocated in POOL.
+ */
+const char *
+svn_fs_fs__path_txn_node_shard(svn_fs_t *fs,
+                               const svn_fs_id_t *id,
+                               apr_pool_t *pool);
+
 /* Return the path of the file containing the in-transaction node revision
  * identified by ID in FS.  The result will be allocated in POOL.
  */
@@ -396,6 +418,18 @@ svn_fs_fs__move_into_place(const char *old_filename,
                            svn_boolean_t flush_to_disk,
                            apr_pool_t *pool);
 
+/* Like svn_fs_fs__move_into_place but do not flush anything to disk
+   immediately.  Instead, schedule NEW_FILENAME and its directory entry
+   for fsync in BATCH.  Like the former, fall back to copying if
+   OLD_FILENAME and NEW_FILENAME are on different devices.
+   Temporary allocations are from POOL. */
+svn_error_t *
+svn_fs_fs__move_into_place_batched(const char *old_filename,
+                                   const char *new_filename,
+                                   const char *perms_reference,
+                                   svn_fs__batch_fsync_t *batch,
+                                   apr_pool_t *pool);
+
 /* Return TRUE, iff FS uses logical addressing. */
 svn_boolean_t
 svn_fs_fs__use_log_addressing(svn_fs_t *fs);
@@ -33,6 +33,7 @@
 #include "revprops.h"
 #include "util.h"
 #include "index.h"
+#include "scan.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
@@ -248,6 +249,10 @@ verify_index_checksums(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Number of l2p index entries that compare_l2p_to_p2l_index() resolves
+ * in one go. */
+#define L2P_BATCH_SIZE 1024
+
 /* Verify that for all log-to-phys index entries for revisions START to
  * START + COUNT-1 in FS there is a consistent entry in the phys-to-log
  * index.  If given, invoke CANCEL_FUNC with CANCEL_BATON at regular
@@ -280,16 +285,34 @@ compare_l2p_to_p2l_index(svn_fs_t *fs,
       apr_uint64_t k;
       apr_uint64_t max_id = APR_ARRAY_IDX(max_ids, i, apr_uint64_t);
       svn_revnum_t revision = start + i;
+      svn_fs_fs__id_part_t items[L2P_BATCH_SIZE];
+      apr_off_t offsets[L2P_BATCH_SIZE];
 
       for (k = 0; k < max_id; ++k)
         {
           apr_off_t offset;
           svn_fs_fs__p2l_entry_t *p2l_entry;
+          int batch_index = (int)(k % L2P_BATCH_SIZE);
           svn_pool_clear(iterpool);
 
-          /* get L2P entry.  Ignore unused entries. */
-          SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, revision,
-                                         NULL, k, iterpool));
+          /* get L2P entries for a whole batch of items at once */
+          if (batch_index == 0)
+            {
+              int batch_size = (int)MIN(L2P_BATCH_SIZE, max_id - k);
+              int l;
+
+              for (l = 0; l < batch_size; ++l)
+                {
+                  items[l].revision = revision;
+                  items[l].number = k + l;
+                }
+
+              SVN_ERR(svn_fs_fs__item_offsets(offsets, fs, rev_file, items,
+                                              batch_size, iterpool));
+            }
+
+          /* Ignore unused entries. */
+          offset = offsets[batch_index];
           if (offset == -1)
             continue;
 
@@ -366,7 +389,9 @@ compare_p2l_to_l2p_index(svn_fs_t *fs,
     {
       apr_array_header_t *entries;
       svn_fs_fs__p2l_entry_t *last_entry;
-      int i;
+      svn_fs_fs__id_part_t *items;
+      apr_off_t *offsets;
+      int i, k;
 
       svn_pool_clear(iterpool);
 
@@ -386,7 +411,21 @@ compare_p2l_to_l2p_index(svn_fs_t *fs,
         = &APR_ARRAY_IDX(entries, entries->nelts-1, svn_fs_fs__p2l_entry_t);
       offset = last_entry->offset + last_entry->size;
 
-      for (i = 0; i < entries->nelts; ++i)
+      /* look up the L2P entries for all used items in this block */
+      items = apr_palloc(iterpool, entries->nelts * sizeof(*items));
+      offsets = apr_palloc(iterpool, entries->nelts * sizeof(*offsets));
+      for (i = 0, k = 0; i < entries->nelts; ++i)
+        {
+          svn_fs_fs__p2l_entry_t *entry
+            = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
+          if (entry->type != SVN_FS_FS__ITEM_TYPE_UNUSED)
+            items[k++] = entry->item;
+        }
+
+      SVN_ERR(svn_fs_fs__item_offsets(offsets, fs, rev_file, items, k,
+                                      iterpool));
+
+      for (i = 0, k = 0; i < entries->nelts; ++i)
         {
           svn_fs_fs__p2l_entry_t *entry
             = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
@@ -411,11 +450,7 @@ compare_p2l_to_l2p_index(svn_fs_t *fs,
             }
           else
             {
-              apr_off_t l2p_offset;
-              SVN_ERR(svn_fs_fs__item_offset(&l2p_offset, fs, rev_file,
-                                             entry->item.revision, NULL,
-                                             entry->item.number, iterpool));
-
+              apr_off_t l2p_offset = offsets[k++];
               if (l2p_offset != entry->offset)
                 return svn_error_createf(SVN_ERR_FS_INDEX_INCONSISTENT,
                                          NULL,
@@ -445,11 +480,15 @@ compare_p2l_to_l2p_index(svn_fs_t *fs,
  * Must be a multiple of 8. */
 #define STREAM_THRESHOLD 4096
 
-/* Verify that the next SIZE bytes read from FILE are NUL.
- * SIZE must not exceed STREAM_THRESHOLD.  Use POOL for allocations.
+/* Verify that the next SIZE bytes read from CONTENTS are NUL.  OFFSET is
+ * the position of that data within FILE and is only used for error
+ * messages.  SIZE must not exceed STREAM_THRESHOLD.  Use POOL for
+ * allocations.
  */
 static svn_error_t *
-expect_buffer_nul(apr_file_t *file,
+expect_buffer_nul(svn_stream_t *contents,
+                  apr_file_t *file,
+                  apr_off_t offset,
                   apr_off_t size,
                   apr_pool_t *pool)
 {
@@ -460,12 +499,15 @@ expect_buffer_nul(apr_file_t *file,
   } data;
 
   apr_size_t i;
+  apr_size_t len = (apr_size_t)size;
   SVN_ERR_ASSERT(size <= STREAM_THRESHOLD);
 
   /* read the whole data block; error out on failure */
   data.chunks[(size - 1)/ sizeof(apr_uint64_t)] = 0;
-  SVN_ERR(svn_io_file_read_full2(file, data.buffer, (apr_size_t)size, NULL,
-                                 NULL, pool));
+  SVN_ERR(svn_stream_read_full(contents, (char *)data.buffer, &len));
+  if (len != (apr_size_t)size)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Unexpected end of item contents"));
 
   /* chunky check */
   for (i = 0; i < size / sizeof(apr_uint64_t); ++i)
@@ -477,34 +519,37 @@ expect_buffer_nul(apr_file_t *file,
     if (data.buffer[i] != 0)
       {
         const char *file_name;
-        apr_off_t offset;
 
         SVN_ERR(svn_io_file_name_get(&file_name, file, pool));
-        SVN_ERR(svn_io_file_get_offset(&offset, file, pool));
-        offset -= size - i;
-
         return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
                                  _("Empty section in file %s contains "
                                    "non-NUL data at offset %s"),
-                                 file_name, apr_off_t_toa(pool, offset));
+                                 file_name,
+                                 apr_off_t_toa(pool, offset + i));
       }
 
   return SVN_NO_ERROR;
 }
 
-/* Verify that the next SIZE bytes read from FILE are NUL.
- * Use POOL for allocations.
+/* Verify that the SIZE bytes read from CONTENTS are NUL.  They start at
+ * OFFSET within FILE.  Use POOL for allocations.
  */
 static svn_error_t *
-read_all_nul(apr_file_t *file,
+read_all_nul(svn_stream_t *contents,
+             apr_file_t *file,
+             apr_off_t offset,
              apr_off_t size,
              apr_pool_t *pool)
 {
   for (; size >= STREAM_THRESHOLD; size -= STREAM_THRESHOLD)
-    SVN_ERR(expect_buffer_nul(file, STREAM_THRESHOLD, pool));
+    {
+      SVN_ERR(expect_buffer_nul(contents, file, offset, STREAM_THRESHOLD,
+                                pool));
+      offset += STREAM_THRESHOLD;
+    }
 
   if (size)
-    SVN_ERR(expect_buffer_nul(file, size, pool));
+    SVN_ERR(expect_buffer_nul(contents, file, offset, size, pool));
 
   return SVN_NO_ERROR;
 }
@@ -515,7 +560,7 @@ read_all_nul(apr_file_t *file,
  */
 static svn_error_t *
 expected_checksum(apr_file_t *file,
-                  svn_fs_fs__p2l_entry_t *entry,
+                  const svn_fs_fs__p2l_entry_t *entry,
                   apr_uint32_t actual,
                   apr_pool_t *pool)
 {
@@ -535,35 +580,38 @@ expected_checksum(apr_file_t *file,
 }
 
 /* Verify that the FNV checksum over the next ENTRY->SIZE bytes read
- * from FILE will match ENTRY's expected checksum.  SIZE must not
- * exceed STREAM_THRESHOLD.  Use POOL for allocations.
+ * from CONTENTS will match ENTRY's expected checksum.  Use the name of
+ * FILE in error messages.  SIZE must not exceed STREAM_THRESHOLD.
+ * Use POOL for allocations.
  */
 static svn_error_t *
-expected_buffered_checksum(apr_file_t *file,
-                           svn_fs_fs__p2l_entry_t *entry,
+expected_buffered_checksum(svn_stream_t *contents,
+                           apr_file_t *file,
+                           const svn_fs_fs__p2l_entry_t *entry,
                            apr_pool_t *pool)
 {
   unsigned char buffer[STREAM_THRESHOLD];
+  apr_size_t len = (apr_size_t)entry->size;
   SVN_ERR_ASSERT(entry->size <= STREAM_THRESHOLD);
 
-  SVN_ERR(svn_io_file_read_full2(file, buffer, (apr_size_t)entry->size,
-                                 NULL, NULL, pool));
-  SVN_ERR(expected_checksum(file, entry,
-                            svn__fnv1a_32x4(buffer, (apr_size_t)entry->size),
+  SVN_ERR(svn_stream_read_full(contents, (char *)buffer, &len));
+  SVN_ERR(expected_checksum(file, entry, svn__fnv1a_32x4(buffer, len),
                             pool));
 
   return SVN_NO_ERROR;
 }
 
 /* Verify that the FNV checksum over the next ENTRY->SIZE bytes read from
- * FILE will match ENTRY's expected checksum.  Use POOL for allocations.
+ * CONTENTS will match ENTRY's expected checksum.  Use the name of FILE
+ * in error messages.  Use POOL for allocations.
  */
 static svn_error_t *
-expected_streamed_checksum(apr_file_t *file,
-                           svn_fs_fs__p2l_entry_t *entry,
+expected_streamed_checksum(svn_stream_t *contents,
+                           apr_file_t *file,
+                           const svn_fs_fs__p2l_entry_t *entry,
                            apr_pool_t *pool)
 {
-  unsigned char buffer[STREAM_THRESHOLD];
+  char buffer[STREAM_THRESHOLD];
   svn_checksum_t *checksum;
   svn_checksum_ctx_t *context
     = svn_checksum_ctx_create(svn_checksum_fnv1a_32x4, pool);
@@ -574,8 +622,12 @@ expected_streamed_checksum(apr_file_t *file,
       apr_size_t to_read = size > sizeof(buffer)
                          ? sizeof(buffer)
                          : (apr_size_t)size;
-      SVN_ERR(svn_io_file_read_full2(file, buffer, to_read, NULL, NULL,
-                                     pool));
+      apr_size_t len = to_read;
+
+      SVN_ERR(svn_stream_read_full(contents, buffer, &len));
+      if (len != to_read)
+        break;
+
       SVN_ERR(svn_checksum_update(context, buffer, to_read));
       size -= to_read;
     }
@@ -588,6 +640,55 @@ expected_streamed_checksum(apr_file_t *file,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_fs_fs__scan_visitor_t.  Check the type <-> item
+ * dependencies of ENTRY and verify CONTENTS against ENTRY's checksum.
+ * BATON is the svn_fs_fs__revision_file_t being scanned.
+ */
+static svn_error_t *
+verify_item(const svn_fs_fs__p2l_entry_t *entry,
+            svn_stream_t *contents,
+            void *baton,
+            apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__revision_file_t *rev_file = baton;
+
+  /* There can be only one changes entry and that has a fixed type
+   * and item number.  Its presence and parse-ability will be checked
+   * during later stages of the verification process. */
+  if (   (entry->type == SVN_FS_FS__ITEM_TYPE_CHANGES)
+      != (entry->item.number == SVN_FS_FS__ITEM_INDEX_CHANGES))
+    return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION,
+                             NULL,
+                             _("p2l index entry for changes in"
+                               " revision r%ld is item %ld of type"
+                               " %d at offset %s"),
+                             entry->item.revision,
+                             entry->item.number,
+                             entry->type,
+                             apr_off_t_toa(scratch_pool, entry->offset));
+
+  /* Check contents. */
+  if (entry->type == SVN_FS_FS__ITEM_TYPE_UNUSED)
+    {
+      /* Empty sections must contain NUL bytes only.
+       * The filler at the end of the p2l index is never visited. */
+      SVN_ERR(read_all_nul(contents, rev_file->file, entry->offset,
+                           entry->size, scratch_pool));
+    }
+  else
+    {
+      /* Generic contents check against checksum. */
+      if (entry->size < STREAM_THRESHOLD)
+        SVN_ERR(expected_buffered_checksum(contents, rev_file->file, entry,
+                                           scratch_pool));
+      else
+        SVN_ERR(expected_streamed_checksum(contents, rev_file->file, entry,
+                                           scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Verify that for all phys-to-log index entries for revisions START to
  * START + COUNT-1 in FS match the actual pack / rev file contents.
  * If given, invoke CANCEL_FUNC with CANCEL_BATON at regular intervals.
@@ -604,11 +705,11 @@ compare_p2l_to_rev(svn_fs_t *fs,
                    void *cancel_baton,
                    apr_pool_t *pool)
 {
-  fs_fs_data_t *ffd = fs->fsap_data;
   apr_pool_t *iterpool = svn_pool_create(pool);
   apr_off_t max_offset;
-  apr_off_t offset = 0;
   svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__scan_visitors_t visitors;
+  int i;
 
   /* open the pack / rev file that is covered by the p2l index */
   SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, start, pool,
@@ -626,107 +727,13 @@ compare_p2l_to_rev(svn_fs_t *fs,
                              apr_off_t_toa(pool, rev_file->l2p_offset), start,
                              apr_off_t_toa(pool, max_offset));
 
-  SVN_ERR(svn_io_file_aligned_seek(rev_file->file, ffd->block_size, NULL, 0,
-                                   pool));
+  /* Read the file front to back and check every item we find against
+     its p2l index entry. */
+  for (i = 0; i < SVN_FS_FS__ITEM_TYPE_ANY_REP; ++i)
+    visitors.visitors[i] = verify_item;
 
-  /* for all offsets in the file, get the P2L index entries and check
-     them against the L2P index */
-  for (offset = 0; offset < max_offset; )
-    {
-      apr_array_header_t *entries;
-      int i;
-
-      svn_pool_clear(iterpool);
-
-      /* get all entries for the current block */
-      SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, fs, rev_file, start,
-                                          offset, ffd->p2l_page_size,
-                                          iterpool, iterpool));
-
-      /* The above might have moved the file pointer.
-       * Ensure we actually start reading at OFFSET.  */
-      SVN_ERR(svn_io_file_aligned_seek(rev_file->file, ffd->block_size,
-                                       NULL, offset, iterpool));
-
-      /* process all entries (and later continue with the next block) */
-      for (i = 0; i < entries->nelts; ++i)
-        {
-          svn_fs_fs__p2l_entry_t *entry
-            = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
-
-          /* skip bits we previously checked */
-          if (i == 0 && entry->offset < offset)
-            continue;
-
-          /* skip zero-sized entries */
-          if (entry->size == 0)
-            continue;
-
-          /* p2l index must cover all rev / pack file offsets exactly once */
-          if (entry->offset != offset)
-            return svn_error_createf(SVN_ERR_FS_INDEX_INCONSISTENT,
-                                     NULL,
-                                     _("p2l index entry for revision r%ld"
-                                       " is non-contiguous between offsets "
-                                       " %s and %s"),
-                                     start,
-                                     apr_off_t_toa(pool, offset),
-                                     apr_off_t_toa(pool, entry->offset));
-
-          /* Check type <-> item dependencies. */
-
-          /* Entry types must be within the valid range. */
-          if (entry->type >= SVN_FS_FS__ITEM_TYPE_ANY_REP)
-            return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION,
-                                     NULL,
-                                     _("p2l index entry for revision r%ld"
-                                       " at offset %s contains invalid item"
-                                       " type %d"),
-                                     start,
-                                     apr_off_t_toa(pool, offset),
-                                     entry->type);
-
-          /* There can be only one changes entry and that has a fixed type
-           * and item number.  Its presence and parse-ability will be checked
-           * during later stages of the verification process. */
-          if (   (entry->type == SVN_FS_FS__ITEM_TYPE_CHANGES)
-              != (entry->item.number == SVN_FS_FS__ITEM_INDEX_CHANGES))
-            return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION,
-                                     NULL,
-                                     _("p2l index entry for changes in"
-                                       " revision r%ld is item %ld of type"
-                                       " %d at offset %s"),
-                                     entry->item.revision,
-                                     entry->item.number,
-                                     entry->type,
-                                     apr_off_t_toa(pool, offset));
-
-          /* Check contents. */
-          if (entry->type == SVN_FS_FS__ITEM_TYPE_UNUSED)
-            {
-              /* Empty sections must contain NUL bytes only.
-               * Beware of the filler at the end of the p2l index. */
-              if (entry->offset != max_offset)
-                SVN_ERR(read_all_nul(rev_file->file, entry->size, pool));
-            }
-          else
-            {
-              /* Generic contents check against checksum. */
-              if (entry->size < STREAM_THRESHOLD)
-                SVN_ERR(expected_buffered_checksum(rev_file->file, entry,
-                                                   pool));
-              else
-                SVN_ERR(expected_streamed_checksum(rev_file->file, entry,
-                                                   pool));
-            }
-
-          /* advance offset */
-          offset += entry->size;
-        }
-
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-    }
+  SVN_ERR(svn_fs_fs__scan_items(fs, rev_file, &visitors, rev_file,
+                                cancel_func, cancel_baton, iterpool));
 
   svn_pool_destroy(iterpool);
 
@@ -24,6 +24,7 @@
 
 #include <assert.h>
 
+#include "svn_dirent_uri.h"
 #include "svn_hash.h"
 #include "svn_ctype.h"
 #include "svn_sorts.h"
@@ -2479,10 +2480,113 @@ compare_dirent_name(const void *a,
   return strcmp(lhs->name, rhs);
 }
 
+/* Parse a single directory entry from the serialized form at *P and
+ * return it in *DIRENT_P.  END is the end of the serialized data and *P
+ * will be moved to the first byte after the entry.  ID is provided for
+ * nicer error messages.
+ *
+ * The name of the new entry will be shared with the data at *P.  Allocate
+ * the result in RESULT_POOL and use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+parse_dir_entry(svn_fs_x__dirent_t **dirent_p,
+                const apr_byte_t **p,
+                const apr_byte_t *end,
+                const svn_fs_x__id_t *id,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  svn_fs_x__dirent_t *dirent = apr_pcalloc(result_pool, sizeof(*dirent));
+  const apr_byte_t *q = *p;
+
+  /* The part of the serialized entry that is not the name will be
+   * about 6 bytes or less.  Since APR allocates with an 8 byte
+   * alignment (4 bytes loss on average per string), simply using
+   * the name string in DATA already gives us near-optimal memory
+   * usage. */
+  dirent->name = (const char *)q;
+  q += strlen(dirent->name) + 1;
+  if (q >= end)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Directory entry missing kind in '%s'"),
+                        svn_fs_x__id_unparse(id, scratch_pool)->data);
+
+  dirent->kind = (svn_node_kind_t)*(q++);
+  if (q == end)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Directory entry missing change set in '%s'"),
+                        svn_fs_x__id_unparse(id, scratch_pool)->data);
+
+  q = svn__decode_int(&dirent->id.change_set, q, end);
+  if (q == end)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Directory entry missing item number in '%s'"),
+                        svn_fs_x__id_unparse(id, scratch_pool)->data);
+
+  *p = svn__decode_uint(&dirent->id.number, q, end);
+  *dirent_p = dirent;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a new array of svn_fs_x__dirent_t *, allocated in RESULT_POOL,
+ * that contains the entries of the sorted array BASE, modified by the
+ * sorted array of CHANGES.  A change with an unused noderev ID removes
+ * the respective entry.  Runs in O(n + m).
+ */
+static apr_array_header_t *
+merge_dir_changes(const apr_array_header_t *base,
+                  const apr_array_header_t *changes,
+                  apr_pool_t *result_pool)
+{
+  svn_fs_x__dirent_t * const *lhs = (const void *)base->elts;
+  svn_fs_x__dirent_t * const *rhs = (const void *)changes->elts;
+  int i = 0, k = 0;
+
+  apr_array_header_t *entries
+    = apr_array_make(result_pool, base->nelts + changes->nelts,
+                     sizeof(svn_fs_x__dirent_t *));
+
+  while (i < base->nelts || k < changes->nelts)
+    {
+      int diff;
+      svn_fs_x__dirent_t *change;
+
+      if (k == changes->nelts)
+        diff = -1;
+      else if (i == base->nelts)
+        diff = 1;
+      else
+        diff = strcmp(lhs[i]->name, rhs[k]->name);
+
+      /* Unchanged entry? */
+      if (diff < 0)
+        {
+          APR_ARRAY_PUSH(entries, svn_fs_x__dirent_t *) = lhs[i++];
+          continue;
+        }
+
+      /* Replaced, added or removed entry. */
+      if (diff == 0)
+        ++i;
+
+      change = rhs[k++];
+      if (svn_fs_x__id_used(&change->id))
+        APR_ARRAY_PUSH(entries, svn_fs_x__dirent_t *) = change;
+    }
+
+  return entries;
+}
+
 /* Into ENTRIES, parse all directories entries from the serialized form in
  * DATA.  If INCREMENTAL is TRUE, read until the end of the STREAM and
  * update the data.  ID is provided for nicer error messages.
  *
+ * The serialized form always starts with a complete directory that is
+ * sorted by entry name.  In INCREMENTAL mode, it is followed by a list
+ * of entry changes that we merge into that array instead of rebuilding
+ * the whole directory from scratch.
+ *
  * The contents of DATA will be shared with the items in ENTRIES, i.e. it
  * must not be modified afterwards and must remain valid as long as ENTRIES
  * is valid.  Use SCRATCH_POOL for temporary allocations.
@@ -2498,8 +2602,8 @@ parse_dir_entries(apr_array_header_t **entries_p,
   const apr_byte_t *p = (const apr_byte_t *)data->data;
   const apr_byte_t *end = p + data->len;
   apr_uint64_t count;
-  apr_hash_t *hash = incremental ? svn_hash__make(scratch_pool) : NULL;
   apr_array_header_t *entries;
+  apr_uint64_t i;
 
   /* Construct the resulting container. */
   p = svn__decode_uint(&count, p, end);
@@ -2511,72 +2615,50 @@ parse_dir_entries(apr_array_header_t **entries_p,
   entries = apr_array_make(result_pool, (int)count,
                            sizeof(svn_fs_x__dirent_t *));
 
-  while (p != end)
-    {
-      apr_size_t len;
-      svn_fs_x__dirent_t *dirent;
-      dirent = apr_pcalloc(result_pool, sizeof(*dirent));
-
-      /* The part of the serialized entry that is not the name will be
-       * about 6 bytes or less.  Since APR allocates with an 8 byte
-       * alignment (4 bytes loss on average per string), simply using
-       * the name string in DATA already gives us near-optimal memory
-       * usage. */
-      dirent->name = (const char *)p;
-      len = strlen(dirent->name);
-      p += len + 1;
-      if (p == end)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                            _("Directory entry missing kind in '%s'"),
-                            svn_fs_x__id_unparse(id, scratch_pool)->data);
-
-      dirent->kind = (svn_node_kind_t)*(p++);
-      if (p == end)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                            _("Directory entry missing change set in '%s'"),
-                            svn_fs_x__id_unparse(id, scratch_pool)->data);
-
-      p = svn__decode_int(&dirent->id.change_set, p, end);
-      if (p == end)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                            _("Directory entry missing item number in '%s'"),
-                            svn_fs_x__id_unparse(id, scratch_pool)->data);
-
-      p = svn__decode_uint(&dirent->id.number, p, end);
-
-      /* In incremental mode, update the hash; otherwise, write to the
-       * final array. */
-      if (incremental)
-        {
-          /* Insertion / update or a deletion? */
-          if (svn_fs_x__id_used(&dirent->id))
-            apr_hash_set(hash, dirent->name, len, dirent);
-          else
-            apr_hash_set(hash, dirent->name, len, NULL);
-        }
-      else
-        {
-          APR_ARRAY_PUSH(entries, svn_fs_x__dirent_t *) = dirent;
-        }
-    }
+  /* Read the complete base directory. */
+  for (i = 0; i < count && p != end; ++i)
+    SVN_ERR(parse_dir_entry(apr_array_push(entries), &p, end, id,
+                            result_pool, scratch_pool));
+
+  /* Check that we read the expected amount of entries. */
+  if ((apr_uint64_t)entries->nelts != count)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                        _("Directory length mismatch in '%s'"),
+                        svn_fs_x__id_unparse(id, scratch_pool)->data);
 
-  if (incremental)
+  /* We write directories sorted but older repositories may not. */
+  if (!sorted(entries))
+    svn_sort__array(entries, compare_dirents);
+
+  if (incremental && p != end)
     {
-      /* Convert container into a sorted array. */
+      /* Collect the latest change per entry name. */
+      apr_hash_t *hash = svn_hash__make(scratch_pool);
+      apr_array_header_t *changes;
       apr_hash_index_t *hi;
+
+      while (p != end)
+        {
+          svn_fs_x__dirent_t *dirent;
+          SVN_ERR(parse_dir_entry(&dirent, &p, end, id, result_pool,
+                                  scratch_pool));
+          svn_hash_sets(hash, dirent->name, dirent);
+        }
+
+      /* Sort the changes and merge them into the base directory. */
+      changes = apr_array_make(scratch_pool, apr_hash_count(hash),
+                               sizeof(svn_fs_x__dirent_t *));
       for (hi = apr_hash_first(scratch_pool, hash); hi; hi = apr_hash_next(hi))
-        APR_ARRAY_PUSH(entries, svn_fs_x__dirent_t *) = apr_hash_this_val(hi);
+        APR_ARRAY_PUSH(changes, svn_fs_x__dirent_t *) = apr_hash_this_val(hi);
 
-      if (!sorted(entries))
-        svn_sort__array(entries, compare_dirents);
+      svn_sort__array(changes, compare_dirents);
+      entries = merge_dir_changes(entries, changes, result_pool);
     }
-  else
+  else if (p != end)
     {
-      /* Check that we read the expected amount of entries. */
-      if ((apr_uint64_t)entries->nelts != count)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                            _("Directory length mismatch in '%s'"),
-                            svn_fs_x__id_unparse(id, scratch_pool)->data);
+      return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                          _("Directory length mismatch in '%s'"),
+                          svn_fs_x__id_unparse(id, scratch_pool)->data);
     }
 
  *entries_p = entries;
@@ -3039,9 +3121,40 @@ block_read_contents(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Return a human-readable name for the p2l index item TYPE.
+ */
+static const char *
+item_type_name(apr_uint32_t type)
+{
+  switch (type)
+    {
+      case SVN_FS_X__ITEM_TYPE_FILE_REP:
+        return _("file representation");
+      case SVN_FS_X__ITEM_TYPE_DIR_REP:
+        return _("directory representation");
+      case SVN_FS_X__ITEM_TYPE_FILE_PROPS:
+        return _("file properties");
+      case SVN_FS_X__ITEM_TYPE_DIR_PROPS:
+        return _("directory properties");
+      case SVN_FS_X__ITEM_TYPE_NODEREV:
+        return _("node revision");
+      case SVN_FS_X__ITEM_TYPE_CHANGES:
+        return _("changed paths list");
+      case SVN_FS_X__ITEM_TYPE_CHANGES_CONT:
+        return _("changes container");
+      case SVN_FS_X__ITEM_TYPE_NODEREVS_CONT:
+        return _("node revisions container");
+      case SVN_FS_X__ITEM_TYPE_REPS_CONT:
+        return _("representations container");
+      default:
+        return _("unknown");
+    }
+}
+
 /* For the given REV_FILE in FS, in *STREAM return a stream covering the
  * item specified by ENTRY.  Also, verify the item's content by low-level
- * checksum.  Allocate the result in RESULT_POOL.
+ * checksum.  Upon mismatch, return an error identifying the damaged item.
+ * Allocate the result in RESULT_POOL.
  */
 static svn_error_t *
 read_item(svn_stream_t **stream,
@@ -3054,6 +3167,9 @@ read_item(svn_stream_t **stream,
   svn_checksum_t *expected, *actual;
   apr_uint32_t plain_digest;
   svn_stringbuf_t *text;
+  svn_error_t *err;
+  const char *file_name;
+  const char *item_name;
 
   /* Read item into string buffer. */
   text = svn_stringbuf_create_ensure(entry->size, result_pool);
@@ -3079,11 +3195,31 @@ read_item(svn_stream_t **stream,
                 (const unsigned char *)&plain_digest, result_pool);
 
   /* Construct the full error message with all the info we have. */
-  return svn_checksum_mismatch_err(expected, actual, result_pool,
+  err = svn_checksum_mismatch_err(expected, actual, result_pool,
                  _("Low-level checksum mismatch while reading\n"
                    "%s bytes of meta data at offset %s "),
                  apr_off_t_toa(result_pool, entry->size),
                  apr_off_t_toa(result_pool, entry->offset));
+
+  /* Tell the user which item is affected. */
+  SVN_ERR(svn_error_compose_create(err,
+                                   svn_fs_x__rev_file_name(&file_name,
+                                                           rev_file,
+                                                           result_pool)));
+  item_name = entry->item_count
+            ? apr_psprintf(result_pool, "r%ld/%" APR_UINT64_T_FMT,
+                           svn_fs_x__get_revnum(entry->items[0].change_set),
+                           entry->items[0].number)
+            : "";
+  if (entry->item_count > 1)
+    item_name = apr_psprintf(result_pool, _("%s and %u more"), item_name,
+                             entry->item_count - 1);
+
+  return svn_error_createf(SVN_ERR_FS_CORRUPT, err,
+                           _("Damaged %s item %s at offset %s in file '%s'"),
+                           item_type_name(entry->type), item_name,
+                           apr_off_t_toa(result_pool, entry->offset),
+                           svn_dirent_local_style(file_name, result_pool));
 }
 
 /* If not already cached or if MUST_READ is set, read the changed paths
@@ -3449,6 +3585,7 @@ block_read(void **result,
                             && entry->size < ffd->block_size))
             {
               void *item = NULL;
+              svn_error_t *err = SVN_NO_ERROR;
               svn_fs_x__pair_cache_key_t key = { 0 };
               key.revision = svn_fs_x__get_revnum(entry->items[0].change_set);
               key.second = entry->items[0].number;
@@ -3461,57 +3598,65 @@ block_read(void **result,
                   case SVN_FS_X__ITEM_TYPE_DIR_REP:
                   case SVN_FS_X__ITEM_TYPE_FILE_PROPS:
                   case SVN_FS_X__ITEM_TYPE_DIR_PROPS:
-                    SVN_ERR(block_read_contents(fs, revision_file,
-                                                entry, &key,
-                                                is_wanted
-                                                  ? -1
-                                                  : block_start + ffd->block_size,
-                                                iterpool));
+                    err = block_read_contents(fs, revision_file,
+                                              entry, &key,
+                                              is_wanted
+                                                ? -1
+                                                : block_start + ffd->block_size,
+                                              iterpool);
                     break;
 
                   case SVN_FS_X__ITEM_TYPE_NODEREV:
-                    SVN_ERR(block_read_noderev((svn_fs_x__noderev_t **)&item,
-                                               fs, revision_file,
-                                               entry, &key, is_result,
-                                               pool, iterpool));
+                    err = block_read_noderev((svn_fs_x__noderev_t **)&item,
+                                             fs, revision_file,
+                                             entry, &key, is_result,
+                                             pool, iterpool);
                     break;
 
                   case SVN_FS_X__ITEM_TYPE_CHANGES:
-                    SVN_ERR(block_read_changes((apr_array_header_t **)&item,
-                                               fs, revision_file,
-                                               entry, baton, is_result,
-                                               pool, iterpool));
+                    err = block_read_changes((apr_array_header_t **)&item,
+                                             fs, revision_file,
+                                             entry, baton, is_result,
+                                             pool, iterpool);
                     break;
 
                   case SVN_FS_X__ITEM_TYPE_CHANGES_CONT:
-                    SVN_ERR(block_read_changes_container
-                                            ((apr_array_header_t **)&item,
-                                             fs, revision_file,
-                                             entry, wanted_sub_item,
-                                             baton, is_result,
-                                             pool, iterpool));
+                    err = block_read_changes_container
+                                          ((apr_array_header_t **)&item,
+                                           fs, revision_file,
+                                           entry, wanted_sub_item,
+                                           baton, is_result,
+                                           pool, iterpool);
                     break;
 
                   case SVN_FS_X__ITEM_TYPE_NODEREVS_CONT:
-                    SVN_ERR(block_read_noderevs_container
-                                            ((svn_fs_x__noderev_t **)&item,
-                                             fs, revision_file,
-                                             entry, wanted_sub_item,
-                                             is_result, pool, iterpool));
+                    err = block_read_noderevs_container
+                                          ((svn_fs_x__noderev_t **)&item,
+                                           fs, revision_file,
+                                           entry, wanted_sub_item,
+                                           is_result, pool, iterpool);
                     break;
 
                   case SVN_FS_X__ITEM_TYPE_REPS_CONT:
-                    SVN_ERR(block_read_reps_container
-                                      ((svn_fs_x__rep_extractor_t **)&item,
-                                       fs, revision_file,
-                                       entry, wanted_sub_item,
-                                       is_result, pool, iterpool));
+                    err = block_read_reps_container
+                                    ((svn_fs_x__rep_extractor_t **)&item,
+                                     fs, revision_file,
+                                     entry, wanted_sub_item,
+                                     is_result, pool, iterpool);
                     break;
 
                   default:
                     break;
                 }
 
+              /* Don't let damage to neighboring items keep us from reading
+               * the one we came for.  Errors with the latter get reported
+               * and the neighbors will do so when they get requested. */
+              if (err && !is_wanted)
+                svn_error_clear(err);
+              else
+                SVN_ERR(err);
+
               if (is_result)
                 *result = item;
 
@@ -32,7 +32,6 @@
 #include "svn_delta.h"
 #include "svn_version.h"
 #include "svn_pools.h"
-#include "batch_fsync.h"
 #include "fs.h"
 #include "fs_x.h"
 #include "pack.h"
@@ -538,9 +537,11 @@ x_hotcopy(svn_fs_t *src_fs,
           apr_pool_t *scratch_pool,
           apr_pool_t *common_pool)
 {
-  /* Open the source repo as usual. */
-  SVN_ERR(x_open(src_fs, src_path, common_pool_lock, scratch_pool,
-                 common_pool));
+  /* Open the source repo as usual, unless we are hotcopying repeatedly
+     from the same, already open source. */
+  if (!src_fs->fsap_data)
+    SVN_ERR(x_open(src_fs, src_path, common_pool_lock, scratch_pool,
+                   common_pool));
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
@@ -665,7 +666,7 @@ svn_fs_x__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(x_version(), checklist, svn_ver_equal));
 
-  SVN_ERR(svn_fs_x__batch_fsync_init(common_pool));
+  SVN_ERR(svn_fs__batch_fsync_init(common_pool));
 
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
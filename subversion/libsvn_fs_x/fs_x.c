@@ -1272,8 +1272,11 @@ svn_fs_x__info_format(int *fs_format,
     case 2:
       (*supports_version)->minor = 10;
       break;
+    case 3:
+      (*supports_version)->minor = 11;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_X__FORMAT_NUMBER != 2
+# if SVN_FS_X__FORMAT_NUMBER != 3
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -707,7 +707,9 @@ svn_fs_x__hotcopy(svn_fs_t *src_fs,
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
-  SVN_ERR(svn_fs_x__open(src_fs, src_path, scratch_pool));
+  /* SRC_FS has been opened by our caller, possibly some time ago.
+   * Pick up any packs that happened since. */
+  SVN_ERR(svn_fs_x__update_min_unpacked_rev(src_fs, scratch_pool));
 
   if (incremental)
     {
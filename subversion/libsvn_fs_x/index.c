@@ -22,6 +22,7 @@
 
 #include <assert.h>
 
+#include "svn_dirent_uri.h"
 #include "svn_io.h"
 #include "svn_pools.h"
 #include "svn_sorts.h"
@@ -78,6 +79,9 @@ typedef struct l2p_page_table_entry_t
 
   /* size of the page on disk (in the index file) */
   apr_uint32_t size;
+
+  /* FNV-1a checksum over the page's on-disk data */
+  apr_uint32_t checksum;
 } l2p_page_table_entry_t;
 
 /* Master run-time data structure of an log-to-phys index.  It contains
@@ -157,6 +161,9 @@ typedef struct p2l_header_t
 
   /* offsets of the pages / cluster descriptions within the index file */
   apr_off_t *offsets;
+
+  /* FNV-1a checksums over the on-disk data of each page description */
+  apr_uint32_t *checksums;
 } p2l_header_t;
 
 /*
@@ -216,6 +223,19 @@ struct svn_fs_x__packed_number_stream_t
 
   /* buffer for prefetched values */
   value_position_pair_t buffer[MAX_NUMBER_PREFETCH];
+
+  /* raw data from FILE that the values in BUFFER have been decoded from */
+  unsigned char raw[MAX_NUMBER_PREFETCH];
+
+  /* If set, collect the raw data of the index page between the FILE
+   * offsets PAGE_START and PAGE_END in PAGE_DATA while decoding it. */
+  svn_boolean_t collect_page;
+  apr_off_t page_start;
+  apr_off_t page_end;
+
+  /* raw data of the current index page.  Allocated in POOL upon first use
+   * and re-used for all further pages. */
+  svn_stringbuf_t *page_data;
 };
 
 /* Return an svn_error_t * object for error ERR on STREAM with the given
@@ -239,6 +259,27 @@ stream_error_create(svn_fs_x__packed_number_stream_t *stream,
                                         (apr_uint64_t)offset));
 }
 
+/* If STREAM collects the data of an index page, append the part of the
+ * LEN bytes in STREAM->RAW, read from file offset START, that belongs to
+ * that page and has not been collected yet.
+ */
+static void
+collect_page_data(svn_fs_x__packed_number_stream_t *stream,
+                  apr_off_t start,
+                  apr_size_t len)
+{
+  apr_off_t first, end;
+  if (!stream->collect_page)
+    return;
+
+  first = stream->page_start + stream->page_data->len;
+  end = MIN(start + (apr_off_t)len, stream->page_end);
+  if (start <= first && first < end)
+    svn_stringbuf_appendbytes(stream->page_data,
+                              (const char *)stream->raw + (first - start),
+                              (apr_size_t)(end - first));
+}
+
 /* Read up to MAX_NUMBER_PREFETCH numbers from the STREAM->NEXT_OFFSET in
  * STREAM->FILE and buffer them.
  *
@@ -250,7 +291,7 @@ SVN__PREVENT_INLINE
 static svn_error_t *
 packed_stream_read(svn_fs_x__packed_number_stream_t *stream)
 {
-  unsigned char buffer[MAX_NUMBER_PREFETCH];
+  unsigned char *buffer = stream->raw;
   apr_size_t bytes_read = 0;
   apr_size_t i;
   value_position_pair_t *target;
@@ -273,7 +314,7 @@ packed_stream_read(svn_fs_x__packed_number_stream_t *stream)
    * boundaries.  This shall prevent jumping back and forth between two
    * blocks because the extra data was not actually request _now_.
    */
-  bytes_read = sizeof(buffer);
+  bytes_read = sizeof(stream->raw);
   block_left = stream->block_size - (stream->next_offset - block_start);
   if (block_left >= 10 && block_left < bytes_read)
     bytes_read = (apr_size_t)block_left;
@@ -340,6 +381,9 @@ packed_stream_read(svn_fs_x__packed_number_stream_t *stream)
   stream->next_offset = stream->start_offset + i;
   stream->current = 0;
 
+  if (stream->collect_page)
+    collect_page_data(stream, stream->start_offset, i);
+
   return SVN_NO_ERROR;
 }
 
@@ -386,6 +430,10 @@ svn_fs_x__packed_stream_open(svn_fs_x__packed_number_stream_t **stream,
   result->start_offset = result->stream_start;
   result->next_offset = result->stream_start;
   result->block_size = block_size;
+  result->collect_page = FALSE;
+  result->page_start = 0;
+  result->page_end = 0;
+  result->page_data = NULL;
 
   *stream = result;
 
@@ -459,6 +507,132 @@ packed_stream_offset(svn_fs_x__packed_number_stream_t *stream)
   return file_offset - stream->stream_start;
 }
 
+/* Return the error for the damaged index page of SIZE bytes at packed
+ * stream OFFSET in STREAM.  INDEX_NAME identifies the index in the error
+ * message.
+ */
+static svn_error_t *
+page_damaged_error(svn_fs_x__packed_number_stream_t *stream,
+                   apr_off_t offset,
+                   apr_off_t size,
+                   const char *index_name)
+{
+  const char *file_name;
+  SVN_ERR(svn_io_file_name_get(&file_name, stream->file, stream->pool));
+
+  return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                           _("%s index page at offset %s of length %s "
+                             "in file '%s' is damaged"),
+                           index_name,
+                           apr_off_t_toa(stream->pool, offset),
+                           apr_off_t_toa(stream->pool, size),
+                           svn_dirent_local_style(file_name, stream->pool));
+}
+
+/* Start collecting the raw data of the SIZE bytes long index page at
+ * packed stream OFFSET in STREAM while it gets decoded.  STREAM must
+ * already be positioned at OFFSET.
+ */
+static void
+packed_stream_begin_page(svn_fs_x__packed_number_stream_t *stream,
+                         apr_off_t offset,
+                         apr_off_t size)
+{
+  if (stream->page_data)
+    svn_stringbuf_setempty(stream->page_data);
+  else
+    stream->page_data = svn_stringbuf_create_ensure((apr_size_t)size,
+                                                    stream->pool);
+
+  stream->collect_page = TRUE;
+  stream->page_start = stream->stream_start + offset;
+  stream->page_end = stream->page_start + size;
+
+  /* The beginning of the page may already have been buffered. */
+  if (stream->used)
+    collect_page_data(stream, stream->start_offset,
+                      (apr_size_t)(stream->next_offset
+                                   - stream->start_offset));
+}
+
+/* Stop collecting page data in STREAM and verify that the page matches
+ * the FNV-1a CHECKSUM recorded for it.  INDEX_NAME identifies the index in
+ * the error message.
+ */
+static svn_error_t *
+packed_stream_end_page(svn_fs_x__packed_number_stream_t *stream,
+                       apr_uint32_t checksum,
+                       const char *index_name)
+{
+  svn_stringbuf_t *data = stream->page_data;
+  apr_off_t size = stream->page_end - stream->page_start;
+
+  stream->collect_page = FALSE;
+
+  /* Decoding may have stopped early, e.g. due to a parser error.
+   * Only then, read the remainder of the page directly. */
+  if (data->len < (apr_size_t)size && stream->page_end <= stream->stream_end)
+    {
+      apr_size_t missing = (apr_size_t)size - data->len;
+
+      svn_stringbuf_ensure(data, (apr_size_t)size);
+      SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
+                                       NULL,
+                                       stream->page_start + data->len,
+                                       stream->pool));
+      SVN_ERR(svn_io_file_read_full2(stream->file, data->data + data->len,
+                                     missing, NULL, NULL, stream->pool));
+      data->len += missing;
+      data->data[data->len] = '\0';
+    }
+
+  if (   data->len != (apr_size_t)size
+      || svn__fnv1a_32x4(data->data, data->len) != checksum)
+    return page_damaged_error(stream,
+                              stream->page_start - stream->stream_start,
+                              size, index_name);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the SIZE bytes of index data starting at the packed stream
+ * offset OFFSET in STREAM match the FNV-1a CHECKSUM recorded for that
+ * index page.  Unlike packed_stream_begin_page, this reads the raw
+ * page data without decoding it.  INDEX_NAME identifies the index in the
+ * error message.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+verify_page_checksum(svn_fs_x__packed_number_stream_t *stream,
+                     apr_off_t offset,
+                     apr_size_t size,
+                     apr_uint32_t checksum,
+                     const char *index_name,
+                     apr_pool_t *scratch_pool)
+{
+  char *buffer;
+  apr_off_t file_offset = stream->stream_start + offset;
+
+  if (file_offset + (apr_off_t)size > stream->stream_end)
+    return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                             _("%s index page at offset %s extends beyond "
+                               "the end of the index"),
+                             index_name,
+                             apr_off_t_toa(scratch_pool, offset));
+
+  /* Read the raw page data.  Subsequent packed_stream_read() calls will
+   * re-position the file pointer as needed. */
+  buffer = apr_palloc(scratch_pool, size);
+  SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size, NULL,
+                                   file_offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(stream->file, buffer, size, NULL, NULL,
+                                 scratch_pool));
+
+  if (svn__fnv1a_32x4(buffer, size) != checksum)
+    return page_damaged_error(stream, offset, size, index_name);
+
+  return SVN_NO_ERROR;
+}
+
 /* Write VALUE to the PROTO_INDEX file, using SCRATCH_POOL for temporary
  * allocations.
  *
@@ -729,6 +903,40 @@ stream_write_encoded(svn_stream_t *stream,
   return svn_error_trace(svn_stream_write(stream, (char *)encoded, &len));
 }
 
+/* Append the LEN bytes at DATA to the index page data in BUFFER and add
+ * them to the checksum of the current page being calculated in
+ * PAGE_CHECKSUM.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_page_data(svn_spillbuf_t *buffer,
+                svn_checksum_ctx_t *page_checksum,
+                const char *data,
+                apr_size_t len,
+                apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_checksum_update(page_checksum, data, len));
+  return svn_error_trace(svn_spillbuf__write(buffer, data, len,
+                                             scratch_pool));
+}
+
+/* Finalize the checksum of the current index page in PAGE_CHECKSUM and
+ * append it as apr_uint64_t to CHECKSUMS.  Reset PAGE_CHECKSUM for the
+ * next page.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+end_page_checksum(apr_array_header_t *checksums,
+                  svn_checksum_ctx_t *page_checksum,
+                  apr_pool_t *scratch_pool)
+{
+  svn_checksum_t *checksum;
+
+  SVN_ERR(svn_checksum_final(&checksum, page_checksum, scratch_pool));
+  APR_ARRAY_PUSH(checksums, apr_uint64_t)
+    = ntohl(*(const apr_uint32_t *)checksum->digest);
+
+  return svn_error_trace(svn_checksum_ctx_reset(page_checksum));
+}
+
 /* Run-length-encode the uint64 numbers in ARRAY starting at index START
  * up to but not including END.  All numbers must be > 0.
  * Return the number of remaining entries in ARRAY after START.
@@ -791,14 +999,15 @@ compare_l2p_entries_by_offset(const l2p_page_entry_t *lhs,
 
 /* Write the log-2-phys index page description for the l2p_page_entry_t
  * array ENTRIES, starting with element START up to but not including END.
- * Write the resulting representation into BUFFER.  Use SCRATCH_POOL for
- * temporary allocations.
+ * Write the resulting representation into BUFFER and add it to the page
+ * checksum in PAGE_CHECKSUM.  Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 encode_l2p_page(apr_array_header_t *entries,
                 int start,
                 int end,
                 svn_spillbuf_t *buffer,
+                svn_checksum_ctx_t *page_checksum,
                 apr_pool_t *scratch_pool)
 {
   unsigned char encoded[ENCODED_INT_LENGTH];
@@ -848,11 +1057,11 @@ encode_l2p_page(apr_array_header_t *entries,
     }
 
   /* write container list to BUFFER */
-  SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                              encode_uint(encoded, container_count),
-                              scratch_pool));
-  SVN_ERR(svn_spillbuf__write(buffer, (const char *)container_offsets->data,
-                              container_offsets->len, scratch_pool));
+  SVN_ERR(write_page_data(buffer, page_checksum, (const char *)encoded,
+                          encode_uint(encoded, container_count),
+                          scratch_pool));
+  SVN_ERR(write_page_data(buffer, page_checksum, container_offsets->data,
+                          container_offsets->len, scratch_pool));
 
   /* encode items */
   for (i = start; i < end; ++i)
@@ -860,7 +1069,8 @@ encode_l2p_page(apr_array_header_t *entries,
       l2p_page_entry_t *entry = &APR_ARRAY_IDX(entries, i, l2p_page_entry_t);
       if (entry->offset == 0)
         {
-          SVN_ERR(svn_spillbuf__write(buffer, "\0", 1, scratch_pool));
+          SVN_ERR(write_page_data(buffer, page_checksum, "\0", 1,
+                                  scratch_pool));
         }
       else
         {
@@ -869,20 +1079,23 @@ encode_l2p_page(apr_array_header_t *entries,
           if (void_idx == NULL)
             {
               apr_uint64_t value = entry->offset + container_count;
-              SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                                          encode_uint(encoded, value),
-                                          scratch_pool));
+              SVN_ERR(write_page_data(buffer, page_checksum,
+                                      (const char *)encoded,
+                                      encode_uint(encoded, value),
+                                      scratch_pool));
             }
           else
             {
               apr_uintptr_t idx = (apr_uintptr_t)void_idx;
               apr_uint64_t value = entry->sub_item;
-              SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                                          encode_uint(encoded, idx),
-                                          scratch_pool));
-              SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                                          encode_uint(encoded, value),
-                                          scratch_pool));
+              SVN_ERR(write_page_data(buffer, page_checksum,
+                                      (const char *)encoded,
+                                      encode_uint(encoded, idx),
+                                      scratch_pool));
+              SVN_ERR(write_page_data(buffer, page_checksum,
+                                      (const char *)encoded,
+                                      encode_uint(encoded, value),
+                                      scratch_pool));
             }
         }
     }
@@ -920,6 +1133,10 @@ svn_fs_x__l2p_index_append(svn_checksum_t **checksum,
     = apr_array_make(local_pool, 16, sizeof(apr_uint64_t));
   apr_array_header_t *entry_counts
     = apr_array_make(local_pool, 16, sizeof(apr_uint64_t));
+  apr_array_header_t *page_checksums
+    = apr_array_make(local_pool, 16, sizeof(apr_uint64_t));
+  svn_checksum_ctx_t *page_checksum
+    = svn_checksum_ctx_create(svn_checksum_fnv1a_32x4, local_pool);
 
   /* collect the item offsets and sub-item value for the current revision */
   apr_array_header_t *entries
@@ -972,7 +1189,9 @@ svn_fs_x__l2p_index_append(svn_checksum_t **checksum,
                           ? (int)ffd->l2p_page_size
                           : entries->nelts - i;
               SVN_ERR(encode_l2p_page(entries, i, i + entry_count,
-                                      buffer, iterpool));
+                                      buffer, page_checksum, iterpool));
+              SVN_ERR(end_page_checksum(page_checksums, page_checksum,
+                                        iterpool));
 
               APR_ARRAY_PUSH(entry_counts, apr_uint64_t) = entry_count;
               APR_ARRAY_PUSH(page_sizes, apr_uint64_t)
@@ -1053,6 +1272,8 @@ svn_fs_x__l2p_index_append(svn_checksum_t **checksum,
       SVN_ERR(stream_write_encoded(stream, value));
       value = APR_ARRAY_IDX(entry_counts, i, apr_uint64_t);
       SVN_ERR(stream_write_encoded(stream, value));
+      value = APR_ARRAY_IDX(page_checksums, i, apr_uint64_t);
+      SVN_ERR(stream_write_encoded(stream, value));
     }
 
   /* append page contents and implicitly close STREAM */
@@ -1344,6 +1565,13 @@ get_l2p_header_body(l2p_header_t **header,
                                 _("Page exceeds L2P index page size"));
 
       result->page_table[page].entry_count = (apr_uint32_t)value;
+
+      SVN_ERR(packed_stream_get(&value, stream));
+      if (value > APR_UINT32_MAX)
+        return svn_error_create(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                                _("Invalid L2P index page checksum"));
+
+      result->page_table[page].checksum = (apr_uint32_t)value;
     }
 
   /* correct the page description offsets */
@@ -1451,6 +1679,9 @@ get_l2p_page(l2p_page_t **page,
   SVN_ERR(svn_fs_x__rev_file_l2p_index(&stream, rev_file));
   packed_stream_seek(stream, table_entry->offset);
 
+  /* make sure the page has not been damaged while decoding it */
+  packed_stream_begin_page(stream, table_entry->offset, table_entry->size);
+
   /* initialize the page content */
   result->entry_count = table_entry->entry_count;
   result->offsets = apr_pcalloc(result_pool, result->entry_count
@@ -1493,6 +1724,8 @@ get_l2p_page(l2p_page_t **page,
         }
     }
 
+  SVN_ERR(packed_stream_end_page(stream, table_entry->checksum, "L2P"));
+
   /* After reading all page entries, the read cursor must have moved by
    * TABLE_ENTRY->SIZE bytes. */
   if (   packed_stream_offset(stream)
@@ -2191,6 +2424,10 @@ svn_fs_x__p2l_index_append(svn_checksum_t **checksum,
   apr_pool_t *local_pool = svn_pool_create(scratch_pool);
   apr_array_header_t *table_sizes
      = apr_array_make(local_pool, 16, sizeof(apr_uint64_t));
+  apr_array_header_t *table_checksums
+     = apr_array_make(local_pool, 16, sizeof(apr_uint64_t));
+  svn_checksum_ctx_t *page_checksum
+    = svn_checksum_ctx_create(svn_checksum_fnv1a_32x4, local_pool);
 
   /* 64k blocks, spill after 16MB */
   svn_spillbuf_t *buffer
@@ -2261,6 +2498,8 @@ svn_fs_x__p2l_index_append(svn_checksum_t **checksum,
           apr_uint64_t buffer_size = svn_spillbuf__get_size(buffer);
           APR_ARRAY_PUSH(table_sizes, apr_uint64_t)
              = buffer_size - last_buffer_size;
+          SVN_ERR(end_page_checksum(table_checksums, page_checksum,
+                                    iterpool));
 
           last_buffer_size = buffer_size;
           last_page_end += page_size;
@@ -2271,23 +2510,24 @@ svn_fs_x__p2l_index_append(svn_checksum_t **checksum,
          (all following entries in the same table will store sizes only) */
       if (new_page)
         {
-          SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                                      encode_uint(encoded, entry.offset),
-                                      iterpool));
+          SVN_ERR(write_page_data(buffer, page_checksum,
+                                  (const char *)encoded,
+                                  encode_uint(encoded, entry.offset),
+                                  iterpool));
           last_revision = revision;
         }
 
       /* write simple item / container entry */
-      SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                                  encode_uint(encoded, entry.size),
-                                  iterpool));
-      SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                                  encode_uint(encoded, entry.type
-                                                     + entry.item_count * 16),
-                                  iterpool));
-      SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                                  encode_uint(encoded, entry.fnv1_checksum),
-                                  iterpool));
+      SVN_ERR(write_page_data(buffer, page_checksum, (const char *)encoded,
+                              encode_uint(encoded, entry.size),
+                              iterpool));
+      SVN_ERR(write_page_data(buffer, page_checksum, (const char *)encoded,
+                              encode_uint(encoded, entry.type
+                                                 + entry.item_count * 16),
+                              iterpool));
+      SVN_ERR(write_page_data(buffer, page_checksum, (const char *)encoded,
+                              encode_uint(encoded, entry.fnv1_checksum),
+                              iterpool));
 
       /* container contents (only one for non-container items) */
       for (sub_item = 0; sub_item < entry.item_count; ++sub_item)
@@ -2295,18 +2535,20 @@ svn_fs_x__p2l_index_append(svn_checksum_t **checksum,
           svn_revnum_t item_rev
             = svn_fs_x__get_revnum(entry.items[sub_item].change_set);
           apr_int64_t diff = item_rev - last_revision;
-          SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                                      encode_int(encoded, diff),
-                                      iterpool));
+          SVN_ERR(write_page_data(buffer, page_checksum,
+                                  (const char *)encoded,
+                                  encode_int(encoded, diff),
+                                  iterpool));
           last_revision = item_rev;
         }
 
       for (sub_item = 0; sub_item < entry.item_count; ++sub_item)
         {
           apr_int64_t diff = entry.items[sub_item].number - last_number;
-          SVN_ERR(svn_spillbuf__write(buffer, (const char *)encoded,
-                                      encode_int(encoded, diff),
-                                      iterpool));
+          SVN_ERR(write_page_data(buffer, page_checksum,
+                                  (const char *)encoded,
+                                  encode_int(encoded, diff),
+                                  iterpool));
           last_number = entry.items[sub_item].number;
         }
 
@@ -2319,6 +2561,7 @@ svn_fs_x__p2l_index_append(svn_checksum_t **checksum,
   /* store length of last table */
   APR_ARRAY_PUSH(table_sizes, apr_uint64_t)
       = svn_spillbuf__get_size(buffer) - last_buffer_size;
+  SVN_ERR(end_page_checksum(table_checksums, page_checksum, local_pool));
 
   /* Open target stream. */
   stream = svn_stream_checksummed2(svn_stream_from_aprfile2(index_file, TRUE,
@@ -2332,12 +2575,15 @@ svn_fs_x__p2l_index_append(svn_checksum_t **checksum,
   SVN_ERR(stream_write_encoded(stream, file_size));
   SVN_ERR(stream_write_encoded(stream, page_size));
 
-  /* write the page table (actually, the sizes of each page description) */
+  /* write the page table (actually, the sizes and checksums of each page
+   * description) */
   SVN_ERR(stream_write_encoded(stream, table_sizes->nelts));
   for (i = 0; i < table_sizes->nelts; ++i)
     {
       apr_uint64_t value = APR_ARRAY_IDX(table_sizes, i, apr_uint64_t);
       SVN_ERR(stream_write_encoded(stream, value));
+      value = APR_ARRAY_IDX(table_checksums, i, apr_uint64_t);
+      SVN_ERR(stream_write_encoded(stream, value));
     }
 
   /* append page contents and implicitly close STREAM */
@@ -2383,15 +2629,19 @@ typedef struct p2l_page_info_baton_t
 
   /* size of each page in pack / rev file */
   apr_uint64_t page_size;
+
+  /* FNV-1a checksum over the page description's on-disk data */
+  apr_uint32_t checksum;
 } p2l_page_info_baton_t;
 
-/* From HEADER and the list of all OFFSETS, fill BATON with the page info
- * requested by BATON->OFFSET.
+/* From HEADER and the list of all OFFSETS and CHECKSUMS, fill BATON with
+ * the page info requested by BATON->OFFSET.
  */
 static void
 p2l_page_info_copy(p2l_page_info_baton_t *baton,
                    const p2l_header_t *header,
-                   const apr_off_t *offsets)
+                   const apr_off_t *offsets,
+                   const apr_uint32_t *checksums)
 {
   /* if the requested offset is out of bounds, return info for
    * a zero-sized empty page right behind the last page.
@@ -2403,6 +2653,7 @@ p2l_page_info_copy(p2l_page_info_baton_t *baton,
       baton->start_offset = offsets[baton->page_no];
       baton->next_offset = offsets[baton->page_no + 1];
       baton->page_size = header->page_size;
+      baton->checksum = checksums[baton->page_no];
     }
   else
     {
@@ -2411,6 +2662,7 @@ p2l_page_info_copy(p2l_page_info_baton_t *baton,
       baton->start_offset = offsets[baton->page_no];
       baton->next_offset = offsets[baton->page_no];
       baton->page_size = 0;
+      baton->checksum = 0;
     }
 
   baton->first_revision = header->first_revision;
@@ -2433,9 +2685,12 @@ p2l_page_info_func(void **out,
   const apr_off_t *offsets
     = svn_temp_deserializer__ptr(header,
                                  (const void *const *)&header->offsets);
+  const apr_uint32_t *checksums
+    = svn_temp_deserializer__ptr(header,
+                                 (const void *const *)&header->checksums);
 
   /* copy data from cache to BATON */
-  p2l_page_info_copy(baton, header, offsets);
+  p2l_page_info_copy(baton, header, offsets, checksums);
   return SVN_NO_ERROR;
 }
 
@@ -2508,13 +2763,23 @@ get_p2l_header(p2l_header_t **header,
 
   result->offsets
     = apr_pcalloc(result_pool, (result->page_count + 1) * sizeof(*result->offsets));
+  result->checksums
+    = apr_pcalloc(result_pool, result->page_count * sizeof(*result->checksums));
 
-  /* read page sizes and derive page description offsets from them */
+  /* read page sizes and checksums and derive page description offsets
+   * from them */
   result->offsets[0] = 0;
   for (i = 0; i < result->page_count; ++i)
     {
       SVN_ERR(packed_stream_get(&value, stream));
       result->offsets[i+1] = result->offsets[i] + (apr_off_t)value;
+
+      SVN_ERR(packed_stream_get(&value, stream));
+      if (value > APR_UINT32_MAX)
+        return svn_error_create(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                                _("Invalid P2L index page checksum"));
+
+      result->checksums[i] = (apr_uint32_t)value;
     }
 
   /* correct the offset values */
@@ -2562,7 +2827,7 @@ get_p2l_page_info(p2l_page_info_baton_t *baton,
                          scratch_pool, scratch_pool));
 
   /* copy the requested info into *BATON */
-  p2l_page_info_copy(baton, header, header->offsets);
+  p2l_page_info_copy(baton, header, header->offsets, header->checksums);
 
   return SVN_NO_ERROR;
 }
@@ -2666,7 +2931,8 @@ read_entry(svn_fs_x__packed_number_stream_t *stream,
 /* Read the phys-to-log mappings for the cluster beginning at rev file
  * offset PAGE_START from the index for START_REVISION in FS.  The data
  * can be found in the index page beginning at START_OFFSET with the next
- * page beginning at NEXT_OFFSET.  PAGE_SIZE is the L2P index page size.
+ * page beginning at NEXT_OFFSET.  PAGE_SIZE is the L2P index page size
+ * and CHECKSUM the FNV-1a checksum over the page description.
  * Return the relevant index entries in *ENTRIES.  Use REV_FILE to access
  * on-disk data.  Allocate *ENTRIES in RESULT_POOL.
  */
@@ -2679,6 +2945,7 @@ get_p2l_page(apr_array_header_t **entries,
              apr_off_t next_offset,
              apr_off_t page_start,
              apr_uint64_t page_size,
+             apr_uint32_t checksum,
              apr_pool_t *result_pool)
 {
   apr_uint64_t value;
@@ -2706,13 +2973,27 @@ get_p2l_page(apr_array_header_t **entries,
     }
   else
     {
-      /* Read non-empty page. */
+      /* Read non-empty page and make sure it has not been damaged. */
+      packed_stream_begin_page(stream, start_offset,
+                               next_offset - start_offset);
       do
         {
-          SVN_ERR(read_entry(stream, &item_offset, start_revision, result));
+          svn_error_t *err = read_entry(stream, &item_offset,
+                                        start_revision, result);
+
+          /* Damaged page data may well fail to parse.  Report that. */
+          if (err)
+            {
+              svn_error_t *page_err
+                = packed_stream_end_page(stream, checksum, "P2L");
+              return svn_error_trace(svn_error_compose_create(page_err,
+                                                              err));
+            }
+
           offset = packed_stream_offset(stream);
         }
       while (offset < next_offset);
+      SVN_ERR(packed_stream_end_page(stream, checksum, "P2L"));
 
       /* We should now be exactly at the next offset, i.e. the numbers in
        * the stream cannot overlap into the next page description. */
@@ -2799,6 +3080,7 @@ prefetch_p2l_page(svn_boolean_t *end,
                        baton->next_offset,
                        baton->page_start,
                        baton->page_size,
+                       baton->checksum,
                        scratch_pool));
 
   /* and put it into our cache */
@@ -3024,7 +3306,8 @@ p2l_index_lookup(apr_array_header_t *entries,
                            page_info.start_offset,
                            page_info.next_offset,
                            page_info.page_start,
-                           page_info.page_size, iterpool));
+                           page_info.page_size,
+                           page_info.checksum, iterpool));
 
       /* The last cache entry must not end beyond the range covered by
        * this index.  The same applies for any subset of entries. */
@@ -3413,6 +3696,68 @@ svn_fs_x__p2l_get_max_offset(apr_off_t *offset,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_x__verify_index_pages(svn_fs_t *fs,
+                             svn_fs_x__revision_file_t *rev_file,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_fs_x__packed_number_stream_t *stream;
+  svn_fs_x__rev_file_info_t file_info;
+  l2p_header_t *l2p_header;
+  p2l_header_t *p2l_header;
+  apr_size_t page, page_count;
+
+  SVN_ERR(svn_fs_x__rev_file_info(&file_info, rev_file));
+
+  /* L2P index pages */
+  SVN_ERR(get_l2p_header(&l2p_header, rev_file, fs,
+                         file_info.start_revision, scratch_pool,
+                         scratch_pool));
+  SVN_ERR(svn_fs_x__rev_file_l2p_index(&stream, rev_file));
+
+  page_count = l2p_header->page_table_index[l2p_header->revision_count];
+  for (page = 0; page < page_count; ++page)
+    {
+      const l2p_page_table_entry_t *entry = &l2p_header->page_table[page];
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(verify_page_checksum(stream, entry->offset, entry->size,
+                                   entry->checksum, "L2P", iterpool));
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+    }
+
+  /* P2L index pages.  Empty pages don't have any data to verify. */
+  SVN_ERR(get_p2l_header(&p2l_header, rev_file, fs,
+                         file_info.start_revision, scratch_pool,
+                         scratch_pool));
+  SVN_ERR(svn_fs_x__rev_file_p2l_index(&stream, rev_file));
+
+  for (page = 0; page < p2l_header->page_count; ++page)
+    {
+      apr_off_t start = p2l_header->offsets[page];
+      apr_off_t next = p2l_header->offsets[page + 1];
+
+      svn_pool_clear(iterpool);
+      if (start < next)
+        SVN_ERR(verify_page_checksum(stream, start,
+                                     (apr_size_t)(next - start),
+                                     p2l_header->checksums[page], "P2L",
+                                     iterpool));
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_x__item_offset(apr_off_t *absolute_position,
                       apr_uint32_t *sub_item,
@@ -3825,17 +4170,22 @@ svn_fs_x__serialize_p2l_header(void **data,
   svn_temp_serializer__context_t *context;
   svn_stringbuf_t *serialized;
   apr_size_t table_size = (header->page_count + 1) * sizeof(*header->offsets);
+  apr_size_t checksums_size = header->page_count * sizeof(*header->checksums);
 
   /* serialize header and all its elements */
   context = svn_temp_serializer__init(header,
                                       sizeof(*header),
-                                      table_size + sizeof(*header) + 32,
+                                        table_size + checksums_size
+                                      + sizeof(*header) + 32,
                                       pool);
 
-  /* offsets array */
+  /* offsets and checksums arrays */
   svn_temp_serializer__add_leaf(context,
                                 (const void * const *)&header->offsets,
                                 table_size);
+  svn_temp_serializer__add_leaf(context,
+                                (const void * const *)&header->checksums,
+                                checksums_size);
 
   /* return the serialized result */
   serialized = svn_temp_serializer__get(context);
@@ -3854,8 +4204,9 @@ svn_fs_x__deserialize_p2l_header(void **out,
 {
   p2l_header_t *header = data;
 
-  /* resolve the only pointer in the struct */
+  /* resolve the pointers in the struct */
   svn_temp_deserializer__resolve(header, (void**)&header->offsets);
+  svn_temp_deserializer__resolve(header, (void**)&header->checksums);
 
   /* done */
   *out = header;
@@ -304,6 +304,19 @@ svn_fs_x__p2l_get_max_offset(apr_off_t *offset,
                              svn_revnum_t revision,
                              apr_pool_t *scratch_pool);
 
+/* Verify the checksums of all L2P and P2L index pages of the rev / pack
+ * file REV_FILE in FS.  Return an SVN_ERR_FS_INDEX_CORRUPTION error
+ * identifying the first damaged page, if any.  If given, invoke
+ * CANCEL_FUNC with CANCEL_BATON at regular intervals.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_x__verify_index_pages(svn_fs_t *fs,
+                             svn_fs_x__revision_file_t *rev_file,
+                             svn_cancel_func_t cancel_func,
+                             void *cancel_baton,
+                             apr_pool_t *scratch_pool);
+
 /* Index (re-)creation utilities.
  */
 
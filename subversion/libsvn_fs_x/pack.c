@@ -22,6 +22,7 @@
 #include <assert.h>
 
 #include "svn_pools.h"
+#include "svn_delta.h"
 #include "svn_dirent_uri.h"
 #include "svn_sorts.h"
 #include "private/svn_sorts_private.h"
@@ -62,9 +63,12 @@
  *
  * In a second step, we read all revisions in the selected range, build
  * the item tracking information and copy the items themselves from the
- * revision files to temporary files.  The latter serve as buckets for a
+ * revision files to staging areas.  The latter serve as buckets for a
  * very coarse bucket presort:  Separate change lists, file properties,
  * directory properties and noderevs + representations from one another.
+ * The revision files are being read strictly sequentially and only once.
+ * Staged data is kept in memory as far as MAX_MEM permits and spills to
+ * temporary files beyond that.
  *
  * The third step will determine an optimized placement for the items in
  * each of the 4 buckets separately.  The first three will simply order
@@ -79,17 +83,31 @@
  *   with special treatment of "trunk" and "branches"
  * - same for file representations
  *
- * Step 4 copies the items from the temporary buckets into the final
- * pack file and writes the temporary index files.
+ * Step 4 copies the items from the staging buckets into the final
+ * pack file and writes the temporary index files.  Writes to the pack
+ * file are strictly sequential.
  *
  * Finally, after the last range of revisions, create the final indexes.
  */
 
-/* Maximum amount of memory we allocate for placement information during
- * the pack process.
+/* Maximum amount of memory we allocate for placement information and
+ * staged item data during the pack process.
  */
 #define DEFAULT_MAX_MEM (64 * 1024 * 1024)
 
+/* Granularity in which we allocate memory for staged item data.
+ */
+#define STAGE_BLOCK_SIZE (64 * 1024)
+
+/* Number of bytes at the start of a representation item that will surely
+ * contain the whole representation header.
+ */
+#define MAX_REP_HEADER_SIZE 1024
+
+/* Maximum number of star-delta bases we add to a single reps container.
+ */
+#define MAX_CONTAINER_BASES 4
+
 /* Data structure describing a node change at PATH, REVISION.
  * We will sort these instances by PATH and NODE_ID such that we can combine
  * similar nodes in the same reps container and store containers in path
@@ -126,6 +144,28 @@ typedef struct reference_t
   svn_fs_x__id_t from;
 } reference_t;
 
+/* Items copied from the revision files get staged in one of these before
+ * being written to the pack file in placement order.  The first part of
+ * the data lives in memory while the remainder spills to a temp file.
+ * Unlike svn_spillbuf_t, which is a strict FIFO, this allows us to read
+ * items back in any order.
+ */
+typedef struct stage_t
+{
+  /* array of char *, each pointing to STAGE_BLOCK_SIZE bytes of data */
+  apr_array_header_t *blocks;
+
+  /* number of bytes held in BLOCKS.  All data beyond this offset is in
+   * SPILL_FILE. */
+  apr_off_t memory_size;
+
+  /* total number of bytes staged so far */
+  apr_off_t size;
+
+  /* temp file receiving all data that did not fit into memory */
+  apr_file_t *spill_file;
+} stage_t;
+
 /* This structure keeps track of all the temporary data and status that
  * needs to be kept around during the creation of one pack file.  After
  * each revision range (in case we can't process all revs at once due to
@@ -179,25 +219,26 @@ typedef struct pack_context_t
    * Will be filled in phase 2 and be cleared after each revision range. */
   apr_array_header_t *changes;
 
-  /* temp file receiving all change list items (referenced by CHANGES).
+  /* staging area receiving all change list items (referenced by CHANGES).
    * Will be filled in phase 2 and be cleared after each revision range. */
-  apr_file_t *changes_file;
+  stage_t *changes_stage;
 
   /* array of svn_fs_x__p2l_entry_t *, all referring to file properties.
    * Will be filled in phase 2 and be cleared after each revision range. */
   apr_array_header_t *file_props;
 
-  /* temp file receiving all file prop items (referenced by FILE_PROPS).
+  /* staging area receiving all file prop items (referenced by FILE_PROPS).
    * Will be filled in phase 2 and be cleared after each revision range.*/
-  apr_file_t *file_props_file;
+  stage_t *file_props_stage;
 
   /* array of svn_fs_x__p2l_entry_t *, all referring to directory properties.
    * Will be filled in phase 2 and be cleared after each revision range. */
   apr_array_header_t *dir_props;
 
-  /* temp file receiving all directory prop items (referenced by DIR_PROPS).
-   * Will be filled in phase 2 and be cleared after each revision range.*/
-  apr_file_t *dir_props_file;
+  /* staging area receiving all directory prop items (referenced by
+   * DIR_PROPS).  Will be filled in phase 2 and be cleared after each
+   * revision range.*/
+  stage_t *dir_props_stage;
 
   /* container for all PATH members in PATH_ORDER. */
   svn_prefix_tree__t *paths;
@@ -221,20 +262,182 @@ typedef struct pack_context_t
    * each revision range. */
   apr_array_header_t *rev_offsets;
 
-  /* temp file receiving all items referenced by REPS.
+  /* staging area receiving all items referenced by REPS.
    * Will be filled in phase 2 and be cleared after each revision range.*/
-  apr_file_t *reps_file;
+  stage_t *reps_stage;
+
+  /* number of bytes that all staging areas may keep in memory */
+  apr_size_t max_stage_memory;
+
+  /* number of bytes currently allocated for staged data in memory */
+  apr_size_t stage_memory;
+
+  /* pool holding the in-memory blocks of all staging areas.  Will be
+   * cleared after each revision range. */
+  apr_pool_t *stage_pool;
 
   /* pool used for temporary data structures that will be cleaned up when
    * the next range of revisions is being processed */
   apr_pool_t *info_pool;
 } pack_context_t;
 
+/* Create a new, empty staging area in TEMP_DIR, allocate it in
+ * RESULT_POOL and return it in *STAGE.
+ */
+static svn_error_t *
+create_stage(stage_t **stage,
+             const char *temp_dir,
+             apr_pool_t *result_pool)
+{
+  stage_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  result->blocks = apr_array_make(result_pool, 16, sizeof(char *));
+  SVN_ERR(svn_io_open_unique_file3(&result->spill_file, NULL, temp_dir,
+                                   svn_io_file_del_on_close, result_pool,
+                                   result_pool));
+
+  *stage = result;
+  return SVN_NO_ERROR;
+}
+
+/* Remove all data from STAGE.  The caller is responsible for releasing
+ * the memory blocks.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+reset_stage(stage_t *stage,
+            apr_pool_t *scratch_pool)
+{
+  apr_array_clear(stage->blocks);
+  stage->memory_size = 0;
+  stage->size = 0;
+  SVN_ERR(svn_io_file_trunc(stage->spill_file, 0, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Append LEN bytes from DATA to STAGE.  Keep them in memory as long as
+ * CONTEXT's staging memory budget allows.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+stage_append(pack_context_t *context,
+             stage_t *stage,
+             const char *data,
+             apr_size_t len,
+             apr_pool_t *scratch_pool)
+{
+  /* Fill the in-memory part until we run out of budget.  Once we spilled
+   * to disk, all further data must go there as well. */
+  while (len && stage->size == stage->memory_size)
+    {
+      apr_size_t block_offset
+        = (apr_size_t)(stage->memory_size % STAGE_BLOCK_SIZE);
+      apr_size_t to_copy = MIN(len, STAGE_BLOCK_SIZE - block_offset);
+      char *block;
+
+      if (block_offset == 0)
+        {
+          if (context->stage_memory + STAGE_BLOCK_SIZE
+              > context->max_stage_memory)
+            break;
+
+          APR_ARRAY_PUSH(stage->blocks, char *)
+            = apr_palloc(context->stage_pool, STAGE_BLOCK_SIZE);
+          context->stage_memory += STAGE_BLOCK_SIZE;
+        }
+
+      block = APR_ARRAY_IDX(stage->blocks, stage->blocks->nelts - 1, char *);
+      memcpy(block + block_offset, data, to_copy);
+
+      data += to_copy;
+      len -= to_copy;
+      stage->memory_size += to_copy;
+      stage->size += to_copy;
+    }
+
+  if (len)
+    {
+      SVN_ERR(svn_io_file_write_full(stage->spill_file, data, len, NULL,
+                                     scratch_pool));
+      stage->size += len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read LEN bytes starting at OFFSET from STAGE into BUFFER.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+stage_read(char *buffer,
+           stage_t *stage,
+           apr_off_t offset,
+           apr_size_t len,
+           apr_pool_t *scratch_pool)
+{
+  if (offset + (apr_off_t)len > stage->size)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Reading beyond the end of the pack "
+                              "staging area"));
+
+  /* in-memory part */
+  while (len && offset < stage->memory_size)
+    {
+      const char *block = APR_ARRAY_IDX(stage->blocks,
+                                        (int)(offset / STAGE_BLOCK_SIZE),
+                                        const char *);
+      apr_size_t block_offset = (apr_size_t)(offset % STAGE_BLOCK_SIZE);
+      apr_size_t to_copy = MIN(len, STAGE_BLOCK_SIZE - block_offset);
+      to_copy = (apr_size_t)MIN(to_copy, stage->memory_size - offset);
+
+      memcpy(buffer, block + block_offset, to_copy);
+
+      buffer += to_copy;
+      len -= to_copy;
+      offset += to_copy;
+    }
+
+  /* spilled part */
+  if (len)
+    {
+      offset -= stage->memory_size;
+      SVN_ERR(svn_io_file_seek(stage->spill_file, APR_SET, &offset,
+                               scratch_pool));
+      SVN_ERR(svn_io_file_read_full2(stage->spill_file, buffer, len,
+                                     NULL, NULL, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the staged data of the item described by ENTRY from STAGE in
+ * *ITEM.  Allocate it in RESULT_POOL and use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+stage_read_item(svn_stringbuf_t **item,
+                stage_t *stage,
+                svn_fs_x__p2l_entry_t *entry,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *result
+    = svn_stringbuf_create_ensure((apr_size_t)entry->size, result_pool);
+
+  SVN_ERR(stage_read(result->data, stage, entry->offset,
+                     (apr_size_t)entry->size, scratch_pool));
+  result->len = (apr_size_t)entry->size;
+  result->data[result->len] = '\0';
+
+  *item = result;
+  return SVN_NO_ERROR;
+}
+
 /* Create and initialize a new pack context for packing shard SHARD_REV in
  * SHARD_DIR into PACK_FILE_DIR within filesystem FS.  Allocate it in POOL
  * and return the structure in *CONTEXT.
  *
- * Limit the number of items being copied per iteration to MAX_ITEMS.
+ * Limit the number of items being copied per iteration to MAX_ITEMS and
+ * the item data being staged in memory to MAX_STAGE_MEMORY bytes.
  * Set CANCEL_FUNC and CANCEL_BATON as well.
  */
 static svn_error_t *
@@ -244,7 +447,8 @@ initialize_pack_context(pack_context_t *context,
                         const char *shard_dir,
                         svn_revnum_t shard_rev,
                         int max_items,
-                        svn_fs_x__batch_fsync_t *batch,
+                        apr_size_t max_stage_memory,
+                        svn_fs__batch_fsync_t *batch,
                         svn_cancel_func_t cancel_func,
                         void *cancel_baton,
                         apr_pool_t *pool)
@@ -274,8 +478,8 @@ initialize_pack_context(pack_context_t *context,
   context->pack_file_path
     = svn_dirent_join(pack_file_dir, PATH_PACKED, pool);
 
-  SVN_ERR(svn_fs_x__batch_fsync_open_file(&context->pack_file, batch,
-                                          context->pack_file_path, pool));
+  SVN_ERR(svn_fs__batch_fsync_open_file(&context->pack_file, batch,
+                                        context->pack_file_path, pool));
 
   /* Proto index files */
   SVN_ERR(svn_fs_x__l2p_proto_index_open(
@@ -291,19 +495,19 @@ initialize_pack_context(pack_context_t *context,
                              pool),
              pool));
 
-  /* item buckets: one item info array and one temp file per bucket */
+  /* item buckets: one item info array and one staging area per bucket */
+  context->max_stage_memory = max_stage_memory;
+  context->stage_pool = svn_pool_create(pool);
+
   context->changes = apr_array_make(pool, max_items,
                                     sizeof(svn_fs_x__p2l_entry_t *));
-  SVN_ERR(svn_io_open_unique_file3(&context->changes_file, NULL, temp_dir,
-                                   svn_io_file_del_on_close, pool, pool));
+  SVN_ERR(create_stage(&context->changes_stage, temp_dir, pool));
   context->file_props = apr_array_make(pool, max_items,
                                        sizeof(svn_fs_x__p2l_entry_t *));
-  SVN_ERR(svn_io_open_unique_file3(&context->file_props_file, NULL, temp_dir,
-                                   svn_io_file_del_on_close, pool, pool));
+  SVN_ERR(create_stage(&context->file_props_stage, temp_dir, pool));
   context->dir_props = apr_array_make(pool, max_items,
                                       sizeof(svn_fs_x__p2l_entry_t *));
-  SVN_ERR(svn_io_open_unique_file3(&context->dir_props_file, NULL, temp_dir,
-                                   svn_io_file_del_on_close, pool, pool));
+  SVN_ERR(create_stage(&context->dir_props_stage, temp_dir, pool));
 
   /* noderev and representation item bucket */
   context->rev_offsets = apr_array_make(pool, max_revs, sizeof(int));
@@ -313,8 +517,7 @@ initialize_pack_context(pack_context_t *context,
                                        sizeof(reference_t *));
   context->reps = apr_array_make(pool, max_items,
                                  sizeof(svn_fs_x__p2l_entry_t *));
-  SVN_ERR(svn_io_open_unique_file3(&context->reps_file, NULL, temp_dir,
-                                   svn_io_file_del_on_close, pool, pool));
+  SVN_ERR(create_stage(&context->reps_stage, temp_dir, pool));
 
   /* the pool used for temp structures */
   context->info_pool = svn_pool_create(pool);
@@ -331,17 +534,20 @@ reset_pack_context(pack_context_t *context,
                    apr_pool_t *scratch_pool)
 {
   apr_array_clear(context->changes);
-  SVN_ERR(svn_io_file_trunc(context->changes_file, 0, scratch_pool));
+  SVN_ERR(reset_stage(context->changes_stage, scratch_pool));
   apr_array_clear(context->file_props);
-  SVN_ERR(svn_io_file_trunc(context->file_props_file, 0, scratch_pool));
+  SVN_ERR(reset_stage(context->file_props_stage, scratch_pool));
   apr_array_clear(context->dir_props);
-  SVN_ERR(svn_io_file_trunc(context->dir_props_file, 0, scratch_pool));
+  SVN_ERR(reset_stage(context->dir_props_stage, scratch_pool));
 
   apr_array_clear(context->rev_offsets);
   apr_array_clear(context->path_order);
   apr_array_clear(context->references);
   apr_array_clear(context->reps);
-  SVN_ERR(svn_io_file_trunc(context->reps_file, 0, scratch_pool));
+  SVN_ERR(reset_stage(context->reps_stage, scratch_pool));
+
+  svn_pool_clear(context->stage_pool);
+  context->stage_memory = 0;
 
   svn_pool_clear(context->info_pool);
   context->paths = svn_prefix_tree__create(context->info_pool);
@@ -461,31 +667,115 @@ write_null_bytes(apr_file_t *dest,
   return SVN_NO_ERROR;
 }
 
+/* Copy SIZE bytes starting at OFFSET in STAGE to the end of DEST.  Invoke
+ * the CANCEL_FUNC from CONTEXT at regular intervals.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+copy_staged_data(pack_context_t *context,
+                 apr_file_t *dest,
+                 stage_t *stage,
+                 apr_off_t offset,
+                 svn_filesize_t size,
+                 apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = context->fs->fsap_data;
+  apr_pool_t *copypool = svn_pool_create(scratch_pool);
+  char *buffer = apr_palloc(copypool,
+                            (apr_size_t)MIN(size, ffd->block_size));
+
+  while (size)
+    {
+      apr_size_t to_copy = (apr_size_t)(MIN(size, ffd->block_size));
+      if (context->cancel_func)
+        SVN_ERR(context->cancel_func(context->cancel_baton));
+
+      SVN_ERR(stage_read(buffer, stage, offset, to_copy, copypool));
+      SVN_ERR(svn_io_file_write_full(dest, buffer, to_copy, NULL,
+                                     copypool));
+
+      offset += to_copy;
+      size -= to_copy;
+    }
+
+  svn_pool_destroy(copypool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the item described by ENTRY from the current position in REV_FILE
+ * and append it to STAGE in CONTEXT.  If HEAD is not NULL, return a copy
+ * of the first HEAD_SIZE bytes of the item in *HEAD, allocated in
+ * RESULT_POOL.  REV_FILE will only be read sequentially.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+stage_item(svn_stringbuf_t **head,
+           pack_context_t *context,
+           stage_t *stage,
+           svn_fs_x__revision_file_t *rev_file,
+           svn_fs_x__p2l_entry_t *entry,
+           apr_size_t head_size,
+           apr_pool_t *result_pool,
+           apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = context->fs->fsap_data;
+  apr_pool_t *copypool = svn_pool_create(scratch_pool);
+  svn_filesize_t size = entry->size;
+  char *buffer = apr_palloc(copypool,
+                            (apr_size_t)MIN(size, ffd->block_size));
+  apr_file_t *file;
+
+  SVN_ERR(svn_fs_x__rev_file_get(&file, rev_file));
+
+  if (head)
+    *head = svn_stringbuf_create_ensure((apr_size_t)MIN(head_size, size),
+                                        result_pool);
+
+  while (size)
+    {
+      apr_size_t to_copy = (apr_size_t)(MIN(size, ffd->block_size));
+      if (context->cancel_func)
+        SVN_ERR(context->cancel_func(context->cancel_baton));
+
+      SVN_ERR(svn_io_file_read_full2(file, buffer, to_copy, NULL, NULL,
+                                     copypool));
+      SVN_ERR(stage_append(context, stage, buffer, to_copy, copypool));
+
+      if (head && (*head)->len < head_size)
+        svn_stringbuf_appendbytes(*head, buffer,
+                                  MIN(to_copy, head_size - (*head)->len));
+
+      size -= to_copy;
+    }
+
+  svn_pool_destroy(copypool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy the "simple" item (changed paths list or property representation)
- * from the current position in REV_FILE to TEMP_FILE using CONTEXT.  Add
+ * from the current position in REV_FILE to STAGE using CONTEXT.  Add
  * a copy of ENTRY to ENTRIES but with an updated offset value that points
- * to the copy destination in TEMP_FILE.
+ * to the copy destination in STAGE.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 copy_item_to_temp(pack_context_t *context,
                   apr_array_header_t *entries,
-                  apr_file_t *temp_file,
+                  stage_t *stage,
                   svn_fs_x__revision_file_t *rev_file,
                   svn_fs_x__p2l_entry_t *entry,
                   apr_pool_t *scratch_pool)
 {
-  apr_file_t *file;
   svn_fs_x__p2l_entry_t *new_entry
     = svn_fs_x__p2l_entry_dup(entry, context->info_pool);
 
-  SVN_ERR(svn_io_file_get_offset(&new_entry->offset, temp_file,
-                                 scratch_pool));
+  new_entry->offset = stage->size;
   APR_ARRAY_PUSH(entries, svn_fs_x__p2l_entry_t *) = new_entry;
 
-  SVN_ERR(svn_fs_x__rev_file_get(&file, rev_file));
-  SVN_ERR(copy_file_data(context, temp_file, file, entry->size,
-                         scratch_pool));
+  SVN_ERR(stage_item(NULL, context, stage, rev_file, entry, 0,
+                     scratch_pool, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -555,7 +845,7 @@ get_item(pack_context_t *context,
 }
 
 /* Copy representation item identified by ENTRY from the current position
- * in REV_FILE into CONTEXT->REPS_FILE.  Add all tracking into needed by
+ * in REV_FILE into CONTEXT->REPS_STAGE.  Add all tracking into needed by
  * our placement algorithm to CONTEXT.
  * Use SCRATCH_POOL for temporary allocations.
  */
@@ -566,20 +856,22 @@ copy_rep_to_temp(pack_context_t *context,
                  apr_pool_t *scratch_pool)
 {
   svn_fs_x__rep_header_t *rep_header;
-  svn_stream_t *stream;
-  apr_file_t *file;
-  apr_off_t source_offset = entry->offset;
+  svn_stringbuf_t *head;
 
   /* create a copy of ENTRY, make it point to the copy destination and
    * store it in CONTEXT */
   entry = svn_fs_x__p2l_entry_dup(entry, context->info_pool);
-  SVN_ERR(svn_io_file_get_offset(&entry->offset, context->reps_file,
-                                 scratch_pool));
+  entry->offset = context->reps_stage->size;
   add_item_rep_mapping(context, entry);
 
-  /* read & parse the representation header */
-  SVN_ERR(svn_fs_x__rev_file_stream(&stream, rev_file));
-  SVN_ERR(svn_fs_x__read_rep_header(&rep_header, stream,
+  /* copy the whole rep (including header!) to our staging area */
+  SVN_ERR(stage_item(&head, context, context->reps_stage, rev_file, entry,
+                     MAX_REP_HEADER_SIZE, scratch_pool, scratch_pool));
+
+  /* parse the representation header */
+  SVN_ERR(svn_fs_x__read_rep_header(&rep_header,
+                                    svn_stream_from_stringbuf(head,
+                                                              scratch_pool),
                                     scratch_pool, scratch_pool));
 
   /* if the representation is a delta against some other rep, link the two */
@@ -595,12 +887,6 @@ copy_rep_to_temp(pack_context_t *context,
       APR_ARRAY_PUSH(context->references, reference_t *) = reference;
     }
 
-  /* copy the whole rep (including header!) to our temp file */
-  SVN_ERR(svn_fs_x__rev_file_seek(rev_file, NULL, source_offset));
-  SVN_ERR(svn_fs_x__rev_file_get(&file, rev_file));
-  SVN_ERR(copy_file_data(context, context->reps_file, file, entry->size,
-                         scratch_pool));
-
   return SVN_NO_ERROR;
 }
 
@@ -673,7 +959,7 @@ tweak_path_for_ordering(const char *original,
 }
 
 /* Copy node revision item identified by ENTRY from the current position
- * in REV_FILE into CONTEXT->REPS_FILE.  Add all tracking into needed by
+ * in REV_FILE into CONTEXT->REPS_STAGE.  Add all tracking into needed by
  * our placement algorithm to CONTEXT.
  * Use SCRATCH_POOL for temporary allocations.
  */
@@ -686,28 +972,24 @@ copy_node_to_temp(pack_context_t *context,
   path_order_t *path_order = apr_pcalloc(context->info_pool,
                                          sizeof(*path_order));
   svn_fs_x__noderev_t *noderev;
-  svn_stream_t *stream;
-  apr_file_t *file;
+  svn_stringbuf_t *item;
   const char *sort_path;
-  apr_off_t source_offset = entry->offset;
-
-  /* read & parse noderev */
-  SVN_ERR(svn_fs_x__rev_file_stream(&stream, rev_file));
-  SVN_ERR(svn_fs_x__read_noderev(&noderev, stream, scratch_pool,
-                                 scratch_pool));
 
   /* create a copy of ENTRY, make it point to the copy destination and
    * store it in CONTEXT */
   entry = svn_fs_x__p2l_entry_dup(entry, context->info_pool);
-  SVN_ERR(svn_io_file_get_offset(&entry->offset, context->reps_file,
-                                 scratch_pool));
+  entry->offset = context->reps_stage->size;
   add_item_rep_mapping(context, entry);
 
-  /* copy the noderev to our temp file */
-  SVN_ERR(svn_fs_x__rev_file_seek(rev_file, NULL, source_offset));
-  SVN_ERR(svn_fs_x__rev_file_get(&file, rev_file));
-  SVN_ERR(copy_file_data(context, context->reps_file, file, entry->size,
-                         scratch_pool));
+  /* copy the noderev to our staging area */
+  SVN_ERR(stage_item(&item, context, context->reps_stage, rev_file, entry,
+                     (apr_size_t)entry->size, scratch_pool, scratch_pool));
+
+  /* parse noderev */
+  SVN_ERR(svn_fs_x__read_noderev(&noderev,
+                                 svn_stream_from_stringbuf(item,
+                                                           scratch_pool),
+                                 scratch_pool, scratch_pool));
 
   /* if the node has a data representation, make that the node's "base".
    * This will (often) cause the noderev to be placed right in front of
@@ -1066,7 +1348,7 @@ write_nodes_container(pack_context_t *context,
 }
 
 /* Read the noderevs given by the svn_fs_x__p2l_entry_t * in NODE_PARTS
- * from TEMP_FILE and add them to *CONTAINER and NODES_IN_CONTAINER.
+ * from STAGE and add them to *CONTAINER and NODES_IN_CONTAINER.
  * Whenever the container grows bigger than the current block in CONTEXT,
  * write the data to disk and continue in the next block.
  *
@@ -1075,7 +1357,7 @@ write_nodes_container(pack_context_t *context,
  */
 static svn_error_t *
 store_nodes(pack_context_t *context,
-            apr_file_t *temp_file,
+            stage_t *stage,
             apr_array_header_t *node_parts,
             svn_fs_x__noderevs_t **container,
             apr_array_header_t *nodes_in_container,
@@ -1085,8 +1367,6 @@ store_nodes(pack_context_t *context,
   int i;
 
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  svn_stream_t *stream
-    = svn_stream_from_aprfile2(temp_file, TRUE, scratch_pool);
 
   /* number of bytes in the current block not being spent on fixed-size
      items (i.e. those not put into the container). */
@@ -1100,6 +1380,7 @@ store_nodes(pack_context_t *context,
   for (i = 0; i < node_parts->nelts; ++i)
     {
       svn_fs_x__noderev_t *noderev;
+      svn_stringbuf_t *item;
       svn_fs_x__p2l_entry_t *entry
         = APR_ARRAY_IDX(node_parts, i, svn_fs_x__p2l_entry_t *);
 
@@ -1148,8 +1429,11 @@ store_nodes(pack_context_t *context,
         }
 
       /* item will fit into the block. */
-      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset, iterpool));
-      SVN_ERR(svn_fs_x__read_noderev(&noderev, stream, iterpool, iterpool));
+      SVN_ERR(stage_read_item(&item, stage, entry, iterpool, iterpool));
+      SVN_ERR(svn_fs_x__read_noderev(&noderev,
+                                     svn_stream_from_stringbuf(item,
+                                                               iterpool),
+                                     iterpool, iterpool));
       svn_fs_x__noderevs_add(*container, noderev);
 
       container_size += entry->size;
@@ -1207,17 +1491,197 @@ write_reps_container(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_txdelta_window_handler_t, adding the target view length
+ * of WINDOW to the svn_filesize_t in *BATON.
+ */
+static svn_error_t *
+sum_window_length(svn_txdelta_window_t *window,
+                  void *baton)
+{
+  svn_filesize_t *expanded_size = baton;
+  if (window)
+    *expanded_size += window->tview_len;
+
+  return SVN_NO_ERROR;
+}
+
+/* For the representation item staged in ITEM, return its length on disk
+ * as in svn_fs_x__representation_t.size in *PACKED_LEN and the length of
+ * its fulltext in *EXPANDED_LEN.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+get_staged_rep_length(svn_filesize_t *packed_len,
+                      svn_filesize_t *expanded_len,
+                      svn_stringbuf_t *item,
+                      apr_pool_t *scratch_pool)
+{
+  /* representations end with "ENDREP\n" */
+  enum { TRAILER_SIZE = 7 };
+
+  svn_fs_x__rep_header_t *rep_header;
+  svn_stream_t *stream;
+  apr_size_t len;
+
+  SVN_ERR(svn_fs_x__read_rep_header(&rep_header,
+                                    svn_stream_from_stringbuf(item,
+                                                              scratch_pool),
+                                    scratch_pool, scratch_pool));
+  if (item->len < rep_header->header_size + TRAILER_SIZE)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Representation too short for its header"));
+
+  /* feed the svndiff data through a parser that sums up the window sizes */
+  len = item->len - rep_header->header_size - TRAILER_SIZE;
+  *packed_len = len;
+  *expanded_len = 0;
+
+  stream = svn_txdelta_parse_svndiff(sum_window_length, expanded_len, TRUE,
+                                     scratch_pool);
+  SVN_ERR(svn_stream_write(stream, item->data + rep_header->header_size,
+                           &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  return SVN_NO_ERROR;
+}
+
+/* If the representation item staged for ENTRY in STAGE is a delta against
+ * some other representation, return the ID of that base in *BASE_ID.
+ * Otherwise, reset *BASE_ID.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+get_staged_delta_base(svn_fs_x__id_t *base_id,
+                      stage_t *stage,
+                      svn_fs_x__p2l_entry_t *entry,
+                      apr_pool_t *scratch_pool)
+{
+  svn_fs_x__rep_header_t *rep_header;
+  apr_size_t len = (apr_size_t)MIN(entry->size, MAX_REP_HEADER_SIZE);
+  svn_stringbuf_t *head = svn_stringbuf_create_ensure(len, scratch_pool);
+
+  SVN_ERR(stage_read(head->data, stage, entry->offset, len, scratch_pool));
+  head->len = len;
+  head->data[len] = '\0';
+
+  SVN_ERR(svn_fs_x__read_rep_header(&rep_header,
+                                    svn_stream_from_stringbuf(head,
+                                                              scratch_pool),
+                                    scratch_pool, scratch_pool));
+
+  if (rep_header->type == svn_fs_x__rep_delta)
+    {
+      base_id->change_set
+        = svn_fs_x__change_set_by_rev(rep_header->base_revision);
+      base_id->number = rep_header->base_item_index;
+    }
+  else
+    {
+      svn_fs_x__id_reset(base_id);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Candidate for a star-delta base in a reps container.
+ */
+typedef struct container_base_t
+{
+  /* Representation to use as base. */
+  svn_fs_x__representation_t *rep;
+
+  /* Number of representations in the container that are deltified
+   * against REP or any of its successors. */
+  int count;
+} container_base_t;
+
+/* Add star-delta bases to the empty reps CONTAINER that is about to be
+ * filled with the representations given as svn_fs_x__p2l_entry_t * in
+ * ENTRIES, starting at index FIRST and going down.  DELTA_BASES contains
+ * the delta base IDs of those ENTRIES.  ELIGIBLE maps the IDs of reps
+ * already written to the nearest svn_fs_x__representation_t * that may
+ * be used as a base for them.
+ *
+ * Set *HAS_BASES to TRUE if we added any bases.  CONTEXT provides the block
+ * size, i.e. how far to look ahead.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+add_container_bases(svn_boolean_t *has_bases,
+                    svn_fs_x__reps_builder_t *container,
+                    pack_context_t *context,
+                    apr_array_header_t *entries,
+                    const svn_fs_x__id_t *delta_bases,
+                    int first,
+                    apr_hash_t *eligible,
+                    apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = context->fs->fsap_data;
+  container_base_t bases[MAX_CONTAINER_BASES];
+  int base_count = 0;
+  apr_int64_t look_ahead = 0;
+  int i, k;
+
+  /* Follow the delta graph for all reps that will probably go into this
+   * container and count how many of them benefit from each base. */
+  for (i = first; i >= 0 && look_ahead < ffd->block_size; --i)
+    {
+      svn_fs_x__representation_t *rep;
+      svn_fs_x__p2l_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t *);
+      look_ahead += entry->size;
+
+      if (!svn_fs_x__id_used(&delta_bases[i]))
+        continue;
+
+      rep = apr_hash_get(eligible, &delta_bases[i], sizeof(delta_bases[i]));
+      if (!rep)
+        continue;
+
+      for (k = 0; k < base_count; ++k)
+        if (bases[k].rep == rep)
+          break;
+
+      if (k < base_count)
+        {
+          ++bases[k].count;
+        }
+      else if (base_count < MAX_CONTAINER_BASES)
+        {
+          bases[base_count].rep = rep;
+          bases[base_count].count = 1;
+          ++base_count;
+        }
+    }
+
+  for (k = 0; k < base_count; ++k)
+    SVN_ERR(svn_fs_x__reps_add_base(container, bases[k].rep, bases[k].count,
+                                    scratch_pool));
+
+  *has_bases = base_count > 0;
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the (property) representations identified by svn_fs_x__p2l_entry_t
- * elements in ENTRIES from TEMP_FILE, aggregate them and write them into
+ * elements in ENTRIES from STAGE, aggregate them and write them into
  * CONTEXT->PACK_FILE.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * If ENTRIES does not fit into a single container, follow the delta graph
+ * and use the delta bases of the reps going into a container as its
+ * star-delta bases, as far as they have already been written to earlier
+ * containers.  Only reps in containers without bases may become bases.
+ * Reps in containers that use bases forward to their own delta base,
+ * i.e. later versions fall back to older versions of the same contents.
+ * Hence, every fulltext can be reconstructed with at most one delta hop.
  */
 static svn_error_t *
 write_reps_containers(pack_context_t *context,
                       apr_array_header_t *entries,
-                      apr_file_t *temp_file,
+                      stage_t *stage,
                       apr_array_header_t *new_entries,
                       apr_pool_t *scratch_pool)
 {
+  svn_fs_x__data_t *ffd = context->fs->fsap_data;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   apr_pool_t *container_pool = svn_pool_create(scratch_pool);
   int i;
@@ -1228,15 +1692,32 @@ write_reps_containers(pack_context_t *context,
     = svn_fs_x__reps_builder_create(context->fs, container_pool);
   apr_array_header_t *sub_items
     = apr_array_make(scratch_pool, 64, sizeof(svn_fs_x__id_t));
-  svn_fs_x__revision_file_t *file;
 
-  SVN_ERR(svn_fs_x__rev_file_wrap_temp(&file, context->fs, temp_file,
-                                       scratch_pool));
+  /* Delta base IDs of all ENTRIES, i.e. the delta graph. */
+  svn_fs_x__id_t *delta_bases
+    = apr_pcalloc(scratch_pool, entries->nelts * sizeof(*delta_bases));
+
+  /* svn_fs_x__id_t of reps written so far -> svn_fs_x__representation_t *
+   * to use as star-delta base for reps deltified against them. */
+  apr_hash_t *eligible = apr_hash_make(scratch_pool);
+  svn_boolean_t has_bases = FALSE;
+
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_fs_x__p2l_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t *);
+      SVN_ERR(get_staged_delta_base(&delta_bases[i], stage, entry,
+                                    iterpool));
+      svn_pool_clear(iterpool);
+    }
 
   /* copy all items in strict order */
   for (i = entries->nelts-1; i >= 0; --i)
     {
       svn_fs_x__representation_t representation = { 0 };
+      svn_fs_x__representation_t *base_rep;
+      svn_fs_x__id_t *key;
+      svn_stringbuf_t *item;
       svn_stringbuf_t *contents;
       svn_stream_t *stream;
       apr_size_t list_index;
@@ -1258,7 +1739,12 @@ write_reps_containers(pack_context_t *context,
           svn_pool_clear(container_pool);
           container = svn_fs_x__reps_builder_create(context->fs,
                                                     container_pool);
-          block_left = get_block_left(context);
+          SVN_ERR(add_container_bases(&has_bases, container, context,
+                                      entries, delta_bases, i, eligible,
+                                      iterpool));
+
+          block_left = get_block_left(context)
+                     - svn_fs_x__reps_estimate_size(container);
         }
 
       /* still enough space in current block? */
@@ -1271,14 +1757,12 @@ write_reps_containers(pack_context_t *context,
       assert(entry->item_count == 1);
       representation.id = entry->items[0];
 
-      /* select the change list in the source file, parse it and add it to
-       * the container */
-      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
-                               iterpool));
-      SVN_ERR(svn_fs_x__get_representation_length(&representation.size,
-                                             &representation.expanded_size,
-                                             context->fs, file,
-                                             entry, iterpool));
+      /* select the representation in the staging area, determine its
+       * fulltext and add it to the container */
+      SVN_ERR(stage_read_item(&item, stage, entry, iterpool, iterpool));
+      SVN_ERR(get_staged_rep_length(&representation.size,
+                                    &representation.expanded_size,
+                                    item, iterpool));
       SVN_ERR(svn_fs_x__get_contents(&stream, context->fs, &representation,
                                      FALSE, iterpool));
       contents = svn_stringbuf_create_ensure(representation.expanded_size,
@@ -1294,6 +1778,25 @@ write_reps_containers(pack_context_t *context,
       SVN_ERR_ASSERT(list_index == sub_items->nelts);
       block_left -= entry->size;
 
+      /* Remember which base later deltas against this rep shall use.
+       * Large bases would dominate the container, so don't use them. */
+      if (has_bases)
+        base_rep = svn_fs_x__id_used(&delta_bases[i])
+                 ? apr_hash_get(eligible, &delta_bases[i],
+                                sizeof(delta_bases[i]))
+                 : NULL;
+      else if (representation.expanded_size <= 2 * ffd->block_size)
+        base_rep = apr_pmemdup(scratch_pool, &representation,
+                               sizeof(representation));
+      else
+        base_rep = NULL;
+
+      if (base_rep)
+        {
+          key = apr_pmemdup(scratch_pool, &entry->items[0], sizeof(*key));
+          apr_hash_set(eligible, key, sizeof(*key), base_rep);
+        }
+
       APR_ARRAY_PUSH(sub_items, svn_fs_x__id_t) = entry->items[0];
 
       svn_pool_clear(iterpool);
@@ -1335,12 +1838,12 @@ should_flush_nodes_container(pack_context_t *context,
 }
 
 /* Read the contents of the first COUNT non-NULL, non-empty items in ITEMS
- * from TEMP_FILE and write them to CONTEXT->PACK_FILE.
+ * from STAGE and write them to CONTEXT->PACK_FILE.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 store_items(pack_context_t *context,
-            apr_file_t *temp_file,
+            stage_t *stage,
             apr_array_header_t *items,
             int count,
             apr_pool_t *scratch_pool)
@@ -1358,12 +1861,10 @@ store_items(pack_context_t *context,
           || entry->item_count == 0)
         continue;
 
-      /* select the item in the source file and copy it into the target
+      /* select the item in the staging area and copy it into the target
        * pack file */
-      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
-                               iterpool));
-      SVN_ERR(copy_file_data(context, context->pack_file, temp_file,
-                             entry->size, iterpool));
+      SVN_ERR(copy_staged_data(context, context->pack_file, stage,
+                               entry->offset, entry->size, iterpool));
 
       /* write index entry and update current position */
       entry->offset = context->pack_offset;
@@ -1382,12 +1883,12 @@ store_items(pack_context_t *context,
 }
 
 /* Copy (append) the items identified by svn_fs_x__p2l_entry_t * elements
- * in ENTRIES strictly in order from TEMP_FILE into CONTEXT->PACK_FILE.
+ * in ENTRIES strictly in order from STAGE into CONTEXT->PACK_FILE.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 copy_reps_from_temp(pack_context_t *context,
-                    apr_file_t *temp_file,
+                    stage_t *stage,
                     apr_pool_t *scratch_pool)
 {
   svn_fs_x__data_t *ffd = context->fs->fsap_data;
@@ -1423,7 +1924,7 @@ copy_reps_from_temp(pack_context_t *context,
       SVN_ERR(select_reps(context, i, selected, node_parts, rep_parts));
 
       /* store the noderevs container in front of the reps */
-      SVN_ERR(store_nodes(context, temp_file, node_parts, &nodes_container,
+      SVN_ERR(store_nodes(context, stage, node_parts, &nodes_container,
                           nodes_in_container, container_pool, iterpool));
 
       /* actually flush the noderevs to disk if the reps container is likely
@@ -1437,10 +1938,10 @@ copy_reps_from_temp(pack_context_t *context,
       /* if all reps are short enough put them into one container.
        * Otherwise, just store all containers here. */
       if (reps_fit_into_containers(selected, 2 * ffd->block_size))
-        SVN_ERR(write_reps_containers(context, rep_parts, temp_file,
+        SVN_ERR(write_reps_containers(context, rep_parts, stage,
                                       context->reps, iterpool));
       else
-        SVN_ERR(store_items(context, temp_file, rep_parts, rep_parts->nelts,
+        SVN_ERR(store_items(context, stage, rep_parts, rep_parts->nelts,
                             iterpool));
 
       /* processed all items */
@@ -1458,7 +1959,7 @@ copy_reps_from_temp(pack_context_t *context,
                                   iterpool));
 
   /* copy all items in strict order */
-  SVN_ERR(store_items(context, temp_file, reps, initial_reps_count,
+  SVN_ERR(store_items(context, stage, reps, initial_reps_count,
                       scratch_pool));
 
   /* vaccum ENTRIES array: eliminate NULL entries */
@@ -1525,13 +2026,13 @@ write_changes_container(pack_context_t *context,
 }
 
 /* Read the change lists identified by svn_fs_x__p2l_entry_t * elements
- * in ENTRIES strictly in from TEMP_FILE, aggregate them and write them
+ * in ENTRIES strictly in from STAGE, aggregate them and write them
  * into CONTEXT->PACK_FILE.  Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 write_changes_containers(pack_context_t *context,
                          apr_array_header_t *entries,
-                         apr_file_t *temp_file,
+                         stage_t *stage,
                          apr_pool_t *scratch_pool)
 {
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
@@ -1547,13 +2048,12 @@ write_changes_containers(pack_context_t *context,
     = apr_array_make(scratch_pool, 64, sizeof(svn_fs_x__id_t));
   apr_array_header_t *new_entries
     = apr_array_make(context->info_pool, 16, entries->elt_size);
-  svn_stream_t *temp_stream
-    = svn_stream_from_aprfile2(temp_file, TRUE, scratch_pool);
 
   /* copy all items in strict order */
   for (i = entries->nelts-1; i >= 0; --i)
     {
       apr_array_header_t *changes;
+      svn_stringbuf_t *item;
       apr_size_t list_index;
       svn_fs_x__p2l_entry_t *entry
         = APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t *);
@@ -1575,7 +2075,7 @@ write_changes_containers(pack_context_t *context,
 
           SVN_ERR(svn_fs_x__write_changes_container(memory_stream,
                                                      container, iterpool));
-          SVN_ERR(svn_stream_close(temp_stream));
+          SVN_ERR(svn_stream_close(memory_stream));
 
           block_left = get_block_left(context) - serialized->len;
           estimated_addition = 0;
@@ -1600,12 +2100,13 @@ write_changes_containers(pack_context_t *context,
           block_left = get_block_left(context);
         }
 
-      /* select the change list in the source file, parse it and add it to
-       * the container */
-      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
-                               iterpool));
-      SVN_ERR(svn_fs_x__read_changes(&changes, temp_stream, INT_MAX,
-                                     scratch_pool, iterpool));
+      /* select the change list in the staging area, parse it and add it
+       * to the container */
+      SVN_ERR(stage_read_item(&item, stage, entry, iterpool, iterpool));
+      SVN_ERR(svn_fs_x__read_changes(&changes,
+                                     svn_stream_from_stringbuf(item,
+                                                               iterpool),
+                                     INT_MAX, scratch_pool, iterpool));
       SVN_ERR(svn_fs_x__changes_append_list(&list_index, container, changes));
       SVN_ERR_ASSERT(list_index == sub_items->nelts);
       block_left -= estimated_size;
@@ -1628,19 +2129,19 @@ write_changes_containers(pack_context_t *context,
 }
 
 /* Read the (property) representations identified by svn_fs_x__p2l_entry_t
- * elements in ENTRIES from TEMP_FILE, aggregate them and write them into
+ * elements in ENTRIES from STAGE, aggregate them and write them into
  * CONTEXT->PACK_FILE.  Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
 write_property_containers(pack_context_t *context,
                           apr_array_header_t *entries,
-                          apr_file_t *temp_file,
+                          stage_t *stage,
                           apr_pool_t *scratch_pool)
 {
   apr_array_header_t *new_entries
     = apr_array_make(context->info_pool, 16, entries->elt_size);
 
-  SVN_ERR(write_reps_containers(context, entries, temp_file, new_entries,
+  SVN_ERR(write_reps_containers(context, entries, stage, new_entries,
                                 scratch_pool));
 
   *entries = *new_entries;
@@ -1762,17 +2263,17 @@ pack_range(pack_context_t *context,
                   if (entry->type == SVN_FS_X__ITEM_TYPE_CHANGES)
                     SVN_ERR(copy_item_to_temp(context,
                                               context->changes,
-                                              context->changes_file,
+                                              context->changes_stage,
                                               rev_file, entry, iterpool));
                   else if (entry->type == SVN_FS_X__ITEM_TYPE_FILE_PROPS)
                     SVN_ERR(copy_item_to_temp(context,
                                               context->file_props,
-                                              context->file_props_file,
+                                              context->file_props_stage,
                                               rev_file, entry, iterpool));
                   else if (entry->type == SVN_FS_X__ITEM_TYPE_DIR_PROPS)
                     SVN_ERR(copy_item_to_temp(context,
                                               context->dir_props,
-                                              context->dir_props_file,
+                                              context->dir_props_stage,
                                               rev_file, entry, iterpool));
                   else if (   entry->type == SVN_FS_X__ITEM_TYPE_FILE_REP
                            || entry->type == SVN_FS_X__ITEM_TYPE_DIR_REP)
@@ -1808,15 +2309,15 @@ pack_range(pack_context_t *context,
 
   /* phase 4: copy bucket data to pack file.  Write P2L index. */
   SVN_ERR(write_changes_containers(context, context->changes,
-                                   context->changes_file, revpool));
+                                   context->changes_stage, revpool));
   svn_pool_clear(revpool);
   SVN_ERR(write_property_containers(context, context->file_props,
-                                    context->file_props_file, revpool));
+                                    context->file_props_stage, revpool));
   svn_pool_clear(revpool);
   SVN_ERR(write_property_containers(context, context->dir_props,
-                                    context->dir_props_file, revpool));
+                                    context->dir_props_stage, revpool));
   svn_pool_clear(revpool);
-  SVN_ERR(copy_reps_from_temp(context, context->reps_file, revpool));
+  SVN_ERR(copy_reps_from_temp(context, context->reps_stage, revpool));
   svn_pool_clear(revpool);
 
   /* write L2P index as well (now that we know all target offsets) */
@@ -1919,7 +2420,7 @@ pack_log_addressed(svn_fs_t *fs,
                    const char *shard_dir,
                    svn_revnum_t shard_rev,
                    apr_size_t max_mem,
-                   svn_fs_x__batch_fsync_t *batch,
+                   svn_fs__batch_fsync_t *batch,
                    svn_cancel_func_t cancel_func,
                    void *cancel_baton,
                    apr_pool_t *scratch_pool)
@@ -1935,9 +2436,12 @@ pack_log_addressed(svn_fs_t *fs,
                    + 6 * sizeof(void*)
     };
 
-  int max_items = max_mem / PER_ITEM_MEM > INT_MAX
+  /* Split the memory budget evenly between the item placement info and
+   * the item data staged between reading and writing. */
+  apr_size_t max_stage_memory = max_mem / 2;
+  int max_items = (max_mem - max_stage_memory) / PER_ITEM_MEM > INT_MAX
                 ? INT_MAX
-                : (int)(max_mem / PER_ITEM_MEM);
+                : (int)((max_mem - max_stage_memory) / PER_ITEM_MEM);
   apr_array_header_t *max_ids;
   pack_context_t context = { 0 };
   int i;
@@ -1946,8 +2450,9 @@ pack_log_addressed(svn_fs_t *fs,
 
   /* set up a pack context */
   SVN_ERR(initialize_pack_context(&context, fs, pack_file_dir, shard_dir,
-                                  shard_rev, max_items, batch, cancel_func,
-                                  cancel_baton, scratch_pool));
+                                  shard_rev, max_items, max_stage_memory,
+                                  batch, cancel_func, cancel_baton,
+                                  scratch_pool));
 
   /* phase 1: determine the size of the revisions to pack */
   SVN_ERR(svn_fs_x__l2p_get_max_ids(&max_ids, fs, shard_rev,
@@ -2019,7 +2524,7 @@ pack_rev_shard(svn_fs_t *fs,
                apr_int64_t shard,
                int max_files_per_dir,
                apr_size_t max_mem,
-               svn_fs_x__batch_fsync_t *batch,
+               svn_fs__batch_fsync_t *batch,
                svn_cancel_func_t cancel_func,
                void *cancel_baton,
                apr_pool_t *scratch_pool)
@@ -2036,7 +2541,7 @@ pack_rev_shard(svn_fs_t *fs,
 
   /* Create the new directory and pack file. */
   SVN_ERR(svn_io_dir_make(pack_file_dir, APR_OS_DEFAULT, scratch_pool));
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, pack_file_dir, scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, pack_file_dir, scratch_pool));
 
   /* Index information files */
   SVN_ERR(pack_log_addressed(fs, pack_file_dir, shard_path, shard_rev,
@@ -2076,7 +2581,7 @@ pack_shard(const char *dir,
 {
   svn_fs_x__data_t *ffd = fs->fsap_data;
   const char *shard_path, *pack_file_dir;
-  svn_fs_x__batch_fsync_t *batch;
+  svn_fs__batch_fsync_t *batch;
 
   /* Notify caller we're starting to pack this shard. */
   if (notify_func)
@@ -2084,8 +2589,8 @@ pack_shard(const char *dir,
                         scratch_pool));
 
   /* Perform all fsyncs through this instance. */
-  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, ffd->flush_to_disk,
-                                       scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_create(&batch, ffd->flush_to_disk,
+                                     scratch_pool));
 
   /* Some useful paths. */
   pack_file_dir = svn_dirent_join(dir,
@@ -2119,7 +2624,7 @@ pack_shard(const char *dir,
   ffd->min_unpacked_rev = (svn_revnum_t)((shard + 1) * max_files_per_dir);
 
   /* Ensure that packed file is written to disk.*/
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, scratch_pool));
+  SVN_ERR(svn_fs__batch_fsync_run(batch, scratch_pool));
 
   /* Finally, remove the existing shard directories. */
   SVN_ERR(svn_io_remove_dir2(shard_path, TRUE,
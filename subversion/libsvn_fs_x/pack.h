@@ -30,7 +30,8 @@
    when required by the repository format.
 
    MAX_MEM limits the size of in-memory data structures needed for reordering
-   items.  0 means use the built-in default.
+   items, including the item contents staged between reading the revision
+   files and writing the pack file.  0 means use the built-in default.
 
    Use optional CANCEL_FUNC/CANCEL_BATON for cancellation support.
    Use SCRATCH_POOL for temporary allocations.
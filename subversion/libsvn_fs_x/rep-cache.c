@@ -100,6 +100,10 @@ open_rep_cache(void *baton,
                            0, NULL, 0,
                            fs->pool, scratch_pool));
 
+  /* The rep-cache lives next to the repository on the server side and
+     only grows.  Share its pages across processes. */
+  SVN_SQLITE__ERR_CLOSE(svn_sqlite__enable_mmap(sdb), sdb);
+
   SVN_SQLITE__ERR_CLOSE(svn_sqlite__read_schema_version(&version, sdb,
                                                         scratch_pool),
                         sdb);
@@ -22,6 +22,7 @@
 
 #include "reps.h"
 
+#include "svn_checksum.h"
 #include "svn_sorts.h"
 #include "private/svn_string_private.h"
 #include "private/svn_packed_data.h"
@@ -62,6 +63,12 @@
  *   that sequence shall be executed (i.e. a sub-sequence)
  * - copy a number of bytes from the base representation buffer starting
  *   at a given offset
+ *
+ * Base representations are fulltexts stored outside the container.  They
+ * are only used as a dictionary for matching and their texts are not part
+ * of the serialized container.  Logically, they form a prefix to the text
+ * corpus, i.e. each base occupies a range of "base text" offsets and the
+ * container's own text starts right after the last base.
  */
 
 /* The contents of a fulltext / representation is defined by its first
@@ -108,9 +115,19 @@ typedef struct base_t
   /* Priority with which to use this base over others */
   int priority;
 
-  /* Index into builder->representations that identifies the copy
-   * instructions for this base. */
-  apr_uint32_t rep;
+  /* Size of the representation on disk as in
+   * svn_fs_x__representation_t.size */
+  svn_filesize_t size;
+
+  /* Offset of the first byte of this base's fulltext within the base text
+   * section.  This is not serialized but reconstructed from LEN. */
+  apr_uint32_t offset;
+
+  /* Length of this base's fulltext */
+  apr_uint32_t len;
+
+  /* MD5 checksum of this base's fulltext */
+  unsigned char md5_digest[APR_MD5_DIGESTSIZE];
 } base_t;
 
 /* Yet another hash data structure.  This one tries to be more cache
@@ -167,14 +184,15 @@ struct svn_fs_x__reps_builder_t
   /* array of base_t objects describing all bases defined so far */
   apr_array_header_t *bases;
 
-  /* array of rep_t objects describing all fulltexts (including bases)
+  /* array of rep_t objects describing all fulltexts (excluding bases)
    * added so far */
   apr_array_header_t *reps;
 
   /* array of instruction_t objects describing all instructions */
   apr_array_header_t *instructions;
 
-  /* number of bytes in the text corpus that belongs to bases */
+  /* number of bytes in the text corpus that belongs to bases.  The base
+   * texts always precede all other text in the corpus. */
   apr_size_t base_text_len;
 };
 
@@ -182,7 +200,7 @@ struct svn_fs_x__reps_builder_t
  */
 struct svn_fs_x__reps_t
 {
-  /* text corpus */
+  /* text corpus (excluding base texts) */
   const char *text;
 
   /* length of the text corpus in bytes */
@@ -242,7 +260,8 @@ struct svn_fs_x__rep_extractor_t
   /* fulltext being constructed */
   svn_stringbuf_t *result;
 
-  /* bases (base_t) yet to process (not used ATM) */
+  /* copy of the container's bases (base_t) array, only set if MISSING is
+   * not NULL */
   apr_array_header_t *bases;
 
   /* missing sections (missing_t) in result->data that need to be filled,
@@ -403,6 +422,80 @@ svn_fs_x__reps_builder_create(svn_fs_t *fs,
   return result;
 }
 
+/* Return the index of the element in the array of COUNT bases starting at
+ * BASES whose text contains the base text OFFSET.  COUNT must not be 0.
+ */
+static apr_size_t
+find_base(const base_t *bases,
+          apr_size_t count,
+          apr_size_t offset)
+{
+  apr_size_t lower = 0;
+  apr_size_t upper = count;
+
+  /* Find the last base that starts at or before OFFSET.  Empty bases
+   * share their start offset with the next base and will be skipped. */
+  while (upper - lower > 1)
+    {
+      apr_size_t current = lower + (upper - lower) / 2;
+      if (bases[current].offset <= offset)
+        lower = current;
+      else
+        upper = current;
+    }
+
+  return lower;
+}
+
+/* Add hash entries for all MATCH_BLOCKSIZE sized blocks in BUILDER's text
+ * corpus starting at offset START.  Don't replace existing entries that
+ * point to text at or behind START.  If PRIORITY is not NULL, the new text
+ * is a base text with that priority and existing entries pointing into
+ * bases with a higher priority will be kept as well.
+ */
+static void
+add_to_hash(svn_fs_x__reps_builder_t *builder,
+            apr_size_t start,
+            const int *priority)
+{
+  apr_size_t offset;
+  apr_size_t buckets_required;
+
+  /* expand the hash upfront to minimize the chances of collisions */
+  buckets_required = builder->hash.used
+                   + (builder->text->len - start) / MATCH_BLOCKSIZE;
+  if (buckets_required * 3 >= builder->hash.size * 2)
+    grow_hash(&builder->hash, builder->text, 2 * buckets_required);
+
+  /* add hash entries for the new sequence */
+  for (offset = start;
+       offset + MATCH_BLOCKSIZE <= builder->text->len;
+       offset += MATCH_BLOCKSIZE)
+    {
+      hash_key_t key = hash_key(builder->text->data + offset);
+      size_t idx = hash_to_index(&builder->hash, key);
+      apr_uint32_t old_offset = builder->hash.offsets[idx];
+
+      /* Don't replace hash entries that stem from the current text.
+       * This makes early matches more likely. */
+      if (old_offset == NO_OFFSET)
+        ++builder->hash.used;
+      else if (old_offset >= start)
+        continue;
+      else if (priority)
+        {
+          const base_t *bases = (const base_t *)builder->bases->elts;
+          apr_size_t base = find_base(bases, builder->bases->nelts,
+                                      old_offset);
+          if (bases[base].priority > *priority)
+            continue;
+        }
+
+      builder->hash.offsets[idx] = (apr_uint32_t)offset;
+      builder->hash.prefixes[idx] = builder->text->data[offset];
+    }
+}
+
 svn_error_t *
 svn_fs_x__reps_add_base(svn_fs_x__reps_builder_t *builder,
                         svn_fs_x__representation_t *rep,
@@ -410,24 +503,41 @@ svn_fs_x__reps_add_base(svn_fs_x__reps_builder_t *builder,
                         apr_pool_t *scratch_pool)
 {
   base_t base;
-  apr_size_t text_start_offset = builder->text->len;
-
   svn_stream_t *stream;
   svn_string_t *contents;
-  apr_size_t idx;
-  SVN_ERR(svn_fs_x__get_contents(&stream, builder->fs, rep, FALSE,
+  svn_checksum_t *md5;
+
+  /* Base texts must precede all other texts in the corpus. */
+  SVN_ERR_ASSERT(builder->reps->nelts == 0);
+
+  SVN_ERR(svn_fs_x__get_contents(&stream, builder->fs, rep, TRUE,
                                  scratch_pool));
   SVN_ERR(svn_string_from_stream2(&contents, stream, SVN__STREAM_CHUNK_SIZE,
                                   scratch_pool));
-  SVN_ERR(svn_fs_x__reps_add(&idx, builder, contents));
+
+  if (builder->base_text_len + contents->len > MAX_TEXT_BODY)
+    return svn_error_create(SVN_ERR_FS_CONTAINER_SIZE, NULL,
+                      _("Base texts exceed star delta container capacity"));
+
+  /* Readers will verify the base contents against this checksum. */
+  SVN_ERR(svn_checksum(&md5, svn_checksum_md5, contents->data,
+                       contents->len, scratch_pool));
 
   base.revision = svn_fs_x__get_revnum(rep->id.change_set);
   base.item_index = rep->id.number;
   base.priority = priority;
-  base.rep = (apr_uint32_t)idx;
+  base.size = rep->size;
+  base.offset = (apr_uint32_t)builder->base_text_len;
+  base.len = (apr_uint32_t)contents->len;
+  memcpy(base.md5_digest, md5->digest, sizeof(base.md5_digest));
 
   APR_ARRAY_PUSH(builder->bases, base_t) = base;
-  builder->base_text_len += builder->text->len - text_start_offset;
+
+  /* The base text is only used for matching, i.e. we don't need any copy
+   * instructions for it. */
+  svn_stringbuf_appendbytes(builder->text, contents->data, contents->len);
+  add_to_hash(builder, base.offset, &priority);
+  builder->base_text_len = builder->text->len;
 
   return SVN_NO_ERROR;
 }
@@ -441,8 +551,6 @@ add_new_text(svn_fs_x__reps_builder_t *builder,
              apr_size_t len)
 {
   instruction_t instruction;
-  apr_size_t offset;
-  apr_size_t buckets_required;
 
   if (len == 0)
     return;
@@ -454,30 +562,7 @@ add_new_text(svn_fs_x__reps_builder_t *builder,
 
   /* add to text corpus */
   svn_stringbuf_appendbytes(builder->text, data, len);
-
-  /* expand the hash upfront to minimize the chances of collisions */
-  buckets_required = builder->hash.used + len / MATCH_BLOCKSIZE;
-  if (buckets_required * 3 >= builder->hash.size * 2)
-    grow_hash(&builder->hash, builder->text, 2 * buckets_required);
-
-  /* add hash entries for the new sequence */
-  for (offset = instruction.offset;
-       offset + MATCH_BLOCKSIZE <= builder->text->len;
-       offset += MATCH_BLOCKSIZE)
-    {
-      hash_key_t key = hash_key(builder->text->data + offset);
-      size_t idx = hash_to_index(&builder->hash, key);
-
-      /* Don't replace hash entries that stem from the current text.
-       * This makes early matches more likely. */
-      if (builder->hash.offsets[idx] == NO_OFFSET)
-        ++builder->hash.used;
-      else if (builder->hash.offsets[idx] >= instruction.offset)
-        continue;
-
-      builder->hash.offsets[idx] = (apr_uint32_t)offset;
-      builder->hash.prefixes[idx] = builder->text->data[offset];
-    }
+  add_to_hash(builder, instruction.offset, NULL);
 }
 
 svn_error_t *
@@ -491,7 +576,8 @@ svn_fs_x__reps_add(apr_size_t *rep_idx,
   const char *end = current + contents->len;
   const char *last_to_test = end - MATCH_BLOCKSIZE - 1;
 
-  if (builder->text->len + contents->len > MAX_TEXT_BODY)
+  if (builder->text->len - builder->base_text_len + contents->len
+      > MAX_TEXT_BODY)
     return svn_error_create(SVN_ERR_FS_CONTAINER_SIZE, NULL,
                       _("Text body exceeds star delta container capacity"));
 
@@ -528,17 +614,37 @@ svn_fs_x__reps_add(apr_size_t *rep_idx,
       if (current < last_to_test)
         {
           instruction_t instruction;
+          size_t prefix_match;
+          size_t postfix_match;
+
+          /* matches must not cross base text boundaries */
+
+          size_t lower = builder->base_text_len;
+          size_t upper = builder->text->len;
+          if (offset < builder->base_text_len)
+            {
+              const base_t *base
+                = &APR_ARRAY_IDX(builder->bases,
+                                 find_base((const base_t *)
+                                              builder->bases->elts,
+                                           builder->bases->nelts,
+                                           offset),
+                                 base_t);
+              lower = base->offset;
+              upper = base->offset + base->len;
+            }
 
           /* extend the match */
 
-          size_t prefix_match
+          prefix_match
             = svn_cstring__reverse_match_length(current,
                                                 builder->text->data + offset,
-                                                MIN(offset, current - processed));
-          size_t postfix_match
+                                                MIN(offset - lower,
+                                                    current - processed));
+          postfix_match
             = svn_cstring__match_length(current + MATCH_BLOCKSIZE,
                            builder->text->data + offset + MATCH_BLOCKSIZE,
-                           MIN(builder->text->len - offset - MATCH_BLOCKSIZE,
+                           MIN(upper - offset - MATCH_BLOCKSIZE,
                                end - current - MATCH_BLOCKSIZE));
 
           /* non-matched section */
@@ -622,10 +728,13 @@ get_text(svn_fs_x__rep_extractor_t *extractor,
       {
         /* a section that we need to fill from some external base rep. */
         missing_t missing;
-        missing.base = 0;
+        missing.base = (apr_uint32_t)find_base(container->bases,
+                                               container->base_count,
+                                               instruction->offset);
         missing.start = (apr_uint32_t)extractor->result->len;
         missing.count = instruction->count;
-        missing.offset = instruction->offset;
+        missing.offset = instruction->offset
+                       - container->bases[missing.base].offset;
         svn_stringbuf_appendfill(extractor->result, 0, instruction->count);
 
         if (extractor->missing == NULL)
@@ -656,10 +765,111 @@ svn_fs_x__reps_get(svn_fs_x__rep_extractor_t **extractor,
   /* fill all the bits of the result that we can, i.e. all but bits coming
    * from base representations */
   get_text(result, container, first, last - first);
+
+  /* The container may not outlive this call (e.g. when we are being called
+   * from within a cache access function), so copy the base descriptions
+   * that we will need to fill the gaps. */
+  if (result->missing)
+    {
+      result->bases = apr_array_make(result_pool,
+                                     (int)container->base_count,
+                                     sizeof(base_t));
+      result->bases->nelts = (int)container->base_count;
+      memcpy(result->bases->elts, container->bases,
+             container->base_count * sizeof(base_t));
+    }
+
   *extractor = result;
   return SVN_NO_ERROR;
 }
 
+/* Read the fulltext of BASE in FS and return it in *CONTENTS.  Allocate
+ * the result in RESULT_POOL and use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_base(svn_stringbuf_t **contents,
+          svn_fs_t *fs,
+          const base_t *base,
+          apr_pool_t *result_pool,
+          apr_pool_t *scratch_pool)
+{
+  svn_fs_x__representation_t rep = { 0 };
+  svn_stream_t *stream;
+  svn_stringbuf_t *text;
+
+  rep.id.change_set = svn_fs_x__change_set_by_rev(base->revision);
+  rep.id.number = base->item_index;
+  rep.size = base->size;
+  rep.expanded_size = base->len;
+  memcpy(rep.md5_digest, base->md5_digest, sizeof(rep.md5_digest));
+
+  /* Bases are shared by many reps, so let the fulltext cache help us. */
+  SVN_ERR(svn_fs_x__get_contents(&stream, fs, &rep, TRUE, scratch_pool));
+
+  text = svn_stringbuf_create_ensure(base->len, result_pool);
+  text->len = base->len;
+  SVN_ERR(svn_stream_read_full(stream, text->data, &text->len));
+  SVN_ERR(svn_stream_close(stream));
+  text->data[text->len] = '\0';
+
+  if (text->len != base->len)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Star delta base r%ld/%s is shorter than "
+                               "expected"),
+                             base->revision,
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_UINT64_T_FMT,
+                                          base->item_index));
+
+  *contents = text;
+  return SVN_NO_ERROR;
+}
+
+/* Fill all sections listed in EXTRACTOR->MISSING with data read from the
+ * respective base representations.  Use SCRATCH_POOL for temporary
+ * allocations.
+ *
+ * Base representations are never stored relative to other bases, i.e.
+ * this is the only delta hop required to reconstruct the fulltext.
+ */
+static svn_error_t *
+fill_missing(svn_fs_x__rep_extractor_t *extractor,
+             apr_pool_t *scratch_pool)
+{
+  int i;
+  const base_t *bases = (const base_t *)extractor->bases->elts;
+  svn_stringbuf_t **texts
+    = apr_pcalloc(scratch_pool,
+                  extractor->bases->nelts * sizeof(*texts));
+
+  for (i = 0; i < extractor->missing->nelts; ++i)
+    {
+      const missing_t *missing
+        = &APR_ARRAY_IDX(extractor->missing, i, missing_t);
+
+      /* Each base gets read at most once. */
+      if (texts[missing->base] == NULL)
+        SVN_ERR(read_base(&texts[missing->base], extractor->fs,
+                          &bases[missing->base], scratch_pool,
+                          scratch_pool));
+
+      if (   missing->offset > texts[missing->base]->len
+          || missing->count > texts[missing->base]->len - missing->offset)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Star delta base reference exceeds "
+                                  "base text"));
+
+      memcpy(extractor->result->data + missing->start,
+             texts[missing->base]->data + missing->offset,
+             missing->count);
+    }
+
+  /* Don't do it again when we get driven another time. */
+  extractor->missing = NULL;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_x__extractor_drive(svn_stringbuf_t **contents,
                           svn_fs_x__rep_extractor_t *extractor,
@@ -668,8 +878,9 @@ svn_fs_x__extractor_drive(svn_stringbuf_t **contents,
                           apr_pool_t *result_pool,
                           apr_pool_t *scratch_pool)
 {
-  /* we don't support base reps right now */
-  SVN_ERR_ASSERT(extractor->missing == NULL);
+  /* fill the gaps from base representations */
+  if (extractor->missing)
+    SVN_ERR(fill_missing(extractor, scratch_pool));
 
   if (size == 0)
     {
@@ -715,18 +926,25 @@ svn_fs_x__write_reps_container(svn_stream_t *stream,
   svn_packed__byte_stream_t *text_stream
     = svn_packed__create_bytes_stream(root);
 
+  /* MD5 digests of all bases, concatenated */
+  svn_packed__byte_stream_t *digests_stream
+    = svn_packed__create_bytes_stream(root);
+
   /* structure the struct streams such we can extract much of the redundancy
    */
   svn_packed__create_int_substream(bases_stream, TRUE, TRUE);
   svn_packed__create_int_substream(bases_stream, TRUE, FALSE);
   svn_packed__create_int_substream(bases_stream, TRUE, FALSE);
-  svn_packed__create_int_substream(bases_stream, TRUE, FALSE);
+  svn_packed__create_int_substream(bases_stream, FALSE, FALSE);
+  svn_packed__create_int_substream(bases_stream, FALSE, FALSE);
 
   svn_packed__create_int_substream(instructions_stream, TRUE, TRUE);
   svn_packed__create_int_substream(instructions_stream, FALSE, FALSE);
 
-  /* text */
-  svn_packed__add_bytes(text_stream, builder->text->data, builder->text->len);
+  /* text, without the base texts */
+  svn_packed__add_bytes(text_stream,
+                        builder->text->data + builder->base_text_len,
+                        builder->text->len - builder->base_text_len);
 
   /* serialize bases */
   for (i = 0; i < builder->bases->nelts; ++i)
@@ -735,7 +953,10 @@ svn_fs_x__write_reps_container(svn_stream_t *stream,
       svn_packed__add_int(bases_stream, base->revision);
       svn_packed__add_uint(bases_stream, base->item_index);
       svn_packed__add_uint(bases_stream, base->priority);
-      svn_packed__add_uint(bases_stream, base->rep);
+      svn_packed__add_uint(bases_stream, base->size);
+      svn_packed__add_uint(bases_stream, base->len);
+      svn_packed__add_bytes(digests_stream, (const char *)base->md5_digest,
+                            sizeof(base->md5_digest));
     }
 
   /* serialize reps */
@@ -757,7 +978,7 @@ svn_fs_x__write_reps_container(svn_stream_t *stream,
     }
 
   /* other elements */
-  svn_packed__add_uint(misc_stream, 0);
+  svn_packed__add_uint(misc_stream, builder->base_text_len);
 
   /* write to stream */
   SVN_ERR(svn_packed__data_write(stream, root, scratch_pool));
@@ -772,6 +993,9 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
                               apr_pool_t *scratch_pool)
 {
   apr_size_t i;
+  apr_size_t base_offset = 0;
+  apr_size_t digests_len = 0;
+  const char *digests = NULL;
 
   base_t *bases;
   apr_uint32_t *first_instructions;
@@ -785,6 +1009,7 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
   svn_packed__int_stream_t *instructions_stream;
   svn_packed__int_stream_t *misc_stream;
   svn_packed__byte_stream_t *text_stream;
+  svn_packed__byte_stream_t *digests_stream;
 
   /* read from disk */
   SVN_ERR(svn_packed__data_read(&root, stream, result_pool, scratch_pool));
@@ -794,6 +1019,7 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
   instructions_stream = svn_packed__next_int_stream(reps_stream);
   misc_stream = svn_packed__next_int_stream(instructions_stream);
   text_stream = svn_packed__first_byte_stream(root);
+  digests_stream = svn_packed__next_byte_stream(text_stream);
 
   /* text */
   reps->text = svn_packed__get_bytes(text_stream, &reps->text_len);
@@ -805,13 +1031,28 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
   bases = apr_palloc(result_pool, reps->base_count * sizeof(*bases));
   reps->bases = bases;
 
+  /* Containers written before bases were supported don't have digests
+   * but they don't have any bases either. */
+  if (digests_stream)
+    digests = svn_packed__get_bytes(digests_stream, &digests_len);
+  if (digests_len != reps->base_count * APR_MD5_DIGESTSIZE)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Star delta container base checksums "
+                              "missing"));
+
   for (i = 0; i < reps->base_count; ++i)
     {
       base_t *base = bases + i;
       base->revision = (svn_revnum_t)svn_packed__get_int(bases_stream);
       base->item_index = svn_packed__get_uint(bases_stream);
       base->priority = (int)svn_packed__get_uint(bases_stream);
-      base->rep = (apr_uint32_t)svn_packed__get_uint(bases_stream);
+      base->size = (svn_filesize_t)svn_packed__get_uint(bases_stream);
+      base->len = (apr_uint32_t)svn_packed__get_uint(bases_stream);
+      base->offset = (apr_uint32_t)base_offset;
+      memcpy(base->md5_digest, digests + i * APR_MD5_DIGESTSIZE,
+             APR_MD5_DIGESTSIZE);
+
+      base_offset += base->len;
     }
 
   /* de-serialize instructions */
@@ -846,6 +1087,10 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
 
   /* other elements */
   reps->base_text_len = (apr_size_t)svn_packed__get_uint(misc_stream);
+  if (reps->base_text_len != base_offset)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Star delta container base text length "
+                              "mismatch"));
 
   /* return result */
   *container = reps;
@@ -39,10 +39,13 @@
  * read-only.
  *
  * Extracting data from a representation container is O(length) but it
- * may require multiple iterations if base representations outside the
- * container were used.  Therefore, you will first create an extractor
- * object (this may happen while holding a cache lock) and the you need
- * to "drive" the extractor outside any cache context.
+ * may require reading base representations outside the container.
+ * Therefore, you will first create an extractor object (this may happen
+ * while holding a cache lock) and the you need to "drive" the extractor
+ * outside any cache context.  Base representations should themselves not
+ * depend on other bases, i.e. they should be self-contained container
+ * members, such that any fulltext can be reconstructed with at most one
+ * delta hop.
  */
 
 /* A write-only constructor object for representation containers.
@@ -80,7 +83,10 @@ svn_fs_x__reps_builder_create(svn_fs_t *fs,
 /* To BUILDER, add reference to the fulltext currently stored in
  * representation REP.  Substrings matching with any of the base reps
  * in BUILDER can be removed from the text base and be replaced by
- * references to those base representations.
+ * references to those base representations.  The base texts themselves
+ * will not be stored in the container.
+ *
+ * All bases must be added before the first call to svn_fs_x__reps_add.
  *
  * The PRIORITY is a mere hint on which base representations should
  * preferred in case we could re-use the same contents from multiple bases.
@@ -162,22 +162,52 @@ balance(builder_table_t *table,
   node->depth = MAX(left_height, right_height);
 }
 
-static apr_uint16_t
-match_length(const svn_string_t *lhs,
-             const svn_string_t *rhs)
+/* Compare the strings LHS and RHS like strcmp() but take embedded NULs
+ * into account.  The first SKIP chars are already known to be identical
+ * in both strings.  Set *MATCH_LEN to the length of their common prefix.
+ */
+static int
+compare_strings(apr_size_t *match_len,
+                const svn_string_t *lhs,
+                const svn_string_t *rhs,
+                apr_size_t skip)
 {
   apr_size_t len = MIN(lhs->len, rhs->len);
-  return (apr_uint16_t)svn_cstring__match_length(lhs->data, rhs->data, len);
+  apr_size_t match = skip + svn_cstring__match_length(lhs->data + skip,
+                                                      rhs->data + skip,
+                                                      len - skip);
+  *match_len = match;
+
+  if (match < len)
+    return (unsigned char)lhs->data[match] - (unsigned char)rhs->data[match];
+
+  return lhs->len < rhs->len ? -1 : lhs->len > rhs->len ? 1 : 0;
 }
 
+/* Insert TO_INSERT into the sub-tree of TABLE rooted at *PARENT and return
+ * its position in TABLE.  If an equal string already exists, return that
+ * string's position instead.
+ *
+ * PREVIOUS_MATCH_LEN and NEXT_MATCH_LEN are the lengths of the common
+ * prefixes between TO_INSERT and the nearest strings before and after that
+ * sub-tree in TABLE's string list, respectively, or 0 if there is no such
+ * string.  All strings within the sub-tree share at least the shorter one
+ * of those prefixes with TO_INSERT, so we don't need to compare them again.
+ * Once we reach a leaf, these values are the match lengths to the new
+ * neighbours of TO_INSERT.
+ */
 static apr_uint16_t
 insert_string(builder_table_t *table,
               builder_string_t **parent,
-              builder_string_t *to_insert)
+              builder_string_t *to_insert,
+              apr_size_t previous_match_len,
+              apr_size_t next_match_len)
 {
   apr_uint16_t result;
+  apr_size_t match;
   builder_string_t *current = *parent;
-  int diff = strcmp(current->string.data, to_insert->string.data);
+  int diff = compare_strings(&match, &current->string, &to_insert->string,
+                             MIN(previous_match_len, next_match_len));
   if (diff == 0)
     {
       apr_array_pop(table->short_strings);
@@ -200,16 +230,14 @@ insert_string(builder_table_t *table,
           else
             {
               builder_string_t *previous = to_insert->previous;
-              to_insert->previous_match_len
-                = match_length(&previous->string, &to_insert->string);
+              to_insert->previous_match_len = previous_match_len;
 
               previous->next = to_insert;
               previous->next_match_len = to_insert->previous_match_len;
             }
 
           current->previous = to_insert;
-          to_insert->next_match_len
-            = match_length(&current->string, &to_insert->string);
+          to_insert->next_match_len = match;
           current->previous_match_len = to_insert->next_match_len;
 
           table->max_data_size -= to_insert->string.len;
@@ -222,7 +250,8 @@ insert_string(builder_table_t *table,
           return to_insert->position;
         }
       else
-        result = insert_string(table, &current->left, to_insert);
+        result = insert_string(table, &current->left, to_insert,
+                               previous_match_len, match);
     }
   else
     {
@@ -240,16 +269,14 @@ insert_string(builder_table_t *table,
           else
             {
               builder_string_t *next = to_insert->next;
-              to_insert->next_match_len
-                = match_length(&next->string, &to_insert->string);
+              to_insert->next_match_len = next_match_len;
 
               next->previous = to_insert;
               next->previous_match_len = to_insert->next_match_len;
             }
 
           current->next = current->right;
-          to_insert->previous_match_len
-            = match_length(&current->string, &to_insert->string);
+          to_insert->previous_match_len = match;
           current->next_match_len = to_insert->previous_match_len;
 
           table->max_data_size -= to_insert->string.len;
@@ -262,7 +289,8 @@ insert_string(builder_table_t *table,
           return to_insert->position;
         }
       else
-        result = insert_string(table, &current->right, to_insert);
+        result = insert_string(table, &current->right, to_insert,
+                               match, next_match_len);
     }
 
   balance(table, parent, current);
@@ -334,7 +362,7 @@ svn_fs_x__string_table_builder_add(string_table_builder_t *builder,
         }
       else
         {
-          result = insert_string(table, &table->top, item)
+          result = insert_string(table, &table->top, item, 0, 0)
                  + (((apr_size_t)builder->tables->nelts - 1) << TABLE_SHIFT);
         }
     }
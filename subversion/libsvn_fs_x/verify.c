@@ -188,9 +188,10 @@ verify_index_checksum(svn_fs_x__revision_file_t *file,
 }
 
 /* Verify the MD5 checksums of the index data in the rev / pack file
- * containing revision START in FS.  If given, invoke CANCEL_FUNC with
- * CANCEL_BATON at regular intervals.  Use SCRATCH_POOL for temporary
- * allocations.
+ * containing revision START in FS.  Upon mismatch, use the per-page
+ * checksums to identify the damaged index pages.  If given, invoke
+ * CANCEL_FUNC with CANCEL_BATON at regular intervals.  Use SCRATCH_POOL
+ * for temporary allocations.
  */
 static svn_error_t *
 verify_index_checksums(svn_fs_t *fs,
@@ -199,6 +200,7 @@ verify_index_checksums(svn_fs_t *fs,
                        void *cancel_baton,
                        apr_pool_t *scratch_pool)
 {
+  svn_error_t *err;
   svn_fs_x__revision_file_t *rev_file;
   svn_fs_x__index_info_t l2p_index_info;
   svn_fs_x__index_info_t p2l_index_info;
@@ -209,10 +211,24 @@ verify_index_checksums(svn_fs_t *fs,
   SVN_ERR(svn_fs_x__rev_file_p2l_info(&p2l_index_info, rev_file));
 
   /* Verify the index contents against the checksum from the footer. */
-  SVN_ERR(verify_index_checksum(rev_file, "L2P index", &l2p_index_info,
-                                cancel_func, cancel_baton, scratch_pool));
-  SVN_ERR(verify_index_checksum(rev_file, "P2L index", &p2l_index_info,
-                                cancel_func, cancel_baton, scratch_pool));
+  err = verify_index_checksum(rev_file, "L2P index", &l2p_index_info,
+                              cancel_func, cancel_baton, scratch_pool);
+  if (!err)
+    err = verify_index_checksum(rev_file, "P2L index", &p2l_index_info,
+                                cancel_func, cancel_baton, scratch_pool);
+
+  /* The index data has been damaged.  Narrow that down to the affected
+   * index page and report it together with the checksum mismatch. */
+  if (err)
+    {
+      svn_error_t *page_err
+        = svn_fs_x__verify_index_pages(fs, rev_file, cancel_func,
+                                       cancel_baton, scratch_pool);
+      err = svn_error_compose_create(page_err, err);
+
+      return svn_error_trace(svn_error_compose_create(err,
+                               svn_fs_x__close_revision_file(rev_file)));
+    }
 
   /* Done. */
   SVN_ERR(svn_fs_x__close_revision_file(rev_file));
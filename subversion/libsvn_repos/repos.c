@@ -36,6 +36,7 @@
 #include "svn_version.h"
 #include "svn_config.h"
 
+#include "private/svn_fs_private.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 #include "svn_private_config.h" /* for SVN_TEMPLATE_ROOT_DIR */
@@ -1963,39 +1964,32 @@ fs_hotcopy_notify(void *baton,
 }
 
 /* Make a copy of a repository with hot backup of fs. */
-svn_error_t *
-svn_repos_hotcopy3(const char *src_path,
-                   const char *dst_path,
-                   svn_boolean_t clean_logs,
-                   svn_boolean_t incremental,
-                   svn_repos_notify_func_t notify_func,
-                   void *notify_baton,
-                   svn_cancel_func_t cancel_func,
-                   void *cancel_baton,
-                   apr_pool_t *scratch_pool)
+/* Copy the repository SRC_REPOS, whose root is at SRC_ABSPATH, to
+ * DST_ABSPATH.  If SRC_REPOS->FS is open, copy from that filesystem
+ * object, otherwise open the filesystem just for this copy.  All other
+ * parameters are as for svn_repos_hotcopy3(). */
+static svn_error_t *
+hotcopy_repos(svn_repos_t *src_repos,
+              const char *src_abspath,
+              const char *dst_abspath,
+              svn_boolean_t clean_logs,
+              svn_boolean_t incremental,
+              svn_repos_notify_func_t notify_func,
+              void *notify_baton,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *scratch_pool)
 {
   svn_fs_hotcopy_notify_t fs_notify_func;
   struct fs_hotcopy_notify_baton_t fs_notify_baton;
   struct hotcopy_ctx_t hotcopy_context;
-  const char *src_abspath;
-  const char *dst_abspath;
-  svn_repos_t *src_repos;
   svn_repos_t *dst_repos;
   svn_error_t *err;
 
-  SVN_ERR(svn_dirent_get_absolute(&src_abspath, src_path, scratch_pool));
-  SVN_ERR(svn_dirent_get_absolute(&dst_abspath, dst_path, scratch_pool));
   if (strcmp(src_abspath, dst_abspath) == 0)
     return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
                              _("Hotcopy source and destination are equal"));
 
-  /* Try to open original repository */
-  SVN_ERR(get_repos(&src_repos, src_abspath,
-                    FALSE, FALSE,
-                    FALSE,    /* don't try to open the db yet. */
-                    NULL,
-                    scratch_pool, scratch_pool));
-
   /* If we are going to clean logs, then get an exclusive lock on
      db-logs.lock, to ensure that no one else will work with logs.
 
@@ -2052,10 +2046,16 @@ svn_repos_hotcopy3(const char *src_path,
   fs_notify_baton.notify_func = notify_func;
   fs_notify_baton.notify_baton = notify_baton;
 
-  SVN_ERR(svn_fs_hotcopy3(src_repos->db_path, dst_repos->db_path,
-                          clean_logs, incremental,
-                          fs_notify_func, &fs_notify_baton,
-                          cancel_func, cancel_baton, scratch_pool));
+  if (src_repos->fs)
+    SVN_ERR(svn_fs__hotcopy_from(src_repos->fs, dst_repos->db_path,
+                                 clean_logs, incremental,
+                                 fs_notify_func, &fs_notify_baton,
+                                 cancel_func, cancel_baton, scratch_pool));
+  else
+    SVN_ERR(svn_fs_hotcopy3(src_repos->db_path, dst_repos->db_path,
+                            clean_logs, incremental,
+                            fs_notify_func, &fs_notify_baton,
+                            cancel_func, cancel_baton, scratch_pool));
 
   /* Destination repository is ready.  Stamp it with a format number. */
   return svn_io_write_version_file
@@ -2063,6 +2063,63 @@ svn_repos_hotcopy3(const char *src_path,
            dst_repos->format, scratch_pool);
 }
 
+svn_error_t *
+svn_repos_hotcopy3(const char *src_path,
+                   const char *dst_path,
+                   svn_boolean_t clean_logs,
+                   svn_boolean_t incremental,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *scratch_pool)
+{
+  const char *src_abspath;
+  const char *dst_abspath;
+  svn_repos_t *src_repos;
+
+  SVN_ERR(svn_dirent_get_absolute(&src_abspath, src_path, scratch_pool));
+  SVN_ERR(svn_dirent_get_absolute(&dst_abspath, dst_path, scratch_pool));
+
+  /* Try to open original repository */
+  SVN_ERR(get_repos(&src_repos, src_abspath,
+                    FALSE, FALSE,
+                    FALSE,    /* don't try to open the db yet. */
+                    NULL,
+                    scratch_pool, scratch_pool));
+
+  return svn_error_trace(hotcopy_repos(src_repos, src_abspath, dst_abspath,
+                                       clean_logs, incremental,
+                                       notify_func, notify_baton,
+                                       cancel_func, cancel_baton,
+                                       scratch_pool));
+}
+
+svn_error_t *
+svn_repos__hotcopy_from(svn_repos_t *src_repos,
+                        const char *dst_path,
+                        svn_boolean_t clean_logs,
+                        svn_boolean_t incremental,
+                        svn_repos_notify_func_t notify_func,
+                        void *notify_baton,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton,
+                        apr_pool_t *scratch_pool)
+{
+  const char *src_abspath;
+  const char *dst_abspath;
+
+  SVN_ERR(svn_dirent_get_absolute(&src_abspath, src_repos->path,
+                                  scratch_pool));
+  SVN_ERR(svn_dirent_get_absolute(&dst_abspath, dst_path, scratch_pool));
+
+  return svn_error_trace(hotcopy_repos(src_repos, src_abspath, dst_abspath,
+                                       clean_logs, incremental,
+                                       notify_func, notify_baton,
+                                       cancel_func, cancel_baton,
+                                       scratch_pool));
+}
+
 /* Return the library version number. */
 const svn_version_t *
 svn_repos_version(void)
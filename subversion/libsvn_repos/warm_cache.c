@@ -0,0 +1,341 @@
+/* warm_cache.c : pre-populating the repository caches
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+#include "svn_error.h"
+#include "svn_cache_config.h"
+#include "svn_fs.h"
+#include "svn_repos.h"
+#include "svn_sorts.h"
+
+#include "private/svn_cache.h"
+#include "private/svn_fspath.h"
+#include "private/svn_sorts_private.h"
+#include "svn_private_config.h"
+
+#include "repos.h"
+
+
+
+/* Shared state of the warm-up walk. */
+typedef struct warm_baton_t
+{
+  /* The revision being read. */
+  svn_fs_root_t *root;
+
+  /* Only read file contents, no properties. */
+  svn_boolean_t contents_only;
+
+  /* Stop once the process-wide membuffer cache holds this many bytes.
+   * 0, if there is no such cache. */
+  apr_uint64_t fill_limit;
+
+  /* Without a membuffer cache, stop after reading BUDGET bytes.  USED is
+   * the number of bytes read so far. */
+  apr_uint64_t budget;
+  apr_uint64_t used;
+
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} warm_baton_t;
+
+/* Return the number of bytes currently held by the process-wide membuffer
+ * cache.  Use SCRATCH_POOL for temporary allocations. */
+static apr_uint64_t
+get_cache_fill(apr_pool_t *scratch_pool)
+{
+  return svn_cache__membuffer_get_global_info(scratch_pool)->used_size;
+}
+
+/* Return TRUE if B has no cache budget left.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_boolean_t
+budget_exhausted(const warm_baton_t *b,
+                 apr_pool_t *scratch_pool)
+{
+  if (b->fill_limit)
+    return get_cache_fill(scratch_pool) >= b->fill_limit;
+
+  return b->used >= b->budget;
+}
+
+/* Read the properties of node PATH in B->ROOT and, depending on KIND,
+ * its contents or its directory entries.  For any other KIND, only the
+ * properties will be read.  If RECURSE is set, continue with all sub-nodes
+ * of directory PATH.  Stop when B's budget has been used up.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+warm_node(warm_baton_t *b,
+          const char *path,
+          svn_node_kind_t kind,
+          svn_boolean_t recurse,
+          apr_pool_t *scratch_pool)
+{
+  if (budget_exhausted(b, scratch_pool))
+    return SVN_NO_ERROR;
+
+  if (b->cancel_func)
+    SVN_ERR(b->cancel_func(b->cancel_baton));
+
+  if (!b->contents_only)
+    {
+      apr_hash_t *props;
+      apr_hash_index_t *hi;
+
+      SVN_ERR(svn_fs_node_proplist(&props, b->root, path, scratch_pool));
+      for (hi = apr_hash_first(scratch_pool, props);
+           hi;
+           hi = apr_hash_next(hi))
+        {
+          const svn_string_t *value = apr_hash_this_val(hi);
+          b->used += apr_hash_this_key_len(hi) + value->len;
+        }
+    }
+
+  if (kind == svn_node_file)
+    {
+      svn_filesize_t length;
+      svn_stream_t *contents;
+
+      /* The FS backends cache fulltexts only after they have been read
+       * completely. */
+      SVN_ERR(svn_fs_file_length(&length, b->root, path, scratch_pool));
+      SVN_ERR(svn_fs_file_contents(&contents, b->root, path, scratch_pool));
+      SVN_ERR(svn_stream_copy3(contents, svn_stream_empty(scratch_pool),
+                               b->cancel_func, b->cancel_baton,
+                               scratch_pool));
+      b->used += length;
+    }
+  else if (kind == svn_node_dir)
+    {
+      apr_hash_t *entries;
+      apr_array_header_t *sorted;
+      apr_pool_t *iterpool;
+      int i;
+
+      SVN_ERR(svn_fs_dir_entries(&entries, b->root, path, scratch_pool));
+      sorted = svn_sort__hash(entries, svn_sort_compare_items_lexically,
+                              scratch_pool);
+      for (i = 0; i < sorted->nelts; ++i)
+        {
+          const svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i,
+                                                        svn_sort__item_t);
+          b->used += sizeof(svn_fs_dirent_t) + item->klen;
+        }
+
+      if (!recurse)
+        return SVN_NO_ERROR;
+
+      iterpool = svn_pool_create(scratch_pool);
+      for (i = 0; i < sorted->nelts; ++i)
+        {
+          const svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i,
+                                                        svn_sort__item_t);
+          const svn_fs_dirent_t *dirent = item->value;
+
+          svn_pool_clear(iterpool);
+          if (budget_exhausted(b, iterpool))
+            break;
+
+          SVN_ERR(warm_node(b, svn_fspath__join(path, dirent->name, iterpool),
+                            dirent->kind, TRUE, iterpool));
+        }
+
+      svn_pool_destroy(iterpool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if PATH is within any of the PATHS trees. */
+static svn_boolean_t
+is_relevant(const char *path,
+            const apr_array_header_t *paths)
+{
+  int i;
+
+  for (i = 0; i < paths->nelts; ++i)
+    if (svn_fspath__skip_ancestor(APR_ARRAY_IDX(paths, i, const char *),
+                                  path))
+      return TRUE;
+
+  return FALSE;
+}
+
+/* Read all nodes in B->ROOT that have been changed in that revision and
+ * that are within any of the PATHS trees.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+warm_changes(warm_baton_t *b,
+             const apr_array_header_t *paths,
+             apr_pool_t *scratch_pool)
+{
+  svn_fs_path_change_iterator_t *iterator;
+  svn_fs_path_change3_t *change;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_fs_paths_changed3(&iterator, b->root, scratch_pool,
+                                scratch_pool));
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+  while (change)
+    {
+      svn_node_kind_t kind = change->node_kind;
+      const char *path = change->path.data;
+
+      svn_pool_clear(iterpool);
+      if (budget_exhausted(b, iterpool))
+        break;
+
+      if (   change->change_kind != svn_fs_path_change_delete
+          && is_relevant(path, paths))
+        {
+          if (kind == svn_node_unknown)
+            SVN_ERR(svn_fs_check_path(&kind, b->root, path, iterpool));
+
+          /* Unchanged file contents have been read for younger revisions
+           * already.  Only read the properties, then. */
+          if (kind == svn_node_file && !change->text_mod)
+            kind = svn_node_none;
+
+          SVN_ERR(warm_node(b, path, kind, FALSE, iterpool));
+        }
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos_warm_cache(svn_repos_t *repos,
+                     const apr_array_header_t *paths,
+                     svn_revnum_t start_rev,
+                     svn_revnum_t end_rev,
+                     apr_uint64_t budget,
+                     svn_boolean_t contents_only,
+                     svn_repos_notify_func_t notify_func,
+                     void *notify_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  svn_fs_t *fs = svn_repos_fs(repos);
+  svn_revnum_t youngest;
+  svn_revnum_t rev;
+  warm_baton_t b = { 0 };
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, scratch_pool));
+
+  if (! SVN_IS_VALID_REVNUM(end_rev))
+    end_rev = youngest;
+  if (! SVN_IS_VALID_REVNUM(start_rev))
+    start_rev = end_rev;
+
+  if (start_rev > end_rev)
+    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
+                             _("Start revision %ld"
+                               " is greater than end revision %ld"),
+                             start_rev, end_rev);
+  else if (end_rev > youngest)
+    return svn_error_createf(SVN_ERR_FS_NO_SUCH_REVISION, NULL,
+                             _("End revision %ld is invalid "
+                               "(youngest revision is %ld)"),
+                             end_rev, youngest);
+
+  if (paths == NULL || paths->nelts == 0)
+    {
+      apr_array_header_t *root_only = apr_array_make(scratch_pool, 1,
+                                                     sizeof(const char *));
+      APR_ARRAY_PUSH(root_only, const char *) = "/";
+      paths = root_only;
+    }
+
+  b.contents_only = contents_only;
+  b.budget = budget ? budget : svn_cache_config_get()->cache_size;
+  b.cancel_func = cancel_func;
+  b.cancel_baton = cancel_baton;
+
+  /* Measure the budget by what actually got added to the memory cache.
+   * Because the cache makes room for new entries before it is completely
+   * full, never try to fill it beyond 90%. */
+  if (svn_cache__get_global_membuffer_cache())
+    {
+      svn_cache__info_t *info
+        = svn_cache__membuffer_get_global_info(scratch_pool);
+      apr_uint64_t limit = info->data_size / 10 * 9;
+
+      b.fill_limit = MIN(info->used_size + b.budget, limit);
+      if (b.fill_limit == 0)
+        return SVN_NO_ERROR;
+    }
+
+  /* Go from young to old revisions, i.e. in the order of decreasing
+   * importance, because we might run out of budget.  The youngest
+   * revision gets read completely, the older ones only where they differ
+   * from their successors. */
+  for (rev = end_rev; rev >= start_rev; --rev)
+    {
+      svn_pool_clear(iterpool);
+      if (budget_exhausted(&b, iterpool))
+        break;
+
+      SVN_ERR(svn_fs_revision_root(&b.root, fs, rev, iterpool));
+
+      if (rev == end_rev)
+        {
+          for (i = 0; i < paths->nelts && !budget_exhausted(&b, iterpool);
+               ++i)
+            {
+              const char *path = APR_ARRAY_IDX(paths, i, const char *);
+              svn_node_kind_t kind;
+
+              SVN_ERR(svn_fs_check_path(&kind, b.root, path, iterpool));
+              if (kind != svn_node_none)
+                SVN_ERR(warm_node(&b, path, kind, TRUE, iterpool));
+            }
+        }
+      else
+        {
+          SVN_ERR(warm_changes(&b, paths, iterpool));
+        }
+
+      if (notify_func)
+        {
+          svn_repos_notify_t *notify
+            = svn_repos_notify_create(budget_exhausted(&b, iterpool)
+                                        ? svn_repos_notify_warm_cache_full
+                                        : svn_repos_notify_warm_cache_rev_end,
+                                      iterpool);
+          notify->revision = rev;
+          notify_func(notify_baton, notify, iterpool);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
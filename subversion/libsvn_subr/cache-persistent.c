@@ -0,0 +1,936 @@
+/*
+ * cache-persistent.c: on-disk caching for Subversion
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_thread_cond.h>
+#include <apr_thread_pool.h>
+
+#include "svn_checksum.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "svn_private_config.h"
+#include "private/svn_atomic.h"
+#include "private/svn_cache.h"
+#include "private/svn_mutex.h"
+#include "private/svn_subr_private.h"
+
+#include "cache.h"
+
+/* A note on the data layout:
+
+   The cache directory contains a fixed number of slot files, named by
+   their slot number in hex.  To keep directories small, they are spread
+   over SLOT_DIR_COUNT sub-directories, named by the slot number modulo
+   SLOT_DIR_COUNT in hex.  Every key is mapped onto exactly one slot
+   through a hash of the full key.  A slot file holds a single entry:
+
+     4 bytes   length of the full key
+     4 bytes   length of the serialized value
+     4 bytes   FNV-1a checksum over the full key and the serialized value
+     n bytes   the full key, i.e. the cache prefix followed by the key
+     m bytes   the serialized value
+
+   All numbers are stored least significant byte first.  A slot file whose
+   size or checksum does not match its header, e.g. because it got torn
+   in a system crash, is treated like an empty slot.
+
+   Writing an entry simply replaces the previous contents of its slot.
+   Thus, the cache never uses more than the number of slots times the
+   maximum entry size on disk.  Like the membuffer cache, we accept that
+   hash collisions may evict entries that are still useful.
+
+   The capacity of the cache is therefore limited to one entry per slot,
+   i.e. to SIZE / SLOT_SIZE entries but no more than MAX_SLOT_COUNT.  For
+   caches larger than MAX_SLOT_COUNT * SLOT_SIZE bytes (1TB), only the
+   maximum entry size will grow.
+
+   A note on writing:
+
+   Writing entries happens in the background, if APR supports threads.
+   Until written, the entries are kept in memory and are visible to the
+   cache instance that added them.  The number of such pending entries
+   is limited to MAX_PENDING_WRITES; additional entries will not be
+   written to disk.  Since this is a cache, slot files are never fsync'ed;
+   the checksum catches whatever a crash may have left behind.
+
+   A note on thread safety:
+
+   Slot files are replaced atomically, so concurrent readers will either
+   see the old or the new entry.  This holds across processes as well.
+   The pending entries are protected by a mutex.  Everything else in
+   persistent_cache_t is never modified after its creation and the
+   optional first-level cache has to take care of itself. */
+
+/* Average disk space per slot.  The actual number of slots is derived
+   from the total cache size. */
+#define SLOT_SIZE 0x40000
+
+/* Limits for the number of slots.  Sharing so few slots among all keys
+   would cause frequent collisions, while more slots would put more than
+   0x4000 files into each sub-directory. */
+#define MIN_SLOT_COUNT 0x10
+#define MAX_SLOT_COUNT 0x400000
+
+/* Number of sub-directories that the slot files get spread over. */
+#define SLOT_DIR_COUNT 0x100
+
+/* Maximum number of entries per cache instance that may wait for being
+   written to disk.  Limits the memory used by the background writes. */
+#define MAX_PENDING_WRITES 64
+
+/* Maximum number of threads writing slot files in the background. */
+#define WRITE_THREADS 2
+
+/* Size of the header fields at the start of each slot file. */
+#define HEADER_SIZE 12
+
+/* An entry waiting for being written to its slot file. */
+typedef struct pending_write_t
+{
+  /* Pool containing this structure and all data in it.  Allocating from
+   * it requires holding the mutex of CACHE. */
+  apr_pool_t *pool;
+
+  /* The slot file to write. */
+  const char *path;
+
+  /* Slot contents not yet taken by the writer thread.  If an entry gets
+   * replaced while being written, this will be non-NULL again.  May be
+   * NULL. */
+  svn_stringbuf_t *contents;
+
+  /* Slot contents currently being written.  May be NULL. */
+  svn_stringbuf_t *writing;
+
+  /* The cache that this write belongs to. */
+  struct persistent_cache_t *cache;
+} pending_write_t;
+
+/* The (internal) cache object. */
+typedef struct persistent_cache_t
+{
+  /* Optional in-memory cache to try before going to disk.  May be NULL. */
+  svn_cache__t *memory_cache;
+
+  /* Directory holding the slot files. */
+  const char *directory;
+
+  /* Number of slot files in DIRECTORY. */
+  apr_uint32_t slot_count;
+
+  /* Maximum size of a serialized value that we will write to disk. */
+  apr_size_t max_entry_size;
+
+  /* A prefix used to differentiate our data from the data of other
+   * caches sharing the same DIRECTORY. */
+  const char *prefix;
+
+  /* The size of the key: either a fixed number of bytes or
+   * APR_HASH_KEY_STRING. */
+  apr_ssize_t klen;
+
+  /* Used to marshal values in and out of the cache. */
+  svn_cache__serialize_func_t serialize_func;
+  svn_cache__deserialize_func_t deserialize_func;
+
+#if APR_HAS_THREADS
+  /* Protects PENDING.  Also used with PENDING_DONE. */
+  svn_mutex__t *mutex;
+
+  /* Signalled whenever an entry got removed from PENDING. */
+  apr_thread_cond_t *pending_done;
+
+  /* Maps slot file paths to the pending_write_t for them.  Allocated in
+   * a pool of its own, which is only used while holding MUTEX. */
+  apr_hash_t *pending;
+#endif
+} persistent_cache_t;
+
+
+/* Return the full key for KEY in CACHE, i.e. the cache prefix followed
+ * by the key data.  Allocate the result in POOL. */
+static svn_stringbuf_t *
+build_full_key(persistent_cache_t *cache,
+               const void *key,
+               apr_pool_t *pool)
+{
+  apr_size_t key_len = cache->klen == APR_HASH_KEY_STRING
+                     ? strlen(key)
+                     : (apr_size_t)cache->klen;
+  svn_stringbuf_t *full_key = svn_stringbuf_create(cache->prefix, pool);
+  svn_stringbuf_appendbytes(full_key, key, key_len);
+
+  return full_key;
+}
+
+/* Set *PATH to the slot file in CACHE that FULL_KEY maps to.
+ * Allocate the result in POOL. */
+static svn_error_t *
+get_slot_path(const char **path,
+              persistent_cache_t *cache,
+              const svn_stringbuf_t *full_key,
+              apr_pool_t *pool)
+{
+  svn_checksum_t *checksum;
+  const unsigned char *digest;
+  apr_uint32_t hash;
+
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_md5, full_key->data,
+                       full_key->len, pool));
+  digest = checksum->digest;
+  hash = (apr_uint32_t)digest[0]
+       | ((apr_uint32_t)digest[1] << 8)
+       | ((apr_uint32_t)digest[2] << 16)
+       | ((apr_uint32_t)digest[3] << 24);
+
+  hash %= cache->slot_count;
+  *path = svn_dirent_join(cache->directory,
+                          apr_psprintf(pool, "%02x/%x",
+                                       hash % SLOT_DIR_COUNT, hash),
+                          pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Store VALUE in the 4 bytes at DATA, least significant byte first. */
+static void
+encode_uint32(unsigned char *data,
+              apr_uint32_t value)
+{
+  data[0] = (unsigned char)(value);
+  data[1] = (unsigned char)(value >> 8);
+  data[2] = (unsigned char)(value >> 16);
+  data[3] = (unsigned char)(value >> 24);
+}
+
+/* Return the number stored by encode_uint32 in the 4 bytes at DATA. */
+static apr_uint32_t
+decode_uint32(const unsigned char *data)
+{
+  return (apr_uint32_t)data[0]
+       | ((apr_uint32_t)data[1] << 8)
+       | ((apr_uint32_t)data[2] << 16)
+       | ((apr_uint32_t)data[3] << 24);
+}
+
+/* If CONTENTS of a slot file contain an intact entry for FULL_KEY, set
+ * *VALUE and *SIZE to the serialized value within CONTENTS and return
+ * TRUE.  Otherwise, return FALSE.
+ */
+static svn_boolean_t
+extract_value(const char **value,
+              apr_size_t *size,
+              const svn_stringbuf_t *contents,
+              const svn_stringbuf_t *full_key)
+{
+  const unsigned char *header;
+  apr_size_t key_len;
+  apr_size_t value_len;
+
+  /* Is this the entry we are looking for?  Anything that does not match
+     - including incomplete or corrupted data - is simply another entry. */
+  if (contents->len < HEADER_SIZE)
+    return FALSE;
+
+  header = (const unsigned char *)contents->data;
+  key_len = decode_uint32(header);
+  value_len = decode_uint32(header + 4);
+
+  if (   key_len != full_key->len
+      || contents->len - HEADER_SIZE < key_len
+      || contents->len - HEADER_SIZE - key_len != value_len
+      || memcmp(contents->data + HEADER_SIZE, full_key->data, key_len)
+      || svn__fnv1a_32(contents->data + HEADER_SIZE, key_len + value_len)
+           != decode_uint32(header + 8))
+    return FALSE;
+
+  *value = contents->data + HEADER_SIZE + key_len;
+  *size = value_len;
+
+  return TRUE;
+}
+
+/* Write CONTENTS to the slot file at PATH, creating its parent directory
+ * if necessary.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_slot_file(const char *path,
+                const svn_stringbuf_t *contents,
+                apr_pool_t *scratch_pool)
+{
+  /* This is a cache.  If the data gets lost in a crash, we simply have
+     to reconstruct it again. */
+  svn_error_t *err = svn_io_write_atomic2(path, contents->data,
+                                          contents->len, NULL, FALSE,
+                                          scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+
+      /* Another process might create the directory at the same time. */
+      err = svn_io_dir_make(svn_dirent_dirname(path, scratch_pool),
+                            APR_OS_DEFAULT, scratch_pool);
+      if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+        return svn_error_trace(err);
+      svn_error_clear(err);
+
+      err = svn_io_write_atomic2(path, contents->data, contents->len, NULL,
+                                 FALSE, scratch_pool);
+    }
+
+  return svn_error_trace(err);
+}
+
+#if APR_HAS_THREADS
+
+/* Thread pool shared by all persistent caches within this process. */
+static apr_thread_pool_t *write_thread_pool = NULL;
+
+/* Keep track on whether we already created WRITE_THREAD_POOL. */
+static volatile svn_atomic_t write_thread_pool_initialized = FALSE;
+
+/* Destructor function that implicitly cleans up any running threads
+   in WRITE_THREAD_POOL *once*.  Must be run as a pre-cleanup hook. */
+static apr_status_t
+write_thread_pool_pre_cleanup(void *data)
+{
+  apr_thread_pool_t *tp = write_thread_pool;
+  if (!write_thread_pool)
+    return APR_SUCCESS;
+
+  write_thread_pool = NULL;
+  write_thread_pool_initialized = FALSE;
+
+  return apr_thread_pool_destroy(tp);
+}
+
+/* Create WRITE_THREAD_POOL.  Implements svn_atomic__err_init_func_t. */
+static svn_error_t *
+create_write_thread_pool(void *baton,
+                         apr_pool_t *scratch_pool)
+{
+  /* The thread pool must be allocated from a thread-safe pool that lives
+     as long as the process. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+  apr_status_t status = apr_thread_pool_create(&write_thread_pool, 0,
+                                               WRITE_THREADS, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create cache thread pool"));
+
+  /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
+     hook instead of the normal cleanup hook.  Otherwise, the sub-pools
+     containing the thread objects would already be invalid. */
+  apr_pool_pre_cleanup_register(pool, NULL, write_thread_pool_pre_cleanup);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread pool task writing the pending_write_t given by DATA to disk
+   and removing it from its cache afterwards. */
+static void * APR_THREAD_FUNC
+write_task(apr_thread_t *tid,
+           void *data)
+{
+  pending_write_t *write = data;
+  persistent_cache_t *cache = write->cache;
+  apr_pool_t *scratch_pool = svn_pool_create(NULL);
+  svn_error_t *err;
+
+  err = svn_mutex__lock(cache->mutex);
+  while (!err)
+    {
+      /* Take the latest contents. */
+      write->writing = write->contents;
+      write->contents = NULL;
+      err = svn_mutex__unlock(cache->mutex, SVN_NO_ERROR);
+      if (err)
+        break;
+
+      /* Failing to write a cache entry is not an error. */
+      svn_pool_clear(scratch_pool);
+      svn_error_clear(write_slot_file(write->path, write->writing,
+                                      scratch_pool));
+
+      /* Done, unless the entry has been replaced in the meantime. */
+      err = svn_mutex__lock(cache->mutex);
+      if (!err && !write->contents)
+        {
+          svn_hash_sets(cache->pending, write->path, NULL);
+          apr_thread_cond_broadcast(cache->pending_done);
+          svn_pool_destroy(write->pool);
+
+          /* As soon as we release the mutex, CACHE may be gone. */
+          err = svn_mutex__unlock(cache->mutex, SVN_NO_ERROR);
+          break;
+        }
+    }
+
+  svn_error_clear(err);
+  svn_pool_destroy(scratch_pool);
+
+  return NULL;
+}
+
+/* Pre-cleanup hook waiting for all pending writes of the
+   persistent_cache_t given by DATA to finish.  They reference the
+   cache object.  If WRITE_THREAD_POOL is gone, e.g. during process
+   shutdown, no write will ever finish and we simply stop waiting. */
+static apr_status_t
+wait_for_pending_writes(void *data)
+{
+  persistent_cache_t *cache = data;
+  svn_error_t *err = svn_mutex__lock(cache->mutex);
+  if (err)
+    {
+      svn_error_clear(err);
+      return APR_SUCCESS;
+    }
+
+  while (apr_hash_count(cache->pending) && write_thread_pool)
+    {
+      apr_status_t status
+        = apr_thread_cond_timedwait(cache->pending_done,
+                                    svn_mutex__get(cache->mutex),
+                                    apr_time_from_msec(10));
+      if (status && !APR_STATUS_IS_TIMEUP(status))
+        break;
+    }
+
+  svn_error_clear(svn_mutex__unlock(cache->mutex, SVN_NO_ERROR));
+
+  return APR_SUCCESS;
+}
+
+/* If there is a pending write for the slot file at PATH in CACHE, set
+ * *CONTENTS to a copy of its data, allocated in RESULT_POOL.  Otherwise,
+ * set it to NULL.  The copy is as large as the whole slot, so RESULT_POOL
+ * should be short-lived.
+ */
+static svn_error_t *
+get_pending_write(svn_stringbuf_t **contents,
+                  persistent_cache_t *cache,
+                  const char *path,
+                  apr_pool_t *result_pool)
+{
+  pending_write_t *write;
+
+  *contents = NULL;
+
+  SVN_ERR(svn_mutex__lock(cache->mutex));
+  write = svn_hash_gets(cache->pending, path);
+  if (write)
+    *contents = svn_stringbuf_dup(write->contents ? write->contents
+                                                  : write->writing,
+                                  result_pool);
+
+  return svn_error_trace(svn_mutex__unlock(cache->mutex, SVN_NO_ERROR));
+}
+
+/* Schedule CONTENTS to be written to the slot file at PATH in CACHE in
+ * the background.  Set *SCHEDULED to FALSE, if that was not possible.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+schedule_write(svn_boolean_t *scheduled,
+               persistent_cache_t *cache,
+               const char *path,
+               const svn_stringbuf_t *contents,
+               apr_pool_t *scratch_pool)
+{
+  pending_write_t *write;
+  apr_pool_t *pool;
+
+  *scheduled = FALSE;
+  SVN_ERR(svn_atomic__init_once(&write_thread_pool_initialized,
+                                create_write_thread_pool, NULL,
+                                scratch_pool));
+
+  SVN_ERR(svn_mutex__lock(cache->mutex));
+
+  /* An update to a pending entry?  Newer entries replace older ones. */
+  write = svn_hash_gets(cache->pending, path);
+  if (write)
+    {
+      write->contents = svn_stringbuf_dup(contents, write->pool);
+      *scheduled = TRUE;
+      return svn_error_trace(svn_mutex__unlock(cache->mutex, SVN_NO_ERROR));
+    }
+
+  /* Too much work queued up already?  Then, drop this entry.  It is
+     still in the first-level cache, if there is one. */
+  if (apr_hash_count(cache->pending) >= MAX_PENDING_WRITES)
+    {
+      *scheduled = TRUE;
+      return svn_error_trace(svn_mutex__unlock(cache->mutex, SVN_NO_ERROR));
+    }
+
+  /* The write will be processed in a different thread, so it needs its
+     own pool hierarchy. */
+  pool = svn_pool_create(NULL);
+  write = apr_pcalloc(pool, sizeof(*write));
+  write->pool = pool;
+  write->path = apr_pstrdup(pool, path);
+  write->contents = svn_stringbuf_dup(contents, pool);
+  write->cache = cache;
+
+  svn_hash_sets(cache->pending, write->path, write);
+  if (apr_thread_pool_push(write_thread_pool, write_task, write, 0, NULL))
+    {
+      /* Let our caller write it. */
+      svn_hash_sets(cache->pending, write->path, NULL);
+      svn_pool_destroy(pool);
+    }
+  else
+    {
+      *scheduled = TRUE;
+    }
+
+  return svn_error_trace(svn_mutex__unlock(cache->mutex, SVN_NO_ERROR));
+}
+
+#endif /* APR_HAS_THREADS */
+
+/* Core functionality of our getter functions: read the serialized value
+ * for KEY from the slot file in CACHE into *DATA and *SIZE.  Indicate
+ * success in *FOUND.  The data will be allocated in RESULT_POOL, is
+ * suitably aligned for the deserializer and will be NUL-terminated.
+ * Only the value itself gets allocated in RESULT_POOL; the slot contents
+ * are read into a temporary pool.
+ */
+static svn_error_t *
+persistent_internal_get(char **data,
+                        apr_size_t *size,
+                        svn_boolean_t *found,
+                        persistent_cache_t *cache,
+                        const void *key,
+                        apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *full_key;
+  svn_stringbuf_t *contents = NULL;
+  const char *path;
+  const char *value;
+  apr_size_t value_len;
+  svn_error_t *err;
+  apr_pool_t *scratch_pool;
+
+  *found = FALSE;
+  if (key == NULL)
+    return SVN_NO_ERROR;
+
+  scratch_pool = svn_pool_create(result_pool);
+  full_key = build_full_key(cache, key, scratch_pool);
+  SVN_ERR(get_slot_path(&path, cache, full_key, scratch_pool));
+
+#if APR_HAS_THREADS
+  /* Entries not written yet take precedence over what is on disk. */
+  SVN_ERR(get_pending_write(&contents, cache, path, scratch_pool));
+#endif
+
+  if (contents == NULL)
+    {
+      err = svn_stringbuf_from_file2(&contents, path, scratch_pool);
+      if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+        {
+          svn_error_clear(err);
+          svn_pool_destroy(scratch_pool);
+          return SVN_NO_ERROR;
+        }
+      SVN_ERR(err);
+    }
+
+  if (extract_value(&value, &value_len, contents, full_key))
+    {
+      /* apr_palloc'ed memory is properly aligned for the deserializers. */
+      *data = apr_palloc(result_pool, value_len + 1);
+      memcpy(*data, value, value_len);
+      (*data)[value_len] = '\0';
+      *size = value_len;
+      *found = TRUE;
+    }
+
+  svn_pool_destroy(scratch_pool);
+  return SVN_NO_ERROR;
+}
+
+/* Core functionality of our setter functions: store SIZE bytes of DATA
+ * to be identified by KEY in the slot file of CACHE.  Values too large
+ * for the cache will silently be dropped.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+persistent_internal_set(persistent_cache_t *cache,
+                        const void *key,
+                        const void *data,
+                        apr_size_t size,
+                        apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *full_key;
+  svn_stringbuf_t *contents;
+  const char *path;
+  unsigned char *header;
+#if APR_HAS_THREADS
+  svn_boolean_t scheduled;
+#endif
+
+  if (   key == NULL
+      || size > cache->max_entry_size
+      || size > APR_UINT32_MAX)
+    return SVN_NO_ERROR;
+
+  full_key = build_full_key(cache, key, scratch_pool);
+  if (full_key->len > APR_UINT32_MAX)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_slot_path(&path, cache, full_key, scratch_pool));
+
+  contents = svn_stringbuf_create_ensure(HEADER_SIZE + full_key->len + size,
+                                         scratch_pool);
+  svn_stringbuf_appendfill(contents, 0, HEADER_SIZE);
+  svn_stringbuf_appendstr(contents, full_key);
+  svn_stringbuf_appendbytes(contents, data, size);
+
+  header = (unsigned char *)contents->data;
+  encode_uint32(header, (apr_uint32_t)full_key->len);
+  encode_uint32(header + 4, (apr_uint32_t)size);
+  encode_uint32(header + 8, svn__fnv1a_32(contents->data + HEADER_SIZE,
+                                          full_key->len + size));
+
+#if APR_HAS_THREADS
+  /* Don't keep our caller waiting for the disk. */
+  SVN_ERR(schedule_write(&scheduled, cache, path, contents, scratch_pool));
+  if (scheduled)
+    return SVN_NO_ERROR;
+#endif
+
+  return svn_error_trace(write_slot_file(path, contents, scratch_pool));
+}
+
+/* Deserialize SIZE bytes of DATA read from CACHE into *VALUE_P.
+ * Allocate the result in RESULT_POOL.
+ */
+static svn_error_t *
+deserialize(void **value_p,
+            persistent_cache_t *cache,
+            char *data,
+            apr_size_t size,
+            apr_pool_t *result_pool)
+{
+  if (cache->deserialize_func)
+    {
+      SVN_ERR((cache->deserialize_func)(value_p, data, size, result_pool));
+    }
+  else
+    {
+      /* Like the membuffer cache, we store stringbufs including their
+         terminating NUL.  DATA is NUL-terminated in any case. */
+      svn_stringbuf_t *value = svn_stringbuf_create_empty(result_pool);
+      value->data = data;
+      value->blocksize = size + 1;
+      value->len = size ? size - 1 : 0;
+      *value_p = value;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+persistent_get(void **value_p,
+               svn_boolean_t *found,
+               void *cache_void,
+               const void *key,
+               apr_pool_t *result_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  char *data;
+  apr_size_t size;
+
+  if (cache->memory_cache)
+    {
+      SVN_ERR(svn_cache__get(value_p, found, cache->memory_cache, key,
+                             result_pool));
+      if (*found)
+        return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(persistent_internal_get(&data, &size, found, cache, key,
+                                  result_pool));
+  if (*found)
+    {
+      SVN_ERR(deserialize(value_p, cache, data, size, result_pool));
+
+      /* Keep it in memory for the next time. */
+      if (cache->memory_cache)
+        SVN_ERR(svn_cache__set(cache->memory_cache, key, *value_p,
+                               result_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement vtable.has_key in terms of the getters.
+ */
+static svn_error_t *
+persistent_has_key(svn_boolean_t *found,
+                   void *cache_void,
+                   const void *key,
+                   apr_pool_t *scratch_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  char *data;
+  apr_size_t size;
+
+  if (cache->memory_cache)
+    {
+      SVN_ERR(svn_cache__has_key(found, cache->memory_cache, key,
+                                 scratch_pool));
+      if (*found)
+        return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(persistent_internal_get(&data, &size, found, cache, key,
+                                  scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+persistent_set(void *cache_void,
+               const void *key,
+               void *value,
+               apr_pool_t *scratch_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  apr_pool_t *subpool;
+  void *data;
+  apr_size_t size;
+  svn_error_t *err;
+
+  if (key == NULL)
+    return SVN_NO_ERROR;
+
+  if (cache->memory_cache)
+    SVN_ERR(svn_cache__set(cache->memory_cache, key, value, scratch_pool));
+
+  subpool = svn_pool_create(scratch_pool);
+  if (cache->serialize_func)
+    {
+      SVN_ERR((cache->serialize_func)(&data, &size, value, subpool));
+    }
+  else
+    {
+      /* Include the terminating NUL, like the membuffer cache does.
+         Partial getters rely on that. */
+      svn_stringbuf_t *value_str = value;
+      data = value_str->data;
+      size = value_str->len + 1;
+    }
+
+  err = persistent_internal_set(cache, key, data, size, subpool);
+
+  svn_pool_destroy(subpool);
+  return err;
+}
+
+static svn_error_t *
+persistent_get_partial(void **value_p,
+                       svn_boolean_t *found,
+                       void *cache_void,
+                       const void *key,
+                       svn_cache__partial_getter_func_t func,
+                       void *baton,
+                       apr_pool_t *result_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  char *data;
+  apr_size_t size;
+  apr_pool_t *subpool;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  if (cache->memory_cache)
+    {
+      SVN_ERR(svn_cache__get_partial(value_p, found, cache->memory_cache,
+                                     key, func, baton, result_pool));
+      if (*found)
+        return SVN_NO_ERROR;
+    }
+
+  /* Partial reads are usually done on large items, so we don't promote
+     them into the memory cache here.  Neither do we keep the whole value
+     in RESULT_POOL. */
+  subpool = svn_pool_create(result_pool);
+  SVN_ERR(persistent_internal_get(&data, &size, found, cache, key,
+                                  subpool));
+  if (*found)
+    err = func(value_p, data, size, baton, result_pool);
+
+  svn_pool_destroy(subpool);
+  return svn_error_trace(err);
+}
+
+static svn_error_t *
+persistent_set_partial(void *cache_void,
+                       const void *key,
+                       svn_cache__partial_setter_func_t func,
+                       void *baton,
+                       apr_pool_t *scratch_pool)
+{
+  persistent_cache_t *cache = cache_void;
+  apr_pool_t *subpool;
+  void *data;
+  apr_size_t size;
+  svn_boolean_t found;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  if (cache->memory_cache)
+    SVN_ERR(svn_cache__set_partial(cache->memory_cache, key, func, baton,
+                                   scratch_pool));
+
+  /* If we have it on disk, modify it and write it back. */
+  subpool = svn_pool_create(scratch_pool);
+  SVN_ERR(persistent_internal_get((char **)&data, &size, &found, cache, key,
+                                  subpool));
+  if (found)
+    {
+      SVN_ERR(func(&data, &size, baton, subpool));
+      err = persistent_internal_set(cache, key, data, size, subpool);
+    }
+
+  svn_pool_destroy(subpool);
+  return err;
+}
+
+static svn_error_t *
+persistent_iter(svn_boolean_t *completed,
+                void *cache_void,
+                svn_iter_apr_hash_cb_t user_cb,
+                void *user_baton,
+                apr_pool_t *scratch_pool)
+{
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Can't iterate a persistent cache"));
+}
+
+static svn_boolean_t
+persistent_is_cachable(void *cache_void,
+                       apr_size_t size)
+{
+  persistent_cache_t *cache = cache_void;
+
+  return size <= cache->max_entry_size
+      || svn_cache__is_cachable(cache->memory_cache, size);
+}
+
+static svn_error_t *
+persistent_get_info(void *cache_void,
+                    svn_cache__info_t *info,
+                    svn_boolean_t reset,
+                    apr_pool_t *result_pool)
+{
+  persistent_cache_t *cache = cache_void;
+
+  info->id = apr_pstrdup(result_pool, cache->prefix);
+
+  /* We don't scan the disk for the actual usage. */
+  info->total_entries = cache->slot_count;
+  info->total_size = (apr_uint64_t)cache->slot_count * cache->max_entry_size;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_cache__vtable_t persistent_vtable = {
+  persistent_get,
+  persistent_has_key,
+  persistent_set,
+  persistent_iter,
+  persistent_is_cachable,
+  persistent_get_partial,
+  persistent_set_partial,
+  persistent_get_info
+};
+
+svn_error_t *
+svn_cache__create_persistent(svn_cache__t **cache_p,
+                             svn_cache__t *memory_cache,
+                             const char *directory,
+                             apr_uint64_t size,
+                             svn_cache__serialize_func_t serialize_func,
+                             svn_cache__deserialize_func_t deserialize_func,
+                             apr_ssize_t klen,
+                             const char *prefix,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  persistent_cache_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+  apr_uint64_t slot_count = size / SLOT_SIZE;
+
+  if (slot_count < MIN_SLOT_COUNT)
+    slot_count = MIN_SLOT_COUNT;
+  else if (slot_count > MAX_SLOT_COUNT)
+    slot_count = MAX_SLOT_COUNT;
+
+  SVN_ERR(svn_io_make_dir_recursively(directory, scratch_pool));
+
+#if APR_HAS_THREADS
+  {
+    apr_status_t status;
+
+    SVN_ERR(svn_mutex__init(&cache->mutex, TRUE, result_pool));
+    status = apr_thread_cond_create(&cache->pending_done, result_pool);
+    if (status)
+      return svn_error_wrap_apr(status,
+                                _("Can't create condition variable"));
+
+    /* Only used while holding MUTEX, so it may not share a pool with
+       anything that might get used concurrently. */
+    cache->pending = apr_hash_make(svn_pool_create(result_pool));
+
+    /* Pending writes must not outlive CACHE. */
+    apr_pool_pre_cleanup_register(result_pool, cache,
+                                  wait_for_pending_writes);
+  }
+#endif
+
+  cache->memory_cache = memory_cache;
+  cache->directory = apr_pstrdup(result_pool, directory);
+  cache->slot_count = (apr_uint32_t)slot_count;
+  cache->max_entry_size = (apr_size_t)MIN(size / slot_count, APR_SIZE_MAX);
+  cache->prefix = apr_pstrdup(result_pool, prefix);
+  cache->klen = klen;
+  cache->serialize_func = serialize_func;
+  cache->deserialize_func = deserialize_func;
+
+  wrapper->vtable = &persistent_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->error_handler = 0;
+  wrapper->error_baton = 0;
+  wrapper->pretend_empty = !!getenv("SVN_X_DOES_NOT_MARK_THE_SPOT");
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
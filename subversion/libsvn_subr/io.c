@@ -51,6 +51,24 @@
 #include <fcntl.h>
 #endif
 
+#if APR_HAS_MMAP && !defined(WIN32)
+#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/* Share the data blocks of another file (reflink).  Older kernel headers
+   don't define this, so don't rely on <linux/fs.h>. */
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+#endif
+
 #include "svn_hash.h"
 #include "svn_types.h"
 #include "svn_dirent_uri.h"
@@ -869,15 +887,123 @@ copy_contents(apr_file_t *from_file,
   /* NOTREACHED */
 }
 
+/* Maximum number of bytes that we let the kernel copy at once before
+ * checking for cancellation. */
+#define KERNEL_COPY_CHUNK_SIZE 0x1000000
+
+/* Try to let the operating system copy the contents of FROM_FILE to
+ * TO_FILE without passing the data through user space.  If the file
+ * system supports it, the two files will even share their data blocks.
+ *
+ * FROM_FILE must be at its start and nothing may have been written to
+ * TO_FILE, yet.  Set *COPIED to TRUE upon success.  If the kernel can't
+ * do the copy for these files, set it to FALSE; neither file will have
+ * been modified in that case.  If CANCEL_FUNC is not NULL, call it with
+ * CANCEL_BATON between chunks of KERNEL_COPY_CHUNK_SIZE bytes.
+ */
+static svn_error_t *
+copy_contents_in_kernel(svn_boolean_t *copied,
+                        apr_file_t *from_file,
+                        apr_file_t *to_file,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton)
+{
+  *copied = FALSE;
+
+#if defined(__linux__) && defined(SYS_copy_file_range)
+  {
+    apr_os_file_t from_fd, to_fd;
+
+    apr_os_file_get(&from_fd, from_file);
+    apr_os_file_get(&to_fd, to_file);
+
+    /* On btrfs, XFS and similar, this is an O(1) operation. */
+    if (ioctl(to_fd, FICLONE, from_fd) == 0)
+      {
+        *copied = TRUE;
+        return SVN_NO_ERROR;
+      }
+
+    /* Otherwise, the kernel may still copy without a round-trip through
+       user space, e.g. by server-side copies on NFS. */
+    while (TRUE)
+      {
+        ssize_t count = syscall(SYS_copy_file_range, from_fd, NULL,
+                                to_fd, NULL,
+                                (size_t)KERNEL_COPY_CHUNK_SIZE, 0);
+        if (count > 0)
+          {
+            *copied = TRUE;
+            if (cancel_func)
+              SVN_ERR(cancel_func(cancel_baton));
+          }
+        else if (count == 0)
+          {
+            /* Some file systems claim EOF right away instead of reporting
+               that they don't support this.  Leave *COPIED as FALSE in
+               that case such that the caller falls back to a standard
+               copy, which is cheap if the file really is empty. */
+            return SVN_NO_ERROR;
+          }
+        else
+          {
+            apr_status_t status = apr_get_os_error();
+            if (APR_STATUS_IS_EINTR(status))
+              continue;
+
+            /* Old kernels or file systems without support for this.
+               If nothing has been modified, yet, the caller may fall
+               back to a standard copy. */
+            if (*copied)
+              return svn_error_wrap_apr(status, NULL);
+
+            return SVN_NO_ERROR;
+          }
+      }
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
 
 svn_error_t *
-svn_io_copy_file(const char *src,
-                 const char *dst,
-                 svn_boolean_t copy_perms,
-                 apr_pool_t *pool)
+svn_io__file_copy_contents(apr_file_t *from_file,
+                           apr_file_t *to_file,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
+{
+  svn_boolean_t copied;
+
+  SVN_ERR(copy_contents_in_kernel(&copied, from_file, to_file,
+                                  cancel_func, cancel_baton));
+  if (!copied)
+    {
+      /* Don't close the files when closing the streams. */
+      svn_stream_t *from_stream = svn_stream_from_aprfile2(from_file, TRUE,
+                                                           scratch_pool);
+      svn_stream_t *to_stream = svn_stream_from_aprfile2(to_file, TRUE,
+                                                         scratch_pool);
+
+      SVN_ERR(svn_stream_copy3(from_stream, to_stream,
+                               cancel_func, cancel_baton, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
+svn_error_t *
+svn_io__copy_file(const char *src,
+                  const char *dst,
+                  svn_boolean_t copy_perms,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *pool)
 {
   apr_file_t *from_file, *to_file;
   apr_status_t apr_err;
+  svn_boolean_t copied;
   const char *dst_tmp;
   svn_error_t *err;
 
@@ -909,16 +1035,21 @@ svn_io_copy_file(const char *src,
                                    svn_dirent_dirname(dst, pool),
                                    svn_io_file_del_none, pool, pool));
 
-  apr_err = copy_contents(from_file, to_file, pool);
-
-  if (apr_err)
+  /* Reflink or copy_file_range if possible, i.e. don't pass large files
+     through user space and the page cache. */
+  err = copy_contents_in_kernel(&copied, from_file, to_file,
+                                cancel_func, cancel_baton);
+  if (!err && !copied)
     {
-      err = svn_error_wrap_apr(apr_err, _("Can't copy '%s' to '%s'"),
-                               svn_dirent_local_style(src, pool),
-                               svn_dirent_local_style(dst_tmp, pool));
+      apr_err = copy_contents(from_file, to_file, pool);
+      if (apr_err)
+        err = svn_error_wrap_apr(apr_err, NULL);
     }
-   else
-     err = NULL;
+
+  if (err)
+    err = svn_error_createf(err->apr_err, err, _("Can't copy '%s' to '%s'"),
+                            svn_dirent_local_style(src, pool),
+                            svn_dirent_local_style(dst_tmp, pool));
 
   err = svn_error_compose_create(err,
                                  svn_io_file_close(from_file, pool));
@@ -943,6 +1074,16 @@ svn_io_copy_file(const char *src,
   return svn_error_trace(svn_io_file_rename2(dst_tmp, dst, FALSE, pool));
 }
 
+svn_error_t *
+svn_io_copy_file(const char *src,
+                 const char *dst,
+                 svn_boolean_t copy_perms,
+                 apr_pool_t *pool)
+{
+  return svn_error_trace(svn_io__copy_file(src, dst, copy_perms,
+                                           NULL, NULL, pool));
+}
+
 #if !defined(WIN32) && !defined(__OS2__)
 /* Wrapper for apr_file_perms_set(), taking a UTF8-encoded filename. */
 static svn_error_t *
@@ -3912,6 +4053,412 @@ svn_io_file_aligned_seek(apr_file_t *file,
   return SVN_NO_ERROR;
 }
 
+void
+svn_io__file_prefetch(apr_file_t *file,
+                      apr_off_t offset,
+                      apr_off_t length)
+{
+#if defined(POSIX_FADV_WILLNEED)
+  apr_os_file_t fd;
+  apr_os_file_get(&fd, file);
+
+  /* This is merely a hint.  The actual read will report any problems. */
+  (void)posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+#endif
+}
+
+void
+svn_io__file_evict(apr_file_t *file,
+                   apr_off_t offset,
+                   apr_off_t length)
+{
+#if defined(POSIX_FADV_DONTNEED)
+  apr_os_file_t fd;
+  apr_os_file_get(&fd, file);
+
+  /* This is merely a hint.  Dirty pages will simply not be dropped. */
+  (void)posix_fadvise(fd, offset, length, POSIX_FADV_DONTNEED);
+#endif
+}
+
+void
+svn_io__memory_prefetch(const void *data,
+                        apr_size_t length)
+{
+#if defined(POSIX_MADV_WILLNEED)
+  /* The start address must be page-aligned. */
+  static apr_size_t page_size = 0;
+  apr_uintptr_t start = (apr_uintptr_t)data;
+
+  if (page_size == 0)
+    page_size = (apr_size_t)sysconf(_SC_PAGESIZE);
+
+  length += start % page_size;
+  start -= start % page_size;
+
+  /* This is merely a hint.  The actual access will fault the pages in. */
+  (void)posix_madvise((void *)start, length, POSIX_MADV_WILLNEED);
+#endif
+}
+
+/* A file or folder watched by an svn_io__file_watch_t. */
+typedef struct watched_path_t
+{
+  /* The path being watched. */
+  const char *path;
+
+  /* Its name within the parent folder, in the native encoding. */
+  const char *name_apr;
+
+  /* State of the path as of the last time we reported a change.
+   * Only used when polling.  EXISTS is FALSE if there was nothing. */
+  svn_boolean_t exists;
+  apr_time_t mtime;
+  apr_off_t size;
+  apr_ino_t inode;
+
+#ifdef __linux__
+  /* inotify watch descriptors for the parent folder and, if PATH is a
+   * folder, for PATH itself.  -1 if not watched. */
+  int parent_wd;
+  int dir_wd;
+#endif
+} watched_path_t;
+
+struct svn_io__file_watch_t
+{
+  /* The paths being watched, as watched_path_t. */
+  apr_array_header_t *paths;
+
+#ifdef __linux__
+  /* inotify instance watching all PATHS.  -1 if we have to poll. */
+  int inotify_fd;
+#endif
+};
+
+/* Set the stamp members of WATCHED to the current state of the watched
+ * path.  Set *CHANGED to TRUE if that differs from the previous state.
+ * Set *IS_DIR to TRUE if the path is a folder.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+update_watched_path_stamp(svn_boolean_t *changed,
+                          svn_boolean_t *is_dir,
+                          watched_path_t *watched,
+                          apr_pool_t *scratch_pool)
+{
+  const char *path_apr;
+  apr_finfo_t finfo;
+  apr_status_t status;
+
+  SVN_ERR(cstring_from_utf8(&path_apr, watched->path, scratch_pool));
+  status = apr_stat(&finfo, path_apr,
+                    APR_FINFO_TYPE | APR_FINFO_MTIME | APR_FINFO_SIZE
+                    | APR_FINFO_INODE,
+                    scratch_pool);
+
+  /* Not all platforms can tell us the inode. */
+  if (status == APR_INCOMPLETE && !(finfo.valid & APR_FINFO_INODE))
+    {
+      finfo.inode = 0;
+      status = APR_SUCCESS;
+    }
+
+  *is_dir = FALSE;
+  if (APR_STATUS_IS_ENOENT(status) || SVN__APR_STATUS_IS_ENOTDIR(status))
+    {
+      *changed = watched->exists;
+      watched->exists = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't stat '%s'"),
+                              svn_dirent_local_style(watched->path,
+                                                     scratch_pool));
+
+  /* Adding, removing or renaming entries in a folder updates its mtime. */
+  *changed = !watched->exists
+          || watched->mtime != finfo.mtime
+          || watched->size != finfo.size
+          || watched->inode != finfo.inode;
+  *is_dir = finfo.filetype == APR_DIR;
+
+  watched->exists = TRUE;
+  watched->mtime = finfo.mtime;
+  watched->size = finfo.size;
+  watched->inode = finfo.inode;
+
+  return SVN_NO_ERROR;
+}
+
+/* Update the stamps of all paths in WATCH.  Set *CHANGED to TRUE if any
+ * of them changed.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+update_file_watch_stamps(svn_boolean_t *changed,
+                         svn_io__file_watch_t *watch,
+                         apr_pool_t *scratch_pool)
+{
+  int i;
+
+  *changed = FALSE;
+  for (i = 0; i < watch->paths->nelts; ++i)
+    {
+      svn_boolean_t path_changed, is_dir;
+      SVN_ERR(update_watched_path_stamp(&path_changed, &is_dir,
+                                        &APR_ARRAY_IDX(watch->paths, i,
+                                                       watched_path_t),
+                                        scratch_pool));
+      *changed |= path_changed;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#ifdef __linux__
+
+/* Pool cleanup function closing the inotify instance of the
+ * svn_io__file_watch_t given as DATA. */
+static apr_status_t
+close_file_watch(void *data)
+{
+  svn_io__file_watch_t *watch = data;
+  if (watch->inotify_fd >= 0)
+    close(watch->inotify_fd);
+
+  watch->inotify_fd = -1;
+  return APR_SUCCESS;
+}
+
+/* Return TRUE if EVENT concerns any of the paths in WATCH. */
+static svn_boolean_t
+is_watched_event(const struct inotify_event *event,
+                 svn_io__file_watch_t *watch)
+{
+  int i;
+
+  /* If the kernel dropped events, anything might have changed. */
+  if (event->mask & IN_Q_OVERFLOW)
+    return TRUE;
+
+  for (i = 0; i < watch->paths->nelts; ++i)
+    {
+      const watched_path_t *watched
+        = &APR_ARRAY_IDX(watch->paths, i, watched_path_t);
+
+      if (event->wd == watched->dir_wd)
+        return TRUE;
+
+      if (   event->wd == watched->parent_wd
+          && event->len
+          && !strcmp(event->name, watched->name_apr))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Read all pending events from the inotify instance in WATCH and set
+ * *CHANGED to TRUE if any of them concerns a watched path. */
+static void
+read_file_watch_events(svn_boolean_t *changed,
+                       svn_io__file_watch_t *watch)
+{
+  /* inotify events must be read into suitably aligned buffers. */
+  union
+    {
+      struct inotify_event event;
+      char data[4096];
+    } buffer;
+  ssize_t len;
+
+  *changed = FALSE;
+  while ((len = read(watch->inotify_fd, &buffer, sizeof(buffer))) > 0)
+    {
+      ssize_t pos = 0;
+      while (pos < len)
+        {
+          const struct inotify_event *event
+            = (const struct inotify_event *)(buffer.data + pos);
+
+          if (is_watched_event(event, watch))
+            *changed = TRUE;
+
+          pos += sizeof(*event) + event->len;
+        }
+    }
+}
+
+/* Add an inotify watch for the folder PATH to WATCH and return its
+ * descriptor in *WD.  Set *WD to -1 if that failed, e.g. because we ran
+ * out of watches.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+add_inotify_watch(int *wd,
+                  svn_io__file_watch_t *watch,
+                  const char *path,
+                  apr_pool_t *scratch_pool)
+{
+  const char *path_apr;
+
+  SVN_ERR(cstring_from_utf8(&path_apr, path, scratch_pool));
+  *wd = inotify_add_watch(watch->inotify_fd, path_apr,
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE
+                          | IN_DELETE | IN_MOVED_FROM);
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+svn_error_t *
+svn_io__file_watch_create(svn_io__file_watch_t **watch,
+                          const apr_array_header_t *paths,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_io__file_watch_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  result->paths = apr_array_make(result_pool, paths->nelts,
+                                 sizeof(watched_path_t));
+
+#ifdef __linux__
+  result->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (result->inotify_fd >= 0)
+    apr_pool_cleanup_register(result_pool, result, close_file_watch,
+                              apr_pool_cleanup_null);
+#endif
+
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      const char *path = APR_ARRAY_IDX(paths, i, const char *);
+      watched_path_t *watched = apr_array_push(result->paths);
+      svn_boolean_t changed, is_dir;
+
+      svn_pool_clear(iterpool);
+
+      watched->path = apr_pstrdup(result_pool, path);
+      SVN_ERR(cstring_from_utf8(&watched->name_apr,
+                                svn_dirent_basename(path, iterpool),
+                                result_pool));
+
+      /* Record the initial state for polling. */
+      watched->exists = FALSE;
+      SVN_ERR(update_watched_path_stamp(&changed, &is_dir, watched,
+                                        iterpool));
+
+#ifdef __linux__
+      watched->parent_wd = -1;
+      watched->dir_wd = -1;
+      if (result->inotify_fd >= 0)
+        {
+          /* The path itself may get replaced, which would end a watch on
+           * it.  Watch its parent folder instead and filter by name.
+           * inotify returns the same descriptor for the same folder. */
+          SVN_ERR(add_inotify_watch(&watched->parent_wd, result,
+                                    svn_dirent_dirname(path, iterpool),
+                                    iterpool));
+
+          /* For folders, we also want to know about their entries. */
+          if (watched->parent_wd >= 0 && is_dir)
+            SVN_ERR(add_inotify_watch(&watched->dir_wd, result, path,
+                                      iterpool));
+
+          /* E.g. when running out of watches, fall back to polling. */
+          if (watched->parent_wd < 0 || (is_dir && watched->dir_wd < 0))
+            close_file_watch(result);
+        }
+#endif
+    }
+
+  svn_pool_destroy(iterpool);
+
+  *watch = result;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_io__file_watch_wait(svn_boolean_t *changed,
+                        svn_io__file_watch_t *watch,
+                        apr_interval_time_t timeout,
+                        apr_pool_t *scratch_pool)
+{
+#ifdef __linux__
+  if (watch->inotify_fd >= 0)
+    {
+      apr_time_t deadline = apr_time_now() + timeout;
+      apr_interval_time_t remaining = timeout;
+
+      /* Other files in the same folders may wake us up as well. */
+      do
+        {
+          struct pollfd fds = { 0 };
+          fds.fd = watch->inotify_fd;
+          fds.events = POLLIN;
+
+          if (poll(&fds, 1, (int)apr_time_msec(remaining)) > 0)
+            {
+              read_file_watch_events(changed, watch);
+              if (*changed)
+                return SVN_NO_ERROR;
+            }
+
+          remaining = deadline - apr_time_now();
+        }
+      while (remaining > 0);
+
+      *changed = FALSE;
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  /* Report changes made before this call right away. */
+  SVN_ERR(update_file_watch_stamps(changed, watch, scratch_pool));
+  if (!*changed)
+    {
+      apr_sleep(timeout);
+      SVN_ERR(update_file_watch_stamps(changed, watch, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_io__flush_file_system(const char *path,
+                          apr_pool_t *scratch_pool)
+{
+#if defined(__linux__) && defined(SYS_syncfs)
+  apr_file_t *dir;
+  apr_os_file_t fd;
+
+  SVN_ERR(svn_io_file_open(&dir, path, APR_READ, APR_OS_DEFAULT,
+                           scratch_pool));
+  apr_os_file_get(&fd, dir);
+
+  if (syscall(SYS_syncfs, fd))
+    {
+      apr_status_t status = apr_get_os_error();
+      svn_error_clear(svn_io_file_close(dir, scratch_pool));
+      return svn_error_wrap_apr(status, _("Can't flush '%s'"),
+                                svn_dirent_local_style(path,
+                                                       scratch_pool));
+    }
+
+  SVN_ERR(svn_io_file_close(dir, scratch_pool));
+#elif !defined(WIN32)
+  sync();
+#else
+  /* Windows can only flush individual files or whole volumes, the latter
+     requiring administrative privileges. */
+  return svn_error_createf(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                           _("Can't flush '%s': not supported on this "
+                             "platform"),
+                           svn_dirent_local_style(path, scratch_pool));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_io_file_write(apr_file_t *file, const void *buf,
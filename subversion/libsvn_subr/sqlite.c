@@ -73,6 +73,13 @@ extern int (*const svn_sqlite3__api_config)(int, ...);
 #define SQLITE_DETERMINISTIC 0
 #endif
 
+/* Maximum number of bytes of a database file that SQLite may access through
+   a memory mapping once svn_sqlite__enable_mmap() has been called.  Define
+   as 0 to always use read() / write(). */
+#ifndef SVN_SQLITE_MMAP_SIZE
+#define SVN_SQLITE_MMAP_SIZE 268435456
+#endif
+
 #ifdef SVN_UNICODE_NORMALIZATION_FIXES
 /* Limit the length of a GLOB or LIKE pattern. */
 #ifndef SQLITE_MAX_LIKE_PATTERN_LENGTH
@@ -1543,6 +1550,18 @@ wrapped_func(sqlite3_context *context,
 }
 
 
+svn_error_t *
+svn_sqlite__enable_mmap(svn_sqlite__db_t *db)
+{
+#if SVN_SQLITE_MMAP_SIZE > 0
+  /* Not fatal if mmap support was compiled out of SQLite. */
+  svn_error_clear(exec_sql(db, "PRAGMA mmap_size = "
+                               APR_STRINGIFY(SVN_SQLITE_MMAP_SIZE) ";"));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_sqlite__create_scalar_function(svn_sqlite__db_t *db,
                                    const char *func_name,
@@ -140,6 +140,7 @@ cleanup_internal(svn_wc__db_t *db,
                                            FALSE /* get_all */,
                                            FALSE /* no_ignore */,
                                            FALSE /* ignore_text_mods */,
+                                           FALSE /* skip_unversioned */,
                                            NULL /* ignore patterns */,
                                            status_dummy_callback, NULL,
                                            cancel_func, cancel_baton,
@@ -506,6 +506,7 @@ svn_wc__diff7(const char **root_relpath,
                                        get_all,
                                        TRUE /* no_ignore */,
                                        FALSE /* ignore_text_mods */,
+                                       FALSE /* skip_unversioned */,
                                        NULL /* ignore_patterns */,
                                        diff_status_callback, &eb,
                                        cancel_func, cancel_baton,
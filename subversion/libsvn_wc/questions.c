@@ -706,7 +706,9 @@ svn_wc__node_has_local_mods(svn_boolean_t *modified,
 
   err = svn_wc__internal_walk_status(db, local_abspath,
                                      svn_depth_infinity,
-                                     FALSE, FALSE, FALSE, NULL,
+                                     FALSE, FALSE, FALSE,
+                                     ignore_unversioned /* skip_unversioned */,
+                                     NULL,
                                      modcheck_callback, &modcheck_baton,
                                      cancel_func, cancel_baton,
                                      scratch_pool);
@@ -29,6 +29,8 @@
 #include <apr_pools.h>
 #include <apr_file_io.h>
 #include <apr_hash.h>
+#include <apr_thread_cond.h>
+#include <apr_thread_pool.h>
 
 #include "svn_pools.h"
 #include "svn_types.h"
@@ -47,6 +49,8 @@
 #include "wc.h"
 #include "props.h"
 
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_wc_private.h"
 #include "private/svn_fspath.h"
@@ -91,6 +95,10 @@ struct walk_status_baton
   /* Scan the working copy for local modifications and missing nodes. */
   svn_boolean_t check_working_copy;
 
+  /* Only look at the on-disk state of versioned nodes, i.e. don't list
+     directories and don't report unversioned children. */
+  svn_boolean_t skip_unversioned;
+
   /* Externals info harvested during the status run. */
   apr_hash_t *externals;
 
@@ -1023,6 +1031,399 @@ send_unversioned_item(const struct walk_status_baton *wb,
   return SVN_NO_ERROR;
 }
 
+/* Reading a directory through svn_io_get_dirents3() returns size and
+   timestamp of its entries without additional system calls on some
+   platforms.  On all others, APR has to stat() each entry separately. */
+#if defined(WIN32) || defined(__OS2__)
+#define DIRENTS_HAVE_STAT_DATA 1
+#else
+#define DIRENTS_HAVE_STAT_DATA 0
+#endif
+
+/* Minimum number of files per thread that we want to stat.  Directories
+   with fewer files get processed by the calling thread alone because the
+   synchronization overhead would outweigh the gains. */
+#define CONCURRENT_STAT_THRESHOLD 64
+
+/* Maximum number of threads used to stat files throughout the process.
+   This is about hiding I/O latency (e.g. on network file systems), not
+   about CPU usage, so it can exceed the number of cores. */
+#define CONCURRENT_STAT_THREADS 8
+
+/* Number of microseconds that an unused stat thread remains in the pool
+   before being terminated.  Status walks visit many directories in quick
+   succession, so we want to keep the threads around between them. */
+#define STAT_THREAD_IDLE_LIMIT 1000000
+
+/* Set size, timestamp and kind of DIRENT for the node NAME in directory
+   DIR_ABSPATH.  If the node does not exist (anymore), set the kind to
+   svn_node_none.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+stat_dirent(svn_io_dirent2_t *dirent,
+            const char *dir_abspath,
+            const char *name,
+            apr_pool_t *scratch_pool)
+{
+  const svn_io_dirent2_t *disk_dirent;
+
+  SVN_ERR(svn_io_stat_dirent2(&disk_dirent,
+                              svn_dirent_join(dir_abspath, name,
+                                              scratch_pool),
+                              FALSE, TRUE, scratch_pool, scratch_pool));
+
+  dirent->kind = disk_dirent->kind;
+  dirent->special = disk_dirent->special;
+  dirent->filesize = disk_dirent->filesize;
+  dirent->mtime = disk_dirent->mtime;
+
+  return SVN_NO_ERROR;
+}
+
+/* Work shared by the calling thread and the stat threads. */
+typedef struct stat_batch_t
+{
+  /* Directory containing the nodes. */
+  const char *dir_abspath;
+
+  /* Node names and the dirents to update for them, COUNT of each. */
+  const char **names;
+  svn_io_dirent2_t **dirents;
+  int count;
+
+  /* Index of the next entry to process. */
+  volatile svn_atomic_t next;
+
+  /* Number of tasks in the thread pool that did not finish, yet, and the
+     first error that any of them encountered.  Both are protected by
+     MUTEX.  COND gets signalled whenever a task finishes. */
+  int pending;
+  svn_error_t *err;
+  svn_mutex__t *mutex;
+#if APR_HAS_THREADS
+  apr_thread_cond_t *cond;
+#endif
+} stat_batch_t;
+
+/* Process entries of BATCH until none are left or an error occurred.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+stat_batch_entries(stat_batch_t *batch,
+                   apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (TRUE)
+    {
+      int i = (int)svn_atomic_inc(&batch->next);
+      if (i >= batch->count)
+        break;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(stat_dirent(batch->dirents[i], batch->dir_abspath,
+                          batch->names[i], iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Thread pool shared by all stat_dirents() calls within this process. */
+static apr_thread_pool_t *stat_thread_pool = NULL;
+
+/* Keep track on whether we already created STAT_THREAD_POOL. */
+static volatile svn_atomic_t stat_thread_pool_initialized = FALSE;
+
+/* Destructor function that implicitly cleans up any running threads
+   in STAT_THREAD_POOL *once*.  Must be run as a pre-cleanup hook. */
+static apr_status_t
+stat_thread_pool_pre_cleanup(void *data)
+{
+  apr_thread_pool_t *tp = stat_thread_pool;
+  if (!stat_thread_pool)
+    return APR_SUCCESS;
+
+  stat_thread_pool = NULL;
+  stat_thread_pool_initialized = FALSE;
+
+  return apr_thread_pool_destroy(tp);
+}
+
+/* Create STAT_THREAD_POOL.  Implements svn_atomic__err_init_func_t. */
+static svn_error_t *
+create_stat_thread_pool(void *baton,
+                        apr_pool_t *scratch_pool)
+{
+  /* The thread pool must be allocated from a thread-safe pool that lives
+     as long as the process. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+  apr_status_t status = apr_thread_pool_create(&stat_thread_pool, 0,
+                                               CONCURRENT_STAT_THREADS,
+                                               pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create stat thread pool"));
+
+  /* Work around an APR bug:  The cleanup must happen in the pre-cleanup
+     hook instead of the normal cleanup hook.  Otherwise, the sub-pools
+     containing the thread objects would already be invalid. */
+  apr_pool_pre_cleanup_register(pool, NULL, stat_thread_pool_pre_cleanup);
+
+  apr_thread_pool_idle_wait_set(stat_thread_pool, STAT_THREAD_IDLE_LIMIT);
+  apr_thread_pool_threshold_set(stat_thread_pool, 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Thread pool task processing the stat_batch_t given by DATA. */
+static void * APR_THREAD_FUNC
+stat_task(apr_thread_t *tid,
+          void *data)
+{
+  stat_batch_t *batch = data;
+
+  /* Each task needs its own pool hierarchy to be thread-safe. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+  svn_error_t *err = stat_batch_entries(batch, pool);
+  svn_pool_destroy(pool);
+
+  /* As soon as we signalled completion, BATCH may be gone. */
+  if (svn_mutex__lock(batch->mutex) == SVN_NO_ERROR)
+    {
+      if (batch->err)
+        svn_error_clear(err);
+      else
+        batch->err = err;
+
+      --batch->pending;
+      apr_thread_cond_broadcast(batch->cond);
+      svn_error_clear(svn_mutex__unlock(batch->mutex, SVN_NO_ERROR));
+    }
+  else
+    {
+      svn_error_clear(err);
+    }
+
+  return NULL;
+}
+
+/* Run the stat()s in BATCH on the calling thread as well as on up to
+   TASKS tasks in STAT_THREAD_POOL.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+run_concurrent_stats(stat_batch_t *batch,
+                     int tasks,
+                     apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+  apr_status_t status;
+  int i;
+
+  SVN_ERR(svn_atomic__init_once(&stat_thread_pool_initialized,
+                                create_stat_thread_pool, NULL,
+                                scratch_pool));
+  SVN_ERR(svn_mutex__init(&batch->mutex, TRUE, scratch_pool));
+  status = apr_thread_cond_create(&batch->cond, scratch_pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create condition variable"));
+
+  batch->pending = 0;
+  batch->err = SVN_NO_ERROR;
+
+  /* If we can't push some tasks, the remaining ones and this thread will
+     pick up the slack.  Hold the mutex while queueing, so that no task can
+     report completion before we counted it.  Once the first task has been
+     queued, nothing may return early until the last one finished. */
+  SVN_ERR(svn_mutex__lock(batch->mutex));
+  for (i = 0; i < tasks; ++i)
+    {
+      if (apr_thread_pool_push(stat_thread_pool, stat_task, batch, 0, NULL))
+        break;
+
+      ++batch->pending;
+    }
+  err = svn_mutex__unlock(batch->mutex, SVN_NO_ERROR);
+
+  /* Participate and then wait for all tasks to finish.  They reference
+     BATCH, so we must not return before that, even if we failed. */
+  err = svn_error_compose_create(err,
+                                 stat_batch_entries(batch, scratch_pool));
+
+  err = svn_error_compose_create(err, svn_mutex__lock(batch->mutex));
+  while (batch->pending)
+    if (apr_thread_cond_wait(batch->cond, svn_mutex__get(batch->mutex)))
+      break;
+
+  err = svn_error_compose_create(err, batch->err);
+  return svn_error_trace(svn_mutex__unlock(batch->mutex, err));
+}
+
+#endif
+
+/* Update the file entries in DIRENTS, as returned by svn_io_get_dirents3()
+   for DIR_ABSPATH with ONLY_CHECK_TYPE set, with size and timestamp
+   information.  Entries of kind svn_node_unknown get fully stat'ed as
+   well.  Remove entries that don't exist (anymore).
+
+   For large directories, issue the stat() calls from multiple threads so
+   that their latency overlaps.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+stat_dirents(apr_hash_t *dirents,
+             const char *dir_abspath,
+             apr_pool_t *scratch_pool)
+{
+  apr_hash_index_t *hi;
+  stat_batch_t batch = { 0 };
+  int i;
+
+  batch.dir_abspath = dir_abspath;
+  batch.names = apr_palloc(scratch_pool,
+                           apr_hash_count(dirents) * sizeof(*batch.names));
+  batch.dirents = apr_palloc(scratch_pool,
+                             apr_hash_count(dirents)
+                               * sizeof(*batch.dirents));
+  svn_atomic_set(&batch.next, 0);
+
+  /* Directories don't need any information beyond their kind. */
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      if (dirent->kind == svn_node_file || dirent->kind == svn_node_unknown)
+        {
+          batch.names[batch.count] = apr_hash_this_key(hi);
+          batch.dirents[batch.count] = dirent;
+          ++batch.count;
+        }
+    }
+
+#if APR_HAS_THREADS
+  /* The calling thread counts as one worker. */
+  if (batch.count >= 2 * CONCURRENT_STAT_THRESHOLD)
+    SVN_ERR(run_concurrent_stats(&batch,
+                                 MIN(CONCURRENT_STAT_THREADS,
+                                     batch.count / CONCURRENT_STAT_THRESHOLD
+                                       - 1),
+                                 scratch_pool));
+  else
+#endif
+    SVN_ERR(stat_batch_entries(&batch, scratch_pool));
+
+  /* Drop nodes that don't exist on disk. */
+  for (i = 0; i < batch.count; ++i)
+    if (batch.dirents[i]->kind == svn_node_none)
+      svn_hash_sets(dirents, batch.names[i], NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *DIRENTS to the on-disk children of DIR_ABSPATH, like
+   svn_io_get_dirents3() does, or to an empty hash if DIR_ABSPATH does not
+   exist or is not a directory.  Unless ONLY_CHECK_TYPE is set, provide
+   size and timestamp of all files.  Where the directory listing does not
+   provide them for free, fetch them separately, possibly concurrently.
+
+   Allocate *DIRENTS in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+read_dirents(apr_hash_t **dirents,
+             const char *dir_abspath,
+             svn_boolean_t only_check_type,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = svn_io_get_dirents3(dirents, dir_abspath,
+                                         only_check_type
+                                           || !DIRENTS_HAVE_STAT_DATA,
+                                         result_pool, scratch_pool);
+  if (err
+      && (APR_STATUS_IS_ENOENT(err->apr_err)
+          || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+    {
+      svn_error_clear(err);
+      *dirents = apr_hash_make(result_pool);
+      return SVN_NO_ERROR;
+    }
+  else
+    SVN_ERR(err);
+
+#if !DIRENTS_HAVE_STAT_DATA
+  if (!only_check_type)
+    SVN_ERR(stat_dirents(*dirents, dir_abspath, scratch_pool));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *DIRENTS to the on-disk state of all children of DIR_ABSPATH that
+   are listed in NODES or CONFLICTS, as returned by
+   svn_wc__db_read_children_info().  Children that don't exist on disk with
+   exactly that name will not be in *DIRENTS.  ONLY_CHECK_TYPE is as for
+   read_dirents().
+
+   Allocate *DIRENTS in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+stat_versioned_children(apr_hash_t **dirents,
+                        const char *dir_abspath,
+                        apr_hash_t *nodes,
+                        apr_hash_t *conflicts,
+                        svn_boolean_t only_check_type,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  apr_hash_t *all_children = apr_hash_overlay(scratch_pool, conflicts, nodes);
+  apr_hash_index_t *hi;
+
+#if defined(WIN32) || defined(__OS2__) || defined(DARWIN)
+  /* On case-insensitive file systems, a child may exist with a different
+     case than the one we know.  Verifying the true names one by one would
+     list DIR_ABSPATH once per child on some platforms.  Instead, read the
+     directory once and only accept exact matches. */
+  apr_hash_t *on_disk;
+
+  SVN_ERR(read_dirents(&on_disk, dir_abspath,
+                       only_check_type || !DIRENTS_HAVE_STAT_DATA,
+                       scratch_pool, scratch_pool));
+
+  *dirents = apr_hash_make(result_pool);
+  for (hi = apr_hash_first(scratch_pool, all_children);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const svn_io_dirent2_t *dirent
+        = apr_hash_get(on_disk, apr_hash_this_key(hi),
+                       apr_hash_this_key_len(hi));
+      if (dirent)
+        apr_hash_set(*dirents, apr_hash_this_key(hi),
+                     apr_hash_this_key_len(hi),
+                     svn_io_dirent2_dup(dirent, result_pool));
+    }
+
+#if !DIRENTS_HAVE_STAT_DATA
+  if (!only_check_type)
+    SVN_ERR(stat_dirents(*dirents, dir_abspath, scratch_pool));
+#endif
+
+#else
+  /* Names are case-sensitive here, so looking up the children directly
+     is exact and we never need to list DIR_ABSPATH. */
+  *dirents = apr_hash_make(result_pool);
+  for (hi = apr_hash_first(scratch_pool, all_children);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      svn_io_dirent2_t *dirent = svn_io_dirent2_create(result_pool);
+      dirent->kind = svn_node_unknown;
+
+      apr_hash_set(*dirents, apr_hash_this_key(hi),
+                   apr_hash_this_key_len(hi), dirent);
+    }
+
+  SVN_ERR(stat_dirents(*dirents, dir_abspath, scratch_pool));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 get_dir_status(const struct walk_status_baton *wb,
                const char *local_abspath,
@@ -1245,21 +1646,9 @@ get_dir_status(const struct walk_status_baton *wb,
 
   iterpool = svn_pool_create(scratch_pool);
 
-  if (wb->check_working_copy)
-    {
-      err = svn_io_get_dirents3(&dirents, local_abspath,
-                                wb->ignore_text_mods /* only_check_type*/,
-                                scratch_pool, iterpool);
-      if (err
-          && (APR_STATUS_IS_ENOENT(err->apr_err)
-              || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
-        {
-          svn_error_clear(err);
-          dirents = apr_hash_make(scratch_pool);
-        }
-      else
-        SVN_ERR(err);
-    }
+  if (wb->check_working_copy && !wb->skip_unversioned)
+    SVN_ERR(read_dirents(&dirents, local_abspath, wb->ignore_text_mods,
+                         scratch_pool, iterpool));
   else
     dirents = apr_hash_make(scratch_pool);
 
@@ -1283,6 +1672,11 @@ get_dir_status(const struct walk_status_baton *wb,
                                         !wb->check_working_copy,
                                         scratch_pool, iterpool));
 
+  if (wb->check_working_copy && wb->skip_unversioned)
+    SVN_ERR(stat_versioned_children(&dirents, local_abspath,
+                                    nodes, conflicts, wb->ignore_text_mods,
+                                    scratch_pool, iterpool));
+
   all_children = apr_hash_overlay(scratch_pool, nodes, dirents);
   if (apr_hash_count(conflicts) > 0)
     all_children = apr_hash_overlay(scratch_pool, conflicts, all_children);
@@ -2445,6 +2839,7 @@ close_edit(void *edit_baton,
                                        eb->get_all,
                                        eb->no_ignore,
                                        FALSE,
+                                       FALSE,
                                        eb->ignores,
                                        eb->status_func,
                                        eb->status_baton,
@@ -2511,6 +2906,7 @@ svn_wc__get_status_editor(const svn_delta_editor_t **editor,
   eb->wb.target_abspath   = eb->target_abspath;
   eb->wb.ignore_text_mods = !check_working_copy;
   eb->wb.check_working_copy = check_working_copy;
+  eb->wb.skip_unversioned = FALSE;
   eb->wb.repos_locks      = NULL;
   eb->wb.repos_root       = NULL;
 
@@ -2626,6 +3022,7 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
                              svn_boolean_t get_all,
                              svn_boolean_t no_ignore,
                              svn_boolean_t ignore_text_mods,
+                             svn_boolean_t skip_unversioned,
                              const apr_array_header_t *ignore_patterns,
                              svn_wc_status_func4_t status_func,
                              void *status_baton,
@@ -2642,6 +3039,7 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
   wb.target_abspath = local_abspath;
   wb.ignore_text_mods = ignore_text_mods;
   wb.check_working_copy = TRUE;
+  wb.skip_unversioned = skip_unversioned;
   wb.repos_root = NULL;
   wb.repos_locks = NULL;
 
@@ -2756,6 +3154,7 @@ svn_wc_walk_status(svn_wc_context_t *wc_ctx,
                                         get_all,
                                         no_ignore,
                                         ignore_text_mods,
+                                        FALSE /* skip_unversioned */,
                                         ignore_patterns,
                                         status_func,
                                         status_baton,
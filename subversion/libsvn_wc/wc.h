@@ -519,7 +519,13 @@ svn_wc__internal_changelist_match(svn_wc__db_t *db,
                                   const apr_hash_t *clhash,
                                   apr_pool_t *scratch_pool);
 
-/* Library-internal version of svn_wc_walk_status(), which see. */
+/* Library-internal version of svn_wc_walk_status(), which see.
+
+   If SKIP_UNVERSIONED is TRUE, don't list the on-disk directories below
+   LOCAL_ABSPATH but only check the nodes known to the working copy
+   database.  Unversioned nodes below LOCAL_ABSPATH will then not be
+   reported.  This saves a lot of I/O when they don't matter to the
+   caller anyway. */
 svn_error_t *
 svn_wc__internal_walk_status(svn_wc__db_t *db,
                              const char *local_abspath,
@@ -527,6 +533,7 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
                              svn_boolean_t get_all,
                              svn_boolean_t no_ignore,
                              svn_boolean_t ignore_text_mods,
+                             svn_boolean_t skip_unversioned,
                              const apr_array_header_t *ignore_patterns,
                              svn_wc_status_func4_t status_func,
                              void *status_baton,
@@ -150,6 +150,80 @@ svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
   return SVN_NO_ERROR;
 }
 
+/* Pristine texts at least this large will be dropped from the OS page
+ * cache once their read stream has been closed.  Nobody is going to read
+ * them again soon and they would only displace the working files. */
+#define PRISTINE_EVICT_THRESHOLD (1024 * 1024)
+
+/* Baton for a pristine read stream that evicts the file contents from
+ * the page cache when being closed. */
+typedef struct evicting_stream_baton_t
+{
+  /* The stream reading from FILE. */
+  svn_stream_t *inner;
+
+  /* The pristine file. */
+  apr_file_t *file;
+} evicting_stream_baton_t;
+
+/* Implements svn_read_fn_t for evicting_stream_baton_t. */
+static svn_error_t *
+evicting_read(void *baton,
+              char *buffer,
+              apr_size_t *len)
+{
+  evicting_stream_baton_t *esb = baton;
+  return svn_error_trace(svn_stream_read_full(esb->inner, buffer, len));
+}
+
+/* Implements svn_stream_skip_fn_t for evicting_stream_baton_t. */
+static svn_error_t *
+evicting_skip(void *baton,
+              apr_size_t len)
+{
+  evicting_stream_baton_t *esb = baton;
+  return svn_error_trace(svn_stream_skip(esb->inner, len));
+}
+
+/* Implements svn_stream_mark_fn_t for evicting_stream_baton_t. */
+static svn_error_t *
+evicting_mark(void *baton,
+              svn_stream_mark_t **mark,
+              apr_pool_t *pool)
+{
+  evicting_stream_baton_t *esb = baton;
+  return svn_error_trace(svn_stream_mark(esb->inner, mark, pool));
+}
+
+/* Implements svn_stream_seek_fn_t for evicting_stream_baton_t. */
+static svn_error_t *
+evicting_seek(void *baton,
+              const svn_stream_mark_t *mark)
+{
+  evicting_stream_baton_t *esb = baton;
+  return svn_error_trace(svn_stream_seek(esb->inner, mark));
+}
+
+/* Implements svn_stream_data_available_fn_t for evicting_stream_baton_t. */
+static svn_error_t *
+evicting_data_available(void *baton,
+                        svn_boolean_t *data_available)
+{
+  evicting_stream_baton_t *esb = baton;
+  return svn_error_trace(svn_stream_data_available(esb->inner,
+                                                   data_available));
+}
+
+/* Implements svn_close_fn_t for evicting_stream_baton_t. */
+static svn_error_t *
+evicting_close(void *baton)
+{
+  evicting_stream_baton_t *esb = baton;
+
+  svn_io__file_evict(esb->file, 0, 0);
+  return svn_error_trace(svn_stream_close(esb->inner));
+}
+
 /* Set *CONTENTS to a readable stream from which the pristine text
  * identified by SHA1_CHECKSUM and PRISTINE_ABSPATH can be read from the
  * pristine store of WCROOT.  If SIZE is not null, set *SIZE to the size
@@ -176,6 +250,7 @@ pristine_read_txn(svn_stream_t **contents,
 {
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  svn_filesize_t pristine_size;
 
   /* Check that this pristine text is present in the store.  (The presence
    * of the file is not sufficient.) */
@@ -184,8 +259,9 @@ pristine_read_txn(svn_stream_t **contents,
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
   SVN_ERR(svn_sqlite__step(&have_row, stmt));
 
+  pristine_size = svn_sqlite__column_int64(stmt, 0);
   if (size)
-    *size = svn_sqlite__column_int64(stmt, 0);
+    *size = pristine_size;
 
   SVN_ERR(svn_sqlite__reset(stmt));
   if (! have_row)
@@ -202,13 +278,34 @@ pristine_read_txn(svn_stream_t **contents,
    * We also don't enable APR_BUFFERED on this file to maximize throughput
    * e.g. for fulltext comparison.  As we use SVN__STREAM_CHUNK_SIZE buffers
    * where needed in streams, there is no point in having another layer of
-   * buffers. */
+   * buffers.
+   *
+   * Large texts get dropped from the page cache once the stream has been
+   * closed, so that e.g. a status crawl over a big working copy does not
+   * keep twice the amount of file data in memory. */
   if (contents)
     {
       apr_file_t *file;
       SVN_ERR(svn_io_file_open(&file, pristine_abspath, APR_READ,
                                APR_OS_DEFAULT, result_pool));
       *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+
+      if (pristine_size >= PRISTINE_EVICT_THRESHOLD)
+        {
+          evicting_stream_baton_t *esb = apr_pcalloc(result_pool,
+                                                     sizeof(*esb));
+          esb->inner = *contents;
+          esb->file = file;
+
+          *contents = svn_stream_create(esb, result_pool);
+          svn_stream_set_read2(*contents, NULL /* only full read support */,
+                               evicting_read);
+          svn_stream_set_skip(*contents, evicting_skip);
+          svn_stream_set_mark(*contents, evicting_mark);
+          svn_stream_set_seek(*contents, evicting_seek);
+          svn_stream_set_data_available(*contents, evicting_data_available);
+          svn_stream_set_close(*contents, evicting_close);
+        }
     }
 
   return SVN_NO_ERROR;
@@ -470,6 +470,7 @@ run_file_install(work_item_baton_t *wqb,
   apr_hash_t *keywords;
   const char *temp_dir_abspath;
   svn_stream_t *dst_stream;
+  svn_boolean_t translate;
   apr_int64_t val;
   const char *wcroot_abspath;
   const char *source_abspath;
@@ -552,9 +553,10 @@ run_file_install(work_item_baton_t *wqb,
       return SVN_NO_ERROR;
     }
 
-  if (svn_subst_translation_required(style, eol, keywords,
-                                     FALSE /* special */,
-                                     TRUE /* force_eol_check */))
+  translate = svn_subst_translation_required(style, eol, keywords,
+                                             FALSE /* special */,
+                                             TRUE /* force_eol_check */);
+  if (translate)
     {
       /* Wrap it in a translating (expanding) stream.  */
       src_stream = svn_subst_stream_translated(src_stream, eol,
@@ -575,11 +577,26 @@ run_file_install(work_item_baton_t *wqb,
   SVN_ERR(svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
                                          scratch_pool, scratch_pool));
 
-  /* Copy from the source to the dest, translating as we go. This will also
-     close both streams.  */
-  SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
-                           cancel_func, cancel_baton,
-                           scratch_pool));
+  if (!translate)
+    {
+      /* The working file is a plain copy of the pristine.  Let the OS do
+         the copy; on file systems that support reflinks, both files will
+         then share their data blocks instead of doubling the disk usage. */
+      SVN_ERR(svn_io__file_copy_contents(svn_stream__aprfile(src_stream),
+                                         svn_stream__aprfile(dst_stream),
+                                         cancel_func, cancel_baton,
+                                         scratch_pool));
+      SVN_ERR(svn_stream_close(src_stream));
+      SVN_ERR(svn_stream_close(dst_stream));
+    }
+  else
+    {
+      /* Copy from the source to the dest, translating as we go. This will
+         also close both streams.  */
+      SVN_ERR(svn_stream_copy3(src_stream, dst_stream,
+                               cancel_func, cancel_baton,
+                               scratch_pool));
+    }
 
   /* All done. Move the file into place.  */
   /* With a single db we might want to install files in a missing directory.
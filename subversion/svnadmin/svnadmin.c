@@ -49,6 +49,8 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_fspath.h"
+#include "private/svn_io_private.h"
+#include "private/svn_repos_private.h"
 
 #include "svn_private_config.h"
 
@@ -121,7 +123,8 @@ static svn_opt_subcommand_t
   subcommand_setuuid,
   subcommand_unlock,
   subcommand_upgrade,
-  subcommand_verify;
+  subcommand_verify,
+  subcommand_warm_cache;
 
 enum svnadmin__cmdline_options_t
   {
@@ -155,7 +158,8 @@ enum svnadmin__cmdline_options_t
     svnadmin__normalize_props,
     svnadmin__exclude,
     svnadmin__include,
-    svnadmin__glob
+    svnadmin__glob,
+    svnadmin__follow
   };
 
 /* Option codes and descriptions.
@@ -294,6 +298,10 @@ static const apr_getopt_option_t options_table[] =
         "                             Character '/' is not treated specially, so\n"
         "                             pattern /*/foo matches paths /a/foo and /a/b/foo.") },
 
+    {"follow", svnadmin__follow, 0,
+     N_("keep running and copy new revisions as soon as\n"
+        "                             they appear in the source (implies --incremental)")},
+
     {NULL}
   };
 
@@ -411,8 +419,13 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
     "Make a hot copy of a repository.\n"
     "If --incremental is passed, data which already exists at the destination\n"
     "is not copied again.  Incremental mode is implemented for FSFS repositories.\n"
+    "\n"), N_(
+    "If --follow is passed, keep the copy up to date until interrupted:\n"
+    "whenever the source repository changes, copy the new data incrementally\n"
+    "and flush it to disk where supported.  This is useful for warm-standby\n"
+    "replicas.\n"
    )},
-   {svnadmin__clean_logs, svnadmin__incremental, 'q'} },
+   {svnadmin__clean_logs, svnadmin__incremental, svnadmin__follow, 'q'} },
 
   {"info", subcommand_info, {0}, {N_(
     "usage: svnadmin info REPOS_PATH\n"
@@ -604,6 +617,23 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
     svnadmin__check_normalization, svnadmin__metadata_only} },
 
+  {"warm-cache", subcommand_warm_cache, {0}, {N_(
+    "usage: svnadmin warm-cache REPOS_PATH [PATH-IN-REPOS...]\n"
+    "\n"), N_(
+    "Read the latest file contents under the given repository paths\n"
+    "(default: the whole tree) to populate the shared caches of the\n"
+    "repository, i.e. memcached or the persistent cache configured in\n"
+    "fsfs.conf.  Only file contents and delta windows get stored there.\n"
+    "If a revision range is given, also read the content changes of the\n"
+    "older revisions in that range.  Stop once the data added to the\n"
+    "memory cache reaches the cache size given by -M.\n"
+    "\n"), N_(
+    "Without memcached or a persistent cache, this has no lasting effect.\n"
+    "Use 'svnserve --warm-cache' to also warm directory and property\n"
+    "caches of the server process itself.\n"
+   )},
+   {'r', 'q', 'M'} },
+
   { NULL, NULL, {0}, {NULL}, {0} }
 };
 
@@ -645,18 +675,21 @@ struct svnadmin_opt_state
   apr_array_header_t *exclude;                      /* --exclude */
   apr_array_header_t *include;                      /* --include */
   svn_boolean_t glob;                               /* --pattern */
+  svn_boolean_t follow;                             /* --follow */
 
   const char *config_dir;    /* Overriding Configuration Directory */
 };
 
 
 /* Helper to open a repository and set a warning func (so we don't
- * SEGFAULT when libsvn_fs's default handler gets run).  */
+ * SEGFAULT when libsvn_fs's default handler gets run).  Unless CACHE_NS
+ * is NULL, it will be used as namespace for the cached data.  */
 static svn_error_t *
-open_repos(svn_repos_t **repos,
-           const char *path,
-           struct svnadmin_opt_state *opt_state,
-           apr_pool_t *pool)
+open_repos_in_ns(svn_repos_t **repos,
+                 const char *path,
+                 const char *cache_ns,
+                 struct svnadmin_opt_state *opt_state,
+                 apr_pool_t *pool)
 {
   /* Enable the "block-read" feature (where it applies)? */
   svn_boolean_t use_block_read
@@ -668,8 +701,8 @@ open_repos(svn_repos_t **repos,
   svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_FULLTEXTS, "1");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NODEPROPS, "1");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_REVPROPS, "2");
-  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
-                           svn_uuid_generate(pool));
+  if (cache_ns)
+    svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS, cache_ns);
   svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ,
                            use_block_read ? "1" : "0");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
@@ -681,6 +714,19 @@ open_repos(svn_repos_t **repos,
   return SVN_NO_ERROR;
 }
 
+/* Like open_repos_in_ns() but using a new, unique cache namespace.
+ * Thus, we won't share potentially outdated data with other processes. */
+static svn_error_t *
+open_repos(svn_repos_t **repos,
+           const char *path,
+           struct svnadmin_opt_state *opt_state,
+           apr_pool_t *pool)
+{
+  return svn_error_trace(open_repos_in_ns(repos, path,
+                                          svn_uuid_generate(pool),
+                                          opt_state, pool));
+}
+
 
 /* Set *REVNUM to the revision specified by REVISION (or to
    SVN_INVALID_REVNUM if that has the type 'unspecified'),
@@ -1058,6 +1104,18 @@ repos_notify_handler(void *baton,
                                         notify->revision));
       return;
 
+    case svn_repos_notify_warm_cache_rev_end:
+      svn_error_clear(svn_stream_printf(feedback_stream, scratch_pool,
+                                        _("* Cached revision %ld.\n"),
+                                        notify->revision));
+      return;
+
+    case svn_repos_notify_warm_cache_full:
+      svn_error_clear(svn_stream_printf(feedback_stream, scratch_pool,
+                        _("* Cache budget used up at revision %ld.\n"),
+                        notify->revision));
+      return;
+
     case svn_repos_notify_verify_rev_structure:
       if (notify->revision == SVN_INVALID_REVNUM)
         svn_error_clear(svn_stream_puts(feedback_stream,
@@ -2325,6 +2383,134 @@ subcommand_verify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Interval in milliseconds at which "hotcopy --follow" checks for
+ * cancellation while waiting for changes in the source repository. */
+#define FOLLOW_POLL_INTERVAL 1000
+
+/* Run an incremental hotcopy pass after at most this many poll intervals,
+ * even if we did not see any change.  This is merely a safety net in case
+ * the source repository changed in ways that we don't watch for. */
+#define FOLLOW_MAX_IDLE_INTERVALS 60
+
+/* Set *PATHS to the files and folders in the repository at REPOS_PATH
+ * that change whenever there is new data to hotcopy: "current" for new
+ * revisions, "min-unpacked-rev" for packs and the revprop folder plus all
+ * its shards for revprop changes.  Allocate *PATHS in RESULT_POOL and use
+ * SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_follow_watch_paths(apr_array_header_t **paths,
+                       const char *repos_path,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  const char *db_path = svn_dirent_join(repos_path, "db", scratch_pool);
+  const char *revprops_path = svn_dirent_join(db_path, "revprops",
+                                              result_pool);
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  svn_error_t *err;
+
+  *paths = apr_array_make(result_pool, 3, sizeof(const char *));
+  APR_ARRAY_PUSH(*paths, const char *)
+    = svn_dirent_join(db_path, "current", result_pool);
+  APR_ARRAY_PUSH(*paths, const char *)
+    = svn_dirent_join(db_path, "min-unpacked-rev", result_pool);
+  APR_ARRAY_PUSH(*paths, const char *) = revprops_path;
+
+  /* Revprop changes replace files within the (packed) shard folders. */
+  err = svn_io_get_dirents3(&dirents, revprops_path, TRUE,
+                            scratch_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      if (dirent->kind == svn_node_dir)
+        APR_ARRAY_PUSH(*paths, const char *)
+          = svn_dirent_join(revprops_path, apr_hash_this_key(hi),
+                            result_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement "hotcopy --follow": Incrementally hotcopy the repository at
+ * SRC_PATH to DST_PATH, then wait for the source to change and repeat
+ * until cancelled.  OPT_STATE and FEEDBACK_STREAM are as for the normal
+ * hotcopy.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+hotcopy_follow(const char *src_path,
+               const char *dst_path,
+               struct svnadmin_opt_state *opt_state,
+               svn_stream_t *feedback_stream,
+               apr_pool_t *scratch_pool)
+{
+  svn_repos_t *src_repos;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *waitpool = svn_pool_create(scratch_pool);
+
+  /* Keep the source open across all passes. */
+  SVN_ERR(open_repos(&src_repos, src_path, opt_state, scratch_pool));
+
+  while (TRUE)
+    {
+      apr_array_header_t *paths;
+      svn_io__file_watch_t *watch;
+      svn_boolean_t changed = FALSE;
+      svn_error_t *err;
+      int i;
+
+      svn_pool_clear(iterpool);
+
+      /* Start watching before the pass, so that changes during the pass
+       * will trigger another one.  Commits and packs add new shards, so
+       * look for them every time. */
+      SVN_ERR(get_follow_watch_paths(&paths, src_path, iterpool, iterpool));
+      SVN_ERR(svn_io__file_watch_create(&watch, paths, iterpool, iterpool));
+
+      SVN_ERR(svn_repos__hotcopy_from(src_repos, dst_path,
+                                      opt_state->clean_logs, TRUE,
+                                      !opt_state->quiet ? repos_notify_handler
+                                                        : NULL,
+                                      feedback_stream, check_cancel, NULL,
+                                      iterpool));
+
+      /* A single flush is much cheaper than fsync'ing every copied file.
+       * Where that is not available, we are no worse off than a normal
+       * hotcopy, which does not fsync the files it copies, either. */
+      err = svn_io__flush_file_system(dst_path, iterpool);
+      if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+        svn_error_clear(err);
+      else
+        SVN_ERR(err);
+
+      /* Tell the user, and scripts waiting for us, that the copy is
+       * complete and consistent now. */
+      if (feedback_stream)
+        {
+          SVN_ERR(svn_stream_puts(feedback_stream,
+                                  _("* Finished hotcopy pass; "
+                                    "waiting for changes.\n")));
+          SVN_ERR(svn_cmdline_fflush(stdout));
+        }
+
+      for (i = 0; i < FOLLOW_MAX_IDLE_INTERVALS && !changed; ++i)
+        {
+          svn_pool_clear(waitpool);
+          SVN_ERR(check_cancel(NULL));
+          SVN_ERR(svn_io__file_watch_wait(&changed, watch,
+                                    apr_time_from_msec(FOLLOW_POLL_INTERVAL),
+                                    waitpool));
+        }
+    }
+  /* NOTREACHED */
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 svn_error_t *
 subcommand_hotcopy(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -2343,6 +2529,11 @@ subcommand_hotcopy(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   if (! opt_state->quiet)
     feedback_stream = recode_stream_create(stdout, pool);
 
+  if (opt_state->follow)
+    return svn_error_trace(hotcopy_follow(opt_state->repository_path,
+                                          new_repos_path, opt_state,
+                                          feedback_stream, pool));
+
   return svn_repos_hotcopy3(opt_state->repository_path, new_repos_path,
                             opt_state->clean_logs, opt_state->incremental,
                             !opt_state->quiet ? repos_notify_handler : NULL,
@@ -2806,6 +2997,54 @@ subcommand_upgrade(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 }
 
 
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_warm_cache(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  apr_array_header_t *targets;
+  svn_revnum_t youngest, lower, upper;
+  svn_stream_t *feedback_stream = NULL;
+  int i;
+
+  SVN_ERR(svn_opt__args_to_target_array(&targets, os,
+                                        apr_array_make(pool, 0,
+                                                       sizeof(const char *)),
+                                        pool));
+  for (i = 0; i < targets->nelts; ++i)
+    SVN_ERR(target_arg_to_fspath(&APR_ARRAY_IDX(targets, i, const char *),
+                                 APR_ARRAY_IDX(targets, i, const char *),
+                                 pool, pool));
+
+  /* Don't use a private cache namespace here.  The whole point is to fill
+     the caches that other processes will use. */
+  SVN_ERR(open_repos_in_ns(&repos, opt_state->repository_path, NULL,
+                           opt_state, pool));
+  SVN_ERR(svn_fs_youngest_rev(&youngest, svn_repos_fs(repos), pool));
+
+  /* Find the revision numbers at which to start and end. */
+  SVN_ERR(get_revnum(&lower, &opt_state->start_revision,
+                     youngest, repos, pool));
+  SVN_ERR(get_revnum(&upper, &opt_state->end_revision,
+                     youngest, repos, pool));
+  if (upper == SVN_INVALID_REVNUM)
+    upper = lower;
+
+  if (!opt_state->quiet)
+    feedback_stream = recode_stream_create(stdout, pool);
+
+  /* Only the file contents will outlive this process. */
+  return svn_error_trace(svn_repos_warm_cache(repos, targets, lower, upper,
+                                              0, TRUE,
+                                              !opt_state->quiet
+                                                ? repos_notify_handler
+                                                : NULL,
+                                              feedback_stream,
+                                              check_cancel, NULL, pool));
+}
+
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_delrevprop(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -3078,6 +3317,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__no_flush_to_disk:
         opt_state.no_flush_to_disk = TRUE;
         break;
+      case svnadmin__follow:
+        opt_state.follow = TRUE;
+        break;
       case svnadmin__normalize_props:
         opt_state.normalize_props = TRUE;
         break;
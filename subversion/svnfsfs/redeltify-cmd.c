@@ -0,0 +1,119 @@
+/* redeltify-cmd.c -- implements the redeltify sub-command.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_fs.h"
+#include "svn_pools.h"
+#include "private/svn_string_private.h"
+#include "private/svn_fs_fs_private.h"
+
+#include "svn_private_config.h"
+
+#include "svnfsfs.h"
+
+/* Implements svn_fs_fs__redeltify_notify_t, printing the results for the
+ * shard described by INFO to the console.
+ */
+static void
+print_shard_info(const svn_fs_fs__redeltify_info_t *info,
+                 void *baton,
+                 apr_pool_t *scratch_pool)
+{
+  printf(_("Shard r%ld: %s of %s file reps redeltified\n"
+           "  delta chain length sum %s -> %s, max %s -> %s\n"
+           "  size %s -> %s bytes\n"),
+         info->shard_rev,
+         svn__ui64toa_sep(info->redeltified_count, ',', scratch_pool),
+         svn__ui64toa_sep(info->rep_count, ',', scratch_pool),
+         svn__ui64toa_sep(info->chain_len_before, ',', scratch_pool),
+         svn__ui64toa_sep(info->chain_len_after, ',', scratch_pool),
+         svn__ui64toa_sep(info->max_chain_len_before, ',', scratch_pool),
+         svn__ui64toa_sep(info->max_chain_len_after, ',', scratch_pool),
+         svn__ui64toa_sep(info->size_before, ',', scratch_pool),
+         svn__ui64toa_sep(info->size_after, ',', scratch_pool));
+  fflush(stdout);
+}
+
+/* Set *REVNUM to the revision number given by REVISION in FS.  Use
+ * DEFAULT_VALUE if REVISION has not been specified.  Use POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+get_revnum(svn_revnum_t *revnum,
+           const svn_opt_revision_t *revision,
+           svn_revnum_t default_value,
+           svn_fs_t *fs,
+           apr_pool_t *pool)
+{
+  switch (revision->kind)
+    {
+      case svn_opt_revision_unspecified:
+        *revnum = default_value;
+        break;
+
+      case svn_opt_revision_number:
+        *revnum = revision->value.number;
+        break;
+
+      case svn_opt_revision_head:
+        SVN_ERR(svn_fs_youngest_rev(revnum, fs, pool));
+        break;
+
+      default:
+        return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                _("Only revision numbers and HEAD are"
+                                  " supported"));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+svn_error_t *
+subcommand__redeltify(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+  svn_fs_t *fs;
+  svn_revnum_t youngest;
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+
+  SVN_ERR(open_fs(&fs, opt_state->repository_path, pool));
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+
+  /* Default to the whole repository.  A single revision selects the
+   * shard containing it. */
+  SVN_ERR(get_revnum(&start_rev, &opt_state->start_revision, 0, fs, pool));
+  SVN_ERR(get_revnum(&end_rev, &opt_state->end_revision,
+                     opt_state->start_revision.kind
+                       == svn_opt_revision_unspecified ? youngest : start_rev,
+                     fs, pool));
+  if (start_rev > end_rev)
+    return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                             _("Invalid revision range %ld:%ld"),
+                             start_rev, end_rev);
+
+  SVN_ERR(svn_fs_fs__redeltify(fs, start_rev, end_rev,
+                               opt_state->quiet ? NULL : print_shard_info,
+                               NULL, check_cancel, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
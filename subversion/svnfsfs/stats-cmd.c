@@ -369,6 +369,83 @@ print_histograms_by_extension(svn_fs_fs__stats_t *stats,
     }
 }
 
+/* COMPARISON_FUNC for svn_sort__hash.
+ * Sort path_info_t values by total rep size in descending order.
+ */
+static int
+compare_path_size(const svn_sort__item_t *a,
+                  const svn_sort__item_t *b)
+{
+  const svn_fs_fs__path_info_t *lhs = a->value;
+  const svn_fs_fs__path_info_t *rhs = b->value;
+  apr_int64_t diff = lhs->cost.packed_size - rhs->cost.packed_size;
+
+  return diff > 0 ? -1 : (diff < 0 ? 1 : 0);
+}
+
+/* COMPARISON_FUNC for svn_sort__hash.
+ * Sort path_info_t values by total delta chain length in descending order.
+ */
+static int
+compare_path_chain_len(const svn_sort__item_t *a,
+                       const svn_sort__item_t *b)
+{
+  const svn_fs_fs__path_info_t *lhs = a->value;
+  const svn_fs_fs__path_info_t *rhs = b->value;
+  apr_int64_t diff = lhs->cost.chain_len - rhs->cost.chain_len;
+
+  return diff > 0 ? -1 : (diff < 0 ? 1 : 0);
+}
+
+/* Print the (up to) 16 path prefixes in STATS with the largest total size
+ * of representations.  Use POOL for allocations.
+ */
+static void
+print_paths_by_reps(svn_fs_fs__stats_t *stats,
+                    apr_pool_t *pool)
+{
+  apr_array_header_t *sorted
+    = svn_sort__hash(stats->by_path, compare_path_size, pool);
+  int i;
+
+  for (i = 0; i < MIN(sorted->nelts, 16); ++i)
+    {
+      svn_fs_fs__path_info_t *info
+        = APR_ARRAY_IDX(sorted, i, svn_sort__item_t).value;
+      printf(_("%20s (%2d%%) bytes in %12s reps  %s\n"),
+             svn__ui64toa_sep(info->cost.packed_size, ',', pool),
+             get_percentage(info->cost.packed_size,
+                            stats->total_rep_stats.total.packed_size),
+             svn__ui64toa_sep(info->cost.count, ',', pool),
+             info->path);
+    }
+}
+
+/* Print the (up to) 16 path prefixes in STATS with the largest sum of
+ * delta chain lengths, i.e. the highest reconstruction cost.
+ * Use POOL for allocations.
+ */
+static void
+print_paths_by_chain_len(svn_fs_fs__stats_t *stats,
+                         apr_pool_t *pool)
+{
+  apr_array_header_t *sorted
+    = svn_sort__hash(stats->by_path, compare_path_chain_len, pool);
+  int i;
+
+  for (i = 0; i < MIN(sorted->nelts, 16); ++i)
+    {
+      svn_fs_fs__path_info_t *info
+        = APR_ARRAY_IDX(sorted, i, svn_sort__item_t).value;
+      printf(_("%20s deltas in %12s reps, %8.3f avg, %4s max  %s\n"),
+             svn__ui64toa_sep(info->cost.chain_len, ',', pool),
+             svn__ui64toa_sep(info->cost.count, ',', pool),
+             info->cost.chain_len / MAX(1.0, (double)info->cost.count),
+             svn__ui64toa_sep(info->cost.max_chain_len, ',', pool),
+             info->path);
+    }
+}
+
 /* Print the contents of STATS to the console.
  * Use POOL for allocations.
  */
@@ -458,6 +535,10 @@ print_stats(svn_fs_fs__stats_t *stats,
   print_extensions_by_nodes(stats, pool);
   printf("\nExtensions by size of representations:\n");
   print_extensions_by_reps(stats, pool);
+  printf("\nPaths by size of representations:\n");
+  print_paths_by_reps(stats, pool);
+  printf("\nPaths by delta chain length:\n");
+  print_paths_by_chain_len(stats, pool);
 
   printf("\nHistogram of expanded node sizes:\n");
   print_histogram(&stats->node_size_histogram, pool);
@@ -483,6 +564,239 @@ print_stats(svn_fs_fs__stats_t *stats,
   print_histograms_by_extension(stats, pool);
 }
 
+/* Return STR as a quoted JSON string, allocated in POOL.
+ */
+static const char *
+json_string(const char *str,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(strlen(str) + 2,
+                                                        pool);
+
+  svn_stringbuf_appendbyte(result, '"');
+  for (; *str; ++str)
+    {
+      unsigned char c = *(const unsigned char *)str;
+      if (c == '"' || c == '\\')
+        {
+          svn_stringbuf_appendbyte(result, '\\');
+          svn_stringbuf_appendbyte(result, c);
+        }
+      else if (c < 0x20)
+        {
+          svn_stringbuf_appendcstr(result,
+                                   apr_psprintf(pool, "\\u%04x", c));
+        }
+      else
+        {
+          svn_stringbuf_appendbyte(result, c);
+        }
+    }
+  svn_stringbuf_appendbyte(result, '"');
+
+  return result->data;
+}
+
+/* Print the non-zero lines of HISTOGRAM as JSON array.
+ */
+static void
+print_json_histogram(const svn_fs_fs__histogram_t *histogram)
+{
+  const char *separator = "";
+  int i;
+
+  printf("[");
+  for (i = 0; i < 64; ++i)
+    if (histogram->lines[i].count)
+      {
+        printf("%s{\"min\": %" APR_UINT64_T_FMT ", "
+               "\"count\": %" APR_UINT64_T_FMT ", "
+               "\"sum\": %" APR_UINT64_T_FMT "}",
+               separator,
+               i ? (apr_uint64_t)1 << (i - 1) : 0,
+               histogram->lines[i].count,
+               histogram->lines[i].sum);
+        separator = ", ";
+      }
+  printf("]");
+}
+
+/* Print COST as JSON object.
+ */
+static void
+print_json_cost(const svn_fs_fs__cost_info_t *cost)
+{
+  printf("{\"count\": %" APR_UINT64_T_FMT ", "
+         "\"packed_size\": %" APR_UINT64_T_FMT ", "
+         "\"expanded_size\": %" APR_UINT64_T_FMT ", "
+         "\"chain_len\": %" APR_UINT64_T_FMT ", "
+         "\"max_chain_len\": %" APR_UINT64_T_FMT "}",
+         cost->count, cost->packed_size, cost->expanded_size,
+         cost->chain_len, cost->max_chain_len);
+}
+
+/* Print the JSON object member NAME with the contents of STATS as value.
+ * Prefix it with SEPARATOR.
+ */
+static void
+print_json_rep_stats(const char *separator,
+                     const char *name,
+                     const svn_fs_fs__representation_stats_t *stats)
+{
+  printf("%s\n    \"%s\": {"
+         "\"count\": %" APR_UINT64_T_FMT ", "
+         "\"packed_size\": %" APR_UINT64_T_FMT ", "
+         "\"expanded_size\": %" APR_UINT64_T_FMT ", "
+         "\"overhead_size\": %" APR_UINT64_T_FMT ", "
+         "\"shared_count\": %" APR_UINT64_T_FMT ", "
+         "\"shared_packed_size\": %" APR_UINT64_T_FMT ", "
+         "\"references\": %" APR_UINT64_T_FMT ", "
+         "\"unshared_expanded_size\": %" APR_UINT64_T_FMT ", "
+         "\"chain_len\": %" APR_UINT64_T_FMT "}",
+         separator, name,
+         stats->total.count, stats->total.packed_size,
+         stats->total.expanded_size, stats->total.overhead_size,
+         stats->shared.count, stats->shared.packed_size,
+         stats->references, stats->expanded_size, stats->chain_len);
+}
+
+/* Print the JSON object member NAME with the contents of STATS as value.
+ * Prefix it with SEPARATOR.
+ */
+static void
+print_json_node_stats(const char *separator,
+                      const char *name,
+                      const svn_fs_fs__node_stats_t *stats)
+{
+  printf("%s\n    \"%s\": {\"count\": %" APR_UINT64_T_FMT ", "
+         "\"size\": %" APR_UINT64_T_FMT "}",
+         separator, name, stats->count, stats->size);
+}
+
+/* Print the contents of STATS to the console as a single JSON object.
+ * Use POOL for allocations.
+ */
+static void
+print_json_stats(svn_fs_fs__stats_t *stats,
+                 apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_array_header_t *sorted;
+  const char *separator;
+  apr_size_t i;
+  int k;
+
+  struct
+    {
+      const char *name;
+      const svn_fs_fs__histogram_t *histogram;
+    }
+  histograms[] =
+    {
+      { "node_sizes", &stats->node_size_histogram },
+      { "rep_sizes", &stats->rep_size_histogram },
+      { "added_node_sizes", &stats->added_node_size_histogram },
+      { "added_rep_sizes", &stats->added_rep_size_histogram },
+      { "unused_rep_sizes", &stats->unused_rep_histogram },
+      { "file_sizes", &stats->file_histogram },
+      { "file_rep_sizes", &stats->file_rep_histogram },
+      { "file_prop_sizes", &stats->file_prop_histogram },
+      { "file_prop_rep_sizes", &stats->file_prop_rep_histogram },
+      { "dir_sizes", &stats->dir_histogram },
+      { "dir_rep_sizes", &stats->dir_rep_histogram },
+      { "dir_prop_sizes", &stats->dir_prop_histogram },
+      { "dir_prop_rep_sizes", &stats->dir_prop_rep_histogram }
+    };
+
+  printf("{\n");
+  printf("  \"revisions\": %" APR_UINT64_T_FMT ",\n"
+         "  \"cached_revisions\": %" APR_UINT64_T_FMT ",\n"
+         "  \"total_size\": %" APR_UINT64_T_FMT ",\n"
+         "  \"change_count\": %" APR_UINT64_T_FMT ",\n"
+         "  \"change_len\": %" APR_UINT64_T_FMT ",\n",
+         stats->revision_count, stats->cached_revision_count,
+         stats->total_size, stats->change_count, stats->change_len);
+
+  printf("  \"nodes\": {");
+  print_json_node_stats("", "total", &stats->total_node_stats);
+  print_json_node_stats(",", "dirs", &stats->dir_node_stats);
+  print_json_node_stats(",", "files", &stats->file_node_stats);
+  printf("\n  },\n");
+
+  printf("  \"representations\": {");
+  print_json_rep_stats("", "total", &stats->total_rep_stats);
+  print_json_rep_stats(",", "dirs", &stats->dir_rep_stats);
+  print_json_rep_stats(",", "files", &stats->file_rep_stats);
+  print_json_rep_stats(",", "dir_props", &stats->dir_prop_rep_stats);
+  print_json_rep_stats(",", "file_props", &stats->file_prop_rep_stats);
+  printf("\n  },\n");
+
+  printf("  \"largest_changes\": [");
+  separator = "";
+  for (i = 0; i < stats->largest_changes->count; ++i)
+    {
+      svn_fs_fs__large_change_info_t *change
+        = stats->largest_changes->changes[i];
+      if (!change->size)
+        break;
+
+      svn_pool_clear(iterpool);
+      printf("%s\n    {\"size\": %" APR_UINT64_T_FMT ", "
+             "\"revision\": %ld, \"path\": %s}",
+             separator, change->size, change->revision,
+             json_string(change->path->data, iterpool));
+      separator = ",";
+    }
+  printf("\n  ],\n");
+
+  printf("  \"histograms\": {");
+  for (k = 0; k < (int)(sizeof(histograms) / sizeof(histograms[0])); ++k)
+    {
+      printf("%s\n    \"%s\": ", k ? "," : "", histograms[k].name);
+      print_json_histogram(histograms[k].histogram);
+    }
+  printf("\n  },\n");
+
+  printf("  \"extensions\": [");
+  sorted = svn_sort__hash(stats->by_extension,
+                          svn_sort_compare_items_lexically, pool);
+  for (k = 0; k < sorted->nelts; ++k)
+    {
+      svn_fs_fs__extension_info_t *info
+        = APR_ARRAY_IDX(sorted, k, svn_sort__item_t).value;
+
+      svn_pool_clear(iterpool);
+      printf("%s\n    {\"extension\": %s, \"cost\": ",
+             k ? "," : "", json_string(info->extension, iterpool));
+      print_json_cost(&info->cost);
+      printf(",\n     \"node_sizes\": ");
+      print_json_histogram(&info->node_histogram);
+      printf(",\n     \"rep_sizes\": ");
+      print_json_histogram(&info->rep_histogram);
+      printf("}");
+    }
+  printf("\n  ],\n");
+
+  printf("  \"paths\": [");
+  sorted = svn_sort__hash(stats->by_path,
+                          svn_sort_compare_items_lexically, pool);
+  for (k = 0; k < sorted->nelts; ++k)
+    {
+      svn_fs_fs__path_info_t *info
+        = APR_ARRAY_IDX(sorted, k, svn_sort__item_t).value;
+
+      svn_pool_clear(iterpool);
+      printf("%s\n    {\"path\": %s, \"cost\": ",
+             k ? "," : "", json_string(info->path, iterpool));
+      print_json_cost(&info->cost);
+      printf("}");
+    }
+  printf("\n  ]\n");
+  printf("}\n");
+
+  svn_pool_destroy(iterpool);
+}
+
 /* Our progress function simply prints the REVISION number and makes it
  * appear immediately.
  */
@@ -502,13 +816,21 @@ subcommand__stats(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   svnfsfs__opt_state *opt_state = baton;
   svn_fs_fs__stats_t *stats;
   svn_fs_t *fs;
+  svn_boolean_t show_progress = !opt_state->quiet && !opt_state->json;
+
+  if (show_progress)
+    printf("Reading revisions\n");
 
-  printf("Reading revisions\n");
   SVN_ERR(open_fs(&fs, opt_state->repository_path, pool));
-  SVN_ERR(svn_fs_fs__get_stats(&stats, fs, print_progress, NULL,
+  SVN_ERR(svn_fs_fs__get_stats(&stats, fs, opt_state->path_depth,
+                               opt_state->stats_cache,
+                               show_progress ? print_progress : NULL, NULL,
                                check_cancel, NULL, pool, pool));
 
-  print_stats(stats, pool);
+  if (opt_state->json)
+    print_json_stats(stats, pool);
+  else
+    print_stats(stats, pool);
 
   return SVN_NO_ERROR;
 }
@@ -76,7 +76,10 @@ check_lib_versions(void)
 
 enum svnfsfs__cmdline_options_t
   {
-    svnfsfs__version = SVN_OPT_FIRST_LONGOPT_ID
+    svnfsfs__version = SVN_OPT_FIRST_LONGOPT_ID,
+    svnfsfs__json,
+    svnfsfs__stats_cache,
+    svnfsfs__path_depth
   };
 
 /* Option codes and descriptions.
@@ -104,6 +107,17 @@ static const apr_getopt_option_t options_table[] =
      N_("size of the extra in-memory cache in MB used to\n"
         "                             minimize redundant operations. Default: 16.")},
 
+    {"json",          svnfsfs__json, 0,
+     N_("write the results as JSON")},
+
+    {"stats-cache",   svnfsfs__stats_cache, 1,
+     N_("keep the results for packed shards in file ARG\n"
+        "                             and only read new shards on later runs")},
+
+    {"path-depth",    svnfsfs__path_depth, 1,
+     N_("attribute representation costs to directories\n"
+        "                             cut off after ARG path segments. Default: 2.")},
+
     {NULL}
   };
 
@@ -162,12 +176,36 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
    )},
    {'M'} },
 
+  {"redeltify", subcommand__redeltify, {0}, {N_(
+    "usage: svnfsfs redeltify REPOS_PATH [-r LOWER[:UPPER]]\n"
+    "\n"), N_(
+    "Rewrite the packed shards containing the given revisions (default: all)\n"
+    "such that file contents get deltified against their skip-delta bases.\n"
+    "This shortens the delta chains that need to be combined when reading a\n"
+    "file, e.g. after loading a repository with a high max-linear-deltification\n"
+    "setting.  File contents and checksums remain unchanged.  Representations\n"
+    "used by later, unprocessed revisions will not be changed.  The results\n"
+    "for each shard get reported.\n"
+    "\n"), N_(
+    "This is an offline operation:  there must be no pending transactions and\n"
+    "processes keeping the repository open, e.g. servers, must be restarted\n"
+    "afterwards.  Only FSFS format 7 (SVN 1.9+) repositories are supported.\n"
+    "Make a backup first.\n"
+   )},
+   {'r', 'q', 'M'} },
+
   {"stats", subcommand__stats, {0}, {N_(
     "usage: svnfsfs stats REPOS_PATH\n"
     "\n"), N_(
     "Write object size statistics to console.\n"
+    "\n"), N_(
+    "Storage size and delta chain lengths get attributed to file extensions\n"
+    "and to the directories containing the respective nodes.  Use --json for\n"
+    "machine-readable output.  With --stats-cache, the results for packed\n"
+    "shards are kept in the given file and later runs will only read shards\n"
+    "that have been packed since.\n"
    )},
-   {'M'} },
+   {'q', 'M', svnfsfs__json, svnfsfs__stats_cache, svnfsfs__path_depth} },
 
   { NULL, NULL, {0}, {NULL}, {0} }
 };
@@ -259,6 +297,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.path_depth = 2;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -323,6 +362,21 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnfsfs__version:
         opt_state.version = TRUE;
         break;
+      case svnfsfs__json:
+        opt_state.json = TRUE;
+        break;
+      case svnfsfs__stats_cache:
+        SVN_ERR(svn_utf_cstring_to_utf8(&utf8_opt_arg, opt_arg, pool));
+        opt_state.stats_cache = svn_dirent_internal_style(utf8_opt_arg, pool);
+        break;
+      case svnfsfs__path_depth:
+        {
+          apr_int64_t depth;
+          SVN_ERR(svn_cstring_strtoi64(&depth, opt_arg, 0, 64, 10));
+
+          opt_state.path_depth = (int)depth;
+        }
+        break;
       default:
         {
           SVN_ERR(subcommand__help(NULL, NULL, pool));
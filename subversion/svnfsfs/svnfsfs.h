@@ -45,6 +45,9 @@ typedef struct svnfsfs__opt_state
   svn_boolean_t version;                            /* --version */
   svn_boolean_t quiet;                              /* --quiet */
   apr_uint64_t memory_cache_size;                   /* --memory-cache-size M */
+  svn_boolean_t json;                               /* --json */
+  const char *stats_cache;                          /* --stats-cache */
+  int path_depth;                                   /* --path-depth */
 } svnfsfs__opt_state;
 
 /* Declare all the command procedures */
@@ -52,6 +55,7 @@ svn_opt_subcommand_t
   subcommand__help,
   subcommand__dump_index,
   subcommand__load_index,
+  subcommand__redeltify,
   subcommand__stats;
 
 
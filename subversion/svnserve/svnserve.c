@@ -222,6 +222,7 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_WARM_CACHE      277
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -325,6 +326,16 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is yes.\n"
         "                             "
         "[used for FSFS repositories only]")},
+    {"warm-cache", SVNSERVE_OPT_WARM_CACHE, 1,
+     N_("read the HEAD revision of repository ARG\n"
+        "                             "
+        "(relative to the root) into the caches before\n"
+        "                             "
+        "serving any requests.  May be given multiple\n"
+        "                             "
+        "times.\n"
+        "                             "
+        "[used for FSFS and FSX repositories only]")},
     {"client-speed", SVNSERVE_OPT_CLIENT_SPEED, 1,
      N_("Optimize network handling based on the assumption\n"
         "                             "
@@ -742,6 +753,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
+  apr_array_header_t *warm_cache_repos
+    = apr_array_make(pool, 0, sizeof(const char *));
 #ifdef SVN_HAVE_SASL
   SVN_ERR(cyrus_init(pool));
 #endif
@@ -925,6 +938,12 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           cache_nodeprops = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_WARM_CACHE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&arg, arg, pool));
+          APR_ARRAY_PUSH(warm_cache_repos, const char *)
+            = svn_relpath_canonicalize(arg, pool);
+          break;
+
         case SVNSERVE_OPT_BLOCK_READ:
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -1297,6 +1316,37 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_set(&settings);
   }
 
+  /* Populate the now configured caches.  Child processes will inherit
+   * them.  Failing to do so is no reason not to serve the repositories. */
+  if (warm_cache_repos->nelts)
+    {
+      apr_pool_t *iterpool = svn_pool_create(pool);
+      int i;
+
+      for (i = 0; i < warm_cache_repos->nelts; ++i)
+        {
+          const char *repos_path;
+          svn_repos_t *repos;
+
+          svn_pool_clear(iterpool);
+          repos_path = svn_dirent_join(params.root,
+                                       APR_ARRAY_IDX(warm_cache_repos, i,
+                                                     const char *),
+                                       iterpool);
+          err = svn_repos_open3(&repos, repos_path, params.fs_config,
+                                iterpool, iterpool);
+          if (!err)
+            err = svn_repos_warm_cache(repos, NULL, SVN_INVALID_REVNUM,
+                                       SVN_INVALID_REVNUM, 0, FALSE,
+                                       NULL, NULL, NULL, NULL, iterpool);
+
+          logger__log_error(params.logger, err, NULL, NULL);
+          svn_error_clear(err);
+        }
+
+      svn_pool_destroy(iterpool);
+    }
+
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
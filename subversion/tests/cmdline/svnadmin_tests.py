@@ -29,11 +29,19 @@ import os
 import logging
 import re
 import shutil
+import subprocess
 import sys
 import threading
 import time
 import gzip
 
+try:
+  # Python >=3.0
+  import queue
+except ImportError:
+  # Python <3.0
+  import Queue as queue
+
 logger = logging.getLogger()
 
 # Our testing module
@@ -3824,6 +3832,103 @@ def load_issue4725(sbox):
   sbox2.build(create_wc=False, empty=True)
   load_and_verify_dumpstream(sbox2, None, [], None, False, dump, '-M100')
 
+def warm_cache(sbox):
+  "svnadmin warm-cache"
+
+  sbox.build(create_wc=False)
+
+  # Only the youngest revision by default.
+  svntest.actions.run_and_verify_svnadmin(['* Cached revision 1.\n'], [],
+                                          'warm-cache', sbox.repo_dir)
+
+  # Older revisions come after the younger ones.
+  svntest.actions.run_and_verify_svnadmin(['* Cached revision 1.\n',
+                                           '* Cached revision 0.\n'], [],
+                                          'warm-cache', '-r0:1',
+                                          sbox.repo_dir)
+
+  # Sub-trees only.  Paths that don't exist are simply ignored.
+  svntest.actions.run_and_verify_svnadmin(['* Cached revision 1.\n'], [],
+                                          'warm-cache', sbox.repo_dir,
+                                          'A/B', 'A/no-such-dir')
+
+  svntest.actions.run_and_verify_svnadmin([], [],
+                                          'warm-cache', '-q', sbox.repo_dir)
+
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+@SkipUnless(svntest.main.is_posix_os)
+def hotcopy_follow(sbox):
+  "'svnadmin hotcopy --follow'"
+  sbox.build()
+
+  backup_dir, backup_url = sbox.add_repo_path('backup')
+
+  follower = subprocess.Popen([svntest.main.svnadmin_binary, 'hotcopy',
+                               '--follow', sbox.repo_dir, backup_dir],
+                              stdout=subprocess.PIPE,
+                              universal_newlines=True)
+
+  # Collect the follower's output without blocking the test.
+  output = queue.Queue()
+  def read_output():
+    for line in iter(follower.stdout.readline, ''):
+      output.put(line)
+  reader = threading.Thread(target=read_output)
+  reader.daemon = True
+  reader.start()
+
+  copied = [-1]
+  def wait_for_revision(revision):
+    "Wait until a hotcopy pass that copied REVISION has finished."
+    while True:
+      try:
+        line = output.get(timeout=60)
+      except queue.Empty:
+        raise svntest.Failure("Hotcopy did not reach r%d" % revision)
+      match = re.match(r'\* Copied revisions? (?:from \d+ to )?(\d+)\.', line)
+      if match:
+        copied[0] = int(match.group(1))
+      elif line.startswith('* Finished hotcopy pass') \
+           and copied[0] >= revision:
+        return
+
+  try:
+    wait_for_revision(1)
+    check_hotcopy_fsfs(sbox.repo_dir, backup_dir)
+
+    # New revisions get copied without restarting the follower.
+    sbox.simple_mkdir('newdir-1')
+    sbox.simple_commit()
+    sbox.simple_mkdir('newdir-2')
+    sbox.simple_commit()
+
+    wait_for_revision(3)
+    check_hotcopy_fsfs(sbox.repo_dir, backup_dir)
+
+    # Revprop changes get copied, too, long before the periodic pass.
+    revprop_file = sbox.get_tempname()
+    svntest.main.file_write(revprop_file, "Modified log message.")
+    svntest.actions.run_and_verify_svnadmin(None, [],
+                                            'setrevprop',
+                                            sbox.repo_dir, '-r', 1,
+                                            'svn:log', revprop_file)
+    deadline = time.time() + 30
+    copied_revprop = False
+    while True:
+      try:
+        line = output.get(timeout=max(deadline - time.time(), 0))
+      except queue.Empty:
+        raise svntest.Failure("Hotcopy did not copy the revprop change")
+      if line == '* Copied revision 1.\n':
+        copied_revprop = True
+      elif line.startswith('* Finished hotcopy pass') and copied_revprop:
+        break
+
+    check_hotcopy_fsfs(sbox.repo_dir, backup_dir)
+  finally:
+    follower.terminate()
+    follower.wait()
+
 ########################################################################
 # Run the tests
 
@@ -3898,6 +4003,8 @@ test_list = [ None,
               dump_exclude_all_rev_changes,
               dump_invalid_filtering_option,
               load_issue4725,
+              warm_cache,
+              hotcopy_follow,
              ]
 
 if __name__ == '__main__':
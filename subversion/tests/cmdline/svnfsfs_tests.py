@@ -33,6 +33,7 @@ import sys
 import threading
 import time
 import gzip
+import json
 
 logger = logging.getLogger()
 
@@ -155,6 +156,8 @@ def test_stats(sbox):
                       'Extensions by number of representations:',
                       'Extensions by size of changed files:',
                       'Extensions by size of representations:',
+                      'Paths by size of representations:',
+                      'Paths by delta chain length:',
                       'Histogram of expanded node sizes:',
                       'Histogram of representation sizes:',
                       'Histogram of file sizes:',
@@ -197,6 +200,10 @@ def test_stats(sbox):
                           ['.*\d+ \( ?\d+%\) representations'],
     'Extensions by size .*:' :
                           ['.*\d+ \( ?\d+%\) bytes'],
+    'Paths by size .*:' :
+                          ['.*\d+ \( ?\d+%\) bytes in *\d+ reps  /\S*'],
+    'Paths by delta .*:' :
+                          ['.*\d+ deltas in *\d+ reps, *[\d.]+ avg, *\d+ max  /\S*'],
     'Histogram of .*:'  : ['.*\d+ \.\. < \d+.*\d+ \( ?\d+%\) bytes in *\d+ \( ?\d+%\) items']
   }
 
@@ -319,6 +326,259 @@ def test_stats_on_empty_repo(sbox):
   exit_code, output, errput = \
     svntest.actions.run_and_verify_svnfsfs(None, [], 'stats', sbox.repo_dir)
 
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+@SkipUnless(svntest.main.fs_has_pack)
+def test_stats_json_cached(sbox):
+  "stats as JSON and with a stats cache"
+
+  # Configure two files per shard to trigger packing.
+  sbox.build(create_wc=False)
+  patch_format(sbox.repo_dir, shard_size=2)
+
+  expected_output = ["Packing revisions in shard 0...done.\n"]
+  svntest.actions.run_and_verify_svnadmin(expected_output, [],
+                                          "pack", sbox.repo_dir)
+
+  cache_file = sbox.get_tempname()
+
+  def get_stats():
+    exit_code, output, errput = \
+      svntest.actions.run_and_verify_svnfsfs(None, [], 'stats', '--json',
+                                             '--stats-cache', cache_file,
+                                             sbox.repo_dir)
+    return json.loads(''.join(output))
+
+  # The first run has to read everything and creates the cache.
+  first = get_stats()
+  if first['revisions'] != 2 or first['cached_revisions'] != 0:
+    raise svntest.Failure
+
+  # All representations must be attributed to some path.
+  paths = dict((p['path'], p['cost']) for p in first['paths'])
+  if '/' not in paths or '/A/D' not in paths:
+    raise svntest.Failure
+  if sum(cost['count'] for cost in paths.values()) \
+     != first['representations']['total']['count']:
+    raise svntest.Failure
+
+  # The second run takes the packed shard from the cache.
+  second = get_stats()
+  if second['cached_revisions'] != 2:
+    raise svntest.Failure
+
+  del first['cached_revisions']
+  del second['cached_revisions']
+  if first != second:
+    raise svntest.Failure
+
+def create_linear_chains(sbox):
+  """Create a repository with shard size 8, in which r1 .. r16 each change
+     a single line of 'iota', and pack it.  Deltas form long, linear chains.
+     Return a dictionary mapping the revisions to the lines of 'iota'."""
+
+  sbox.build(create_wc=False, empty=True)
+  patch_format(sbox.repo_dir, shard_size=8)
+
+  # Make commits produce long, linear delta chains.
+  confpath = svntest.main.get_fsfs_conf_file_path(sbox.repo_dir)
+  with open(confpath, 'r') as conffile:
+    lines = conffile.readlines()
+  with open(confpath, 'w') as conffile:
+    for line in lines:
+      if line.startswith('# max-linear-deltification '):
+        line = 'max-linear-deltification = 1000\n'
+      conffile.write(line)
+
+  # r1 .. r16 each change a single line in the same file.
+  source = sbox.get_tempname()
+  contents = {}
+  for rev in range(1, 17):
+    lines = ['line %d\n' % i for i in range(100)]
+    lines[rev] = 'changed in r%d\n' % rev
+    svntest.main.file_write(source, ''.join(lines))
+    svntest.actions.run_and_verify_svnmucc(None, [],
+                                           '-U', sbox.repo_url,
+                                           '-m', 'log_msg',
+                                           'put', source, 'iota')
+    contents[rev] = lines
+
+  expected_output = ["Packing revisions in shard 0...done.\n",
+                     "Packing revisions in shard 1...done.\n"]
+  svntest.actions.run_and_verify_svnadmin(expected_output, [],
+                                          "pack", sbox.repo_dir)
+
+  return contents
+
+def read_rep_cache(repo_dir):
+  "Return the rows of REPO_DIR's rep-cache as {(rev, item): size}."
+  db = svntest.sqlite3.connect(os.path.join(repo_dir, 'db', 'rep-cache.db'))
+  rows = db.execute('SELECT revision, offset, size FROM rep_cache').fetchall()
+  db.close()
+  return dict(((rev, item), size) for rev, item, size in rows)
+
+def read_rep_sizes(repo_dir, shard_revs):
+  """Return the actual on-disk sizes of all representations in the packed
+     shards starting at SHARD_REVS of REPO_DIR as {(rev, item): size}."""
+  sizes = {}
+  for shard_rev in shard_revs:
+    exit_code, output, errput = \
+      svntest.actions.run_and_verify_svnfsfs(None, [], 'dump-index',
+                                             '-r', str(shard_rev), repo_dir)
+    pack_path = os.path.join(repo_dir, 'db', 'revs',
+                             '%d.pack' % (shard_rev // 8), 'pack')
+    with open(pack_path, 'rb') as pack_file:
+      pack = pack_file.read()
+
+    # Skip the table header.  Representations are followed by ENDREP.
+    for line in output[1:]:
+      fields = line.split()
+      if fields[2] not in ('frep', 'drep', 'fprop', 'dprop'):
+        continue
+      offset = int(fields[0], 16)
+      length = int(fields[1], 16)
+      header_length = pack.index(b'\n', offset) + 1 - offset
+      sizes[(int(fields[3]), int(fields[4]))] \
+        = length - header_length - len(b'ENDREP\n')
+
+  return sizes
+
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+def redeltify_packed_shards(sbox):
+  "redeltify packed shards"
+
+  contents = create_linear_chains(sbox)
+
+  exit_code, output, errput = \
+    svntest.actions.run_and_verify_svnfsfs(None, [], 'redeltify',
+                                           sbox.repo_dir)
+
+  # Both packed shards get processed and their linear chains must become
+  # shorter.
+  shards = [line.split(':')[0] for line in output
+            if line.startswith('Shard r')]
+  if shards != ['Shard r0', 'Shard r8']:
+    logger.warn("Unexpected shards: %s" % shards)
+    raise svntest.Failure
+
+  chains = [re.match(r'  delta chain length sum (\S+) -> (\S+), ', line)
+            for line in output]
+  chains = [(int(m.group(1)), int(m.group(2))) for m in chains if m]
+  if len(chains) != 2 or [c for c in chains if c[1] >= c[0]]:
+    logger.warn("Unexpected chain lengths: %s" % chains)
+    raise svntest.Failure
+
+  # The repository must still be valid and contents must not change.
+  svntest.actions.run_and_verify_svnadmin(None, [], "verify",
+                                          sbox.repo_dir)
+  for rev in range(1, 17):
+    svntest.actions.run_and_verify_svnlook(contents[rev], [], 'cat',
+                                           '-r', str(rev), sbox.repo_dir,
+                                           'iota')
+
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+@SkipUnless(svntest.main.fs_has_rep_sharing)
+def redeltify_rep_cache(sbox):
+  "redeltify updates the rep-cache"
+
+  contents = create_linear_chains(sbox)
+  before = read_rep_cache(sbox.repo_dir)
+
+  svntest.actions.run_and_verify_svnfsfs(None, [], 'redeltify',
+                                         sbox.repo_dir)
+
+  # Every rep-cache entry for the packed shards must match the actual
+  # representation size, and some of them must have changed.
+  after = read_rep_cache(sbox.repo_dir)
+  sizes = read_rep_sizes(sbox.repo_dir, [0, 8])
+  packed = [key for key in after if key in sizes]
+  if not packed:
+    raise svntest.Failure("No rep-cache entries for the packed shards")
+
+  for key in packed:
+    if after[key] != sizes[key]:
+      logger.warn("rep-cache size for r%d item %d is %d instead of %d"
+                  % (key[0], key[1], after[key], sizes[key]))
+      raise svntest.Failure
+
+  if not [key for key in packed if after[key] != before[key]]:
+    raise svntest.Failure("rep-cache has not been updated")
+
+  # New commits share the redeltified representations.
+  source = sbox.get_tempname()
+  for rev in [3, 11]:
+    svntest.main.file_write(source, ''.join(contents[rev]))
+    svntest.actions.run_and_verify_svnmucc(None, [],
+                                           '-U', sbox.repo_url,
+                                           '-m', 'log_msg',
+                                           'put', source, 'copy-%d' % rev)
+
+  svntest.actions.run_and_verify_svnadmin(None, [], "verify",
+                                          sbox.repo_dir)
+  for rev in [3, 11]:
+    svntest.actions.run_and_verify_svnlook(contents[rev], [], 'cat',
+                                           sbox.repo_dir, 'copy-%d' % rev)
+
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+@SkipUnless(svntest.main.fs_has_rep_sharing)
+def redeltify_complete_journal(sbox):
+  "the first writer completes an interrupted redeltify"
+
+  contents = create_linear_chains(sbox)
+
+  # Redeltify a copy of the repository and take its results.
+  backup_dir, backup_url = sbox.add_repo_path('backup')
+  shutil.copytree(sbox.repo_dir, backup_dir)
+  svntest.actions.run_and_verify_svnfsfs(None, [], 'redeltify', backup_dir)
+  expected_rep_cache = read_rep_cache(backup_dir)
+
+  # Simulate getting interrupted right after the first shard's pack file
+  # has been replaced.
+  journal = []
+  for shard in [0, 1]:
+    src = os.path.join(backup_dir, 'db', 'revs', '%d.pack' % shard, 'pack')
+    dst = os.path.join(sbox.repo_dir, 'db', 'revs', '%d.pack' % shard,
+                       shard and 'pack.redeltified' or 'pack')
+    if os.path.exists(dst):
+      os.remove(dst)
+    shutil.copyfile(src, dst)
+    journal.append('pack %d\n' % (shard * 8))
+
+  before = read_rep_cache(sbox.repo_dir)
+  for key, size in expected_rep_cache.items():
+    if before.get(key) != size:
+      journal.append('rep %d %d %d\n' % (key[0], key[1], size))
+
+  svntest.main.file_write(os.path.join(sbox.repo_dir, 'db',
+                                       'redeltify-journal'),
+                          ''.join(journal))
+
+  # Readers don't need any locks and leave the journal alone.
+  svntest.actions.run_and_verify_svnlook(['16\n'], [], 'youngest',
+                                         sbox.repo_dir)
+  if not os.path.exists(os.path.join(sbox.repo_dir, 'db',
+                                     'redeltify-journal')):
+    raise svntest.Failure("Reading has modified the repository")
+
+  # The next commit completes the operation.
+  svntest.actions.run_and_verify_svnmucc(None, [],
+                                         '-U', sbox.repo_url,
+                                         '-m', 'log_msg',
+                                         'mkdir', 'new-dir')
+  if os.path.exists(os.path.join(sbox.repo_dir, 'db', 'redeltify-journal')) \
+     or os.path.exists(os.path.join(sbox.repo_dir, 'db', 'revs', '1.pack',
+                                    'pack.redeltified')):
+    raise svntest.Failure("Redeltify has not been completed")
+
+  if read_rep_cache(sbox.repo_dir) != expected_rep_cache:
+    raise svntest.Failure("rep-cache has not been updated")
+
+  svntest.actions.run_and_verify_svnadmin(None, [], "verify",
+                                          sbox.repo_dir)
+  for rev in range(1, 17):
+    svntest.actions.run_and_verify_svnlook(contents[rev], [], 'cat',
+                                           '-r', str(rev), sbox.repo_dir,
+                                           'iota')
+
 ########################################################################
 # Run the tests
 
@@ -328,6 +588,10 @@ test_list = [ None,
               test_stats,
               load_index_sharded,
               test_stats_on_empty_repo,
+              test_stats_json_cached,
+              redeltify_packed_shards,
+              redeltify_rep_cache,
+              redeltify_complete_journal,
              ]
 
 if __name__ == '__main__':
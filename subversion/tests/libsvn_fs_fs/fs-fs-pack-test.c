@@ -28,13 +28,16 @@
 #include "../../libsvn_fs/fs-loader.h"
 #include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
+#include "../../libsvn_fs_fs/index.h"
 #include "../../libsvn_fs_fs/low_level.h"
 #include "../../libsvn_fs_fs/pack.h"
+#include "../../libsvn_fs_fs/rev_file.h"
 #include "../../libsvn_fs_fs/util.h"
 
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
+#include "svn_sorts.h"
 #include "svn_fs.h"
 #include "private/svn_string_private.h"
 
@@ -1887,6 +1890,304 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-reopen-changed-config"
+
+static svn_error_t *
+reopen_changed_config(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_fs_t *fs, *fs2;
+  fs_fs_data_t *ffd;
+  const char *config_path;
+  const char *config = "[" CONFIG_SECTION_DEBUG "]\n"
+                       CONFIG_OPTION_PACK_AFTER_COMMIT " = true\n";
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_PACKED_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.6 SVN doesn't support packing");
+
+  /* Repeated opens return the same meta data. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  SVN_TEST_STRING_ASSERT(fs->uuid, fs2->uuid);
+  ffd = fs2->fsap_data;
+  SVN_TEST_ASSERT(!ffd->pack_after_commit);
+
+  /* Changes to the config file must become visible to later opens. */
+  config_path = svn_dirent_join(fs->path, PATH_CONFIG, pool);
+  SVN_ERR(svn_io_write_atomic2(config_path, config, strlen(config),
+                               NULL, FALSE, pool));
+
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  SVN_TEST_STRING_ASSERT(fs->uuid, fs2->uuid);
+  ffd = fs2->fsap_data;
+  SVN_TEST_ASSERT(ffd->pack_after_commit);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-bulk-item-offsets"
+#define SHARD_SIZE 4
+#define MAX_REV 9
+
+static svn_error_t *
+bulk_item_offsets(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_fs__revision_file_t *rev_file;
+  apr_array_header_t *max_ids;
+  apr_array_header_t *items;
+  apr_off_t *offsets;
+  svn_revnum_t start;
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 9))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.9 SVN doesn't have log addressing");
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  if (!svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "test requires log addressing");
+
+  /* Check the packed shards as well as the non-packed revisions. */
+  for (start = 0; start <= MAX_REV; start += SHARD_SIZE)
+    {
+      svn_revnum_t count = MIN(SHARD_SIZE, MAX_REV + 1 - start);
+      svn_revnum_t rev;
+
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, start,
+                                               pool, pool));
+      if (!rev_file->is_packed)
+        count = 1;
+
+      SVN_ERR(svn_fs_fs__l2p_get_max_ids(&max_ids, fs, start, count,
+                                         pool, pool));
+
+      /* All items in the file, youngest first to check that any order
+       * gives correct results. */
+      items = apr_array_make(pool, 16, sizeof(svn_fs_fs__id_part_t));
+      for (rev = start + count - 1; rev >= start; --rev)
+        {
+          apr_uint64_t k;
+          apr_uint64_t max_id = APR_ARRAY_IDX(max_ids, rev - start,
+                                              apr_uint64_t);
+          for (k = 0; k < max_id; ++k)
+            {
+              svn_fs_fs__id_part_t *item = apr_array_push(items);
+              item->revision = rev;
+              item->number = k;
+            }
+        }
+
+      offsets = apr_pcalloc(pool, items->nelts * sizeof(*offsets));
+      SVN_ERR(svn_fs_fs__item_offsets(offsets, fs, rev_file,
+                                      (void *)items->elts, items->nelts,
+                                      pool));
+
+      /* Must match the individual lookups. */
+      for (i = 0; i < items->nelts; ++i)
+        {
+          const svn_fs_fs__id_part_t *item
+            = &APR_ARRAY_IDX(items, i, svn_fs_fs__id_part_t);
+          apr_off_t offset;
+
+          SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file,
+                                         item->revision, NULL, item->number,
+                                         pool));
+          SVN_TEST_ASSERT(offsets[i] == offset);
+        }
+
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-txn_node_shards"
+/* Enough nodes to use every node shard at least once. */
+#define FILE_COUNT (SVN_FS_FS__TXN_NODE_SHARDS + 16)
+
+static svn_error_t *
+txn_node_shards(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  const char *txn_name;
+  const char *nodes_dir;
+  apr_hash_t *dirents;
+  svn_stringbuf_t *contents;
+  int i;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 11))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.11 SVN doesn't shard txn node files");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  /* Add lots of nodes in a single txn. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_name(&txn_name, txn, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "A", pool));
+  for (i = 0; i < FILE_COUNT; ++i)
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "A/f%d", i);
+      SVN_ERR(svn_fs_make_file(root, path, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, path, path, iterpool));
+    }
+
+  /* All node shards should be in use now. */
+  nodes_dir = svn_dirent_join_many(pool, REPO_NAME, PATH_TXNS_DIR,
+                                   apr_pstrcat(pool, txn_name, PATH_EXT_TXN,
+                                               SVN_VA_NULL),
+                                   PATH_TXN_NODES, SVN_VA_NULL);
+  SVN_ERR(svn_io_get_dirents3(&dirents, nodes_dir, TRUE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == SVN_FS_FS__TXN_NODE_SHARDS);
+
+  /* Continue the txn from a separate FS instance and commit it. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_open_txn(&txn, fs, txn_name, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "A/f0", "changed", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+
+  /* Verify the result. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_dir_entries(&dirents, root, "A", pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == FILE_COUNT);
+
+  SVN_ERR(svn_test__get_file_contents(root, "A/f0", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "changed");
+  SVN_ERR(svn_test__get_file_contents(root, "A/f1", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "A/f1");
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef FILE_COUNT
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-mapped-pack-files"
+#define SHARD_SIZE 3
+#define MAX_REV 10
+
+static svn_error_t *
+mapped_pack_files(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  const char *config_path;
+  const char *config = "[" CONFIG_SECTION_IO "]\n"
+                       CONFIG_OPTION_MAX_MAPPED_PACK_FILES " = 1\n";
+  apr_pool_t *fs_pool = svn_pool_create(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t i;
+
+  /* Create a packed repository and enable mapping a single pack file. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  config_path = svn_dirent_join(REPO_NAME, PATH_CONFIG, pool);
+  SVN_ERR(svn_io_write_atomic2(config_path, config, strlen(config),
+                               NULL, FALSE, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, fs_pool, pool));
+  ffd = fs->fsap_data;
+  SVN_TEST_ASSERT(ffd->max_mapped_pack_files == 1);
+
+  /* Read every revision.  Consecutive shards compete for the one mapping,
+   * so it gets recycled over and over. */
+  for (i = 1; i <= MAX_REV; i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, iterpool));
+      SVN_ERR(svn_test__get_file_contents(rev_root, "iota", &contents,
+                                          iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             i == 1 ? "This is the file 'iota'.\n"
+                                    : get_rev_contents(i, iterpool));
+      SVN_ERR(svn_fs_verify_root(rev_root, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Indexes and checksums must match as well. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL,
+                        SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+#if APR_HAS_MMAP
+  {
+    svn_fs_fs__revision_file_t *rev_file, *rev_file2;
+
+    /* With the mapping in use, other pack files must use plain file I/O. */
+    SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, pool, pool));
+    SVN_TEST_ASSERT(rev_file->mapped_data != NULL);
+    SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file2, fs, SHARD_SIZE + 1,
+                                             pool, pool));
+    SVN_TEST_ASSERT(rev_file2->mapped_data == NULL);
+    SVN_ERR(svn_fs_fs__close_revision_file(rev_file2));
+
+    /* Closing FS while REV_FILE's pool is still alive must not leave a
+     * dangling mapping behind. */
+    svn_pool_destroy(fs_pool);
+    SVN_TEST_ASSERT(rev_file->mapped_data == NULL);
+    SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
 
 
 /* The test table.  */
@@ -1942,6 +2243,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(reopen_changed_config,
+                       "reopen FSFS after changing its config"),
+    SVN_TEST_OPTS_PASS(bulk_item_offsets,
+                       "resolve FSFS item offsets in bulk"),
+    SVN_TEST_OPTS_PASS(txn_node_shards,
+                       "commit a txn using all node shards"),
+    SVN_TEST_OPTS_PASS(mapped_pack_files,
+                       "read FSFS pack files through memory mappings"),
     SVN_TEST_NULL
   };
 
@@ -201,6 +201,7 @@ get_repo_stats(const svn_test_opts_t *opts,
   apr_size_t i;
   svn_fs_fs__stats_t *stats;
   svn_fs_fs__extension_info_t *extension_info;
+  svn_fs_fs__path_info_t *path_info;
 
   /* Bail (with success) on known-untestable scenarios */
   if (strcmp(opts->fs_type, "fsfs") != 0)
@@ -211,8 +212,8 @@ get_repo_stats(const svn_test_opts_t *opts,
   SVN_ERR(create_greek_repo(&repos, &rev, opts, REPO_NAME, pool, pool));
 
   /* Gather statistics info on that repo. */
-  SVN_ERR(svn_fs_fs__get_stats(&stats, svn_repos_fs(repos), NULL, NULL,
-                               NULL, NULL, pool, pool));
+  SVN_ERR(svn_fs_fs__get_stats(&stats, svn_repos_fs(repos), 2, NULL,
+                               NULL, NULL, NULL, NULL, pool, pool));
 
   /* Check that the stats make sense. */
   SVN_TEST_ASSERT(stats->total_size > 1000 && stats->total_size < 10000);
@@ -262,6 +263,21 @@ get_repo_stats(const svn_test_opts_t *opts,
   SVN_ERR(verify_histogram(&extension_info->rep_histogram));
   SVN_ERR(verify_histogram(&extension_info->node_histogram));
 
+  /* All file text reps are billed to that extension. */
+  SVN_TEST_ASSERT(extension_info->cost.count == 12);
+  SVN_TEST_ASSERT(extension_info->cost.packed_size
+                  == stats->file_rep_stats.total.packed_size);
+  SVN_TEST_ASSERT(extension_info->cost.chain_len
+                  == stats->file_rep_stats.chain_len);
+
+  /* Files get billed to their parent folders, cut off after 2 levels. */
+  path_info = svn_hash_gets(stats->by_path, "/A/D");
+  SVN_TEST_ASSERT(path_info);
+  SVN_TEST_ASSERT(path_info->cost.count > 0);
+  SVN_TEST_ASSERT(path_info->cost.max_chain_len >= 1);
+  SVN_TEST_ASSERT(svn_hash_gets(stats->by_path, "/"));
+  SVN_TEST_ASSERT(!svn_hash_gets(stats->by_path, "/A/D/G"));
+
   return SVN_NO_ERROR;
 }
 
@@ -25,13 +25,22 @@
 #include <apr_pools.h>
 
 #include "../svn_test.h"
-#include "../../libsvn_fs_x/batch_fsync.h"
+#include "../../libsvn_fs_x/cached_data.h"
+#include "../../libsvn_fs_x/dag.h"
+#include "../../libsvn_fs_x/dag_cache.h"
 #include "../../libsvn_fs_x/fs.h"
+#include "../../libsvn_fs_x/index.h"
+#include "../../libsvn_fs_x/pack.h"
 #include "../../libsvn_fs_x/reps.h"
+#include "../../libsvn_fs_x/rev_file.h"
+#include "../../libsvn_fs_x/util.h"
 
+#include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
+#include "svn_sorts.h"
 #include "svn_fs.h"
+#include "svn_uuid.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -820,6 +829,257 @@ test_reps(const svn_test_opts_t *opts,
 #undef SHARD_SIZE
 #undef MAX_REV
 
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-fsx-rep-container-base"
+#define SHARD_SIZE 3
+#define MAX_REV 5
+static svn_error_t *
+test_reps_with_base(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs = NULL;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  const char *conflict;
+  svn_revnum_t rev;
+  dag_node_t *node;
+  svn_fs_x__noderev_t *noderev;
+  svn_fs_x__reps_builder_t *builder;
+  svn_fs_x__reps_t *container;
+  svn_stringbuf_t *serialized;
+  svn_stream_t *stream;
+  svn_stringbuf_t *contents = svn_stringbuf_create_ensure(10000, pool);
+  svn_stringbuf_t *texts[3];
+  apr_size_t i;
+
+  for (i = 0; i < 10000; ++i)
+    {
+      apr_size_t v, s = 0;
+      for (v = i; v > 0; v /= 10)
+        s += v % 10;
+
+      svn_stringbuf_appendbyte(contents, (char)(s + ' '));
+    }
+
+  /* Variations of the base text plus some unrelated text. */
+  texts[0] = svn_stringbuf_dup(contents, pool);
+  memset(texts[0]->data + 5000, 'X', 10);
+  texts[1] = svn_stringbuf_create("head", pool);
+  svn_stringbuf_appendbytes(texts[1], contents->data + 1000, 7000);
+  svn_stringbuf_appendcstr(texts[1], "tail");
+  texts[2] = svn_stringbuf_create("This text is not in the base.\n", pool);
+
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  /* Commit the future base text. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, MAX_REV, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "base", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "base", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_x__get_dag_node(&node, root, "base", pool, pool));
+  SVN_ERR(svn_fs_x__get_node_revision(&noderev, fs,
+                                      svn_fs_x__dag_get_id(node),
+                                      pool, pool));
+
+  /* Build the container. */
+  builder = svn_fs_x__reps_builder_create(fs, pool);
+  SVN_ERR(svn_fs_x__reps_add_base(builder, noderev->data_rep, 0, pool));
+  for (i = 0; i < 3; ++i)
+    {
+      apr_size_t idx;
+      svn_string_t string;
+      string.data = texts[i]->data;
+      string.len = texts[i]->len;
+
+      SVN_ERR(svn_fs_x__reps_add(&idx, builder, &string));
+      SVN_TEST_ASSERT(idx == i);
+    }
+
+  serialized = svn_stringbuf_create_empty(pool);
+  stream = svn_stream_from_stringbuf(serialized, pool);
+  SVN_ERR(svn_fs_x__write_reps_container(stream, builder, pool));
+
+  /* The base text must not be part of the container. */
+  SVN_TEST_ASSERT(serialized->len < contents->len / 2);
+
+  SVN_ERR(svn_stream_reset(stream));
+  SVN_ERR(svn_fs_x__read_reps_container(&container, stream, pool, pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  /* Reconstruct all texts, in full and partially. */
+  for (i = 0; i < 3; ++i)
+    {
+      svn_fs_x__rep_extractor_t *extractor;
+      svn_stringbuf_t *text;
+      apr_size_t start = texts[i]->len / 3;
+
+      SVN_ERR(svn_fs_x__reps_get(&extractor, fs, container, i, pool));
+      SVN_ERR(svn_fs_x__extractor_drive(&text, extractor, 0, 0, pool, pool));
+      SVN_TEST_ASSERT(svn_stringbuf_compare(text, texts[i]));
+
+      SVN_ERR(svn_fs_x__reps_get(&extractor, fs, container, i, pool));
+      SVN_ERR(svn_fs_x__extractor_drive(&text, extractor, start, 100,
+                                        pool, pool));
+      SVN_TEST_ASSERT(text->len == MIN(100, texts[i]->len - start));
+      SVN_TEST_ASSERT(memcmp(text->data, texts[i]->data + start,
+                             text->len) == 0);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-fsx-pack-related-reps"
+#define SHARD_SIZE 16
+#define MAX_REV 16
+
+/* Return the contents of "file" in revision REV: a common body with a
+ * chunk of revision-specific text in front of it. */
+static const char *
+get_related_contents(svn_revnum_t rev,
+                     apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents = svn_stringbuf_create_ensure(1500, pool);
+  apr_uint32_t seed = (apr_uint32_t)rev * 2654435761u;
+  apr_size_t i;
+
+  for (i = 0; i < 250; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(contents, (char)('a' + (seed >> 16) % 26));
+    }
+
+  for (i = 0; i < 1200; ++i)
+    {
+      apr_size_t v, s = 0;
+      for (v = i; v > 0; v /= 10)
+        s += v % 10;
+
+      svn_stringbuf_appendbyte(contents, (char)(s + ' '));
+    }
+
+  return contents->data;
+}
+
+static svn_error_t *
+pack_related_reps(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  apr_file_t *file;
+  apr_hash_t *containers;
+  const char *config = "\n[" CONFIG_SECTION_IO "]\n"
+                       CONFIG_OPTION_BLOCK_SIZE " = 1\n";
+  int version;
+  apr_pool_t *iterpool;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  /* Use small blocks such that the versions of "file" need to be spread
+   * over several reps containers. */
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, iterpool));
+  svn_pool_clear(iterpool);
+
+  SVN_ERR(svn_io_read_version_file(&version,
+                                   svn_dirent_join(REPO_NAME, "format",
+                                                   pool),
+                                   pool));
+  SVN_ERR(write_format(REPO_NAME, version, SHARD_SIZE, pool));
+  SVN_ERR(svn_io_file_open(&file, svn_dirent_join(REPO_NAME, PATH_CONFIG,
+                                                  pool),
+                           APR_WRITE | APR_APPEND, APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_write_full(file, config, strlen(config), NULL, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* Modify the same file in every revision. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = 0; rev < MAX_REV; )
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      if (rev == 0)
+        SVN_ERR(svn_fs_make_file(root, "file", iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "file",
+                                          get_related_contents(rev + 1,
+                                                               iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+      SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+    }
+
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+
+  /* Read all versions back.  Use a separate cache namespace to make sure
+   * we reconstruct them from the pack file. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  containers = apr_hash_make(pool);
+  for (rev = 1; rev < SHARD_SIZE; ++rev)
+    {
+      svn_stringbuf_t *contents;
+      dag_node_t *node;
+      svn_fs_x__noderev_t *noderev;
+      svn_fs_x__revision_file_t *rev_file;
+      apr_off_t *offset = apr_palloc(pool, sizeof(*offset));
+      apr_uint32_t sub_item;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(root, "file", &contents, iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             get_related_contents(rev, iterpool));
+
+      /* Find the container holding this version. */
+      SVN_ERR(svn_fs_x__get_dag_node(&node, root, "file", iterpool,
+                                     iterpool));
+      SVN_ERR(svn_fs_x__get_node_revision(&noderev, fs,
+                                          svn_fs_x__dag_get_id(node),
+                                          iterpool, iterpool));
+      SVN_ERR(svn_fs_x__rev_file_init(&rev_file, fs, rev, iterpool));
+      SVN_ERR(svn_fs_x__item_offset(offset, &sub_item, fs, rev_file,
+                                    &noderev->data_rep->id, iterpool));
+      SVN_ERR(svn_fs_x__close_revision_file(rev_file));
+      apr_hash_set(containers, offset, sizeof(*offset), offset);
+    }
+
+  /* The node must actually span multiple containers. */
+  SVN_TEST_ASSERT(apr_hash_count(containers) > 1);
+  SVN_TEST_ASSERT(apr_hash_count(containers) < SHARD_SIZE - 1);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
 /* ------------------------------------------------------------------------ */
 #define REPO_NAME "test-repo-fsx-pack-shard-size-one"
 #define SHARD_SIZE 1
@@ -851,7 +1111,7 @@ test_batch_fsync(const svn_test_opts_t *opts,
                  apr_pool_t *pool)
 {
   const char *abspath;
-  svn_fs_x__batch_fsync_t *batch;
+  svn_fs__batch_fsync_t *batch;
   int i;
 
   /* Disable this test for non FSX backends because it has no relevance to
@@ -870,13 +1130,13 @@ test_batch_fsync(const svn_test_opts_t *opts,
 
   /* Initialize infrastructure with a pool that lives as long as this
    * application. */
-  SVN_ERR(svn_fs_x__batch_fsync_init(pool));
+  SVN_ERR(svn_fs__batch_fsync_init(pool));
 
   /* We use and re-use the same batch object throughout this test. */
-  SVN_ERR(svn_fs_x__batch_fsync_create(&batch, TRUE, pool));
+  SVN_ERR(svn_fs__batch_fsync_create(&batch, TRUE, pool));
 
   /* The working directory is new. */
-  SVN_ERR(svn_fs_x__batch_fsync_new_path(batch, abspath, pool));
+  SVN_ERR(svn_fs__batch_fsync_new_path(batch, abspath, pool));
 
   /* 1st run: Has to fire up worker threads etc. */
   for (i = 0; i < 10; ++i)
@@ -887,12 +1147,12 @@ test_batch_fsync(const svn_test_opts_t *opts,
                                          pool);
       apr_size_t len = strlen(path);
 
-      SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, path, pool));
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, path, pool));
 
       SVN_ERR(svn_io_file_write(file, path, &len, pool));
     }
 
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, pool));
+  SVN_ERR(svn_fs__batch_fsync_run(batch, pool));
 
   /* 2nd run: Running a batch must leave the container in an empty,
    * re-usable state. Hence, try to re-use it. */
@@ -904,12 +1164,12 @@ test_batch_fsync(const svn_test_opts_t *opts,
                                          pool);
       apr_size_t len = strlen(path);
 
-      SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, path, pool));
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, path, pool));
 
       SVN_ERR(svn_io_file_write(file, path, &len, pool));
     }
 
-  SVN_ERR(svn_fs_x__batch_fsync_run(batch, pool));
+  SVN_ERR(svn_fs__batch_fsync_run(batch, pool));
 
   /* 3rd run: Schedule but don't execute. POOL cleanup shall not fail. */
   for (i = 0; i < 10; ++i)
@@ -920,7 +1180,7 @@ test_batch_fsync(const svn_test_opts_t *opts,
                                          pool);
       apr_size_t len = strlen(path);
 
-      SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, path, pool));
+      SVN_ERR(svn_fs__batch_fsync_open_file(&file, batch, path, pool));
 
       SVN_ERR(svn_io_file_write(file, path, &len, pool));
     }
@@ -930,6 +1190,295 @@ test_batch_fsync(const svn_test_opts_t *opts,
 #undef REPO_NAME
 /* ------------------------------------------------------------------------ */
 
+#define REPO_NAME "test-repo-fsx-incremental-dir"
+static svn_error_t *
+incremental_txn_dir(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  apr_hash_t *entries;
+  const char *txn_name;
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  /* r1: a directory with 20 files. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "dir", pool));
+  for (i = 0; i < 20; ++i)
+    SVN_ERR(svn_fs_make_file(root, apr_psprintf(pool, "dir/f%02d", i),
+                             pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+
+  /* Modify the directory such that its in-txn representation contains
+   * additions, deletions and replacements in non-sorted order. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "dir/g", pool));
+  SVN_ERR(svn_fs_delete(root, "dir/f05", pool));
+  SVN_ERR(svn_fs_make_file(root, "dir/a", pool));
+  SVN_ERR(svn_fs_delete(root, "dir/f10", pool));
+  SVN_ERR(svn_fs_make_dir(root, "dir/f10", pool));
+  SVN_ERR(svn_fs_delete(root, "dir/f19", pool));
+  SVN_ERR(svn_fs_make_file(root, "dir/h", pool));
+  SVN_ERR(svn_fs_delete(root, "dir/h", pool));
+  SVN_ERR(svn_fs_txn_name(&txn_name, txn, pool));
+
+  /* Use a separate cache namespace to make sure we parse the in-txn
+   * directory representation instead of using cached data. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_open_txn(&txn, fs, txn_name, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+
+  SVN_ERR(svn_fs_dir_entries(&entries, root, "dir", pool));
+  SVN_TEST_ASSERT(apr_hash_count(entries) == 20);
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "a"));
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "g"));
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "f00"));
+  SVN_TEST_ASSERT(!svn_hash_gets(entries, "f05"));
+  SVN_TEST_ASSERT(!svn_hash_gets(entries, "f19"));
+  SVN_TEST_ASSERT(!svn_hash_gets(entries, "h"));
+  SVN_TEST_ASSERT(((svn_fs_dirent_t *)svn_hash_gets(entries, "f10"))->kind
+                  == svn_node_dir);
+
+  /* The committed directory must match. */
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_dir_entries(&entries, root, "dir", pool));
+  SVN_TEST_ASSERT(apr_hash_count(entries) == 20);
+  SVN_TEST_ASSERT(!svn_hash_gets(entries, "f05"));
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "a"));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-fsx-pack-small-stage"
+#define SHARD_SIZE 4
+#define MAX_REV 4
+
+/* Return poorly compressible contents for "file" in revision REV. */
+static const char *
+get_large_contents(svn_revnum_t rev,
+                   apr_pool_t *pool)
+{
+  apr_size_t len = 40000 + (apr_size_t)rev * 1000;
+  svn_stringbuf_t *contents = svn_stringbuf_create_ensure(len, pool);
+  apr_uint32_t seed = (apr_uint32_t)rev;
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(contents, (char)(1 + (seed >> 16) % 255));
+    }
+
+  return contents->data;
+}
+
+static svn_error_t *
+pack_small_stage(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  int version;
+  apr_pool_t *iterpool;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, iterpool));
+  svn_pool_clear(iterpool);
+
+  SVN_ERR(svn_io_read_version_file(&version,
+                                   svn_dirent_join(REPO_NAME, "format",
+                                                   pool),
+                                   pool));
+  SVN_ERR(write_format(REPO_NAME, version, SHARD_SIZE, pool));
+
+  /* Replace the file contents in every revision such that the staged
+   * reps add up to more than a single staging block. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = 0; rev < MAX_REV; )
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      if (rev == 0)
+        SVN_ERR(svn_fs_make_file(root, "file", iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "file",
+                                          get_large_contents(rev + 1,
+                                                             iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+      SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+    }
+
+  /* Allow for a single in-memory staging block.  All further item data
+   * gets spilled to disk and some items straddle that boundary. */
+  SVN_ERR(svn_fs_x__pack(fs, 2 * 64 * 1024, NULL, NULL, NULL, NULL, pool));
+
+  /* Read all versions back.  Use a separate cache namespace to make sure
+   * we read them from the pack file. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_TEST_ASSERT(rev == MAX_REV);
+
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(svn_test__get_file_contents(root, "file", &contents, iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data,
+                             get_large_contents(rev, iterpool));
+    }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, fs_config, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-fsx-index-page-checksum"
+
+/* Return TRUE if any error in the chain ERR has the error code APR_ERR
+ * and a message containing PATTERN. */
+static svn_boolean_t
+error_chain_contains(svn_error_t *err,
+                     apr_status_t apr_err,
+                     const char *pattern)
+{
+  for (; err; err = err->child)
+    if (   err->apr_err == apr_err
+        && err->message
+        && strstr(err->message, pattern))
+      return TRUE;
+
+  return FALSE;
+}
+
+static svn_error_t *
+index_page_checksum(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_fs_x__revision_file_t *rev_file;
+  svn_fs_x__index_info_t p2l_index_info;
+  apr_array_header_t *entries;
+  apr_hash_t *fs_config;
+  const char *path;
+  apr_file_t *file;
+  apr_off_t offset;
+  char c;
+  svn_error_t *err;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  /* r1: the greek tree. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+
+  /* Locate the P2L index within the revision file. */
+  SVN_ERR(svn_fs_x__rev_file_init(&rev_file, fs, rev, pool));
+  SVN_ERR(svn_fs_x__rev_file_p2l_info(&p2l_index_info, rev_file));
+  SVN_ERR(svn_fs_x__close_revision_file(rev_file));
+
+  /* Flip the lowest bit in the last byte of the last P2L index page.
+   * That keeps the number encoding intact but changes the contents. */
+  path = svn_fs_x__path_rev(fs, rev, pool);
+  SVN_ERR(svn_io_set_file_read_write(path, FALSE, pool));
+  SVN_ERR(svn_io_file_open(&file, path, APR_READ | APR_WRITE,
+                           APR_OS_DEFAULT, pool));
+  offset = p2l_index_info.end - 1;
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+  SVN_ERR(svn_io_file_getc(&c, file, pool));
+  c ^= 1;
+  offset = p2l_index_info.end - 1;
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+  SVN_ERR(svn_io_file_putc(c, file, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  /* Regular index lookups must detect the damage while decoding the page.
+   * Use a separate cache namespace to make sure we read the damaged data.
+   * Parser errors would not mention the page. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_x__rev_file_init(&rev_file, fs, rev, pool));
+  SVN_ERR(svn_fs_x__p2l_get_max_offset(&offset, fs, rev_file, rev, pool));
+  err = svn_fs_x__p2l_index_lookup(&entries, fs, rev_file, rev, 0, offset,
+                                   pool, pool);
+  SVN_TEST_ASSERT(err);
+  SVN_TEST_ASSERT(error_chain_contains(err, SVN_ERR_FS_INDEX_CORRUPTION,
+                                       "P2L index page at offset"));
+  svn_error_clear(err);
+  SVN_ERR(svn_fs_x__close_revision_file(rev_file));
+
+  /* Verification must detect the damage and attribute it to the index
+   * page in addition to reporting the index checksum mismatch. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  err = svn_fs_verify(REPO_NAME, fs_config, 0, rev, NULL, NULL, NULL, NULL,
+                      pool);
+  SVN_TEST_ASSERT(err);
+  SVN_TEST_ASSERT(error_chain_contains(err, SVN_ERR_FS_INDEX_CORRUPTION,
+                                       "P2L index page at offset"));
+  SVN_TEST_ASSERT(error_chain_contains(err, SVN_ERR_CHECKSUM_MISMATCH,
+                                       "P2L index checksum mismatch"));
+  svn_error_clear(err);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+/* ------------------------------------------------------------------------ */
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -959,10 +1508,20 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test svn_fs_info"),
     SVN_TEST_OPTS_PASS(test_reps,
                        "test representations container"),
+    SVN_TEST_OPTS_PASS(test_reps_with_base,
+                       "test representations container with base rep"),
+    SVN_TEST_OPTS_PASS(pack_related_reps,
+                       "pack versions of a node into related containers"),
     SVN_TEST_OPTS_PASS(pack_shard_size_one,
                        "test packing with shard size = 1"),
     SVN_TEST_OPTS_PASS(test_batch_fsync,
                        "test batch fsync"),
+    SVN_TEST_OPTS_PASS(incremental_txn_dir,
+                       "read incrementally modified txn directories"),
+    SVN_TEST_OPTS_PASS(pack_small_stage,
+                       "pack FSX with a spilling staging area"),
+    SVN_TEST_OPTS_PASS(index_page_checksum,
+                       "detect damaged FSX index pages"),
     SVN_TEST_NULL
   };
 
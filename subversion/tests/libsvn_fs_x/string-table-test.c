@@ -286,6 +286,64 @@ store_load_many_strings_table(apr_pool_t *pool)
   return svn_error_trace(many_strings_table_body(TRUE, pool));
 }
 
+/* Build a table from many path-like strings with long common prefixes,
+ * as they are typical for noderev and change containers, and read them
+ * back.  In verbose mode, report the build and lookup rates. */
+static svn_error_t *
+string_table_throughput(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  enum { COUNT = 50000, LOOKUP_ROUNDS = 10 };
+
+  const char **strings = apr_palloc(pool, COUNT * sizeof(*strings));
+  apr_size_t *indexes = apr_palloc(pool, COUNT * sizeof(*indexes));
+  string_table_builder_t *builder;
+  string_table_t *table;
+  apr_time_t start, built, looked_up;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i, k;
+
+  for (i = 0; i < COUNT; ++i)
+    strings[i] = apr_psprintf(pool,
+                              "/trunk/subversion/libsvn_%s/sub%03d/file%d.c",
+                              basic_strings[i % STRING_COUNT],
+                              (i * 7) % 101, i % 997);
+
+  start = apr_time_now();
+
+  builder = svn_fs_x__string_table_builder_create(pool);
+  for (i = 0; i < COUNT; ++i)
+    indexes[i] = svn_fs_x__string_table_builder_add(builder, strings[i], 0);
+  table = svn_fs_x__string_table_create(builder, pool);
+
+  built = apr_time_now();
+
+  for (k = 0; k < LOOKUP_ROUNDS; ++k)
+    {
+      svn_pool_clear(iterpool);
+      for (i = 0; i < COUNT; ++i)
+        {
+          apr_size_t len;
+          const char *string
+            = svn_fs_x__string_table_get(table, indexes[i], &len, iterpool);
+
+          SVN_TEST_STRING_ASSERT(string, strings[i]);
+          SVN_TEST_ASSERT(len == strlen(strings[i]));
+        }
+    }
+
+  looked_up = apr_time_now();
+  svn_pool_destroy(iterpool);
+
+  if (opts->verbose)
+    printf("built %d strings in %" APR_TIME_T_FMT " usec, "
+           "%d lookups in %" APR_TIME_T_FMT " usec\n",
+           COUNT, built - start,
+           COUNT * LOOKUP_ROUNDS, looked_up - built);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* ------------------------------------------------------------------------ */
 
@@ -312,6 +370,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "store and load table with large strings only"),
     SVN_TEST_PASS2(store_load_many_strings_table,
                    "store and load string table with many strings"),
+    SVN_TEST_OPTS_PASS(string_table_throughput,
+                       "string table build and lookup throughput"),
     SVN_TEST_NULL
   };
 
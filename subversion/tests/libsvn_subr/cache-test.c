@@ -27,6 +27,8 @@
 #include <apr_lib.h>
 #include <apr_time.h>
 
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
 #include "svn_pools.h"
 
 #include "private/svn_cache.h"
@@ -591,6 +593,192 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
 }
 
 
+static svn_error_t *
+test_persistent_cache_basic(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  const char *cache_dir;
+  svn_boolean_t found;
+  svn_revnum_t *answer;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_test_make_sandbox_dir(&cache_dir, "persistent-cache-test",
+                                    pool));
+
+  /* Without a first-level cache, all data comes from disk or from the
+     entries that are still waiting to be written. */
+  SVN_ERR(svn_cache__create_persistent(&cache,
+                                       NULL,
+                                       cache_dir,
+                                       1024 * 1024,
+                                       serialize_revnum,
+                                       deserialize_revnum,
+                                       APR_HASH_KEY_STRING,
+                                       "cache:",
+                                       subpool, pool));
+
+  SVN_ERR(basic_cache_test(cache, FALSE, subpool));
+
+  /* Make sure everything has been written to disk. */
+  svn_pool_destroy(subpool);
+
+  /* A new cache instance, e.g. after a restart, sees the same data. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+  SVN_ERR(svn_cache__create_persistent(&cache,
+                                       cache,
+                                       cache_dir,
+                                       1024 * 1024,
+                                       serialize_revnum,
+                                       deserialize_revnum,
+                                       APR_HASH_KEY_STRING,
+                                       "cache:",
+                                       pool, pool));
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "thirty", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(*answer == 30);
+
+  /* Entries of other caches in the same directory don't match. */
+  SVN_ERR(svn_cache__create_persistent(&cache,
+                                       NULL,
+                                       cache_dir,
+                                       1024 * 1024,
+                                       serialize_revnum,
+                                       deserialize_revnum,
+                                       APR_HASH_KEY_STRING,
+                                       "other:",
+                                       pool, pool));
+
+  SVN_ERR(svn_cache__get((void **) &answer, &found, cache, "thirty", pool));
+  SVN_TEST_ASSERT(!found);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__partial_getter_func_t for stringbuf values.
+ * Like the FSFS fulltext getter, return the stored string without its
+ * terminating NUL. */
+static svn_error_t *
+get_stringbuf_partial(void **out,
+                      const void *data,
+                      apr_size_t data_len,
+                      void *baton,
+                      apr_pool_t *result_pool)
+{
+  SVN_ERR_ASSERT(data_len > 0);
+  *out = svn_stringbuf_ncreate(data, data_len - 1, result_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Truncate every slot file under the persistent cache DIRECTORY by one
+ * byte, as a crash during a write might have done. */
+static svn_error_t *
+truncate_slot_files(const char *directory,
+                    apr_pool_t *pool)
+{
+  apr_hash_t *dirs;
+  apr_hash_index_t *hi;
+
+  SVN_ERR(svn_io_get_dirents3(&dirs, directory, TRUE, pool, pool));
+  for (hi = apr_hash_first(pool, dirs); hi; hi = apr_hash_next(hi))
+    {
+      const char *dir = svn_dirent_join(directory, apr_hash_this_key(hi),
+                                        pool);
+      apr_hash_t *files;
+      apr_hash_index_t *fi;
+
+      SVN_ERR(svn_io_get_dirents3(&files, dir, TRUE, pool, pool));
+      for (fi = apr_hash_first(pool, files); fi; fi = apr_hash_next(fi))
+        {
+          const char *path = svn_dirent_join(dir, apr_hash_this_key(fi),
+                                             pool);
+          svn_stringbuf_t *contents;
+
+          SVN_ERR(svn_stringbuf_from_file2(&contents, path, pool));
+          SVN_ERR(svn_io_write_atomic2(path, contents->data,
+                                       contents->len - 1, NULL, FALSE,
+                                       pool));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_persistent_cache_stringbuf(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  const char *cache_dir;
+  svn_boolean_t found;
+  svn_stringbuf_t *value;
+  apr_pool_t *subpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_test_make_sandbox_dir(&cache_dir,
+                                    "persistent-cache-stringbuf-test",
+                                    pool));
+
+  /* Without a serializer, the values are stringbufs. */
+  SVN_ERR(svn_cache__create_persistent(&cache, NULL, cache_dir,
+                                       1024 * 1024, NULL, NULL,
+                                       APR_HASH_KEY_STRING, "text:",
+                                       subpool, pool));
+  SVN_ERR(svn_cache__set(cache, "full",
+                         svn_stringbuf_create("fulltext", subpool),
+                         subpool));
+  SVN_ERR(svn_cache__set(cache, "empty",
+                         svn_stringbuf_create_empty(subpool), subpool));
+
+  /* Make sure everything has been written to disk. */
+  svn_pool_destroy(subpool);
+
+  /* Read it back through a new instance.  Neither the partial nor the
+     full getter may lose or add any bytes. */
+  SVN_ERR(svn_cache__create_persistent(&cache, NULL, cache_dir,
+                                       1024 * 1024, NULL, NULL,
+                                       APR_HASH_KEY_STRING, "text:",
+                                       pool, pool));
+
+  SVN_ERR(svn_cache__get_partial((void **)&value, &found, cache, "full",
+                                 get_stringbuf_partial, NULL, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_STRING_ASSERT(value->data, "fulltext");
+
+  SVN_ERR(svn_cache__get_partial((void **)&value, &found, cache, "empty",
+                                 get_stringbuf_partial, NULL, pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(value->len == 0);
+
+  SVN_ERR(svn_cache__get((void **)&value, &found, cache, "full", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(value->len == strlen("fulltext"));
+  SVN_TEST_STRING_ASSERT(value->data, "fulltext");
+
+  /* Damaged slot files are misses. */
+  SVN_ERR(truncate_slot_files(cache_dir, pool));
+
+  SVN_ERR(svn_cache__get((void **)&value, &found, cache, "full", pool));
+  SVN_TEST_ASSERT(!found);
+  SVN_ERR(svn_cache__get_partial((void **)&value, &found, cache, "empty",
+                                 get_stringbuf_partial, NULL, pool));
+  SVN_TEST_ASSERT(!found);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -616,6 +804,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_PASS2(test_persistent_cache_basic,
+                   "basic persistent svn_cache test"),
+    SVN_TEST_PASS2(test_persistent_cache_stringbuf,
+                   "persistent svn_cache with stringbuf values"),
     SVN_TEST_NULL
   };
 
@@ -170,6 +170,50 @@ test_sqlite_txn_commit_busy(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_sqlite_mmap(apr_pool_t *pool)
+{
+  svn_sqlite__db_t *sdb1, *sdb2;
+  const char *db_abspath;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  static const char *const statements[] = {
+    "CREATE TABLE mmap ("
+    "    one INTEGER NOT NULL PRIMARY KEY"
+    ");"
+    "INSERT INTO mmap(one) VALUES (1);",
+
+    "INSERT INTO mmap(one) VALUES (2);",
+
+    "SELECT COUNT(*) FROM mmap",
+
+    NULL
+  };
+
+  /* A mapped connection writing to the database. */
+  SVN_ERR(open_db(&sdb1, &db_abspath, "mmap", statements, 0, pool));
+  SVN_ERR(svn_sqlite__enable_mmap(sdb1));
+  SVN_ERR(svn_sqlite__exec_statements(sdb1, 0));
+
+  /* An unmapped connection sees the data and adds to it. */
+  SVN_ERR(svn_sqlite__open(&sdb2, db_abspath, svn_sqlite__mode_readwrite,
+                           statements, 0, NULL, 0, pool, pool));
+  SVN_ERR(svn_sqlite__exec_statements(sdb2, 1));
+
+  /* The mapped connection sees the change. */
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb1, 2));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  SVN_TEST_ASSERT(have_row);
+  SVN_TEST_ASSERT(svn_sqlite__column_int(stmt, 0) == 2);
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  SVN_ERR(svn_sqlite__close(sdb2));
+  SVN_ERR(svn_sqlite__close(sdb1));
+
+  return SVN_NO_ERROR;
+}
+
 
 static int max_threads = 1;
 
@@ -180,6 +224,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "sqlite reset"),
     SVN_TEST_PASS2(test_sqlite_txn_commit_busy,
                    "sqlite busy on transaction commit"),
+    SVN_TEST_PASS2(test_sqlite_mmap,
+                   "sqlite with memory mapped database pages"),
     SVN_TEST_NULL
   };
 
@@ -493,6 +493,127 @@ test_internal_file_modified(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Number of files in the directory used by the status tests below.  It
+ * is large enough to make the status walker stat files concurrently. */
+#define STATUS_TEST_FILE_COUNT 300
+
+/* Create a working copy in B with directory A containing
+ * STATUS_TEST_FILE_COUNT files A/f000, A/f001 etc. and commit it. */
+static svn_error_t *
+create_large_dir_wc(svn_test__sandbox_t *b,
+                    const char *name,
+                    const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_ERR(svn_test__sandbox_create(b, name, opts, pool));
+  SVN_ERR(sbox_wc_mkdir(b, "A"));
+  for (i = 0; i < STATUS_TEST_FILE_COUNT; ++i)
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "A/f%03d", i);
+      SVN_ERR(sbox_file_write(b, path, "initial\n"));
+      SVN_ERR(sbox_wc_add(b, path));
+    }
+  svn_pool_destroy(iterpool);
+  SVN_ERR(sbox_wc_commit(b, ""));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_wc_status_func4_t.  BATON is an int array indexed by
+ * svn_wc_status_kind.  Count the node status of LOCAL_ABSPATH in it. */
+static svn_error_t *
+count_node_status(void *baton,
+                  const char *local_abspath,
+                  const svn_wc_status3_t *status,
+                  apr_pool_t *scratch_pool)
+{
+  int *counts = baton;
+  counts[status->node_status]++;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_status_large_dir(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  int counts[svn_wc_status_incomplete + 1] = { 0 };
+
+  SVN_ERR(create_large_dir_wc(&b, "status_large_dir", opts, pool));
+  SVN_ERR(sbox_file_write(&b, "A/f007", "modified content\n"));
+  SVN_ERR(sbox_file_write(&b, "A/f123", "modified content\n"));
+  SVN_ERR(svn_io_remove_file2(sbox_wc_path(&b, "A/f042"), FALSE, pool));
+  SVN_ERR(sbox_file_write(&b, "A/new", "unversioned\n"));
+
+  SVN_ERR(svn_wc_walk_status(b.wc_ctx, sbox_wc_path(&b, "A"),
+                             svn_depth_infinity,
+                             TRUE /* get_all */,
+                             FALSE /* no_ignore */,
+                             FALSE /* ignore_text_mods */,
+                             NULL /* ignore_patterns */,
+                             count_node_status, counts,
+                             NULL, NULL, pool));
+
+  SVN_TEST_INT_ASSERT(counts[svn_wc_status_modified], 2);
+  SVN_TEST_INT_ASSERT(counts[svn_wc_status_missing], 1);
+  SVN_TEST_INT_ASSERT(counts[svn_wc_status_unversioned], 1);
+  /* A itself plus all untouched files */
+  SVN_TEST_INT_ASSERT(counts[svn_wc_status_normal],
+                      STATUS_TEST_FILE_COUNT - 3 + 1);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_local_mods_ignore_unversioned(const svn_test_opts_t *opts,
+                                   apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_boolean_t modified;
+
+  SVN_ERR(create_large_dir_wc(&b, "local_mods_ignore_unversioned", opts,
+                              pool));
+  SVN_ERR(sbox_file_write(&b, "A/new", "unversioned\n"));
+  SVN_ERR(sbox_disk_mkdir(&b, "A/build"));
+  SVN_ERR(sbox_file_write(&b, "A/build/output", "unversioned\n"));
+
+  /* Unversioned nodes only count if we ask for them. */
+  SVN_ERR(svn_wc__node_has_local_mods(&modified, NULL, b.wc_ctx->db,
+                                      sbox_wc_path(&b, "A"), TRUE,
+                                      NULL, NULL, pool));
+  SVN_TEST_ASSERT(!modified);
+  SVN_ERR(svn_wc__node_has_local_mods(&modified, NULL, b.wc_ctx->db,
+                                      sbox_wc_path(&b, "A"), FALSE,
+                                      NULL, NULL, pool));
+  SVN_TEST_ASSERT(modified);
+
+  /* A file that only exists with a different case is missing, even on
+   * case-insensitive file systems. */
+  SVN_ERR(svn_io_file_rename2(sbox_wc_path(&b, "A/f100"),
+                              sbox_wc_path(&b, "A/F100"), FALSE, pool));
+  SVN_ERR(svn_wc__node_has_local_mods(&modified, NULL, b.wc_ctx->db,
+                                      sbox_wc_path(&b, "A"), TRUE,
+                                      NULL, NULL, pool));
+  SVN_TEST_ASSERT(modified);
+
+  /* Text modifications are found as well. */
+  SVN_ERR(svn_io_file_rename2(sbox_wc_path(&b, "A/F100"),
+                              sbox_wc_path(&b, "A/f100"), FALSE, pool));
+  SVN_ERR(sbox_file_write(&b, "A/f007", "modified content\n"));
+  SVN_ERR(svn_wc__node_has_local_mods(&modified, NULL, b.wc_ctx->db,
+                                      sbox_wc_path(&b, "A"), TRUE,
+                                      NULL, NULL, pool));
+  SVN_TEST_ASSERT(modified);
+
+  return SVN_NO_ERROR;
+}
+
 /* ---------------------------------------------------------------------- */
 /* The list of test functions */
 
@@ -515,6 +636,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test legacy commit2"),
     SVN_TEST_OPTS_PASS(test_internal_file_modified,
                        "test internal_file_modified"),
+    SVN_TEST_OPTS_PASS(test_status_large_dir,
+                       "status of a directory with many files"),
+    SVN_TEST_OPTS_PASS(test_local_mods_ignore_unversioned,
+                       "local mods check ignoring unversioned nodes"),
     SVN_TEST_NULL
   };
 
@@ -0,0 +1,89 @@
+#!/bin/bash
+
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# usage: pack_mmap.sh REPO
+#
+# Compare read performance on the packed FSFS repository REPO with and
+# without memory-mapped pack files ([io] max-mapped-pack-files in
+# fsfs.conf).  Every reader runs with a disabled membuffer cache such that
+# all data has to come from the pack files.
+#
+# Cold runs require root privileges to drop the OS file cache.  Set COLD
+# to an empty string to skip them.  fsfs.conf will be restored at the end.
+
+REPO="$1"
+if [ ! -f "${REPO}/db/fsfs.conf" ] ; then
+  echo "usage: $0 REPO"
+  exit 1
+fi
+
+# set SVNPATH to the 'subversion' folder of your SVN source code w/c
+
+SVNPATH="$('pwd')/subversion"
+
+SVNADMIN=${SVNPATH}/svnadmin/svnadmin
+SVNLOOK=${SVNPATH}/svnlook/svnlook
+
+# number of pack files to keep mapped when mapping is enabled
+
+MAPPED=64
+COLD=yes
+
+# from here on, we should be good
+
+TIMEFORMAT='%3R  %3U  %3S'
+CONF="${REPO}/db/fsfs.conf"
+cp "${CONF}" "${CONF}.orig"
+
+set_mapped_files ()
+{
+  cp "${CONF}.orig" "${CONF}"
+  printf '[io]\nmax-mapped-pack-files = %s\n' "$1" >> "${CONF}"
+}
+
+drop_caches ()
+{
+  if [ "${COLD}" != "" ] ; then
+    sync
+    echo 3 > /proc/sys/vm/drop_caches
+  fi
+}
+
+run ()
+{
+  printf '%-28s' "$1"
+  shift
+  time "$@" > /dev/null
+}
+
+echo "Test                        real   user   sys"
+
+for files in 0 ${MAPPED} ; do
+  set_mapped_files ${files}
+
+  drop_caches
+  run "dump, cold, mapped=${files}" ${SVNADMIN} dump -q -M 0 "${REPO}"
+  run "dump, warm, mapped=${files}" ${SVNADMIN} dump -q -M 0 "${REPO}"
+
+  drop_caches
+  run "tree, cold, mapped=${files}" ${SVNLOOK} tree -M 0 --full-paths "${REPO}"
+  run "tree, warm, mapped=${files}" ${SVNLOOK} tree -M 0 --full-paths "${REPO}"
+done
+
+mv "${CONF}.orig" "${CONF}"
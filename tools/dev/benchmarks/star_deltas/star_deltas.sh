@@ -0,0 +1,106 @@
+#!/bin/bash
+
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# usage: run this script from the root of your working copy
+#        and / or adjust the path settings below as needed
+#
+# Compare reading old file revisions from packed FSFS and FSX repositories
+# holding the same history.  FSFS has to walk delta chains whose length
+# grows with the file's history while FSX star-delta containers need at
+# most one delta hop.  Every read runs in a new process, i.e. with cold
+# caches.
+#
+# The script creates a single file with REVCOUNT revisions in an FSFS
+# repository, loads the same history into an FSX repository, packs both
+# and reports repository sizes and the time taken to read every EVERY-th
+# revision of the file.
+
+# set SVNPATH to the 'subversion' folder of your SVN source code w/c
+
+SVNPATH="$('pwd')/subversion"
+
+SVNADMIN=${SVNPATH}/svnadmin/svnadmin
+SVNLOOK=${SVNPATH}/svnlook/svnlook
+SVNMUCC=${SVNPATH}/svnmucc/svnmucc
+
+# set your data paths here
+
+REPOROOT=/dev/shm/star_deltas
+
+# number of revisions to create and read sampling interval
+
+REVCOUNT=2000
+EVERY=50
+
+# from here on, we should be good
+
+TIMEFORMAT='%3R  %3U  %3S'
+FSFS=${REPOROOT}/fsfs
+FSX=${REPOROOT}/fsx
+FILE=${REPOROOT}/file.txt
+
+rm -rf "${REPOROOT}"
+mkdir -p "${REPOROOT}"
+
+${SVNADMIN} create --fs-type fsfs "${FSFS}"
+${SVNADMIN} create --fs-type fsx "${FSX}"
+
+# Each revision changes a few lines in a ~30kB file.
+
+i=0
+: > "${FILE}"
+while [ $i -lt 1000 ] ; do
+  echo "line $i of the original file contents" >> "${FILE}"
+  i=$((i + 1))
+done
+
+rev=1
+while [ $rev -le ${REVCOUNT} ] ; do
+  sed "s/^line $((rev % 1000)) .*/line $((rev % 1000)) changed in r$rev/" \
+      "${FILE}" > "${FILE}.tmp"
+  mv "${FILE}.tmp" "${FILE}"
+  ${SVNMUCC} -m "r$rev" put "${FILE}" "file://${FSFS}/file.txt" > /dev/null
+  rev=$((rev + 1))
+done
+
+${SVNADMIN} dump -q "${FSFS}" | ${SVNADMIN} load -q "${FSX}"
+
+${SVNADMIN} pack -q "${FSFS}"
+${SVNADMIN} pack -q "${FSX}"
+
+echo "Repository sizes:"
+du -sh "${FSFS}/db" "${FSX}/db"
+echo
+
+read_revisions ()
+{
+  rev=${EVERY}
+  while [ $rev -le ${REVCOUNT} ] ; do
+    ${SVNLOOK} cat -r $rev "$1" file.txt > /dev/null
+    rev=$((rev + ${EVERY}))
+  done
+}
+
+echo "Test                        real   user   sys"
+
+printf '%-28s' "read old revisions, FSFS"
+time read_revisions "${FSFS}"
+
+printf '%-28s' "read old revisions, FSX"
+time read_revisions "${FSX}"